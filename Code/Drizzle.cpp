@@ -19,15 +19,36 @@
 #include "RasterElement.h"
 #include "Drizzle.h"
 #include "DesktopServices.h"
+#include "DrizzleAccumulator.h"
+#include "DrizzleImageJob.h"
+#include "DrizzleJobManager.h"
+#include "DrizzleMergeJob.h"
+#include "DrizzleOperator.h"
+#include "DrizzleOperatorJob.h"
+#include "DrizzleQueue_GUI.h"
+#include "DrizzleStreamJob.h"
+#include "DrizzleTuneJob.h"
+#include "DrizzleTuner.h"
+#include "GcpList.h"
 #include "ModelServices.h"
 #include "Progress.h"
+#include "ProgressResource.h"
+#include "RasterDataDescriptor.h"
+#include "SessionItemDeserializer.h"
 #include "SessionItemSerializer.h"
 #include "hdf5.h"
 
 #include <Qt\qapplication.h>
+#include <Qt\qfiledialog.h>
 #include <Qt\qmessagebox.h>
+#include <Qt\qfileinfo.h>
+#include <Qt\qinputdialog.h>
+#include <Qt\qdir.h>
+#include <Qt\qfile.h>
 #include <Qt\qlayout.h>
 
+#include <memory>
+
 REGISTER_PLUGIN_BASIC(ImageEnhancement, Drizzle);
 
 Drizzle::Drizzle() : gui(NULL)
@@ -48,6 +69,7 @@ Drizzle::Drizzle() : gui(NULL)
 
 Drizzle::~Drizzle()
 {
+   DrizzleJobManager::instance()->releaseSessionOwner(this);
 }
 
 bool Drizzle::getInputSpecification(PlugInArgList*& pInArgList)
@@ -78,6 +100,21 @@ bool Drizzle::openGUI()
 	QPushButton* Video = new QPushButton( "videoButton", gui);
 	Video->setText("Drizzle video to image.");
 
+	QPushButton* Merge = new QPushButton( "mergeButton", gui);
+	Merge->setText("Merge partial results.");
+
+	QPushButton* Operator = new QPushButton( "operatorButton", gui);
+	Operator->setText("Apply drizzle geometry.");
+
+	QPushButton* Queue = new QPushButton( "queueButton", gui);
+	Queue->setText("Show job queue.");
+
+	QPushButton* Resume = new QPushButton( "resumeButton", gui);
+	Resume->setText("Resume from checkpoint.");
+
+	QPushButton* Tune = new QPushButton( "tuneButton", gui);
+	Tune->setText("Calibrate.");
+
 	QPushButton* Cancel = new QPushButton( "cancelButton", gui);
 	Cancel->setText("Cancel");
 
@@ -86,11 +123,21 @@ bool Drizzle::openGUI()
 	//LAYOUT
 	pLayout->addWidget(Image, 0, 0);
 	pLayout->addWidget(Video, 0, 1);
-	pLayout->addWidget(Cancel, 0, 2);
+	pLayout->addWidget(Merge, 0, 2);
+	pLayout->addWidget(Operator, 0, 3);
+	pLayout->addWidget(Queue, 0, 4);
+	pLayout->addWidget(Resume, 0, 5);
+	pLayout->addWidget(Tune, 0, 6);
+	pLayout->addWidget(Cancel, 0, 7);
 
 	//Make connections slots & signals
 	connect(Image, SIGNAL(clicked()), this, SLOT(imageGUI()));
 	connect(Video, SIGNAL(clicked()), this, SLOT(videoGUI()));
+	connect(Merge, SIGNAL(clicked()), this, SLOT(mergeGUI()));
+	connect(Operator, SIGNAL(clicked()), this, SLOT(operatorGUI()));
+	connect(Queue, SIGNAL(clicked()), this, SLOT(queueGUI()));
+	connect(Resume, SIGNAL(clicked()), this, SLOT(resumeGUI()));
+	connect(Tune, SIGNAL(clicked()), this, SLOT(tuneGUI()));
 	connect(Cancel, SIGNAL(clicked()), this, SLOT(closemainGUI()));
 	
 	gui->show();
@@ -138,11 +185,215 @@ void Drizzle::videoGUI()
 	pStep->finalize(Message::Success);
 }
 
+void Drizzle::mergeGUI()
+{
+	StepResource pStep( "Drizzle merge", "app", "5E0B7F0E-3F4C-4B5D-9E51-0C2C8A7D4F61" );
+	ProgressResource pProgress("ProgressBar");
+
+	//Select partial result files
+	QStringList filenames = QFileDialog::getOpenFileNames(gui, "Select partial results", QString(), "Drizzle partial results (*.drzp)");
+	if (filenames.isEmpty())
+	{
+		pStep->finalize(Message::Abort);
+		return;
+	}
+
+	//The output grid is read from the header of a partial result, the partial results are merged by the job
+	std::string error;
+	DrizzleGrid grid;
+	if (!DrizzleAccumulator::loadGrid(filenames[0].toStdString(), grid, error))
+	{
+		pProgress->updateProgress(error, 0, ERRORS);
+		pStep->finalize(Message::Failure, error);
+		return;
+	}
+	std::vector<std::string> files;
+	for (int i = 0; i < filenames.size(); ++i)
+	{
+		files.push_back(filenames[i].toStdString());
+	}
+
+	//Optionally keep the merged partial result so more partial results can be merged later
+	QString mergedFile = QFileDialog::getSaveFileName(gui, "Save merged partial result (optional)", QString(), "Drizzle partial results (*.drzp)");
+
+	//Create and georeference the output RasterElement
+	GcpList* pGcpList = NULL;
+	RasterElement* pResult = grid.createElement(QFileInfo(filenames[0]).baseName().toStdString() + "_Merged", pProgress.get(), &pGcpList, error);
+	if (pResult == NULL)
+	{
+		pProgress->updateProgress(error, 0, ERRORS);
+		pStep->finalize(Message::Failure, error);
+		return;
+	}
+
+	//The partial results are merged in the job manager, the GUI stays responsive
+	DrizzleMergeJob* pJob = new DrizzleMergeJob(pResult, pGcpList, new ProgressResource("ProgressBar"), grid, files, mergedFile.toStdString());
+	DrizzleJobManager::instance()->submit(pJob, QFileInfo(filenames[0]).baseName() + " (merge)");
+	pStep->finalize(Message::Success);
+	DrizzleQueue_GUI::showQueue();
+}
+
+void Drizzle::operatorGUI()
+{
+	StepResource pStep( "Drizzle geometry", "app", "8F3A2C61-4B7D-4E19-A5C0-6D2E9B1F7A43" );
+	ProgressResource pProgress("ProgressBar");
+
+	QString filename = QFileDialog::getOpenFileName(gui, "Select drizzle geometry", QString(), "Drizzle operators (*.drzw)");
+	if (filename.isEmpty())
+	{
+		pStep->finalize(Message::Abort);
+		return;
+	}
+
+	std::string error;
+	std::auto_ptr<DrizzleOperator> pOperator(DrizzleOperator::load(filename.toStdString(), error));
+	if (pOperator.get() == NULL)
+	{
+		pProgress->updateProgress(error, 0, ERRORS);
+		pStep->finalize(Message::Failure, error);
+		return;
+	}
+
+	//Select the data set replacing every recorded input, the recorded input itself is proposed
+	Service<ModelServices> pModel;
+	std::vector<std::string> names = pModel->getElementNames("RasterElement");
+	std::vector<RasterElement*> images;
+	for (unsigned int i = 0; i < pOperator->getInputCount(); ++i)
+	{
+		QStringList candidates;
+		int current = 0;
+		for (std::vector<std::string>::iterator it = names.begin(); it != names.end(); ++it)
+		{
+			RasterElement* pElement = dynamic_cast<RasterElement*>(pModel->getElement(*it, "", NULL));
+			const RasterDataDescriptor* pDesc = (pElement == NULL) ? NULL : static_cast<const RasterDataDescriptor*>(pElement->getDataDescriptor());
+			if (pDesc != NULL && pDesc->getRowCount() == pOperator->getInputRows(i) && pDesc->getColumnCount() == pOperator->getInputColumns(i))
+			{
+				if (*it == pOperator->getInputName(i))
+				{
+					current = candidates.size();
+				}
+				candidates << QString::fromStdString(*it);
+			}
+		}
+		if (candidates.isEmpty())
+		{
+			error = "No image has the size of input " + pOperator->getInputName(i) + ".";
+			pProgress->updateProgress(error, 0, ERRORS);
+			pStep->finalize(Message::Failure, error);
+			return;
+		}
+
+		bool ok = false;
+		QString name = QInputDialog::getItem(Service<DesktopServices>()->getMainWidget(), "Drizzle geometry",
+			"Data set for input " + QString::fromStdString(pOperator->getInputName(i)), candidates, current, false, &ok);
+		if (!ok)
+		{
+			pStep->finalize(Message::Abort);
+			return;
+		}
+		images.push_back(dynamic_cast<RasterElement*>(pModel->getElement(name.toStdString(), "", NULL)));
+	}
+
+	//Create and georeference the output RasterElement
+	GcpList* pGcpList = NULL;
+	RasterElement* pResult = pOperator->getGrid().createElement(images.front()->getName() + "_Drizzled", pProgress.get(), &pGcpList, error);
+	if (pResult == NULL)
+	{
+		pProgress->updateProgress(error, 0, ERRORS);
+		pStep->finalize(Message::Failure, error);
+		return;
+	}
+
+	//The sparse product runs in the job manager, the GUI stays responsive
+	DrizzleOperatorJob* pJob = new DrizzleOperatorJob(pResult, pGcpList, new ProgressResource("ProgressBar"), pOperator.release(), images);
+	DrizzleJobManager::instance()->submit(pJob, QString::fromStdString(images.front()->getName() + " (drizzle geometry)"));
+	pStep->finalize(Message::Success);
+	DrizzleQueue_GUI::showQueue();
+}
+
+void Drizzle::queueGUI()
+{
+	DrizzleQueue_GUI::showQueue();
+}
+
+void Drizzle::tuneGUI()
+{
+	//The calibration runs in the job manager, the GUI stays responsive
+	std::string error;
+	DrizzleTuneJob* pJob = DrizzleTuneJob::create(new ProgressResource("ProgressBar"), error);
+	if (pJob == NULL)
+	{
+		StepResource pStep( "Drizzle calibration", "app", "B3E1C6F2-7D0A-4E8B-9C35-1F6A2D4E8B70" );
+		pStep->finalize(Message::Failure, error);
+		QMessageBox::warning(Service<DesktopServices>()->getMainWidget(), "Drizzle", QString::fromStdString(error));
+		return;
+	}
+	DrizzleJobManager::instance()->submit(pJob, "Calibration");
+}
+
+void Drizzle::resumeGUI()
+{
+	QString filename = QFileDialog::getOpenFileName(gui, "Select checkpoint", QDir::tempPath(), "Drizzle checkpoints (*.drzc)");
+	if (!filename.isEmpty() && resumeCheckpoint(filename))
+	{
+		DrizzleQueue_GUI::showQueue();
+	}
+}
+
+bool Drizzle::resumeCheckpoint(const QString& filename)
+{
+	StepResource pStep( "Drizzle resume", "app", "D2A4F1B8-6C3E-4A7D-8F05-9B1E3C7A5D24" );
+	pStep->addProperty("Checkpoint", filename.toStdString());
+
+	//Video drizzles write checkpoints of their own
+	std::string name;
+	std::string error;
+	DrizzleJob* pJob = NULL;
+	if (DrizzleStreamJob::isCheckpoint(filename.toStdString()))
+	{
+		pJob = DrizzleStreamJob::resume(filename.toStdString(), name, error);
+	}
+	else
+	{
+		pJob = ImageDrizzleJob::resume(filename.toStdString(), name, error);
+	}
+	if (pJob == NULL)
+	{
+		QMessageBox::warning(Service<DesktopServices>()->getMainWidget(), "Drizzle", QString::fromStdString(error));
+		pStep->finalize(Message::Failure, error);
+		return false;
+	}
+
+	DrizzleJobManager::instance()->submit(pJob, QString::fromStdString(name));
+	DrizzleJobManager::instance()->setResumed(filename);
+	pStep->finalize(Message::Success);
+	return true;
+}
+
 bool Drizzle::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
 {
+   //Calibrate on first use and after the processor changed
+   if (DrizzleTuner::needsTuning())
+   {
+      tuneGUI();
+   }
    return openGUI();
 }
 
+bool Drizzle::abort()
+{
+   ViewerShell::abort();
+
+   //Queued drizzles are aborted from the queue view, only the registration of video frames runs in the GUI
+   DrizzleVideo_GUI* pVideoGui = dynamic_cast<DrizzleVideo_GUI*>(gui);
+   if (pVideoGui != NULL)
+   {
+      pVideoGui->abortDrizzle();
+      return true;
+   }
+   return false;
+}
+
 QWidget* Drizzle::getWidget() const
 {
    return gui;
@@ -150,11 +401,43 @@ QWidget* Drizzle::getWidget() const
 
 bool Drizzle::serialize(SessionItemSerializer &serializer) const
 {
-   return serializer.serialize(NULL, 0);
+   //Checkpoints of the unfinished drizzles, so they can be resumed when the session is opened.
+   //The job manager is shared by all instances, only one of them saves the checkpoints
+   QByteArray checkpoints;
+   if (DrizzleJobManager::instance()->isSessionOwner(this))
+   {
+      checkpoints = DrizzleJobManager::instance()->checkpointAll().join("\n").toUtf8();
+   }
+   return serializer.serialize(checkpoints.constData(), checkpoints.size());
 }
 
 bool Drizzle::deserialize(SessionItemDeserializer &deserializer)
 {
+   std::vector<unsigned char> buffer;
+   if (deserializer.deserialize(buffer) && !buffer.empty())
+   {
+      QStringList checkpoints = QString::fromUtf8(reinterpret_cast<const char*>(&buffer[0]), static_cast<int>(buffer.size())).split("\n", QString::SkipEmptyParts);
+      bool resumed = false;
+      for (QStringList::iterator it = checkpoints.begin(); it != checkpoints.end(); ++it)
+      {
+         //Sessions saved by several instances list the same checkpoints more than once
+         if (!QFile::exists(*it) || DrizzleJobManager::instance()->isResumed(*it))
+         {
+            continue;
+         }
+         if (QMessageBox::question(Service<DesktopServices>()->getMainWidget(), "Drizzle",
+            "An unfinished drizzle was saved with the session.\nResume it from checkpoint " + *it + "?",
+            QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes)
+         {
+            resumed = resumeCheckpoint(*it) || resumed;
+         }
+      }
+      if (resumed)
+      {
+         DrizzleQueue_GUI::showQueue();
+      }
+   }
+
    return openGUI();
 }
 
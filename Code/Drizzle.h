@@ -47,6 +47,14 @@ public:
 	bool getInputSpecification(PlugInArgList*& pInArgList);
 	bool getOutputSpecification(PlugInArgList*& pOutArgList);
 	bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+
+	/**
+	* Aborts the registration of video frames which is running in the opened video GUI.
+	* Queued drizzle jobs are aborted from the queue view.
+	*
+	* @return True when the abort request was forwarded.
+	*/
+	bool abort();
 	QWidget* getWidget() const;
 
 public slots:
@@ -67,7 +75,43 @@ public slots:
 	*/
 	void videoGUI();
 
+	/**
+	* Slot to merge partial result files of a distributed drizzle into
+	* the output image, connected to the 'Merge' button.
+	*/
+	void mergeGUI();
+
+	/**
+	* Slot to apply a recorded drizzle geometry to other input images,
+	* connected to the 'Apply geometry' button.
+	*/
+	void operatorGUI();
+
+	/**
+	* Slot to show the queue of drizzle jobs, connected to the 'Queue' button.
+	*/
+	void queueGUI();
+
+	/**
+	* Slot to calibrate the drizzle configuration of this machine, connected to the 'Calibrate' button.
+	* Queues a DrizzleTuneJob in the job manager.
+	*/
+	void tuneGUI();
+
+	/**
+	* Slot to resume an interrupted drizzle from a checkpoint, connected to the 'Resume' button.
+	*/
+	void resumeGUI();
+
 private:
+	/**
+	* Resumes an interrupted drizzle from a checkpoint and queues it in the job manager.
+	*
+	* @param filename Path of the checkpoint.
+	* @return True when the drizzle was queued.
+	*/
+	bool resumeCheckpoint(const QString& filename);
+
 	/**
 	* Initialises the general GUI which lets the user choose between
 	* video or images input.
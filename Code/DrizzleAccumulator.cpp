@@ -0,0 +1,687 @@
+/********************************************//*
+*
+* @file: DrizzleAccumulator.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "Georeference.h"
+#include "GeoreferenceDescriptor.h"
+#include "ModelServices.h"
+#include "ObjectResource.h"
+#include "PlugInArgList.h"
+#include "PlugInResource.h"
+#include "Progress.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterUtilities.h"
+#include "switchOnEncoding.h"
+#include "DrizzleAccumulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+namespace
+{
+	/**
+	* Identification of a partial result file, followed by the format version.
+	*/
+	const char PARTIAL_MAGIC[8] = { 'D', 'R', 'Z', 'P', 'A', 'R', 'T', '\0' };
+	const unsigned int PARTIAL_VERSION = 1;
+
+	template<typename V>
+	void writeValue(std::ofstream& file, const V& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(V));
+	}
+
+	template<typename V>
+	bool readValue(std::ifstream& file, V& value)
+	{
+		file.read(reinterpret_cast<char*>(&value), sizeof(V));
+		return file.good();
+	}
+
+	void writeLocation(std::ofstream& file, const LocationType& location)
+	{
+		writeValue(file, location.mX);
+		writeValue(file, location.mY);
+	}
+
+	bool readLocation(std::ifstream& file, LocationType& location)
+	{
+		return readValue(file, location.mX) && readValue(file, location.mY);
+	}
+
+	/**
+	* Number of bytes left in a file after the current position, used to bound the counts read from a header.
+	*/
+	unsigned long long getRemaining(std::ifstream& file)
+	{
+		std::streampos position = file.tellg();
+		file.seekg(0, std::ios::end);
+		std::streampos end = file.tellg();
+		file.seekg(position);
+		return (position < 0 || end < position) ? 0 : static_cast<unsigned long long>(end - position);
+	}
+
+	/**
+	* Reads the header of a partial result file: the output grid and the region covered by the partial result.
+	*/
+	bool readHeader(std::ifstream& file, const std::string& filename, DrizzleGrid& grid, unsigned int& startRow, unsigned int& startColumn,
+		unsigned int& rows, unsigned int& columns, std::string& error)
+	{
+		char magic[sizeof(PARTIAL_MAGIC)];
+		unsigned int version = 0;
+		file.read(magic, sizeof(magic));
+		if (!file.good() || !std::equal(magic, magic + sizeof(magic), PARTIAL_MAGIC) || !readValue(file, version) || version != PARTIAL_VERSION)
+		{
+			error = filename + " is not a Drizzle partial result.";
+			return false;
+		}
+
+		unsigned int dataType = 0;
+		unsigned int nameLength = 0;
+		unsigned int gcpCount = 0;
+		bool valid = readValue(file, grid.rows) && readValue(file, grid.columns) && readValue(file, dataType) &&
+			readLocation(file, grid.topLeft) && readLocation(file, grid.bottomLeft) &&
+			readLocation(file, grid.bottomRight) && readLocation(file, grid.topRight) &&
+			readValue(file, nameLength) && nameLength <= getRemaining(file);
+		if (valid)
+		{
+			std::vector<char> name(nameLength + 1, '\0');
+			file.read(&name[0], nameLength);
+			grid.georeferencePlugIn = std::string(&name[0]);
+			grid.dataType = static_cast<EncodingTypeEnum>(dataType);
+			valid = file.good() && readValue(file, gcpCount) &&
+				static_cast<unsigned long long>(gcpCount) * 4 * sizeof(double) <= getRemaining(file);
+		}
+		for (unsigned int i = 0; valid && i < gcpCount; i++)
+		{
+			GcpPoint point;
+			valid = readLocation(file, point.mPixel) && readLocation(file, point.mCoordinate);
+			grid.gcps.push_back(point);
+		}
+
+		valid = valid && readValue(file, startRow) && readValue(file, startColumn) && readValue(file, rows) && readValue(file, columns);
+		if (!valid || startRow > grid.rows || rows > grid.rows - startRow || startColumn > grid.columns || columns > grid.columns - startColumn)
+		{
+			error = filename + " has an invalid header.";
+			return false;
+		}
+		return true;
+	}
+
+	template<typename T>
+	/**
+	* Function to write a row of normalised values to a row of a RasterElement,
+	* rounding and saturating them to the range of the data type.
+	*
+	* @param pData First pixel of the row of the RasterElement.
+	* @param pValues Normalised values.
+	* @param count Number of values.
+	*/
+	void WriteValues(T* pData, const double* pValues, unsigned int count)
+	{
+		const bool integer = std::numeric_limits<T>::is_integer;
+		const double lowest = integer ? static_cast<double>((std::numeric_limits<T>::min)()) : -static_cast<double>((std::numeric_limits<T>::max)());
+		const double highest = static_cast<double>((std::numeric_limits<T>::max)());
+		const double rounding = integer ? 0.5 : 0.0;
+
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			double value = std::min(std::max(pValues[i], lowest), highest);
+			pData[i] = static_cast<T>(integer ? std::floor(value + rounding) : value);
+		}
+	}
+};
+
+LocationType DrizzleGrid::pixelToGeo(double col, double row) const
+{
+	//Same interpolation as used for the destination pixels by the original Drizzle function
+	double dtx = topRight.mX - topLeft.mX;			//difference in x coordinate over top of image
+	double dty = topRight.mY - topLeft.mY;			//difference in y coordinate over top of image
+	double dlx = bottomLeft.mX - topLeft.mX;		//difference in x coordinate over left side of image
+	double dly = bottomLeft.mY - topLeft.mY;		//difference in y coordinate over left side of image
+	double dbx = bottomRight.mX - bottomLeft.mX;	//difference in x coordinate over bottom of image
+	double dby = bottomRight.mY - bottomLeft.mY;	//difference in y coordinate over bottom of image
+	double drx = bottomRight.mX - topRight.mX;		//difference in x coordinate over right side of image
+	double dry = bottomRight.mY - topRight.mY;		//difference in y coordinate over right side of image
+
+	double x = topLeft.mX + ((((dbx-dtx)/rows)*row + dtx)/double(columns))*col + ((((drx-dlx)/columns)*col + dlx)/double(rows))*row;
+	double y = topLeft.mY + ((((dby-dty)/rows)*row + dty)/double(columns))*col + ((((dry-dly)/columns)*col + dly)/double(rows))*row;
+	return LocationType(x, y);
+}
+
+bool DrizzleGrid::geoToPixel(const LocationType& geo, LocationType& pixel) const
+{
+	//Coefficients of pixelToGeo written as x = x0 + ax*col + bx*row + cx*col*row
+	double ax = (topRight.mX - topLeft.mX) / columns;
+	double ay = (topRight.mY - topLeft.mY) / columns;
+	double bx = (bottomLeft.mX - topLeft.mX) / rows;
+	double by = (bottomLeft.mY - topLeft.mY) / rows;
+	double cx = ((bottomRight.mX - bottomLeft.mX) - (topRight.mX - topLeft.mX) + (bottomRight.mX - topRight.mX) - (bottomLeft.mX - topLeft.mX)) / (double(rows) * columns);
+	double cy = ((bottomRight.mY - bottomLeft.mY) - (topRight.mY - topLeft.mY) + (bottomRight.mY - topRight.mY) - (bottomLeft.mY - topLeft.mY)) / (double(rows) * columns);
+
+	//Newton iterations starting from the centre of the grid
+	double col = columns / 2.0;
+	double row = rows / 2.0;
+	for (int i = 0; i < 20; i++)
+	{
+		LocationType current = pixelToGeo(col, row);
+		double fx = current.mX - geo.mX;
+		double fy = current.mY - geo.mY;
+
+		double jxc = ax + cx*row;
+		double jxr = bx + cx*col;
+		double jyc = ay + cy*row;
+		double jyr = by + cy*col;
+		double det = jxc*jyr - jxr*jyc;
+		if (det == 0.0)
+		{
+			return false;
+		}
+
+		double dcol = (fx*jyr - fy*jxr) / det;
+		double drow = (fy*jxc - fx*jyc) / det;
+		col -= dcol;
+		row -= drow;
+		if (std::fabs(dcol) < 1e-6 && std::fabs(drow) < 1e-6)
+		{
+			break;
+		}
+	}
+
+	pixel = LocationType(col, row);
+	return true;
+}
+
+bool DrizzleGrid::isCompatible(const DrizzleGrid& other) const
+{
+	if (rows != other.rows || columns != other.columns || dataType != other.dataType)
+	{
+		return false;
+	}
+
+	//Corners are compared relative to the size of the grid
+	double tolerance = 1e-9 * (std::fabs(topRight.mX - topLeft.mX) + std::fabs(bottomLeft.mY - topLeft.mY) + 1.0);
+	const LocationType* pCorners[] = { &topLeft, &bottomLeft, &bottomRight, &topRight };
+	const LocationType* pOtherCorners[] = { &other.topLeft, &other.bottomLeft, &other.bottomRight, &other.topRight };
+	for (int i = 0; i < 4; i++)
+	{
+		if (std::fabs(pCorners[i]->mX - pOtherCorners[i]->mX) > tolerance || std::fabs(pCorners[i]->mY - pOtherCorners[i]->mY) > tolerance)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+DrizzleGrid DrizzleGrid::decimate(unsigned int factor) const
+{
+	factor = std::max(factor, 1u);
+	return resize((rows + factor - 1) / factor, (columns + factor - 1) / factor);
+}
+
+DrizzleGrid DrizzleGrid::resize(unsigned int newRows, unsigned int newColumns) const
+{
+	DrizzleGrid grid = *this;
+	grid.rows = std::max(newRows, 1u);
+	grid.columns = std::max(newColumns, 1u);
+
+	//Corners are kept, so the GCPs are scaled with the size of the grid
+	for (std::list<GcpPoint>::iterator it = grid.gcps.begin(); it != grid.gcps.end(); ++it)
+	{
+		it->mPixel.mX *= double(grid.columns) / columns;
+		it->mPixel.mY *= double(grid.rows) / rows;
+	}
+	return grid;
+}
+
+RasterElement* DrizzleGrid::createElement(const std::string& name, Progress* pProgress, GcpList** pGcpList, std::string& error) const
+{
+	Service<ModelServices> pModel;
+	ModelResource<RasterElement> pResultCube(RasterUtilities::createRasterElement(name, rows, columns, dataType));
+	if (pResultCube.get() == NULL)
+	{
+		error = "A raster cube could not be created.";
+		return NULL;
+	}
+
+	//Create new GCP list for output RasterElement
+	GcpList* pNewGcpList = static_cast<GcpList*>(pModel->createElement("Corner coordinates", "GcpList", pResultCube.get()));
+	pNewGcpList->addPoints(gcps);
+
+	//Georeference the output image using the Georeference Plugin
+	RasterDataDescriptor* pDestDesc = static_cast<RasterDataDescriptor*>(pResultCube->getDataDescriptor());
+	pDestDesc->getGeoreferenceDescriptor()->setGeoreferencePlugInName(georeferencePlugIn);
+	if (!georeferencePlugIn.empty())
+	{
+		ExecutableResource geoPlugIn(georeferencePlugIn);
+		PlugInArgList& argList = geoPlugIn->getInArgList();
+		argList.setPlugInArgValue(Executable::DataElementArg(), pResultCube.get());
+		argList.setPlugInArgValue(Executable::ProgressArg(), pProgress);
+		argList.setPlugInArgValueLoose(Georeference::GcpListArg(), pNewGcpList);
+		if (geoPlugIn->execute() == false)
+		{
+			error = "Could not georeference the data set.";
+			return NULL;
+		}
+		geoPlugIn.release();
+	}
+	else if (pProgress != NULL)
+	{
+		//The output is kept without georeference, as for the first output
+		pProgress->updateProgress("A georeference plug-in is not available to georeference the data set.", 0, WARNING);
+	}
+
+	if (pGcpList != NULL)
+	{
+		*pGcpList = pNewGcpList;
+	}
+	return pResultCube.release();
+}
+
+DrizzleAccumulator::DrizzleAccumulator(const DrizzleGrid& grid, unsigned int startRow, unsigned int startColumn, unsigned int rows, unsigned int columns) :
+	mGrid(grid),
+	mStartRow(startRow),
+	mStartColumn(startColumn),
+	mRows(rows),
+	mColumns(columns),
+	mSum(static_cast<size_t>(rows) * columns, 0.0),
+	mWeight(static_cast<size_t>(rows) * columns, 0.0),
+	mCount(static_cast<size_t>(rows) * columns, 0)
+{
+}
+
+DrizzleAccumulator::~DrizzleAccumulator()
+{
+}
+
+const DrizzleGrid& DrizzleAccumulator::getGrid() const
+{
+	return mGrid;
+}
+
+unsigned int DrizzleAccumulator::getStartRow() const
+{
+	return mStartRow;
+}
+
+unsigned int DrizzleAccumulator::getStartColumn() const
+{
+	return mStartColumn;
+}
+
+unsigned int DrizzleAccumulator::getRows() const
+{
+	return mRows;
+}
+
+unsigned int DrizzleAccumulator::getColumns() const
+{
+	return mColumns;
+}
+
+bool DrizzleAccumulator::contains(unsigned int row, unsigned int col) const
+{
+	return row >= mStartRow && row < mStartRow + mRows && col >= mStartColumn && col < mStartColumn + mColumns;
+}
+
+size_t DrizzleAccumulator::index(unsigned int row, unsigned int col) const
+{
+	return static_cast<size_t>(row - mStartRow) * mColumns + (col - mStartColumn);
+}
+
+void DrizzleAccumulator::add(unsigned int row, unsigned int col, double sum, double weight, bool overlapped)
+{
+	size_t i = index(row, col);
+	mSum[i] += sum;
+	mWeight[i] += weight;
+	if (overlapped)
+	{
+		mCount[i]++;
+	}
+}
+
+void DrizzleAccumulator::set(unsigned int row, unsigned int col, double sum, double weight, unsigned int count)
+{
+	size_t i = index(row, col);
+	mSum[i] = sum;
+	mWeight[i] = weight;
+	mCount[i] = count;
+}
+
+void DrizzleAccumulator::clear(unsigned int startRow, unsigned int startColumn, unsigned int rows, unsigned int columns)
+{
+	for (unsigned int row = startRow; row < startRow + rows; ++row)
+	{
+		size_t i = index(row, startColumn);
+		std::fill(mSum.begin() + i, mSum.begin() + i + columns, 0.0);
+		std::fill(mWeight.begin() + i, mWeight.begin() + i + columns, 0.0);
+		std::fill(mCount.begin() + i, mCount.begin() + i + columns, 0u);
+	}
+}
+
+bool DrizzleAccumulator::copy(const DrizzleAccumulator& other, unsigned int startRow, unsigned int startColumn, unsigned int rows, unsigned int columns, std::string& error)
+{
+	if (!mGrid.isCompatible(other.mGrid))
+	{
+		error = "Partial results do not share the same output grid.";
+		return false;
+	}
+	clear(startRow, startColumn, rows, columns);
+
+	//Only the intersection with the region of the other accumulator holds values
+	unsigned int firstRow = std::max(startRow, other.mStartRow);
+	unsigned int endRow = std::min(startRow + rows, other.mStartRow + other.mRows);
+	unsigned int firstColumn = std::max(startColumn, other.mStartColumn);
+	unsigned int endColumn = std::min(startColumn + columns, other.mStartColumn + other.mColumns);
+	for (unsigned int row = firstRow; row < endRow && firstColumn < endColumn; ++row)
+	{
+		size_t src = other.index(row, firstColumn);
+		size_t dst = index(row, firstColumn);
+		size_t length = endColumn - firstColumn;
+		std::copy(other.mSum.begin() + src, other.mSum.begin() + src + length, mSum.begin() + dst);
+		std::copy(other.mWeight.begin() + src, other.mWeight.begin() + src + length, mWeight.begin() + dst);
+		std::copy(other.mCount.begin() + src, other.mCount.begin() + src + length, mCount.begin() + dst);
+	}
+	return true;
+}
+
+double DrizzleAccumulator::getSum(unsigned int row, unsigned int col) const
+{
+	return mSum[index(row, col)];
+}
+
+double DrizzleAccumulator::getWeight(unsigned int row, unsigned int col) const
+{
+	return mWeight[index(row, col)];
+}
+
+unsigned int DrizzleAccumulator::getCount(unsigned int row, unsigned int col) const
+{
+	return mCount[index(row, col)];
+}
+
+double DrizzleAccumulator::getValue(unsigned int row, unsigned int col) const
+{
+	size_t i = index(row, col);
+	return (mWeight[i] <= 0.0) ? 0.0 : mSum[i] / mWeight[i];
+}
+
+void DrizzleAccumulator::resize(unsigned int startRow, unsigned int startColumn, unsigned int rows, unsigned int columns)
+{
+	std::vector<double> sum(static_cast<size_t>(rows) * columns, 0.0);
+	std::vector<double> weight(static_cast<size_t>(rows) * columns, 0.0);
+	std::vector<unsigned int> count(static_cast<size_t>(rows) * columns, 0);
+
+	//Copy the old region into the new one
+	for (unsigned int row = 0; row < mRows; ++row)
+	{
+		size_t src = static_cast<size_t>(row) * mColumns;
+		size_t dst = static_cast<size_t>(row + mStartRow - startRow) * columns + (mStartColumn - startColumn);
+		std::copy(mSum.begin() + src, mSum.begin() + src + mColumns, sum.begin() + dst);
+		std::copy(mWeight.begin() + src, mWeight.begin() + src + mColumns, weight.begin() + dst);
+		std::copy(mCount.begin() + src, mCount.begin() + src + mColumns, count.begin() + dst);
+	}
+
+	mSum.swap(sum);
+	mWeight.swap(weight);
+	mCount.swap(count);
+	mStartRow = startRow;
+	mStartColumn = startColumn;
+	mRows = rows;
+	mColumns = columns;
+}
+
+bool DrizzleAccumulator::merge(const DrizzleAccumulator& other, std::string& error)
+{
+	if (!mGrid.isCompatible(other.mGrid))
+	{
+		error = "Partial results do not share the same output grid.";
+		return false;
+	}
+
+	//Grow the region to the bounding box of both regions
+	unsigned int startRow = std::min(mStartRow, other.mStartRow);
+	unsigned int startColumn = std::min(mStartColumn, other.mStartColumn);
+	unsigned int endRow = std::max(mStartRow + mRows, other.mStartRow + other.mRows);
+	unsigned int endColumn = std::max(mStartColumn + mColumns, other.mStartColumn + other.mColumns);
+	if (startRow != mStartRow || startColumn != mStartColumn || endRow - startRow != mRows || endColumn - startColumn != mColumns)
+	{
+		resize(startRow, startColumn, endRow - startRow, endColumn - startColumn);
+	}
+
+	for (unsigned int row = 0; row < other.mRows; ++row)
+	{
+		size_t src = static_cast<size_t>(row) * other.mColumns;
+		size_t dst = index(other.mStartRow + row, other.mStartColumn);
+		for (unsigned int col = 0; col < other.mColumns; ++col)
+		{
+			mSum[dst + col] += other.mSum[src + col];
+			mWeight[dst + col] += other.mWeight[src + col];
+			mCount[dst + col] += other.mCount[src + col];
+		}
+	}
+	return true;
+}
+
+bool DrizzleAccumulator::normalise(RasterElement* pElement, std::string& error) const
+{
+	return writePlane(pElement, PLANE_VALUE, error);
+}
+
+bool DrizzleAccumulator::normaliseScaled(RasterElement* pElement, std::string& error) const
+{
+	RasterDataDescriptor* pDesc = static_cast<RasterDataDescriptor*>(pElement->getDataDescriptor());
+	unsigned int rows = pDesc->getRowCount();
+	unsigned int columns = pDesc->getColumnCount();
+	if (rows < mGrid.rows || columns < mGrid.columns)
+	{
+		error = "The output image is smaller than the output grid.";
+		return false;
+	}
+	if (mRows == 0 || mColumns == 0)
+	{
+		return true;
+	}
+
+	FactoryResource<DataRequest> pRequest;
+	pRequest->setWritable(true);
+	DataAccessor pDestAcc = pElement->getDataAccessor(pRequest.release());
+
+	std::vector<double> values(columns);
+	for (unsigned int row = 0; row < rows; ++row)
+	{
+		pDestAcc->toPixel(row, 0);
+		if (!pDestAcc.isValid())
+		{
+			error = "Unable to access the cube data.";
+			return false;
+		}
+
+		//Nearest output pixel, pixels outside the region are left empty
+		unsigned int gridRow = static_cast<unsigned int>((static_cast<unsigned long long>(row) * mGrid.rows) / rows);
+		bool inRegion = gridRow >= mStartRow && gridRow < mStartRow + mRows;
+		for (unsigned int col = 0; col < columns; ++col)
+		{
+			unsigned int gridCol = static_cast<unsigned int>((static_cast<unsigned long long>(col) * mGrid.columns) / columns);
+			values[col] = (inRegion && gridCol >= mStartColumn && gridCol < mStartColumn + mColumns) ? getValue(gridRow, gridCol) : 0.0;
+		}
+		switchOnEncoding(pDesc->getDataType(), WriteValues, pDestAcc->getColumn(), &values[0], columns);
+	}
+	return true;
+}
+
+bool DrizzleAccumulator::writeWeight(RasterElement* pElement, std::string& error) const
+{
+	return writePlane(pElement, PLANE_WEIGHT, error);
+}
+
+bool DrizzleAccumulator::writeCount(RasterElement* pElement, std::string& error) const
+{
+	return writePlane(pElement, PLANE_COUNT, error);
+}
+
+bool DrizzleAccumulator::writePlane(RasterElement* pElement, Plane plane, std::string& error) const
+{
+	RasterDataDescriptor* pDesc = static_cast<RasterDataDescriptor*>(pElement->getDataDescriptor());
+	if (pDesc->getRowCount() != mGrid.rows || pDesc->getColumnCount() != mGrid.columns)
+	{
+		error = "The output image does not match the output grid.";
+		return false;
+	}
+	if (mRows == 0 || mColumns == 0)
+	{
+		return true;
+	}
+
+	FactoryResource<DataRequest> pRequest;
+	pRequest->setWritable(true);
+	DataAccessor pDestAcc = pElement->getDataAccessor(pRequest.release());
+
+	std::vector<double> values(mColumns);
+	for (unsigned int row = 0; row < mRows; ++row)
+	{
+		pDestAcc->toPixel(mStartRow + row, mStartColumn);
+		if (!pDestAcc.isValid())
+		{
+			error = "Unable to access the cube data.";
+			return false;
+		}
+
+		//Normalise the whole row first, then convert it in one pass
+		const double* pSum = &mSum[0] + static_cast<size_t>(row) * mColumns;
+		const double* pWeight = &mWeight[0] + static_cast<size_t>(row) * mColumns;
+		const unsigned int* pCount = &mCount[0] + static_cast<size_t>(row) * mColumns;
+		switch (plane)
+		{
+		case PLANE_WEIGHT:
+			std::copy(pWeight, pWeight + mColumns, values.begin());
+			break;
+		case PLANE_COUNT:
+			std::copy(pCount, pCount + mColumns, values.begin());
+			break;
+		default:
+			for (unsigned int col = 0; col < mColumns; ++col)
+			{
+				values[col] = (pWeight[col] <= 0.0) ? 0.0 : pSum[col] / pWeight[col];
+			}
+			break;
+		}
+		switchOnEncoding(pDesc->getDataType(), WriteValues, pDestAcc->getColumn(), &values[0], mColumns);
+	}
+	return true;
+}
+
+bool DrizzleAccumulator::save(const std::string& filename, std::string& error) const
+{
+	std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		error = "Unable to open " + filename + " for writing.";
+		return false;
+	}
+
+	//Header: output grid definition
+	file.write(PARTIAL_MAGIC, sizeof(PARTIAL_MAGIC));
+	writeValue(file, PARTIAL_VERSION);
+	writeValue(file, mGrid.rows);
+	writeValue(file, mGrid.columns);
+	writeValue(file, static_cast<unsigned int>(mGrid.dataType));
+	writeLocation(file, mGrid.topLeft);
+	writeLocation(file, mGrid.bottomLeft);
+	writeLocation(file, mGrid.bottomRight);
+	writeLocation(file, mGrid.topRight);
+	writeValue(file, static_cast<unsigned int>(mGrid.georeferencePlugIn.size()));
+	file.write(mGrid.georeferencePlugIn.c_str(), mGrid.georeferencePlugIn.size());
+	writeValue(file, static_cast<unsigned int>(mGrid.gcps.size()));
+	for (std::list<GcpPoint>::const_iterator it = mGrid.gcps.begin(); it != mGrid.gcps.end(); ++it)
+	{
+		writeLocation(file, it->mPixel);
+		writeLocation(file, it->mCoordinate);
+	}
+
+	//Region covered by this partial result
+	writeValue(file, mStartRow);
+	writeValue(file, mStartColumn);
+	writeValue(file, mRows);
+	writeValue(file, mColumns);
+
+	//Sum, weight and count planes
+	if (!mSum.empty())
+	{
+		file.write(reinterpret_cast<const char*>(&mSum[0]), mSum.size() * sizeof(double));
+		file.write(reinterpret_cast<const char*>(&mWeight[0]), mWeight.size() * sizeof(double));
+		file.write(reinterpret_cast<const char*>(&mCount[0]), mCount.size() * sizeof(unsigned int));
+	}
+
+	if (!file.good())
+	{
+		error = "Unable to write " + filename + ".";
+		return false;
+	}
+	return true;
+}
+
+bool DrizzleAccumulator::loadGrid(const std::string& filename, DrizzleGrid& grid, std::string& error)
+{
+	std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		error = "Unable to open " + filename + ".";
+		return false;
+	}
+
+	unsigned int startRow = 0;
+	unsigned int startColumn = 0;
+	unsigned int rows = 0;
+	unsigned int columns = 0;
+	return readHeader(file, filename, grid, startRow, startColumn, rows, columns, error);
+}
+
+DrizzleAccumulator* DrizzleAccumulator::load(const std::string& filename, std::string& error)
+{
+	std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		error = "Unable to open " + filename + ".";
+		return NULL;
+	}
+
+	DrizzleGrid grid;
+	unsigned int startRow = 0;
+	unsigned int startColumn = 0;
+	unsigned int rows = 0;
+	unsigned int columns = 0;
+	if (!readHeader(file, filename, grid, startRow, startColumn, rows, columns, error))
+	{
+		return NULL;
+	}
+
+	DrizzleAccumulator* pAccumulator = new DrizzleAccumulator(grid, startRow, startColumn, rows, columns);
+	if (!pAccumulator->mSum.empty())
+	{
+		file.read(reinterpret_cast<char*>(&pAccumulator->mSum[0]), pAccumulator->mSum.size() * sizeof(double));
+		file.read(reinterpret_cast<char*>(&pAccumulator->mWeight[0]), pAccumulator->mWeight.size() * sizeof(double));
+		file.read(reinterpret_cast<char*>(&pAccumulator->mCount[0]), pAccumulator->mCount.size() * sizeof(unsigned int));
+	}
+	if (!file.good())
+	{
+		delete pAccumulator;
+		error = filename + " is truncated.";
+		return NULL;
+	}
+	return pAccumulator;
+}
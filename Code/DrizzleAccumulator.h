@@ -0,0 +1,401 @@
+/********************************************//*
+*
+* @file: DrizzleAccumulator.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleAccumulator_H
+#define DrizzleAccumulator_H
+
+#include "GcpList.h"
+#include "LocationType.h"
+#include "TypesFile.h"
+
+#include <list>
+#include <string>
+#include <vector>
+
+class GcpList;
+class Progress;
+class RasterElement;
+
+/**
+*
+* Definition of the output grid of a drizzle: its size, data type and
+* the geographical coordinates of its corners.
+*/
+struct DrizzleGrid
+{
+	/**
+	* Height of the output image.
+	*/
+	unsigned int rows;
+
+	/**
+	* Width of the output image.
+	*/
+	unsigned int columns;
+
+	/**
+	* Data type of the output image.
+	*/
+	EncodingType dataType;
+
+	/**
+	* Geographical coordinates of pixel (0,0).
+	*/
+	LocationType topLeft;
+
+	/**
+	* Geographical coordinates of pixel (0,rows).
+	*/
+	LocationType bottomLeft;
+
+	/**
+	* Geographical coordinates of pixel (columns,rows).
+	*/
+	LocationType bottomRight;
+
+	/**
+	* Geographical coordinates of pixel (columns,0).
+	*/
+	LocationType topRight;
+
+	/**
+	* Name of the georeference plug-in used to georeference the output image.
+	*/
+	std::string georeferencePlugIn;
+
+	/**
+	* GCPs used to georeference the output image.
+	*/
+	std::list<GcpPoint> gcps;
+
+	/**
+	* Calculates the geographical coordinates of a location in the output image
+	* by interpolating between the corners of the grid.
+	*
+	* @param col Column of the location (can be fractional).
+	* @param row Row of the location (can be fractional).
+	* @return Geographical coordinates of the location.
+	*/
+	LocationType pixelToGeo(double col, double row) const;
+
+	/**
+	* Calculates the location in the output image of geographical coordinates
+	* by inverting the interpolation of pixelToGeo.
+	*
+	* @param geo Geographical coordinates.
+	* @param pixel Location which will hold the column (mX) and row (mY), can be outside the grid.
+	* @return True when successfull, false when the grid is degenerate.
+	*/
+	bool geoToPixel(const LocationType& geo, LocationType& pixel) const;
+
+	/**
+	* Determines whether two grids describe the same output image.
+	*
+	* @param other Grid to compare with.
+	* @return True when size, data type and corners are equal.
+	*/
+	bool isCompatible(const DrizzleGrid& other) const;
+
+	/**
+	* Returns a grid of another size covering the same area, e.g. to drizzle at another output scale.
+	*
+	* @param newRows Height of the new grid.
+	* @param newColumns Width of the new grid.
+	* @return Grid of the new size, at least one pixel wide and high.
+	*/
+	DrizzleGrid resize(unsigned int newRows, unsigned int newColumns) const;
+
+	/**
+	* Returns a coarser grid covering the same area, e.g. to drizzle a quick preview.
+	*
+	* @param factor Number of pixels of this grid along each axis merged into one pixel of the coarser grid.
+	* @return Coarser grid, at least one pixel wide and high.
+	*/
+	DrizzleGrid decimate(unsigned int factor) const;
+
+	/**
+	* Creates an empty RasterElement for the output grid and georeferences it
+	* with the GCPs and georeference plug-in of the grid. Without a georeference plug-in
+	* the RasterElement is not georeferenced and a warning is reported to the progress.
+	*
+	* @param name Name of the new RasterElement.
+	* @param pProgress Progress used by the georeference plug-in, can be NULL.
+	* @param pGcpList Pointer which will hold the GCP list of the new RasterElement, can be NULL.
+	* @param error String which will hold the error message on failure.
+	* @return New RasterElement, NULL on failure.
+	*/
+	RasterElement* createElement(const std::string& name, Progress* pProgress, GcpList** pGcpList, std::string& error) const;
+};
+
+/**
+*
+* Un-normalised drizzle result for a rectangular region of the output grid.
+* For every output pixel it holds the sum of weighted input pixels, the sum of
+* the weights (overlap areas) and the number of input images which overlapped.
+* Accumulators of disjoint input sets or output regions can be merged in any
+* order and saved to or loaded from a partial result file.
+*/
+class DrizzleAccumulator
+{
+public:
+	/**
+	* Constructor for an accumulator covering a region of the output grid.
+	* All planes are initialised to zero.
+	*
+	* @param grid Output grid.
+	* @param startRow First row of the region.
+	* @param startColumn First column of the region.
+	* @param rows Height of the region.
+	* @param columns Width of the region.
+	*/
+	DrizzleAccumulator(const DrizzleGrid& grid, unsigned int startRow, unsigned int startColumn, unsigned int rows, unsigned int columns);
+
+	/**
+	* Destructor for the accumulator.
+	*/
+	~DrizzleAccumulator();
+
+	/**
+	* Returns the output grid.
+	*
+	* @return The output grid.
+	*/
+	const DrizzleGrid& getGrid() const;
+
+	/**
+	* @return First row of the region.
+	*/
+	unsigned int getStartRow() const;
+
+	/**
+	* @return First column of the region.
+	*/
+	unsigned int getStartColumn() const;
+
+	/**
+	* @return Height of the region.
+	*/
+	unsigned int getRows() const;
+
+	/**
+	* @return Width of the region.
+	*/
+	unsigned int getColumns() const;
+
+	/**
+	* Determines whether a pixel of the output grid lies in the region.
+	*
+	* @param row Row in the output grid.
+	* @param col Column in the output grid.
+	* @return True when the pixel lies in the region.
+	*/
+	bool contains(unsigned int row, unsigned int col) const;
+
+	/**
+	* Adds the contribution of one input image to an output pixel.
+	* Different threads may add to different pixels concurrently.
+	*
+	* @param row Row in the output grid.
+	* @param col Column in the output grid.
+	* @param sum Sum of the weighted input pixels.
+	* @param weight Sum of the weights.
+	* @param overlapped True when the input image overlapped with the output pixel.
+	*/
+	void add(unsigned int row, unsigned int col, double sum, double weight, bool overlapped);
+
+	/**
+	* Replaces the accumulated values of an output pixel, e.g. by values computed by a DrizzleOperator.
+	* Different threads may set different pixels concurrently.
+	*
+	* @param row Row in the output grid.
+	* @param col Column in the output grid.
+	* @param sum Sum of the weighted input pixels.
+	* @param weight Sum of the weights.
+	* @param count Number of input images which overlapped.
+	*/
+	void set(unsigned int row, unsigned int col, double sum, double weight, unsigned int count);
+
+	/**
+	* Resets a rectangle of the region to zero.
+	*
+	* @param startRow First row of the rectangle in the output grid.
+	* @param startColumn First column of the rectangle in the output grid.
+	* @param rows Height of the rectangle.
+	* @param columns Width of the rectangle.
+	*/
+	void clear(unsigned int startRow, unsigned int startColumn, unsigned int rows, unsigned int columns);
+
+	/**
+	* Replaces a rectangle of the region by the values of another accumulator of the same output grid,
+	* e.g. to snapshot or restore tiles. Pixels of the rectangle outside the region of the other accumulator are cleared.
+	*
+	* @param other Accumulator to copy from.
+	* @param startRow First row of the rectangle in the output grid.
+	* @param startColumn First column of the rectangle in the output grid.
+	* @param rows Height of the rectangle.
+	* @param columns Width of the rectangle.
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull, false when the grids are not compatible.
+	*/
+	bool copy(const DrizzleAccumulator& other, unsigned int startRow, unsigned int startColumn, unsigned int rows, unsigned int columns, std::string& error);
+
+	/**
+	* @return Sum of the weighted input pixels of an output pixel.
+	*/
+	double getSum(unsigned int row, unsigned int col) const;
+
+	/**
+	* @return Sum of the weights of an output pixel.
+	*/
+	double getWeight(unsigned int row, unsigned int col) const;
+
+	/**
+	* @return Number of input images which overlapped with an output pixel.
+	*/
+	unsigned int getCount(unsigned int row, unsigned int col) const;
+
+	/**
+	* Returns the normalised value of an output pixel: the sum divided by the sum of the weights,
+	* so partly covered pixels and drops smaller than the input pixels keep the brightness of the inputs.
+	*
+	* @param row Row in the output grid.
+	* @param col Column in the output grid.
+	* @return Normalised value, 0 when no input image contributed.
+	*/
+	double getValue(unsigned int row, unsigned int col) const;
+
+	/**
+	* Adds another accumulator of the same output grid to this one.
+	* The region grows to the bounding box of both regions.
+	*
+	* @param other Accumulator to merge.
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull, false when the grids are not compatible.
+	*/
+	bool merge(const DrizzleAccumulator& other, std::string& error);
+
+	/**
+	* Writes the normalised values of the region to a RasterElement with the size of the output grid.
+	* Values are rounded and saturated to the range of the data type of the RasterElement.
+	*
+	* @param pElement Output RasterElement.
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull, false otherwise.
+	*/
+	bool normalise(RasterElement* pElement, std::string& error) const;
+
+	/**
+	* Writes the normalised values to a RasterElement covering the same area as the output grid
+	* at a higher resolution: every pixel takes the value of the output pixel it falls in.
+	* Used to show a preview drizzled onto a decimated grid at the size of the final result.
+	*
+	* @param pElement Output RasterElement, at least as large as the output grid.
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull, false otherwise.
+	*/
+	bool normaliseScaled(RasterElement* pElement, std::string& error) const;
+
+	/**
+	* Writes the sums of the weights (coverage) of the region to a RasterElement with the size of the output grid.
+	*
+	* @param pElement Output RasterElement.
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull, false otherwise.
+	*/
+	bool writeWeight(RasterElement* pElement, std::string& error) const;
+
+	/**
+	* Writes the numbers of overlapping input images of the region to a RasterElement with the size of the output grid.
+	*
+	* @param pElement Output RasterElement.
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull, false otherwise.
+	*/
+	bool writeCount(RasterElement* pElement, std::string& error) const;
+
+	/**
+	* Saves the grid and the planes to a partial result file.
+	*
+	* @param filename Path of the partial result file.
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull, false otherwise.
+	*/
+	bool save(const std::string& filename, std::string& error) const;
+
+	/**
+	* Loads an accumulator from a partial result file.
+	*
+	* @param filename Path of the partial result file.
+	* @param error String which will hold the error message on failure.
+	* @return New accumulator, NULL on failure. The caller takes ownership.
+	*/
+	static DrizzleAccumulator* load(const std::string& filename, std::string& error);
+
+	/**
+	* Reads the output grid of a partial result file without loading its planes.
+	*
+	* @param filename Path of the partial result file.
+	* @param grid Grid which will hold the output grid of the partial result.
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull, false otherwise.
+	*/
+	static bool loadGrid(const std::string& filename, DrizzleGrid& grid, std::string& error);
+
+private:
+	/**
+	* Planes which can be written to a RasterElement.
+	*/
+	enum Plane
+	{
+		PLANE_VALUE,
+		PLANE_WEIGHT,
+		PLANE_COUNT
+	};
+
+	/**
+	* Writes one plane of the region to a RasterElement with the size of the output grid.
+	*/
+	bool writePlane(RasterElement* pElement, Plane plane, std::string& error) const;
+
+	/**
+	* Resizes the region, keeping the accumulated values.
+	*/
+	void resize(unsigned int startRow, unsigned int startColumn, unsigned int rows, unsigned int columns);
+
+	/**
+	* Returns the index in the planes of a pixel of the output grid.
+	*/
+	size_t index(unsigned int row, unsigned int col) const;
+
+	DrizzleGrid mGrid;
+	unsigned int mStartRow;
+	unsigned int mStartColumn;
+	unsigned int mRows;
+	unsigned int mColumns;
+
+	/**
+	* Sum of the weighted input pixels.
+	*/
+	std::vector<double> mSum;
+
+	/**
+	* Sum of the weights.
+	*/
+	std::vector<double> mWeight;
+
+	/**
+	* Number of overlapping input images.
+	*/
+	std::vector<unsigned int> mCount;
+};
+
+#endif
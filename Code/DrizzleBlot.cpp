@@ -0,0 +1,145 @@
+/********************************************//*
+*
+* @file: DrizzleBlot.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "ModelServices.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "Progress.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterUtilities.h"
+#include "DrizzleBlot.h"
+#include "DrizzleJobManager.h"
+#include "DrizzleOperator.h"
+
+#include <memory>
+
+REGISTER_PLUGIN_BASIC(ImageEnhancement, DrizzleBlot);
+
+DrizzleBlot::DrizzleBlot()
+{
+   setDescriptorId("{5A170306-8245-4B66-AC8D-1C827EC96684}");
+   setName("Drizzle Blot");
+   setVersion("Sample");
+   setDescription("Resample a drizzled image onto the pixel grid of one of its inputs");
+   setCreator("Tom Van den Eynde");
+   setCopyright("Copyright (C) 2015, Tom Van den Eynde");
+   setProductionStatus(false);
+   setType("Sample");
+   setSubtype("Image Enhancement");
+   setAbortSupported(false);
+   allowMultipleInstances(true);
+}
+
+DrizzleBlot::~DrizzleBlot()
+{
+}
+
+bool DrizzleBlot::getInputSpecification(PlugInArgList*& pInArgList)
+{
+   pInArgList = Service<PlugInManagerServices>()->getPlugInArgList();
+   VERIFY(pInArgList != NULL);
+   pInArgList->addArg<Progress>(Executable::ProgressArg(), NULL, "Progress reporter");
+   pInArgList->addArg<RasterElement>("Drizzled image", NULL, "Drizzled image to blot");
+   pInArgList->addArg<RasterElement>("Input image", NULL, "Input image of the drizzle onto which the drizzled image is blotted");
+   pInArgList->addArg<std::string>("Operator file", NULL, "Drizzle geometry (.drzw) recorded by the drizzle");
+   return true;
+}
+
+bool DrizzleBlot::getOutputSpecification(PlugInArgList*& pOutArgList)
+{
+   pOutArgList = Service<PlugInManagerServices>()->getPlugInArgList();
+   VERIFY(pOutArgList != NULL);
+   pOutArgList->addArg<RasterElement>("Blotted image", NULL);
+   return true;
+}
+
+bool DrizzleBlot::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   VERIFY(pInArgList != NULL && pOutArgList != NULL);
+   Progress* pProgress = pInArgList->getPlugInArgValue<Progress>(Executable::ProgressArg());
+   RasterElement* pDrizzled = pInArgList->getPlugInArgValue<RasterElement>("Drizzled image");
+   RasterElement* pInput = pInArgList->getPlugInArgValue<RasterElement>("Input image");
+   std::string* pOperatorFile = pInArgList->getPlugInArgValue<std::string>("Operator file");
+   if (pDrizzled == NULL || pInput == NULL || pOperatorFile == NULL)
+   {
+      if (pProgress != NULL)
+      {
+         pProgress->updateProgress("A drizzled image, an input image and an operator file must be specified.", 100, ERRORS);
+      }
+      return false;
+   }
+
+   std::string error;
+   std::auto_ptr<DrizzleOperator> pOperator(DrizzleOperator::load(*pOperatorFile, error));
+   if (pOperator.get() == NULL)
+   {
+      if (pProgress != NULL)
+      {
+         pProgress->updateProgress(error, 100, ERRORS);
+      }
+      return false;
+   }
+
+   //The input is recorded by name, the only input with its size is taken when it was renamed
+   const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(pInput->getDataDescriptor());
+   unsigned int input = pOperator->getInputCount();
+   unsigned int sameSize = 0;
+   for (unsigned int i = 0; i < pOperator->getInputCount(); ++i)
+   {
+      if (pOperator->getInputRows(i) != pDesc->getRowCount() || pOperator->getInputColumns(i) != pDesc->getColumnCount())
+      {
+         continue;
+      }
+      if (pOperator->getInputName(i) == pInput->getName())
+      {
+         input = i;
+         sameSize = 1;
+         break;
+      }
+      if (sameSize++ == 0)
+      {
+         input = i;
+      }
+   }
+   if (sameSize != 1)
+   {
+      if (pProgress != NULL)
+      {
+         pProgress->updateProgress(pInput->getName() + " is not an input of the drizzle geometry.", 100, ERRORS);
+      }
+      return false;
+   }
+
+   ModelResource<RasterElement> pBlotted(RasterUtilities::createRasterElement(pInput->getName() + "_Blotted", pDesc->getRowCount(), pDesc->getColumnCount(), FLT8BYTES, true, pInput));
+   if (pBlotted.get() == NULL)
+   {
+      if (pProgress != NULL)
+      {
+         pProgress->updateProgress("A raster cube could not be created.", 100, ERRORS);
+      }
+      return false;
+   }
+
+   if (!pOperator->blot(pDrizzled, input, pBlotted.get(), DrizzleJobManager::instance()->getThreadBudget(), pProgress, error))
+   {
+      if (pProgress != NULL)
+      {
+         pProgress->updateProgress(error, 100, ERRORS);
+      }
+      return false;
+   }
+
+   pOutArgList->setPlugInArgValue("Blotted image", pBlotted.release());
+   return true;
+}
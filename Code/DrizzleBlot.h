@@ -0,0 +1,43 @@
+/********************************************//*
+*
+* @file: DrizzleBlot.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DRIZZLEBLOT_H
+#define DRIZZLEBLOT_H
+
+#include "ExecutableShell.h"
+
+/**
+*
+* Plugin which blots (reverse drizzles) a drizzled image onto the pixel grid of one of its
+* input images, e.g. for residual or outlier analysis. The overlap weights are taken from
+* the operator file recorded by the drizzle, so the geometry is not recomputed.
+* The blot is created as a child of the input image.
+*/
+class DrizzleBlot : public ExecutableShell
+{
+public:
+	/**
+	* Constructor for the blot plugin.
+	*/
+	DrizzleBlot();
+
+	/**
+	* Destructor for the blot plugin.
+	*/
+	~DrizzleBlot();
+
+	bool getInputSpecification(PlugInArgList*& pInArgList);
+	bool getOutputSpecification(PlugInArgList*& pOutArgList);
+	bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+};
+
+#endif
@@ -0,0 +1,46 @@
+/********************************************//*
+*
+* @file: DrizzleFrame.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleFrame_H
+#define DrizzleFrame_H
+
+#include "DrizzleAccumulator.h"
+
+#include <string>
+#include <vector>
+
+/**
+*
+* Registered video frame kept as a contiguous buffer instead of a RasterElement,
+* so no model elements, GCP lists or georeference runs are needed per frame.
+* The registration places the frame on the output grid through the coordinates of its corners.
+*/
+struct DrizzleFrame
+{
+	/**
+	* Name of the frame, e.g. recorded in a DrizzleOperator.
+	*/
+	std::string name;
+
+	/**
+	* Size, data type (INT1UBYTE or INT2UBYTES) and corners of the frame, in the coordinates of the output grid.
+	* The georeference plug-in and GCPs are not used.
+	*/
+	DrizzleGrid grid;
+
+	/**
+	* Pixels of the frame, row after row.
+	*/
+	std::vector<unsigned char> pixels;
+};
+
+#endif
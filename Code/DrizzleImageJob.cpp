@@ -0,0 +1,1335 @@
+/********************************************//*
+*
+* @file: DrizzleImageJob.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "AppVerify.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "DataVariant.h"
+#include "DynamicObject.h"
+#include "GcpList.h"
+#include "Layer.h"
+#include "MessageLogResource.h"
+#include "ModelServices.h"
+#include "ObjectResource.h"
+#include "Progress.h"
+#include "ProgressResource.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "Service.h"
+#include "SpatialDataView.h"
+#include "RasterUtilities.h"
+#include "switchOnEncoding.h"
+#include "TypeConverter.h"
+#include "drizzle_helper_functions.h"
+#include "DrizzleFrame.h"
+#include "DrizzleImageJob.h"
+#include "DrizzleJobManager.h"
+#include "DrizzleOperator.h"
+
+#include <Qt/qdatastream.h>
+#include <Qt/qdir.h>
+#include <Qt/qfile.h>
+#include <Qt/qfileinfo.h>
+#include <Qt/qregexp.h>
+#include <Qt/qstringlist.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <new>
+
+namespace
+{
+	/**
+	* Source image of the kernel read through a DataAccessor, located by the georeference of its RasterElement.
+	*/
+	class RasterSource
+	{
+	public:
+		RasterSource(DataAccessor& pAcc) :
+			mpAcc(pAcc),
+			mpElement(pAcc->getAssociatedRasterElement())
+		{
+		}
+
+		LocationType geoToPixel(const LocationType& geo) const
+		{
+			return mpElement->convertGeocoordToPixel(geo);
+		}
+
+		template<typename T>
+		bool read(int row, int col, T& value)
+		{
+			mpAcc->toPixel(row, col);
+			if (!mpAcc.isValid())
+			{
+				return false;
+			}
+			value = *reinterpret_cast<T*>(mpAcc->getColumn());
+			return true;
+		}
+
+	private:
+		DataAccessor& mpAcc;
+		const RasterElement* mpElement;
+	};
+
+	/**
+	* Source image of the kernel held in a DrizzleFrame, located by the corners of the frame.
+	*/
+	class FrameSource
+	{
+	public:
+		FrameSource(const DrizzleFrame& frame) :
+			mFrame(frame)
+		{
+		}
+
+		LocationType geoToPixel(const LocationType& geo) const
+		{
+			//Degenerate frames are left out by the jobs, the inversion then always succeeds
+			LocationType pixel;
+			mFrame.grid.geoToPixel(geo, pixel);
+			return pixel;
+		}
+
+		template<typename T>
+		bool read(int row, int col, T& value)
+		{
+			value = reinterpret_cast<const T*>(&mFrame.pixels[0])[static_cast<size_t>(row) * mFrame.grid.columns + col];
+			return true;
+		}
+
+	private:
+		const DrizzleFrame& mFrame;
+	};
+
+	template<typename T, typename Source>
+	/**
+	* Function which drizzles one source image onto one pixel of the destination image.
+	* The contribution is returned un-normalised so it can be added to a DrizzleAccumulator.
+	*
+	* @param pData Unused, only determines the data type T of the source image.
+	* @param source Source image, a RasterSource or a FrameSource.
+	* @param pSrcGrid Size and geographical corners of the source RasterElement.
+	* @param pGrid Output grid determining the geographical position of the destination pixels.
+	* @param row Current row of the destination image.
+	* @param col Current column of the destination image.
+	* @param drop Percentage of width and height of pixel of the source images which is taken into account (from 0 to 1).
+	* @param pSum Pointer to double to which the weighted source pixels are added.
+	* @param pWeight Pointer to double to which the overlap areas are added.
+	* @param overlapped Pointer to boolean indicating whether or not current pixel of destination image overlapped with the source RasterElement.
+	* @param separable True to use the separable kernel when the destination pixel is axis-aligned in the source image.
+	* @param pBlock Block to which the overlap weights are appended, NULL when they are not recorded.
+	* @param firstSource Number of the first pixel of the source image in the DrizzleOperator.
+	*/
+	void Drizzle(T* pData, Source& source, const DrizzleGrid* pSrcGrid, const DrizzleGrid* pGrid, unsigned int row, unsigned int col, double drop, double* pSum, double* pWeight, bool* overlapped, bool separable,
+		DrizzleOperatorBlock* pBlock, unsigned long long firstSource)
+	{
+		std::vector<LocationType> ipoints;	//initialise vector holding point of interest
+
+		LocationType dptl = pGrid->pixelToGeo(col, row);		//top left coordinates of destination pixel
+		LocationType dpbl = pGrid->pixelToGeo(col, row+1);		//bottom left coordinates of destination pixel
+		LocationType dptr = pGrid->pixelToGeo(col+1, row);		//top right coordinates of destination pixel
+		LocationType dpbr = pGrid->pixelToGeo(col+1, row+1);	//bottom right coordinates of destination pixel
+
+		double dptlx1 = dptl.mX;			//top left x coordinate of destination pixel
+		double dptly1 = dptl.mY;			//top left y coordinate of destination pixel
+		double dpblx1 = dpbl.mX;			//bottom left x coordinate of destination pixel
+		double dpbly1 = dpbl.mY;			//bottom left y coordinate of destination pixel
+		double dptrx1 = dptr.mX;			//top right x coordinate of destination pixel
+		double dptry1 = dptr.mY;			//top right y coordinate of destination pixel
+		double dpbrx1 = dpbr.mX;			//bottom right x coordinate of destination pixel
+		double dpbry1 = dpbr.mY;			//bottom right y coordinate of destination pixel
+
+		int srcrowSize = pSrcGrid->rows;		//height of source image
+		int srccolSize = pSrcGrid->columns;		//width of source image
+
+		//Corners of the destination pixel in the source image, each converted once
+		LocationType tlsrc = source.geoToPixel(dptl);
+		LocationType blsrc = source.geoToPixel(dpbl);
+		LocationType trsrc = source.geoToPixel(dptr);
+		LocationType brsrc = source.geoToPixel(dpbr);
+
+		double tlsrccol = (tlsrc.mX > 0) ? tlsrc.mX : 0;		//top left x coordinate of destination pixel wrt source image
+		double tlsrcrow = (tlsrc.mY > 0) ? tlsrc.mY : 0;		//top left y coordinate of destination pixel wrt source image
+		double trsrccol = (trsrc.mX > 0) ? trsrc.mX : 0;		//top right x coordinate of destination pixel wrt source image
+		double trsrcrow = (trsrc.mY > 0) ? trsrc.mY : 0;		//top right y coordinate of destination pixel wrt source image
+		double brsrccol = (brsrc.mX > 0) ? brsrc.mX : 0;		//bottom right x coordinate of destination pixel wrt source image
+		double brsrcrow = (brsrc.mY > 0) ? brsrc.mY : 0;		//bottom right y coordinate of destination pixel wrt source image
+		double blsrccol = (blsrc.mX > 0) ? blsrc.mX : 0;		//bottom left x coordinate of destination pixel wrt source image
+		double blsrcrow = (blsrc.mY > 0) ? blsrc.mY : 0;		//bottom left y coordinate of destination pixel wrt source image
+
+		//Destination pixel is an axis-aligned rectangle in the source image when both images are north-up
+		double tolerance = 1e-9 * (std::fabs(trsrccol - tlsrccol) + std::fabs(blsrcrow - tlsrcrow) + 1.0);
+		bool axisAligned = separable && std::fabs(tlsrccol - blsrccol) <= tolerance && std::fabs(trsrccol - brsrccol) <= tolerance
+			&& std::fabs(tlsrcrow - trsrcrow) <= tolerance && std::fabs(blsrcrow - brsrcrow) <= tolerance;
+
+		//Corners of the source image are sampled once per job by the DrizzleJobManager
+		const LocationType& geo1 = pSrcGrid->topLeft;			//coordinates of top left pixel of source image
+		const LocationType& geo2 = pSrcGrid->bottomLeft;		//coordinates of bottom left pixel of source image
+		const LocationType& geo3 = pSrcGrid->topRight;			//coordinates of top right pixel of source image
+		const LocationType& geo4 = pSrcGrid->bottomRight;		//coordinates of bottom right pixel of source image
+
+		double tlx1 = geo1.mX;			//x coordinate of top left pixel of source image
+		double tly1 = geo1.mY;			//y coordinate of top left pixel of source image
+		double blx1 = geo2.mX;			//x coordinate of top right pixel of source image
+		double bly1 = geo2.mY;			//y coordinate of top right pixel of source image 
+		double trx1 = geo3.mX;			//x coordinate of bottom left pixel of source image 
+		double try1 = geo3.mY;			//y coordinate of bottom left pixel of source image 
+		double brx1 = geo4.mX;			//x coordinate of bottom right pixel of source image 
+		double bry1 = geo4.mY;			//y coordinate of bottom right pixel of source image 
+
+		double dtx1 = trx1 - tlx1;		//difference in x coordinate over top of source image 
+		double dty1 = try1 - tly1;		//difference in y coordinate over top of source image
+		double dlx1 = blx1 - tlx1;		//difference in x coordinate over left side of source image
+		double dly1 = bly1 - tly1;		//difference in y coordinate over left side of source image
+		double dbx1 = brx1 - blx1;		//difference in x coordinate over bottom of source image
+		double dby1 = bry1 - bly1;		//difference in y coordinate over bottom of source image
+		double drx1 = brx1 - trx1;		//difference in x coordinate over right side of source image
+		double dry1 = bry1 - try1;		//difference in y coordinate over right side of source image
+		
+		//Get upper and lower bounds on searchable area for pixels of the source image
+		int rtlsrccol = int(std::floor(tlsrccol));
+		int rtlsrcrow = int(std::floor(tlsrcrow));
+		int rtrsrccol = int(std::floor(trsrccol));
+		int rtrsrcrow = int(std::ceil(trsrcrow));
+		int rbrsrccol = int(std::ceil(brsrccol));
+		int rbrsrcrow = int(std::ceil(brsrcrow));
+		int rblsrccol = int(std::ceil(blsrccol));
+		int rblsrcrow = int(std::floor(blsrcrow));
+
+		for(int srcrow = std::min(std::min(rtlsrcrow,rtrsrcrow),std::min(rblsrcrow,rbrsrcrow)); srcrow <= std::max(std::max(rtlsrcrow,rtrsrcrow),std::max(rblsrcrow,rbrsrcrow)); srcrow++){
+			for(int srccol = std::min(std::min(rtlsrccol,rtrsrccol),std::min(rblsrccol,rbrsrccol)); srccol <= std::max(std::max(rtlsrccol,rtrsrccol),std::max(rblsrccol,rbrsrccol)); srccol++){
+				if(srccol < srccolSize && srcrow < srcrowSize){ 
+					ipoints.clear();		//Clear interest points vector
+
+					double ddrop = (1-drop)/2;
+
+					double ptlx1 = tlx1 + ((((dbx1-dtx1)/srcrowSize)*double(srcrow + ddrop) + dtx1)/double(srccolSize))*double(srccol + ddrop) + ((((drx1-dlx1)/srccolSize)*double(srccol + ddrop) + dlx1)/double(srcrowSize))*double(srcrow + ddrop);					//top left x coordinate of source pixel 
+					double ptly1 = tly1 + ((((dby1-dty1)/srcrowSize)*double(srcrow + ddrop) + dty1)/double(srccolSize))*double(srccol + ddrop) + ((((dry1-dly1)/srccolSize)*double(srccol + ddrop) + dly1)/double(srcrowSize))*double(srcrow + ddrop);					//top left y coordinate of source pixel
+					double pblx1 = tlx1 + ((((dbx1-dtx1)/srcrowSize)*double(srcrow+1 - ddrop) + dtx1)/double(srccolSize))*double(srccol + ddrop) + ((((drx1-dlx1)/srccolSize)*double(srccol + ddrop) + dlx1)/double(srcrowSize))*double(srcrow+1 - ddrop);				//top right x coordinate of source pixel
+					double pbly1 = tly1 + ((((dby1-dty1)/srcrowSize)*double(srcrow+1 - ddrop) + dty1)/double(srccolSize))*double(srccol + ddrop) + ((((dry1-dly1)/srccolSize)*double(srccol + ddrop) + dly1)/double(srcrowSize))*double(srcrow+1 - ddrop);				//top right y coordinate of source pixel
+					double ptrx1 = tlx1 + ((((dbx1-dtx1)/srcrowSize)*double(srcrow + ddrop) + dtx1)/double(srccolSize))*double(srccol+1 - ddrop) + ((((drx1-dlx1)/srccolSize)*double(srccol+1 - ddrop) + dlx1)/double(srcrowSize))*double(srcrow + ddrop);				//bottom left x coordinate of source pixel
+					double ptry1 = tly1 + ((((dby1-dty1)/srcrowSize)*double(srcrow + ddrop) + dty1)/double(srccolSize))*double(srccol+1 - ddrop) + ((((dry1-dly1)/srccolSize)*double(srccol+1 - ddrop) + dly1)/double(srcrowSize))*double(srcrow + ddrop);				//bottom left y coordinate of source pixel
+					double pbrx1 = tlx1 + ((((dbx1-dtx1)/srcrowSize)*double(srcrow+1 - ddrop) + dtx1)/double(srccolSize))*double(srccol+1 - ddrop) + ((((drx1-dlx1)/srccolSize)*double(srccol+1 - ddrop) + dlx1)/double(srcrowSize))*double(srcrow+1 - ddrop);			//bottom right x coordinate of source pixel
+					double pbry1 = tly1 + ((((dby1-dty1)/srcrowSize)*double(srcrow+1 - ddrop) + dty1)/double(srccolSize))*double(srccol+1 - ddrop) + ((((dry1-dly1)/srccolSize)*double(srccol+1 - ddrop) + dly1)/double(srcrowSize))*double(srcrow+1 - ddrop);			//bottom right y coordinate of source pixel
+
+					//Check whether input and output pixel can overlap
+					if((std::max(std::max(pbrx1,pblx1),std::max(ptrx1,ptlx1))>=std::min(std::min(dpbrx1,dpblx1),std::min(dptrx1,dptlx1)))
+						&& (std::min(std::min(pbrx1,pblx1),std::min(ptrx1,ptlx1))<=std::max(std::max(dpbrx1,dpblx1),std::max(dptrx1,dptlx1)))
+						&& (std::max(std::max(pbry1,pbly1),std::max(ptry1,ptly1))>=std::min(std::min(dpbry1,dpbly1),std::min(dptry1,dptly1)))
+						&& (std::min(std::min(pbry1,pbly1),std::min(ptry1,ptly1))<=std::max(std::max(dpbry1,dpbly1),std::max(dptry1,dptly1))))
+					{
+						//SEPARABLE KERNEL: area of overlap is the product of the overlaps along both axes
+						if (axisAligned)
+						{
+							double overlapx = std::min(srccol+1 - ddrop, std::max(trsrccol, brsrccol)) - std::max(srccol + ddrop, std::min(tlsrccol, blsrccol));
+							double overlapy = std::min(srcrow+1 - ddrop, std::max(blsrcrow, brsrcrow)) - std::max(srcrow + ddrop, std::min(tlsrcrow, trsrcrow));
+							if (overlapx > 0 && overlapy > 0)
+							{
+								//Get source pixel value
+								T srcpixel;
+								VERIFYNRV(source.read(srcrow, srccol, srcpixel));
+
+								*pSum += overlapx*overlapy*srcpixel;
+								*pWeight += overlapx*overlapy;
+								*overlapped=true;
+								if (pBlock != NULL)
+								{
+									pBlock->sources.push_back(firstSource + static_cast<unsigned long long>(srcrow) * srccolSize + srccol);
+									pBlock->weights.push_back(overlapx*overlapy);
+								}
+							}
+							continue;
+						}
+
+						//SUTHERLAND-HODGMAN POLYGON CLIPPING
+
+						//Use of geographical positions -> limited resolution of double
+						/*std::vector<LocationType> subject;
+						subject.push_back(*(new LocationType(ptlx1,ptly1)));
+						subject.push_back(*(new LocationType(pblx1,pbly1)));
+						subject.push_back(*(new LocationType(pbrx1,pbry1)));
+						subject.push_back(*(new LocationType(ptrx1,ptry1)));
+						std::vector<LocationType> clip;
+						clip.push_back(*(new LocationType(dptlx1,dptly1)));
+						clip.push_back(*(new LocationType(dpblx1,dpbly1)));
+						clip.push_back(*(new LocationType(dpbrx1,dpbry1)));
+						clip.push_back(*(new LocationType(dptrx1,dptry1)));*/
+
+						//Use relative positions wrt source image instead of geographical positions due to limited resolution of double.
+						std::vector<LocationType> subject;
+						subject.push_back(LocationType(srccol + ddrop,srcrow + ddrop));
+						subject.push_back(LocationType(srccol + ddrop,srcrow+1 - ddrop));
+						subject.push_back(LocationType(srccol+1 - ddrop,srcrow+1  - ddrop));
+						subject.push_back(LocationType(srccol+1 - ddrop,srcrow + ddrop));
+
+						std::vector<LocationType> clip;
+						clip.push_back(LocationType(tlsrccol,tlsrcrow));
+						clip.push_back(LocationType(blsrccol,blsrcrow));
+						clip.push_back(LocationType(brsrccol,brsrcrow));
+						clip.push_back(LocationType(trsrccol,trsrcrow));
+						
+						std::vector<LocationType> p1;
+						std::vector<LocationType> tmp;
+
+						int dir = int(drizzle_helper_functions::left_of(clip[0], clip[1], clip[2]));
+						
+						drizzle_helper_functions::poly_edge_clip(subject, clip[clip.size()-1], clip[0], dir, &ipoints);
+
+						for (int i = 0; i < clip.size()-1; i++) {
+							tmp = ipoints; 
+							ipoints = p1; 
+							p1 = tmp;
+
+							if(p1.size() == 0) {
+								ipoints.clear();
+								break;
+							}
+							drizzle_helper_functions::poly_edge_clip(p1, clip[i], clip[i+1], dir, &ipoints);
+						}
+
+						p1.clear();
+						tmp.clear();
+
+						if(ipoints.size() > 0){
+							//CALCULATION OF AREA OF OVERLAP
+							double s1 = 0;
+							double s2 = 0;
+							double area = 0;
+							for (unsigned int i = 0; i < ipoints.size(); i++){
+								s1 += ipoints.at(i).mY*ipoints.at((i+1)%ipoints.size()).mX;
+								s2 += ipoints.at(i).mX*ipoints.at((i+1)%ipoints.size()).mY;
+							}
+
+							area = (s1-s2)/2.0;
+
+							//Total area for geographical coordinate
+							//double totalarea = (((ptly1*pblx1)+(pbly1*pbrx1)+(pbry1*ptrx1)+(ptry1*ptlx1))-((ptlx1*pbly1)+(pblx1*pbry1)+(pbrx1*ptry1)+(ptrx1*ptly1)))/2;
+
+							//Total area for relative coordinate
+							//double totalarea = (((tlsrcrow*blsrcrow)+(blsrcrow*brsrccol)+(brsrcrow*trsrccol)+(trsrcrow*tlsrccol))-((tlsrccol*blsrcrow)+(blsrccol*brsrcrow)+(brsrccol*trsrcrow)+(trsrccol*tlsrcrow)))/2;
+
+							//Get source pixel value
+							T srcpixel;
+							VERIFYNRV(source.read(srcrow, srccol, srcpixel));
+
+							//Add weighted source pixel and its weight to the contribution of this source image
+							*pSum += area*srcpixel;
+							*pWeight += area;
+							if (pBlock != NULL)
+							{
+								pBlock->sources.push_back(firstSource + static_cast<unsigned long long>(srcrow) * srccolSize + srccol);
+								pBlock->weights.push_back(area);
+							}
+
+							//Set overlapped true to be able to determine the number of overlapping images for each destination pixel
+							*overlapped=true;
+
+							//ipoints.clear();
+							//clip.clear();
+							//subject.clear();
+							//p1.clear();
+							//tmp.clear();
+						}
+					}
+				}
+			}
+		}
+		//ipoints.clear();
+	}
+};
+
+namespace
+{
+	/**
+	* Metadata attribute of a drizzled RasterElement holding the path of its accumulation state.
+	*/
+	const std::string STATE_ATTRIBUTE = "Drizzle/Accumulation state";
+
+	/**
+	* Identification of a checkpoint file ("DRZC"), followed by the format version.
+	*/
+	const quint32 CHECKPOINT_MAGIC = 0x44525A43;
+	const quint32 CHECKPOINT_VERSION = 2;
+
+	/**
+	* Replaces a file by a newly written temporary file.
+	*/
+	bool replaceFile(const QString& tempFile, const QString& filename)
+	{
+		QFile::remove(filename);
+		return QFile::rename(tempFile, filename);
+	}
+};
+
+ImageDrizzleJob::ImageDrizzleJob(RasterElement* pResult, GcpList* pResultGcps, ProgressResource* pProgress, const DrizzleGrid& grid, unsigned int startRow, unsigned int rowCount,
+	const std::vector<RasterElement*>& images, double drop, const std::string& partialFile, unsigned int tileSize, DrizzleKernel kernel) :
+	DrizzleJob(startRow, 0, rowCount, grid.columns, tileSize),
+	mpResult(pResult),
+	mpResultGcps(pResultGcps),
+	mpWeight(NULL),
+	mpCount(NULL),
+	mpProgress(pProgress),
+	mGrid(grid),
+	mpAccumulator(NULL),
+	mImages(images),
+	mDrop(drop),
+	mPartialFile(partialFile),
+	mKernel(kernel),
+	mOwnsInputs(false),
+	mSigmaClip(0.0),
+	mInPlace(false),
+	mpOperator(NULL),
+	mpRefinement(NULL),
+	mCheckpointInterval(0),
+	mResume(false)
+{
+}
+
+ImageDrizzleJob::~ImageDrizzleJob()
+{
+	delete mpAccumulator;
+	delete mpOperator;
+	delete mpProgress;
+	delete mpRefinement;
+	if (mOwnsInputs)
+	{
+		for (std::vector<DrizzleFrame*>::iterator it = mFrames.begin(); it != mFrames.end(); ++it){
+			delete *it;
+		}
+	}
+}
+
+void ImageDrizzleJob::setCoverageOutputs(RasterElement* pWeight, RasterElement* pCount)
+{
+	mpWeight = pWeight;
+	mpCount = pCount;
+}
+
+void ImageDrizzleJob::setInitialState(const std::string& filename)
+{
+	mInitialState = filename;
+	mInPlace = true;
+}
+
+std::string ImageDrizzleJob::getStateFile(const RasterElement* pElement)
+{
+	const DynamicObject* pMetadata = (pElement == NULL) ? NULL : pElement->getMetadata();
+	if (pMetadata == NULL)
+	{
+		return std::string();
+	}
+	return dv_cast<std::string>(pMetadata->getAttributeByPath(STATE_ATTRIBUTE), std::string());
+}
+
+void ImageDrizzleJob::addFrames(const std::vector<DrizzleFrame*>& frames)
+{
+	mFrames.insert(mFrames.end(), frames.begin(), frames.end());
+}
+
+void ImageDrizzleJob::setOwnsInputs(bool ownsInputs)
+{
+	mOwnsInputs = ownsInputs;
+}
+
+void ImageDrizzleJob::setCheckpoint(const std::string& filename)
+{
+	//Frames cannot be looked up when the job is resumed
+	if (!mFrames.empty())
+	{
+		return;
+	}
+	mCheckpointFile = filename;
+
+	//Names identify the RasterElements when the job is resumed
+	mResultName = mpResult->getName();
+	mImageNames.clear();
+	for (std::vector<RasterElement*>::iterator it = mImages.begin(); it != mImages.end(); ++it){
+		mImageNames.push_back((*it)->getName());
+	}
+}
+
+void ImageDrizzleJob::setOperatorFile(const std::string& filename)
+{
+	mOperatorFile = filename;
+}
+
+void ImageDrizzleJob::setSigmaClip(double k)
+{
+	mSigmaClip = std::max(k, 0.0);
+}
+
+ImageDrizzleJob* ImageDrizzleJob::createPreview(ImageDrizzleJob* pRefinement, ProgressResource* pProgress, const std::string& name)
+{
+	//Coarse grid of at most PreviewSize pixels along each axis
+	const DrizzleGrid& grid = pRefinement->mGrid;
+	unsigned int size = std::max(getSettingPreviewSize(), 1u);
+	unsigned int factor = (std::max(grid.rows, grid.columns) + size - 1) / size;
+	DrizzleGrid coarse = grid.decimate(factor);
+
+	//Inputs evenly spread over the images and frames
+	const std::vector<RasterElement*>& images = pRefinement->mImages;
+	const std::vector<DrizzleFrame*>& frames = pRefinement->mFrames;
+	size_t inputs = images.size() + frames.size();
+	size_t count = std::min(inputs, static_cast<size_t>(std::max(getSettingPreviewInputs(), 1u)));
+	std::vector<RasterElement*> subset;
+	std::vector<DrizzleFrame*> frameSubset;
+	for (size_t i = 0; i < count; ++i)
+	{
+		size_t input = (i * inputs) / count;
+		if (input < images.size())
+		{
+			subset.push_back(images[input]);
+		}
+		else
+		{
+			frameSubset.push_back(frames[input - images.size()]);
+		}
+	}
+
+	ImageDrizzleJob* pPreview = new ImageDrizzleJob(pRefinement->mpResult, pRefinement->mpResultGcps, pProgress, coarse, 0, coarse.rows,
+		subset, pRefinement->mDrop, std::string(), pRefinement->mTileSize, pRefinement->mKernel);
+	pPreview->addFrames(frameSubset);
+	pPreview->setCoverageOutputs(pRefinement->mpWeight, pRefinement->mpCount);
+	pPreview->setSigmaClip(pRefinement->mSigmaClip);
+	pPreview->mpRefinement = pRefinement;
+	pPreview->mRefinementName = name;
+
+	//The refinement overwrites the preview, which owns the output from now on
+	pRefinement->mInPlace = true;
+	return pPreview;
+}
+
+bool ImageDrizzleJob::getFootprint(const DrizzleGrid& srcGrid, const DrizzleGrid& grid, DrizzleFootprint& footprint)
+{
+	//Borders are only straight in the output grid when both grids are parallelograms
+	const int samples = 16;
+	double minCol = 0.0;
+	double maxCol = 0.0;
+	double minRow = 0.0;
+	double maxRow = 0.0;
+	for (int i = 0; i <= samples; i++)
+	{
+		double t = double(i) / samples;
+		LocationType border[] = { LocationType(t * srcGrid.columns, 0), LocationType(t * srcGrid.columns, srcGrid.rows),
+			LocationType(0, t * srcGrid.rows), LocationType(srcGrid.columns, t * srcGrid.rows) };
+		for (int j = 0; j < 4; j++)
+		{
+			LocationType pixel;
+			if (!grid.geoToPixel(srcGrid.pixelToGeo(border[j].mX, border[j].mY), pixel))
+			{
+				return false;
+			}
+			if (i == 0 && j == 0)
+			{
+				minCol = maxCol = pixel.mX;
+				minRow = maxRow = pixel.mY;
+			}
+			minCol = std::min(minCol, pixel.mX);
+			maxCol = std::max(maxCol, pixel.mX);
+			minRow = std::min(minRow, pixel.mY);
+			maxRow = std::max(maxRow, pixel.mY);
+		}
+	}
+
+	//Clamp before converting, inputs far outside the output grid do not overlap at all
+	double limit = 2.0 * std::max(grid.rows, grid.columns) + 2.0;
+	footprint.firstColumn = int(std::floor(std::max(minCol, -limit))) - 1;
+	footprint.lastColumn = int(std::ceil(std::min(maxCol, limit))) + 1;
+	footprint.firstRow = int(std::floor(std::max(minRow, -limit))) - 1;
+	footprint.lastRow = int(std::ceil(std::min(maxRow, limit))) + 1;
+	return true;
+}
+
+void ImageDrizzleJob::drizzlePixel(const DrizzleFrame& frame, const DrizzleGrid& grid, unsigned int row, unsigned int col, double drop, DrizzleKernel kernel,
+	double& sum, double& weight, bool& overlapped)
+{
+	FrameSource source(frame);
+	switchOnEncoding(frame.grid.dataType, Drizzle, NULL, source, &frame.grid, &grid, row, col, drop, &sum, &weight, &overlapped, kernel == KERNEL_SEPARABLE, NULL, 0);
+}
+
+std::string ImageDrizzleJob::getScratchFile(const std::string& name, const std::string& extension)
+{
+	//Names of imported RasterElements are often paths
+	QString base = QFileInfo(QString::fromStdString(name)).fileName();
+	base.replace(QRegExp("[^A-Za-z0-9_.-]"), "_");
+	base += "_" + QDateTime::currentDateTime().toString("yyyyMMddhhmmsszzz") + QString::fromStdString(extension);
+	return QDir::temp().filePath(base).toStdString();
+}
+
+ImageDrizzleJob* ImageDrizzleJob::resume(const std::string& filename, std::string& name, std::string& error)
+{
+	QFile file(QString::fromStdString(filename));
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		error = "Unable to open " + filename + ".";
+		return NULL;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_6);
+	quint32 magic = 0;
+	quint32 version = 0;
+	stream >> magic >> version;
+	if (magic != CHECKPOINT_MAGIC || version < 1 || version > CHECKPOINT_VERSION)
+	{
+		error = filename + " is not a Drizzle checkpoint.";
+		return NULL;
+	}
+
+	QString resultName;
+	quint32 startRow = 0;
+	quint32 rowCount = 0;
+	quint32 tileSize = 0;
+	qint32 kernel = 0;
+	double drop = 0.0;
+	QString partialFile;
+	QString initialState;
+	bool ownsInputs = false;
+	bool weight = false;
+	bool count = false;
+	QStringList imageNames;
+	QByteArray doneTiles;
+	stream >> resultName >> startRow >> rowCount >> tileSize >> kernel >> drop >> partialFile >> initialState
+		>> ownsInputs >> weight >> count >> imageNames >> doneTiles;
+
+	//Version 1 checkpoints precede sigma clipping
+	double sigmaClip = 0.0;
+	if (version >= 2)
+	{
+		stream >> sigmaClip;
+	}
+	if (stream.status() != QDataStream::Ok)
+	{
+		error = filename + " is truncated.";
+		return NULL;
+	}
+
+	//The output grid is stored with the accumulation state
+	std::auto_ptr<DrizzleAccumulator> pState(DrizzleAccumulator::load(filename + ".drzp", error));
+	if (pState.get() == NULL)
+	{
+		return NULL;
+	}
+	const DrizzleGrid& grid = pState->getGrid();
+
+	//Inputs are looked up by name, e.g. restored with the session
+	Service<ModelServices> pModel;
+	std::vector<RasterElement*> images;
+	for (QStringList::iterator it = imageNames.begin(); it != imageNames.end(); ++it){
+		RasterElement* pImage = dynamic_cast<RasterElement*>(pModel->getElement(it->toStdString(), TypeConverter::toString<RasterElement>(), NULL));
+		if (pImage == NULL)
+		{
+			error = "Input image " + it->toStdString() + " of the checkpoint is not loaded.";
+			return NULL;
+		}
+		images.push_back(pImage);
+	}
+
+	//Continue on the output of the interrupted run when it is still loaded
+	RasterElement* pResult = dynamic_cast<RasterElement*>(pModel->getElement(resultName.toStdString(), TypeConverter::toString<RasterElement>(), NULL));
+	GcpList* pGcps = NULL;
+	if (pResult != NULL)
+	{
+		const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(pResult->getDataDescriptor());
+		if (pDesc->getRowCount() != grid.rows || pDesc->getColumnCount() != grid.columns)
+		{
+			error = "The output image " + resultName.toStdString() + " does not match the checkpoint.";
+			return NULL;
+		}
+		pGcps = dynamic_cast<GcpList*>(pModel->getElement("Corner coordinates", TypeConverter::toString<GcpList>(), pResult));
+	}
+	else if (!initialState.isEmpty())
+	{
+		error = "The output image " + resultName.toStdString() + " to which inputs were added is not loaded.";
+		return NULL;
+	}
+	else
+	{
+		pResult = grid.createElement(resultName.toStdString(), NULL, &pGcps, error);
+		if (pResult == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	//Coverage outputs are children of the output
+	RasterElement* pCoverage[] = { NULL, NULL };
+	const bool coverage[] = { weight, count };
+	const std::string suffix[] = { "_Weight", "_Count" };
+	const EncodingType type[] = { FLT8BYTES, INT4UBYTES };
+	for (int i = 0; i < 2; i++)
+	{
+		if (!coverage[i])
+		{
+			continue;
+		}
+		pCoverage[i] = dynamic_cast<RasterElement*>(pModel->getElement(resultName.toStdString() + suffix[i], TypeConverter::toString<RasterElement>(), pResult));
+		if (pCoverage[i] == NULL)
+		{
+			pCoverage[i] = RasterUtilities::createRasterElement(resultName.toStdString() + suffix[i], grid.rows, grid.columns, type[i], true, pResult);
+		}
+	}
+
+	ImageDrizzleJob* pJob = new ImageDrizzleJob(pResult, pGcps, new ProgressResource("ProgressBar"), grid, startRow, rowCount,
+		images, drop, partialFile.toStdString(), tileSize, static_cast<DrizzleKernel>(kernel));
+	pJob->setCoverageOutputs(pCoverage[0], pCoverage[1]);
+	pJob->setOwnsInputs(ownsInputs);
+	pJob->setSigmaClip(sigmaClip);
+	if (!initialState.isEmpty())
+	{
+		//Only jobs which added inputs to an earlier result start from a state
+		pJob->setInitialState(initialState.toStdString());
+	}
+	pJob->setCheckpoint(filename);
+	pJob->mResume = true;
+	pJob->mDoneTiles.assign(doneTiles.constData(), doneTiles.constData() + doneTiles.size());
+
+	name = resultName.toStdString() + " (resumed)";
+	return pJob;
+}
+
+bool ImageDrizzleJob::checkpoint(std::string& filename, std::string& error)
+{
+	//The refinement is only submitted once the preview has finished, so the preview checkpoints it.
+	//Before it has started it resumes from the beginning, and overwrites the preview when it completes
+	if (mpRefinement != NULL)
+	{
+		return mpRefinement->checkpoint(filename, error);
+	}
+	if (mCheckpointFile.empty())
+	{
+		return false;
+	}
+
+	QMutexLocker lock(&mCheckpointMutex);
+	filename = mCheckpointFile;
+	return writeCheckpoint(error);
+}
+
+bool ImageDrizzleJob::writeCheckpoint(std::string& error)
+{
+	//The checkpoint a queued job resumes from is still valid
+	if (mpAccumulator == NULL && mResume)
+	{
+		return true;
+	}
+
+	//Snapshot of the tiles completed so far, tiles being drizzled are left empty and start over when the job is resumed.
+	//Completed tiles are no longer written to, so the accumulator is only locked while they are copied
+	QByteArray doneTiles;
+	std::auto_ptr<DrizzleAccumulator> pSnapshot;
+	{
+		QMutexLocker lock(&mTileMutex);
+		if (!mDoneTiles.empty())
+		{
+			doneTiles = QByteArray(&mDoneTiles[0], static_cast<int>(mDoneTiles.size()));
+		}
+		if (mpAccumulator != NULL)
+		{
+			try
+			{
+				pSnapshot.reset(new DrizzleAccumulator(mpAccumulator->getGrid(), mpAccumulator->getStartRow(), mpAccumulator->getStartColumn(),
+					mpAccumulator->getRows(), mpAccumulator->getColumns()));
+			}
+			catch (std::bad_alloc&)
+			{
+				error = "Not enough memory to write the checkpoint.";
+				return false;
+			}
+
+			//Rows of an earlier result outside the band of this job never change
+			unsigned int firstRow = pSnapshot->getStartRow();
+			unsigned int endRow = firstRow + pSnapshot->getRows();
+			if (firstRow < mStartRow && !pSnapshot->copy(*mpAccumulator, firstRow, pSnapshot->getStartColumn(),
+				mStartRow - firstRow, pSnapshot->getColumns(), error))
+			{
+				return false;
+			}
+			if (endRow > mStartRow + mRowCount && !pSnapshot->copy(*mpAccumulator, mStartRow + mRowCount, pSnapshot->getStartColumn(),
+				endRow - mStartRow - mRowCount, pSnapshot->getColumns(), error))
+			{
+				return false;
+			}
+			for (unsigned int i = 0; i < mDoneTiles.size(); i++){
+				DrizzleTile tile = getTile(i);
+				if (mDoneTiles[i] != 0 && !pSnapshot->copy(*mpAccumulator, tile.startRow, tile.startColumn, tile.rows, tile.columns, error))
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	//Accumulation state, only the grid before the job has started
+	std::string stateFile = mCheckpointFile + ".drzp";
+	if (pSnapshot.get() != NULL)
+	{
+		if (!pSnapshot->save(stateFile + ".tmp", error))
+		{
+			return false;
+		}
+	}
+	else if (!DrizzleAccumulator(mGrid, mStartRow, mStartColumn, 0, 0).save(stateFile + ".tmp", error))
+	{
+		return false;
+	}
+
+	QString tempFile = QString::fromStdString(mCheckpointFile + ".tmp");
+	QFile file(tempFile);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		error = "Unable to open " + mCheckpointFile + " for writing.";
+		return false;
+	}
+
+	QStringList imageNames;
+	for (std::vector<std::string>::iterator it = mImageNames.begin(); it != mImageNames.end(); ++it){
+		imageNames.push_back(QString::fromStdString(*it));
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_6);
+	stream << CHECKPOINT_MAGIC << CHECKPOINT_VERSION << QString::fromStdString(mResultName)
+		<< quint32(mStartRow) << quint32(mRowCount) << quint32(mTileSize) << qint32(mKernel) << mDrop
+		<< QString::fromStdString(mPartialFile) << QString::fromStdString(mInitialState)
+		<< mOwnsInputs << (mpWeight != NULL) << (mpCount != NULL) << imageNames << doneTiles << mSigmaClip;
+	file.close();
+	if (stream.status() != QDataStream::Ok || file.error() != QFile::NoError)
+	{
+		error = "Unable to write " + mCheckpointFile + ".";
+		return false;
+	}
+
+	//Replace the previous checkpoint only when the new one is complete
+	if (!replaceFile(QString::fromStdString(stateFile + ".tmp"), QString::fromStdString(stateFile)) ||
+		!replaceFile(tempFile, QString::fromStdString(mCheckpointFile)))
+	{
+		error = "Unable to replace " + mCheckpointFile + ".";
+		return false;
+	}
+	return true;
+}
+
+size_t ImageDrizzleJob::getMemoryEstimate() const
+{
+	//Sum, weight and count planes of the accumulator, once more while an earlier state is merged and for the checkpoint snapshot
+	size_t planes = static_cast<size_t>(mRowCount) * mColumnCount * (2 * sizeof(double) + sizeof(unsigned int));
+	size_t copies = 1 + ((mInitialState.empty() && !mResume) ? 0 : 1) + (mCheckpointFile.empty() ? 0 : 1);
+	return copies * planes;
+}
+
+bool ImageDrizzleJob::resumeState(bool& restored, std::string& error)
+{
+	restored = false;
+	std::auto_ptr<DrizzleAccumulator> pState(DrizzleAccumulator::load(mCheckpointFile + ".drzp", error));
+	if (pState.get() == NULL)
+	{
+		return false;
+	}
+
+	//Tiles which start over get back the part of the earlier result they held
+	std::auto_ptr<DrizzleAccumulator> pInitial;
+	if (!mInitialState.empty())
+	{
+		pInitial.reset(DrizzleAccumulator::load(mInitialState, error));
+		if (pInitial.get() == NULL)
+		{
+			return false;
+		}
+	}
+
+	QMutexLocker lock(&mTileMutex);
+	if (pState->getRows() == 0 || mDoneTiles.size() != getTileCount())
+	{
+		//Checkpoint was written before the job started
+		mDoneTiles.assign(getTileCount(), 0);
+		return true;
+	}
+	if (!mpAccumulator->merge(*pState, error))
+	{
+		return false;
+	}
+
+	for (unsigned int i = 0; i < mDoneTiles.size(); i++){
+		DrizzleTile tile = getTile(i);
+		if (mDoneTiles[i] == 0)
+		{
+			//Tiles which were being drizzled when the checkpoint was written start over
+			if (pInitial.get() == NULL)
+			{
+				mpAccumulator->clear(tile.startRow, tile.startColumn, tile.rows, tile.columns);
+			}
+			else if (!mpAccumulator->copy(*pInitial, tile.startRow, tile.startColumn, tile.rows, tile.columns, error))
+			{
+				return false;
+			}
+			continue;
+		}
+		if (pInitial.get() == NULL)
+		{
+			continue;
+		}
+
+		//Completed tiles already hold the earlier result, counts never decrease while inputs are added
+		for (unsigned int row = tile.startRow; row < tile.startRow + tile.rows; ++row){
+			for (unsigned int col = tile.startColumn; col < tile.startColumn + tile.columns; ++col){
+				if (pInitial->contains(row, col) && mpAccumulator->getCount(row, col) < pInitial->getCount(row, col))
+				{
+					error = "The checkpoint " + mCheckpointFile + " does not hold the result the inputs were added to.";
+					return false;
+				}
+			}
+		}
+	}
+	mGrid = pState->getGrid();
+	restored = true;
+	return true;
+}
+
+bool ImageDrizzleJob::prepare(std::string& error)
+{
+	DrizzleAccumulator* pAccumulator = NULL;
+	try
+	{
+		pAccumulator = new DrizzleAccumulator(mGrid, mStartRow, mStartColumn, mRowCount, mColumnCount);
+	}
+	catch (std::bad_alloc&)
+	{
+		error = "Not enough memory to drizzle the output image.";
+		return false;
+	}
+
+	//Checkpoints may be written from the GUI thread from now on
+	{
+		QMutexLocker lock(&mCheckpointMutex);
+		mpAccumulator = pAccumulator;
+	}
+	mCheckpointInterval = getSettingCheckpointInterval();
+	mCheckpointTimer.start();
+
+	bool restored = false;
+	if (mResume)
+	{
+		QMutexLocker lock(&mCheckpointMutex);
+		if (!resumeState(restored, error))
+		{
+			return false;
+		}
+	}
+	else
+	{
+		QMutexLocker lock(&mTileMutex);
+		mDoneTiles.assign(getTileCount(), 0);
+	}
+
+	//Continue from the accumulation state of the earlier drizzle, a restored checkpoint already holds it
+	if (!mInitialState.empty() && !restored)
+	{
+		std::auto_ptr<DrizzleAccumulator> pState(DrizzleAccumulator::load(mInitialState, error));
+		if (pState.get() == NULL)
+		{
+			return false;
+		}
+
+		//Checkpoints snapshot the accumulator under the same lock
+		QMutexLocker lock(&mTileMutex);
+		if (!mpAccumulator->merge(*pState, error))
+		{
+			return false;
+		}
+
+		//The stored grid also holds the GCPs needed to merge the state later on
+		mGrid = pState->getGrid();
+	}
+
+	//Georeference samplings of the inputs are shared with other jobs
+	mImageGrids.clear();
+	mFootprints.clear();
+	for (std::vector<RasterElement*>::iterator it = mImages.begin(); it != mImages.end(); ++it){
+		mImageGrids.push_back(DrizzleJobManager::instance()->getInputGrid(*it));
+
+		//Inputs whose footprint is unknown are drizzled onto every pixel
+		DrizzleFootprint footprint;
+		if (!getFootprint(mImageGrids.back(), mGrid, footprint))
+		{
+			footprint.firstRow = footprint.firstColumn = 0;
+			footprint.lastRow = mGrid.rows;
+			footprint.lastColumn = mGrid.columns;
+		}
+		mFootprints.push_back(footprint);
+	}
+	for (std::vector<DrizzleFrame*>::iterator it = mFrames.begin(); it != mFrames.end(); ++it){
+		mImageGrids.push_back((*it)->grid);
+
+		//Degenerate frames cover no pixels at all
+		DrizzleFootprint footprint;
+		if (!getFootprint(mImageGrids.back(), mGrid, footprint))
+		{
+			footprint.firstRow = footprint.firstColumn = 0;
+			footprint.lastRow = footprint.lastColumn = -1;
+		}
+		mFootprints.push_back(footprint);
+	}
+
+	//Resumed jobs skip tiles, so their weights cannot be recorded
+	if (!mOperatorFile.empty() && !mResume)
+	{
+		delete mpOperator;
+		mpOperator = new DrizzleOperator(mGrid, mStartRow, mStartColumn, mRowCount, mColumnCount);
+		mFirstSources.clear();
+		for (unsigned int i = 0; i < mImageGrids.size(); i++){
+			std::string name = (i < mImages.size()) ? mImages[i]->getName() : mFrames[i - mImages.size()]->name;
+			mFirstSources.push_back(mpOperator->addInput(name, mImageGrids[i].rows, mImageGrids[i].columns));
+		}
+	}
+
+	//Uniform grid over the tiles holding the inputs overlapping each tile
+	mTileImages.assign(getTileCount(), std::vector<unsigned int>());
+	unsigned int tileColumns = (mColumnCount + mTileSize - 1) / mTileSize;
+	unsigned int tileRows = (mRowCount + mTileSize - 1) / mTileSize;
+	for (unsigned int i = 0; i < mFootprints.size(); i++){
+		const DrizzleFootprint& footprint = mFootprints[i];
+		int firstRow = std::max(footprint.firstRow - int(mStartRow), 0);
+		int lastRow = std::min(footprint.lastRow - int(mStartRow), int(mRowCount) - 1);
+		int firstColumn = std::max(footprint.firstColumn - int(mStartColumn), 0);
+		int lastColumn = std::min(footprint.lastColumn - int(mStartColumn), int(mColumnCount) - 1);
+		if (firstRow > lastRow || firstColumn > lastColumn)
+		{
+			continue;
+		}
+
+		for (unsigned int tileRow = firstRow / mTileSize; tileRow <= lastRow / mTileSize && tileRow < tileRows; tileRow++){
+			for (unsigned int tileColumn = firstColumn / mTileSize; tileColumn <= lastColumn / mTileSize && tileColumn < tileColumns; tileColumn++){
+				mTileImages[tileRow * tileColumns + tileColumn].push_back(i);
+			}
+		}
+	}
+	return true;
+}
+
+bool ImageDrizzleJob::processTile(const DrizzleTile& tile, std::string& error)
+{
+	//Tiles completed before the checkpoint was written are skipped
+	unsigned int index = getTileIndex(tile);
+	{
+		QMutexLocker lock(&mTileMutex);
+		if (mDoneTiles[index] != 0)
+		{
+			return true;
+		}
+	}
+
+	//Only the inputs overlapping the tile are visited, each input image with its own DataAccessor (the images precede the frames)
+	const std::vector<unsigned int>& tileImages = mTileImages[index];
+	std::vector<DataAccessor> pSrcAcc;
+	for (std::vector<unsigned int>::const_iterator it = tileImages.begin(); it != tileImages.end() && *it < mImages.size(); ++it){
+		FactoryResource<DataRequest> pRequest;
+		pSrcAcc.push_back(mImages[*it]->getDataAccessor(pRequest.release()));
+	}
+
+	//Overlap weights of the tile, one row per pixel
+	std::auto_ptr<DrizzleOperatorBlock> pBlock;
+	if (mpOperator != NULL)
+	{
+		pBlock.reset(new DrizzleOperatorBlock());
+		pBlock->startRow = tile.startRow;
+		pBlock->startColumn = tile.startColumn;
+		pBlock->rows = tile.rows;
+		pBlock->columns = tile.columns;
+		pBlock->offsets.push_back(0);
+	}
+
+	//With sigma clipping the inputs are streamed twice: the first pass only gathers the running
+	//mean and variance of the contributions to every pixel of the tile (Welford), the second pass
+	//drizzles the contributions within mSigmaClip standard deviations of that mean
+	bool clip = mSigmaClip > 0.0;
+	std::vector<unsigned int> statCount;
+	std::vector<double> statMean;
+	std::vector<double> statM2;
+	if (clip)
+	{
+		statCount.resize(static_cast<size_t>(tile.rows) * tile.columns, 0);
+		statMean.resize(statCount.size(), 0.0);
+		statM2.resize(statCount.size(), 0.0);
+	}
+
+	for (int pass = clip ? 0 : 1; pass < 2; ++pass){
+		bool gather = (pass == 0);
+		for (unsigned int row = tile.startRow; row < tile.startRow + tile.rows; ++row){
+			//Poll abort flag for every row of the tile
+			if (isAborted())
+			{
+				return false;
+			}
+
+			for (unsigned int col = tile.startColumn; col < tile.startColumn + tile.columns; ++col)
+			{
+				size_t pixel = static_cast<size_t>(row - tile.startRow) * tile.columns + (col - tile.startColumn);
+				double limit = -1.0;
+				if (clip && !gather && statCount[pixel] >= 3 && statM2[pixel] > 0.0)
+				{
+					limit = mSigmaClip * std::sqrt(statM2[pixel] / (statCount[pixel] - 1));
+				}
+
+				//Drizzle input images, each overlapping image is counted once
+				unsigned int count = 0;
+				for (unsigned int j=0; j<tileImages.size();j++){
+					unsigned int i = tileImages[j];
+					const DrizzleFootprint& footprint = mFootprints[i];
+					if (int(row) < footprint.firstRow || int(row) > footprint.lastRow || int(col) < footprint.firstColumn || int(col) > footprint.lastColumn)
+					{
+						continue;
+					}
+
+					double sum = 0.0;
+					double weight = 0.0;
+					bool overlapped = false;
+					DrizzleOperatorBlock* pRecord = gather ? NULL : pBlock.get();
+					size_t recorded = (pRecord == NULL) ? 0 : pRecord->sources.size();
+					unsigned long long firstSource = (pRecord == NULL) ? 0 : mFirstSources[i];
+					if (i < mImages.size())
+					{
+						RasterSource source(pSrcAcc[j]);
+						switchOnEncoding(mImageGrids[i].dataType, Drizzle, NULL, source, &mImageGrids[i], &mGrid, row, col, mDrop, &sum, &weight, &overlapped, mKernel == KERNEL_SEPARABLE,
+							pRecord, firstSource);
+					}
+					else
+					{
+						FrameSource source(*mFrames[i - mImages.size()]);
+						switchOnEncoding(mImageGrids[i].dataType, Drizzle, NULL, source, &mImageGrids[i], &mGrid, row, col, mDrop, &sum, &weight, &overlapped, mKernel == KERNEL_SEPARABLE,
+							pRecord, firstSource);
+					}
+					if (!overlapped || weight <= 0.0)
+					{
+						if (!gather)
+						{
+							mpAccumulator->add(row, col, sum, weight, overlapped);
+							count += overlapped ? 1 : 0;
+						}
+						continue;
+					}
+
+					double value = sum / weight;
+					if (gather)
+					{
+						statCount[pixel]++;
+						double delta = value - statMean[pixel];
+						statMean[pixel] += delta / statCount[pixel];
+						statM2[pixel] += delta * (value - statMean[pixel]);
+						continue;
+					}
+
+					//Rejected contributions leave no trace, also not in the recorded weights
+					if (limit >= 0.0 && std::fabs(value - statMean[pixel]) > limit)
+					{
+						if (pRecord != NULL)
+						{
+							pRecord->sources.resize(recorded);
+							pRecord->weights.resize(recorded);
+						}
+						continue;
+					}
+					mpAccumulator->add(row, col, sum, weight, overlapped);
+					count++;
+				}
+
+				if (!gather && pBlock.get() != NULL)
+				{
+					pBlock->offsets.push_back(pBlock->sources.size());
+					pBlock->counts.push_back(count);
+				}
+			}
+		}
+	}
+
+	if (pBlock.get() != NULL)
+	{
+		mpOperator->addBlock(*pBlock);
+	}
+
+	//Remember the completed tile, and write a checkpoint now and then
+	bool due = false;
+	{
+		QMutexLocker lock(&mTileMutex);
+		mDoneTiles[index] = 1;
+		due = !mCheckpointFile.empty() && mCheckpointInterval > 0 && static_cast<unsigned int>(mCheckpointTimer.elapsed()) >= mCheckpointInterval * 1000;
+		if (due)
+		{
+			mCheckpointTimer.restart();
+		}
+	}
+	if (due && mCheckpointMutex.tryLock())
+	{
+		//A failed checkpoint does not stop the drizzle, the previous one is kept
+		std::string checkpointError;
+		writeCheckpoint(checkpointError);
+		mCheckpointMutex.unlock();
+	}
+	return true;
+}
+
+bool ImageDrizzleJob::finish(std::string& error)
+{
+	//A preview fills the whole output, the coverage outputs are left to the refinement
+	if (mpRefinement != NULL)
+	{
+		return mpAccumulator->normaliseScaled(mpResult, error);
+	}
+
+	//Divide output pixels by the sum of the weights of the input pixels drizzled onto them
+	if (!mpAccumulator->normalise(mpResult, error))
+	{
+		return false;
+	}
+	if (mpWeight != NULL && !mpAccumulator->writeWeight(mpWeight, error))
+	{
+		return false;
+	}
+	if (mpCount != NULL && !mpAccumulator->writeCount(mpCount, error))
+	{
+		return false;
+	}
+	if (mpOperator != NULL && !mpOperator->save(mOperatorFile, error))
+	{
+		return false;
+	}
+	return mPartialFile.empty() || mpAccumulator->save(mPartialFile, error);
+}
+
+bool ImageDrizzleJob::updateProgress(const std::string& message, int percent)
+{
+	if (mpProgress == NULL)
+	{
+		return true;
+	}
+
+	(*mpProgress)->updateProgress(message, percent, NORMAL);
+
+	//Abort the job when the user cancelled the progress
+	return !isProgressAborted(mpProgress);
+}
+
+void ImageDrizzleJob::complete(bool success, const std::string& error)
+{
+	StepResource pStep("Drizzle output", "app", "0C0B86C4-3DA4-4B0C-9C61-52D0B1A6E8C5");
+	Progress* pProgress = (mpProgress == NULL) ? NULL : mpProgress->get();
+	std::string msg = error;
+
+	//Checkpoint is no longer needed once the result is complete
+	if (success && !mCheckpointFile.empty())
+	{
+		QMutexLocker lock(&mCheckpointMutex);
+		QFile::remove(QString::fromStdString(mCheckpointFile));
+		QFile::remove(QString::fromStdString(mCheckpointFile + ".drzp"));
+	}
+
+	//Input images owned by the job are no longer needed, owned frames are deleted with the job
+	if (mOwnsInputs)
+	{
+		Service<ModelServices> pModel;
+		for (std::vector<RasterElement*>::iterator it = mImages.begin(); it != mImages.end(); ++it){
+			DrizzleJobManager::instance()->clearInputGrid(*it);
+			pModel->destroyElement(*it);
+		}
+		mImages.clear();
+	}
+
+	//An earlier result or a preview is updated in place, its view shows the new values
+	if (mInPlace)
+	{
+		if (success)
+		{
+			if (!mPartialFile.empty() && mpResult->getMetadata() != NULL)
+			{
+				mpResult->getMetadata()->setAttributeByPath(STATE_ATTRIBUTE, mPartialFile);
+			}
+			mpResult->updateData();
+			pStep->finalize();
+			if (pProgress != NULL)
+			{
+				pProgress->updateProgress("Done", 100, NORMAL);
+			}
+		}
+		else
+		{
+			pStep->finalize(Message::Failure, msg);
+			if (pProgress != NULL)
+			{
+				pProgress->updateProgress(msg, 0, ERRORS);
+			}
+		}
+		mpResult = NULL;
+		return;
+	}
+
+	//Create view of the output and its corner coordinates
+	SpatialDataView* pView = success ? createView(mpResult, mpResultGcps, msg) : NULL;
+	success = success && pView != NULL;
+
+	if (!success)
+	{
+		Service<ModelServices>()->destroyElement(mpResult);
+		pStep->finalize(Message::Failure, msg);
+		if (pProgress != NULL)
+		{
+			pProgress->updateProgress(msg, 0, ERRORS);
+		}
+	}
+	else
+	{
+		//Keep the accumulation state alongside the result, so inputs can be added later on
+		if (!mPartialFile.empty() && mpResult->getMetadata() != NULL)
+		{
+			mpResult->getMetadata()->setAttributeByPath(STATE_ATTRIBUTE, mPartialFile);
+		}
+
+		//Coverage outputs are available as hidden layers
+		RasterElement* pCoverage[] = { mpWeight, mpCount };
+		for (int i = 0; i < 2; i++)
+		{
+			Layer* pLayer = (pCoverage[i] == NULL) ? NULL : pView->createLayer(RASTER, pCoverage[i]);
+			if (pLayer != NULL)
+			{
+				pView->hideLayer(pLayer);
+			}
+		}
+
+		pStep->finalize();
+		if (pProgress != NULL)
+		{
+			pProgress->updateProgress("Done", 100, NORMAL);
+		}
+	}
+
+	//Refine the preview at full resolution, or drop the refinement with its output
+	if (mpRefinement != NULL)
+	{
+		ImageDrizzleJob* pRefinement = mpRefinement;
+		mpRefinement = NULL;
+		if (success)
+		{
+			DrizzleJobManager::instance()->submit(pRefinement, QString::fromStdString(mRefinementName));
+		}
+		else
+		{
+			pRefinement->complete(false, "Drizzle preview failed: " + msg);
+			delete pRefinement;
+		}
+	}
+	mpResult = NULL;
+	mpWeight = NULL;
+	mpCount = NULL;
+}
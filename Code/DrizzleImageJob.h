@@ -0,0 +1,309 @@
+/********************************************//*
+*
+* @file: DrizzleImageJob.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleImageJob_H
+#define DrizzleImageJob_H
+
+#include "ConfigurationSettings.h"
+#include "DrizzleAccumulator.h"
+#include "DrizzleJob.h"
+
+#include <Qt/qdatetime.h>
+#include <Qt/qmutex.h>
+
+#include <string>
+#include <vector>
+
+class DrizzleOperator;
+struct DrizzleFrame;
+class GcpList;
+class ProgressResource;
+class RasterElement;
+
+/**
+* Variant of the kernel computing the overlap of a destination pixel and a source pixel.
+*/
+enum DrizzleKernel
+{
+	/**
+	* Sutherland-Hodgman clipping of the pixels, works for any geometry.
+	*/
+	KERNEL_CLIP,
+
+	/**
+	* Product of the overlaps along both axes when the destination pixel is an
+	* axis-aligned rectangle in the source image, clipping otherwise.
+	*/
+	KERNEL_SEPARABLE
+};
+
+/**
+*
+* Bounding box of the footprint of an input image in the output image, in pixels (inclusive).
+*/
+struct DrizzleFootprint
+{
+	int firstRow;
+	int lastRow;
+	int firstColumn;
+	int lastColumn;
+};
+
+/**
+*
+* DrizzleJob which drizzles input images onto a DrizzleAccumulator and
+* writes the normalised result to the output RasterElement.
+* The footprints of the inputs are indexed per tile, so a tile only visits
+* the inputs which overlap it.
+*/
+class ImageDrizzleJob : public DrizzleJob
+{
+public:
+	SETTING(CheckpointInterval, Drizzle, unsigned int, 300)
+	SETTING(PreviewSize, Drizzle, unsigned int, 512)
+	SETTING(PreviewInputs, Drizzle, unsigned int, 16)
+
+	/**
+	* Constructor for the image drizzle job.
+	*
+	* @param pResult Georeferenced output RasterElement, the job takes ownership until it completes.
+	* @param pResultGcps GCP list of the output RasterElement, can be NULL.
+	* @param pProgress Progress of the job, the job takes ownership. Can be NULL.
+	* @param grid Output grid.
+	* @param startRow First row of the band of output rows to drizzle.
+	* @param rowCount Number of output rows to drizzle.
+	* @param images Input images.
+	* @param drop Dropsize (from 0 to 1).
+	* @param partialFile Path of the partial result file to write, empty when no partial result is needed.
+	* @param tileSize Width and height of one tile in pixels.
+	* @param kernel Kernel variant.
+	*/
+	ImageDrizzleJob(RasterElement* pResult, GcpList* pResultGcps, ProgressResource* pProgress, const DrizzleGrid& grid, unsigned int startRow, unsigned int rowCount,
+		const std::vector<RasterElement*>& images, double drop, const std::string& partialFile, unsigned int tileSize, DrizzleKernel kernel);
+
+	/**
+	* Destructor for the image drizzle job.
+	*/
+	~ImageDrizzleJob();
+
+	/**
+	* Sets the optional coverage outputs, written when the job has finished.
+	* They must have the size of the output grid and be children of the output RasterElement.
+	*
+	* @param pWeight RasterElement which will hold the sums of the weights, can be NULL.
+	* @param pCount RasterElement which will hold the numbers of overlapping input images, can be NULL.
+	*/
+	void setCoverageOutputs(RasterElement* pWeight, RasterElement* pCount);
+
+	/**
+	* Starts from the accumulation state of an earlier drizzle onto the same output grid
+	* instead of an empty accumulator, so only the new input images are drizzled.
+	* The output RasterElement is then the earlier result: it is updated in place and never removed.
+	*
+	* @param filename Path of the partial result file holding the accumulation state.
+	*/
+	void setInitialState(const std::string& filename);
+
+	/**
+	* Returns the accumulation state kept alongside a drizzled RasterElement.
+	*
+	* @param pElement Drizzled RasterElement.
+	* @return Path of the partial result file holding the accumulation state, empty when none is kept.
+	*/
+	static std::string getStateFile(const RasterElement* pElement);
+
+	/**
+	* Adds video frames to the inputs, drizzled after the input images.
+	* Jobs with frames cannot write checkpoints, the frames are not part of the model.
+	*
+	* @param frames Registered video frames.
+	*/
+	void addFrames(const std::vector<DrizzleFrame*>& frames);
+
+	/**
+	* Sets whether the job removes the input images and deletes the frames when it has completed.
+	*
+	* @param ownsInputs True when the job removes the inputs.
+	*/
+	void setOwnsInputs(bool ownsInputs);
+
+	/**
+	* Lets the job write a checkpoint every CheckpointInterval seconds, from which it can be resumed.
+	* The checkpoint is removed when the job has succeeded.
+	*
+	* @param filename Path of the checkpoint, the accumulation state is written next to it.
+	*/
+	void setCheckpoint(const std::string& filename);
+
+	/**
+	* Records the overlap weights of the drizzle as a DrizzleOperator and saves it when the job has finished,
+	* so the same geometry can be applied to other data sets. Not recorded when the job is resumed.
+	*
+	* @param filename Path of the operator file.
+	*/
+	void setOperatorFile(const std::string& filename);
+
+	/**
+	* Rejects outlying contributions, e.g. satellite trails or cosmic rays. Every tile streams its inputs twice:
+	* the first pass keeps the running mean and variance of the contributions to every output pixel,
+	* the second pass drizzles only the contributions within k standard deviations of that mean.
+	* Memory use does not depend on the number of inputs, the drizzle takes about twice as long.
+	*
+	* @param k Clipping threshold in standard deviations, 0 disables clipping.
+	*/
+	void setSigmaClip(double k);
+
+	/**
+	* Creates a job drizzling a quick preview of another job: a subset of its input images
+	* is drizzled onto a decimated output grid of at most PreviewSize pixels along each axis.
+	* The preview is shown at the size of the output RasterElement as soon as it completes,
+	* the other job is then queued to refine it in place. When the preview fails or is aborted,
+	* the other job is not run. Checkpoints of the preview are those of the other job, so a saved
+	* session resumes the refinement.
+	*
+	* @param pRefinement Job drizzling the whole output grid, the preview takes ownership.
+	* @param pProgress Progress of the preview, the preview takes ownership. Can be NULL.
+	* @param name Name under which the refinement is queued.
+	* @return New job.
+	*/
+	static ImageDrizzleJob* createPreview(ImageDrizzleJob* pRefinement, ProgressResource* pProgress, const std::string& name);
+
+	/**
+	* Calculates the bounding box of the footprint of an input image in the output grid,
+	* by sampling the border of the input image.
+	*
+	* @param srcGrid Grid of the input image.
+	* @param grid Output grid.
+	* @param footprint Footprint which will hold the bounding box, widened by one pixel.
+	* @return True when successfull, false when the footprint could not be determined.
+	*/
+	static bool getFootprint(const DrizzleGrid& srcGrid, const DrizzleGrid& grid, DrizzleFootprint& footprint);
+
+	/**
+	* Drizzles one video frame onto one pixel of the output grid, for jobs combining the contributions in another way.
+	* The contribution is returned un-normalised, as it would be added to a DrizzleAccumulator.
+	*
+	* @param frame Video frame.
+	* @param grid Output grid.
+	* @param row Row of the output pixel.
+	* @param col Column of the output pixel.
+	* @param drop Dropsize (from 0 to 1).
+	* @param kernel Kernel variant.
+	* @param sum Double to which the weighted input pixels are added.
+	* @param weight Double to which the overlap areas are added.
+	* @param overlapped Set to true when the input image overlaps the output pixel.
+	*/
+	static void drizzlePixel(const DrizzleFrame& frame, const DrizzleGrid& grid, unsigned int row, unsigned int col, double drop, DrizzleKernel kernel,
+		double& sum, double& weight, bool& overlapped);
+
+	/**
+	* Returns a new path in the scratch directory.
+	*
+	* @param name Name the file is based on, e.g. the name of a RasterElement.
+	* @param extension Extension of the file, including the dot.
+	* @return Path of the file.
+	*/
+	static std::string getScratchFile(const std::string& name, const std::string& extension);
+
+	/**
+	* Creates a job which continues from a checkpoint.
+	* The input images must be loaded, they are looked up by name.
+	*
+	* @param filename Path of the checkpoint.
+	* @param name String which will hold the name of the job.
+	* @param error String which will hold the error message on failure.
+	* @return New job, NULL on failure.
+	*/
+	static ImageDrizzleJob* resume(const std::string& filename, std::string& name, std::string& error);
+
+	size_t getMemoryEstimate() const;
+	bool prepare(std::string& error);
+	bool processTile(const DrizzleTile& tile, std::string& error);
+	bool finish(std::string& error);
+	bool updateProgress(const std::string& message, int percent);
+	void complete(bool success, const std::string& error);
+	bool checkpoint(std::string& filename, std::string& error);
+
+private:
+	/**
+	* Writes the checkpoint, serialised by mCheckpointMutex.
+	*/
+	bool writeCheckpoint(std::string& error);
+
+	/**
+	* Loads the accumulation state of the checkpoint and restores the tiles which were not completed
+	* to the initial state, or clears them when the job has no initial state.
+	*
+	* @param restored Set to true when the accumulator holds the state of the checkpoint,
+	*                 false when the checkpoint was written before the job started.
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull, false otherwise.
+	*/
+	bool resumeState(bool& restored, std::string& error);
+
+	RasterElement* mpResult;
+	GcpList* mpResultGcps;
+	RasterElement* mpWeight;
+	RasterElement* mpCount;
+	ProgressResource* mpProgress;
+	DrizzleGrid mGrid;
+	DrizzleAccumulator* mpAccumulator;
+	std::vector<RasterElement*> mImages;
+	std::vector<DrizzleFrame*> mFrames;
+
+	/**
+	* Grids and footprints of the input images followed by those of the frames.
+	*/
+	std::vector<DrizzleGrid> mImageGrids;
+	std::vector<DrizzleFootprint> mFootprints;
+	std::vector<std::vector<unsigned int> > mTileImages;
+	double mDrop;
+	std::string mPartialFile;
+	std::string mInitialState;
+	DrizzleKernel mKernel;
+	bool mOwnsInputs;
+	double mSigmaClip;
+
+	/**
+	* The output RasterElement is already shown: it is updated in place and never removed.
+	*/
+	bool mInPlace;
+
+	/**
+	* Overlap weights recorded for mOperatorFile, and the number of the first pixel of every input.
+	*/
+	std::string mOperatorFile;
+	DrizzleOperator* mpOperator;
+	std::vector<unsigned long long> mFirstSources;
+
+	/**
+	* Job queued to refine this preview, NULL when this job is not a preview.
+	*/
+	ImageDrizzleJob* mpRefinement;
+	std::string mRefinementName;
+
+	std::string mCheckpointFile;
+	std::string mResultName;
+	std::vector<std::string> mImageNames;
+	unsigned int mCheckpointInterval;
+	QTime mCheckpointTimer;
+	QMutex mCheckpointMutex;
+	bool mResume;
+
+	/**
+	* Tiles which are drizzled completely, protected by mTileMutex.
+	*/
+	std::vector<char> mDoneTiles;
+	QMutex mTileMutex;
+};
+
+#endif
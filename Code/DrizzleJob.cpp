@@ -0,0 +1,139 @@
+/********************************************//*
+*
+* @file: DrizzleJob.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "DesktopServices.h"
+#include "GcpList.h"
+#include "Progress.h"
+#include "ProgressResource.h"
+#include "RasterElement.h"
+#include "Service.h"
+#include "SpatialDataView.h"
+#include "SpatialDataWindow.h"
+#include "DrizzleJob.h"
+
+#include <algorithm>
+
+DrizzleJob::DrizzleJob(unsigned int startRow, unsigned int startColumn, unsigned int rowCount, unsigned int columnCount, unsigned int tileSize) :
+	mStartRow(startRow),
+	mStartColumn(startColumn),
+	mRowCount(rowCount),
+	mColumnCount(columnCount),
+	mTileSize(std::max(tileSize, 1u)),
+	mpAbortFlag(NULL)
+{
+}
+
+DrizzleJob::~DrizzleJob()
+{
+}
+
+unsigned int DrizzleJob::getTileCount() const
+{
+	unsigned int tileRows = (mRowCount + mTileSize - 1) / mTileSize;
+	unsigned int tileColumns = (mColumnCount + mTileSize - 1) / mTileSize;
+	return tileRows * tileColumns;
+}
+
+DrizzleTile DrizzleJob::getTile(unsigned int index) const
+{
+	unsigned int tileColumns = (mColumnCount + mTileSize - 1) / mTileSize;
+
+	unsigned int row = (index / tileColumns) * mTileSize;
+	unsigned int column = (index % tileColumns) * mTileSize;
+
+	DrizzleTile tile;
+	tile.startRow = mStartRow + row;
+	tile.startColumn = mStartColumn + column;
+	tile.rows = std::min(mTileSize, mRowCount - row);
+	tile.columns = std::min(mTileSize, mColumnCount - column);
+	tile.part = 0;
+	return tile;
+}
+
+unsigned int DrizzleJob::getTileIndex(const DrizzleTile& tile) const
+{
+	unsigned int tileColumns = (mColumnCount + mTileSize - 1) / mTileSize;
+	return ((tile.startRow - mStartRow) / mTileSize) * tileColumns + (tile.startColumn - mStartColumn) / mTileSize;
+}
+
+bool DrizzleJob::prepare(std::string& error)
+{
+	return true;
+}
+
+bool DrizzleJob::finish(std::string& error)
+{
+	return true;
+}
+
+size_t DrizzleJob::getMemoryEstimate() const
+{
+	return 0;
+}
+
+bool DrizzleJob::updateProgress(const std::string& message, int percent)
+{
+	return true;
+}
+
+void DrizzleJob::complete(bool success, const std::string& error)
+{
+}
+
+bool DrizzleJob::checkpoint(std::string& filename, std::string& error)
+{
+	return false;
+}
+
+void DrizzleJob::setAbortFlag(const QAtomicInt* pAbortFlag)
+{
+	mpAbortFlag = pAbortFlag;
+}
+
+bool DrizzleJob::isAborted() const
+{
+	return mpAbortFlag != NULL && int(*mpAbortFlag) != 0;
+}
+
+bool DrizzleJob::isProgressAborted(ProgressResource* pProgress)
+{
+	if (pProgress == NULL)
+	{
+		return false;
+	}
+
+	std::string text;
+	int current = 0;
+	ReportingLevel level = NORMAL;
+	(*pProgress)->getProgress(text, current, level);
+	return level == ABORT;
+}
+
+SpatialDataView* DrizzleJob::createView(RasterElement* pResult, GcpList* pGcpList, std::string& error)
+{
+	Service<DesktopServices> pDesktop;
+	SpatialDataWindow* pWindow = static_cast<SpatialDataWindow*>(pDesktop->createWindow(pResult->getName(), SPATIAL_DATA_WINDOW));
+	SpatialDataView* pView = (pWindow == NULL) ? NULL : pWindow->getSpatialDataView();
+	if (pView == NULL)
+	{
+		error = "Unable to create view.";
+		return NULL;
+	}
+
+	pView->setPrimaryRasterElement(pResult);
+	pView->createLayer(RASTER, pResult);
+	if (pGcpList != NULL)
+	{
+		pView->createLayer(GCP_LAYER, pGcpList, "Corner Coordinates");
+	}
+	return pView;
+}
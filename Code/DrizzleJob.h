@@ -0,0 +1,241 @@
+/********************************************//*
+*
+* @file: DrizzleJob.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleJob_H
+#define DrizzleJob_H
+
+#include <Qt/qatomic.h>
+
+#include <stddef.h>
+#include <string>
+
+class GcpList;
+class ProgressResource;
+class RasterElement;
+class SpatialDataView;
+
+/**
+*
+* Rectangular block of the destination image which is processed as one unit of work.
+*/
+struct DrizzleTile
+{
+	/**
+	* First row of the tile in the destination image.
+	*/
+	unsigned int startRow;
+
+	/**
+	* First column of the tile in the destination image.
+	*/
+	unsigned int startColumn;
+
+	/**
+	* Number of rows of the tile.
+	*/
+	unsigned int rows;
+
+	/**
+	* Number of columns of the tile.
+	*/
+	unsigned int columns;
+
+	/**
+	* Part of a composite job the tile belongs to, 0 for other jobs.
+	*/
+	unsigned int part;
+};
+
+/**
+*
+* Base class for a drizzle computation which can be run off the GUI thread.
+* A region of the destination image is split into tiles, each tile is drizzled
+* independently so the computation can be aborted between (and within) tiles.
+*/
+class DrizzleJob
+{
+public:
+	/**
+	* Constructor for a drizzle job.
+	*
+	* @param startRow First row of the region of the destination image to drizzle.
+	* @param startColumn First column of the region of the destination image to drizzle.
+	* @param rowCount Height of the region.
+	* @param columnCount Width of the region.
+	* @param tileSize Width and height of one tile in pixels.
+	*/
+	DrizzleJob(unsigned int startRow, unsigned int startColumn, unsigned int rowCount, unsigned int columnCount, unsigned int tileSize);
+
+	/**
+	* Destructor for a drizzle job.
+	*/
+	virtual ~DrizzleJob();
+
+	/**
+	* Returns the number of tiles the region is split into.
+	* Composite jobs return the tiles of all their parts.
+	*
+	* @return Number of tiles.
+	*/
+	virtual unsigned int getTileCount() const;
+
+	/**
+	* Returns a tile of the destination image, tiles are numbered row by row.
+	*
+	* @param index Index of the tile (from 0 to getTileCount()-1).
+	* @return The tile with the given index.
+	*/
+	virtual DrizzleTile getTile(unsigned int index) const;
+
+	/**
+	* Returns the index of a tile, the inverse of getTile.
+	*
+	* @param tile Tile of this job.
+	* @return Index of the tile.
+	*/
+	unsigned int getTileIndex(const DrizzleTile& tile) const;
+
+	/**
+	* Performs calculations needed before the first tile is drizzled.
+	* Called on the worker thread.
+	*
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull, false otherwise.
+	*/
+	virtual bool prepare(std::string& error);
+
+	/**
+	* Drizzles all input images onto one tile of the destination image.
+	* Called on the worker thread.
+	*
+	* @param tile Tile of the destination image to drizzle.
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull, false otherwise.
+	*/
+	virtual bool processTile(const DrizzleTile& tile, std::string& error) = 0;
+
+	/**
+	* Performs calculations needed after the last tile is drizzled, e.g. writing the result.
+	* Called on the worker thread, not called when the job failed or was aborted.
+	*
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull, false otherwise.
+	*/
+	virtual bool finish(std::string& error);
+
+	/**
+	* Returns an estimate of the memory the job allocates in prepare(),
+	* used by the DrizzleJobManager to keep concurrent jobs within the memory budget.
+	*
+	* @return Estimated number of bytes, default 0.
+	*/
+	virtual size_t getMemoryEstimate() const;
+
+	/**
+	* Reports the progress of the job.
+	* Called periodically on the GUI thread while the job is running.
+	*
+	* @param message Progress message.
+	* @param percent Percentage of tiles which are drizzled.
+	* @return False when the user requested to abort the job, true otherwise.
+	*/
+	virtual bool updateProgress(const std::string& message, int percent);
+
+	/**
+	* Handles the outcome of the job, e.g. creating a view of the result.
+	* Called on the GUI thread after the job has stopped, the job is deleted afterwards.
+	*
+	* @param success True when all tiles were drizzled and finish() succeeded.
+	* @param error Error message when the job failed or was aborted.
+	*/
+	virtual void complete(bool success, const std::string& error);
+
+	/**
+	* Writes a checkpoint from which the job can be resumed, e.g. when the session is saved.
+	* Called from the GUI thread, also while tiles are being processed.
+	* The default implementation does not support checkpoints.
+	*
+	* @param filename String which will hold the path of the checkpoint.
+	* @param error String which will hold the error message on failure.
+	* @return True when a checkpoint was written.
+	*/
+	virtual bool checkpoint(std::string& filename, std::string& error);
+
+	/**
+	* Sets the flag which is polled to determine whether the job has been aborted.
+	*
+	* @param pAbortFlag Flag which is non-zero when the job has to be aborted.
+	*/
+	virtual void setAbortFlag(const QAtomicInt* pAbortFlag);
+
+	/**
+	* Determines whether the job has been aborted.
+	* Tile implementations poll this between input images.
+	*
+	* @return True when the job has been aborted.
+	*/
+	bool isAborted() const;
+
+protected:
+	/**
+	* Shows a drizzled output in a new spatial data view, with its corner coordinates as a GCP layer.
+	* Called on the GUI thread, typically from complete().
+	*
+	* @param pResult Georeferenced output RasterElement.
+	* @param pGcpList GCP list with the corner coordinates of the output, can be NULL.
+	* @param error String which will hold the error message on failure.
+	* @return The new view, NULL on failure.
+	*/
+	static SpatialDataView* createView(RasterElement* pResult, GcpList* pGcpList, std::string& error);
+
+	/**
+	* Determines whether the user cancelled the progress of a job.
+	* Called on the GUI thread, typically at the end of updateProgress().
+	*
+	* @param pProgress Progress of the job, can be NULL.
+	* @return True when the progress was cancelled.
+	*/
+	static bool isProgressAborted(ProgressResource* pProgress);
+
+	/**
+	* First row of the region.
+	*/
+	unsigned int mStartRow;
+
+	/**
+	* First column of the region.
+	*/
+	unsigned int mStartColumn;
+
+	/**
+	* Height of the region.
+	*/
+	unsigned int mRowCount;
+
+	/**
+	* Width of the region.
+	*/
+	unsigned int mColumnCount;
+
+	/**
+	* Width and height of one tile.
+	*/
+	unsigned int mTileSize;
+
+private:
+	/**
+	* Flag which is non-zero when the job has been aborted.
+	*/
+	const QAtomicInt* mpAbortFlag;
+};
+
+#endif
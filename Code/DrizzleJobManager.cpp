@@ -0,0 +1,539 @@
+/********************************************//*
+*
+* @file: DrizzleJobManager.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "DrizzleJobManager.h"
+#include "DrizzleTuner.h"
+
+#include <Qt/qatomic.h>
+#include <Qt/qdatetime.h>
+#include <Qt/qfileinfo.h>
+#include <Qt/qmetaobject.h>
+#include <Qt/qrunnable.h>
+#include <Qt/qthread.h>
+#include <Qt/qthreadpool.h>
+#include <Qt/qtimer.h>
+
+#include <algorithm>
+
+/**
+*
+* Bookkeeping of one job in the DrizzleJobManager.
+*/
+class DrizzleJobEntry
+{
+public:
+	DrizzleJobEntry(int id, const QString& name, DrizzleJob* pJob) :
+		mId(id),
+		mName(name),
+		mpJob(pJob),
+		mState(JOB_QUEUED),
+		mMemory(pJob->getMemoryEstimate()),
+		mTileCount(pJob->getTileCount()),
+		mNextTile(0),
+		mTilesDone(0),
+		mActiveTasks(0),
+		mAborted(0),
+		mUserAborted(false),
+		mSuccess(false),
+		mElapsed(0),
+		mLastPercent(-1)
+	{
+		mpJob->setAbortFlag(&mAborted);
+	}
+
+	~DrizzleJobEntry()
+	{
+		delete mpJob;
+	}
+
+	int mId;
+	QString mName;
+	DrizzleJob* mpJob;
+	DrizzleJobState mState;
+	size_t mMemory;
+	unsigned int mTileCount;
+
+	/**
+	* Index of the next tile to be claimed by a task.
+	*/
+	QAtomicInt mNextTile;
+
+	/**
+	* Number of tiles which are drizzled.
+	*/
+	QAtomicInt mTilesDone;
+
+	/**
+	* Number of tasks of this job which are queued or running in the pool.
+	*/
+	QAtomicInt mActiveTasks;
+
+	/**
+	* Non-zero when the job has to stop, polled by the job itself.
+	*/
+	QAtomicInt mAborted;
+
+	/**
+	* True when the job was aborted through abort() rather than by a failing tile.
+	*/
+	bool mUserAborted;
+
+	/**
+	* Error message of the first failing tile, protected by mMutex.
+	*/
+	std::string mError;
+	bool mSuccess;
+	QMutex mMutex;
+
+	QTime mTimer;
+	int mElapsed;
+	int mLastPercent;
+};
+
+namespace
+{
+	/**
+	*
+	* Task in the shared thread pool which drizzles tiles of one job.
+	* The first task of a job prepares it and starts the other tasks, all tasks claim
+	* tiles until none are left. The last task to stop finishes the job.
+	*/
+	class DrizzleTileTask : public QRunnable
+	{
+	public:
+		DrizzleTileTask(DrizzleJobManager* pManager, QThreadPool* pPool, DrizzleJobEntry* pEntry, int helpers) :
+			mpManager(pManager),
+			mpPool(pPool),
+			mpEntry(pEntry),
+			mHelpers(helpers)
+		{
+		}
+
+		void run()
+		{
+			DrizzleJob* pJob = mpEntry->mpJob;
+			std::string error;
+			bool success = true;
+
+			if (mHelpers >= 0)
+			{
+				//First task of the job
+				success = pJob->prepare(error);
+				if (success)
+				{
+					for (int i = 0; i < mHelpers; ++i)
+					{
+						mpEntry->mActiveTasks.fetchAndAddOrdered(1);
+						mpPool->start(new DrizzleTileTask(mpManager, mpPool, mpEntry, -1));
+					}
+				}
+			}
+
+			while (success && !pJob->isAborted())
+			{
+				unsigned int index = static_cast<unsigned int>(mpEntry->mNextTile.fetchAndAddOrdered(1));
+				if (index >= mpEntry->mTileCount)
+				{
+					break;
+				}
+				success = pJob->processTile(pJob->getTile(index), error);
+				mpEntry->mTilesDone.fetchAndAddOrdered(1);
+			}
+
+			if (!success)
+			{
+				//Stop the other tasks of this job, only the first error is kept
+				QMutexLocker lock(&mpEntry->mMutex);
+				if (mpEntry->mError.empty())
+				{
+					mpEntry->mError = error;
+				}
+				mpEntry->mAborted.fetchAndStoreOrdered(1);
+			}
+
+			//Last task of the job
+			if (mpEntry->mActiveTasks.fetchAndAddOrdered(-1) == 1)
+			{
+				bool ok = false;
+				{
+					QMutexLocker lock(&mpEntry->mMutex);
+					ok = mpEntry->mError.empty() && !pJob->isAborted();
+				}
+				if (ok)
+				{
+					ok = pJob->finish(error);
+					if (!ok)
+					{
+						QMutexLocker lock(&mpEntry->mMutex);
+						mpEntry->mError = error;
+					}
+				}
+				mpEntry->mSuccess = ok;
+				QMetaObject::invokeMethod(mpManager, "taskFinished", Qt::QueuedConnection, Q_ARG(int, mpEntry->mId));
+			}
+		}
+
+	private:
+		DrizzleJobManager* mpManager;
+		QThreadPool* mpPool;
+		DrizzleJobEntry* mpEntry;
+
+		/**
+		* Number of tasks to start after preparing the job, -1 for those tasks themselves.
+		*/
+		int mHelpers;
+	};
+};
+
+DrizzleJobManager* DrizzleJobManager::instance()
+{
+	//Shared by all plugin instances and kept for the lifetime of the application
+	static DrizzleJobManager* spManager = NULL;
+	if (spManager == NULL)
+	{
+		spManager = new DrizzleJobManager();
+	}
+	return spManager;
+}
+
+DrizzleJobManager::DrizzleJobManager() :
+	mpPool(new QThreadPool(this)),
+	mpTimer(new QTimer(this)),
+	mNextId(1),
+	mMemoryBudget(static_cast<size_t>(1024) * 1024 * 1024),
+	mMemoryInUse(0),
+	mpSessionOwner(NULL)
+{
+	mpPool->setMaxThreadCount(static_cast<int>(DrizzleTuner::getTuning().threads));
+	mpTimer->setInterval(250);
+	connect(mpTimer, SIGNAL(timeout()), this, SLOT(pollProgress()));
+}
+
+DrizzleJobManager::~DrizzleJobManager()
+{
+	abortAll();
+	mpPool->waitForDone();
+	for (QList<DrizzleJobEntry*>::iterator it = mJobs.begin(); it != mJobs.end(); ++it)
+	{
+		delete *it;
+	}
+}
+
+int DrizzleJobManager::submit(DrizzleJob* pJob, const QString& name)
+{
+	DrizzleJobEntry* pEntry = new DrizzleJobEntry(mNextId++, name, pJob);
+	mJobs.push_back(pEntry);
+	emit jobsChanged();
+
+	schedule();
+	return pEntry->mId;
+}
+
+void DrizzleJobManager::abort(int id)
+{
+	for (QList<DrizzleJobEntry*>::iterator it = mJobs.begin(); it != mJobs.end(); ++it)
+	{
+		DrizzleJobEntry* pEntry = *it;
+		if (pEntry->mId != id)
+		{
+			continue;
+		}
+
+		if (pEntry->mState == JOB_QUEUED)
+		{
+			//Never started, complete it right away
+			pEntry->mAborted.fetchAndStoreOrdered(1);
+			pEntry->mUserAborted = true;
+			completeJob(pEntry);
+			schedule();
+		}
+		else if (pEntry->mState == JOB_RUNNING)
+		{
+			//The tasks stop at the next tile or row
+			pEntry->mAborted.fetchAndStoreOrdered(1);
+			pEntry->mUserAborted = true;
+		}
+		return;
+	}
+}
+
+void DrizzleJobManager::abortAll()
+{
+	QList<int> ids;
+	for (QList<DrizzleJobEntry*>::iterator it = mJobs.begin(); it != mJobs.end(); ++it)
+	{
+		ids.push_back((*it)->mId);
+	}
+	for (QList<int>::iterator it = ids.begin(); it != ids.end(); ++it)
+	{
+		abort(*it);
+	}
+}
+
+QStringList DrizzleJobManager::checkpointAll()
+{
+	QStringList checkpoints;
+	for (QList<DrizzleJobEntry*>::iterator it = mJobs.begin(); it != mJobs.end(); ++it)
+	{
+		DrizzleJobEntry* pEntry = *it;
+		if (pEntry->mState != JOB_QUEUED && pEntry->mState != JOB_RUNNING)
+		{
+			continue;
+		}
+
+		std::string filename;
+		std::string error;
+		if (pEntry->mpJob->checkpoint(filename, error))
+		{
+			checkpoints.push_back(QString::fromStdString(filename));
+		}
+	}
+	return checkpoints;
+}
+
+bool DrizzleJobManager::isSessionOwner(const void* pInstance)
+{
+	if (mpSessionOwner == NULL)
+	{
+		mpSessionOwner = pInstance;
+	}
+	return mpSessionOwner == pInstance;
+}
+
+void DrizzleJobManager::releaseSessionOwner(const void* pInstance)
+{
+	if (mpSessionOwner == pInstance)
+	{
+		mpSessionOwner = NULL;
+	}
+}
+
+bool DrizzleJobManager::isResumed(const QString& filename) const
+{
+	return mResumedCheckpoints.contains(QFileInfo(filename).absoluteFilePath());
+}
+
+void DrizzleJobManager::setResumed(const QString& filename)
+{
+	mResumedCheckpoints.insert(QFileInfo(filename).absoluteFilePath());
+}
+
+QList<DrizzleJobInfo> DrizzleJobManager::getJobs() const
+{
+	QList<DrizzleJobInfo> jobs;
+	for (QList<DrizzleJobEntry*>::const_iterator it = mJobs.begin(); it != mJobs.end(); ++it)
+	{
+		DrizzleJobEntry* pEntry = *it;
+		DrizzleJobInfo info;
+		info.id = pEntry->mId;
+		info.name = pEntry->mName;
+		info.state = pEntry->mState;
+		info.tilesDone = std::min(static_cast<unsigned int>(int(pEntry->mTilesDone)), pEntry->mTileCount);
+		info.tileCount = pEntry->mTileCount;
+		info.elapsed = (pEntry->mState == JOB_RUNNING ? pEntry->mTimer.elapsed() : pEntry->mElapsed) / 1000.0;
+		info.memory = pEntry->mMemory;
+		QMutexLocker lock(&pEntry->mMutex);
+		info.error = QString::fromStdString(pEntry->mError);
+		jobs.push_back(info);
+	}
+	return jobs;
+}
+
+void DrizzleJobManager::clearFinished()
+{
+	for (QList<DrizzleJobEntry*>::iterator it = mJobs.begin(); it != mJobs.end();)
+	{
+		if ((*it)->mState != JOB_QUEUED && (*it)->mState != JOB_RUNNING)
+		{
+			delete *it;
+			it = mJobs.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+	emit jobsChanged();
+}
+
+int DrizzleJobManager::getThreadBudget() const
+{
+	return mpPool->maxThreadCount();
+}
+
+void DrizzleJobManager::setThreadBudget(int threads)
+{
+	mpPool->setMaxThreadCount(std::max(threads, 1));
+}
+
+size_t DrizzleJobManager::getMemoryBudget() const
+{
+	return mMemoryBudget;
+}
+
+void DrizzleJobManager::setMemoryBudget(size_t bytes)
+{
+	mMemoryBudget = bytes;
+	schedule();
+}
+
+DrizzleGrid DrizzleJobManager::getInputGrid(RasterElement* pElement)
+{
+	QMutexLocker lock(&mInputGridMutex);
+	std::map<RasterElement*, DrizzleGrid>::iterator found = mInputGrids.find(pElement);
+	if (found != mInputGrids.end())
+	{
+		return found->second;
+	}
+
+	//Sample the georeference of the corners of the input image
+	const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(pElement->getDataDescriptor());
+	DrizzleGrid grid;
+	grid.rows = pDesc->getRowCount();
+	grid.columns = pDesc->getColumnCount();
+	grid.dataType = pDesc->getDataType();
+	grid.topLeft = pElement->convertPixelToGeocoord(LocationType(0,0));
+	grid.bottomLeft = pElement->convertPixelToGeocoord(LocationType(0,grid.rows));
+	grid.bottomRight = pElement->convertPixelToGeocoord(LocationType(grid.columns,grid.rows));
+	grid.topRight = pElement->convertPixelToGeocoord(LocationType(grid.columns,0));
+	mInputGrids[pElement] = grid;
+	return grid;
+}
+
+void DrizzleJobManager::clearInputGrid(RasterElement* pElement)
+{
+	QMutexLocker lock(&mInputGridMutex);
+	mInputGrids.erase(pElement);
+}
+
+void DrizzleJobManager::pollProgress()
+{
+	QList<int> aborted;
+	for (QList<DrizzleJobEntry*>::iterator it = mJobs.begin(); it != mJobs.end(); ++it)
+	{
+		DrizzleJobEntry* pEntry = *it;
+		if (pEntry->mState != JOB_RUNNING || pEntry->mTileCount == 0)
+		{
+			continue;
+		}
+
+		unsigned int done = std::min(static_cast<unsigned int>(int(pEntry->mTilesDone)), pEntry->mTileCount);
+		int percent = static_cast<int>((static_cast<unsigned long long>(done) * 100) / pEntry->mTileCount);
+		if (!pEntry->mpJob->updateProgress("Calculating result", percent))
+		{
+			aborted.push_back(pEntry->mId);
+		}
+		if (percent != pEntry->mLastPercent)
+		{
+			pEntry->mLastPercent = percent;
+			emit jobProgress(pEntry->mId, percent);
+		}
+	}
+
+	for (QList<int>::iterator it = aborted.begin(); it != aborted.end(); ++it)
+	{
+		abort(*it);
+	}
+}
+
+void DrizzleJobManager::taskFinished(int id)
+{
+	for (QList<DrizzleJobEntry*>::iterator it = mJobs.begin(); it != mJobs.end(); ++it)
+	{
+		if ((*it)->mId == id)
+		{
+			mMemoryInUse -= std::min(mMemoryInUse, (*it)->mMemory);
+			completeJob(*it);
+			break;
+		}
+	}
+	schedule();
+}
+
+void DrizzleJobManager::schedule()
+{
+	int running = 0;
+	for (QList<DrizzleJobEntry*>::iterator it = mJobs.begin(); it != mJobs.end(); ++it)
+	{
+		if ((*it)->mState == JOB_RUNNING)
+		{
+			++running;
+		}
+	}
+
+	//Start jobs in submission order, a job which does not fit in the memory budget blocks later jobs
+	for (QList<DrizzleJobEntry*>::iterator it = mJobs.begin(); it != mJobs.end(); ++it)
+	{
+		DrizzleJobEntry* pEntry = *it;
+		if (pEntry->mState != JOB_QUEUED)
+		{
+			continue;
+		}
+		if (running > 0 && mMemoryInUse + pEntry->mMemory > mMemoryBudget)
+		{
+			break;
+		}
+
+		pEntry->mState = JOB_RUNNING;
+		pEntry->mTimer.start();
+		mMemoryInUse += pEntry->mMemory;
+		++running;
+
+		int helpers = static_cast<int>(std::min(static_cast<unsigned int>(getThreadBudget()), std::max(pEntry->mTileCount, 1u))) - 1;
+		pEntry->mActiveTasks.fetchAndStoreOrdered(1);
+		mpPool->start(new DrizzleTileTask(this, mpPool, pEntry, helpers));
+	}
+
+	if (running > 0)
+	{
+		mpTimer->start();
+	}
+	else
+	{
+		mpTimer->stop();
+
+		//Inputs may be changed or deleted once no job uses them
+		QMutexLocker lock(&mInputGridMutex);
+		mInputGrids.clear();
+	}
+	emit jobsChanged();
+}
+
+void DrizzleJobManager::completeJob(DrizzleJobEntry* pEntry)
+{
+	if (pEntry->mState == JOB_RUNNING)
+	{
+		pEntry->mElapsed = pEntry->mTimer.elapsed();
+	}
+	if (pEntry->mSuccess)
+	{
+		pEntry->mState = JOB_SUCCEEDED;
+	}
+	else if (pEntry->mUserAborted)
+	{
+		pEntry->mState = JOB_ABORTED;
+		pEntry->mError = "Drizzle aborted by user.";
+	}
+	else
+	{
+		pEntry->mState = JOB_FAILED;
+	}
+
+	//Let the job handle its result, it is no longer needed afterwards
+	pEntry->mpJob->complete(pEntry->mSuccess, pEntry->mError);
+	delete pEntry->mpJob;
+	pEntry->mpJob = NULL;
+
+	emit jobFinished(pEntry->mId, pEntry->mSuccess, QString::fromStdString(pEntry->mError));
+}
@@ -0,0 +1,326 @@
+/********************************************//*
+*
+* @file: DrizzleJobManager.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleJobManager_H
+#define DrizzleJobManager_H
+
+#include "DrizzleAccumulator.h"
+#include "DrizzleJob.h"
+
+#include <Qt/qlist.h>
+#include <Qt/qmutex.h>
+#include <Qt/qobject.h>
+#include <Qt/qset.h>
+#include <Qt/qstring.h>
+#include <Qt/qstringlist.h>
+
+#include <map>
+
+class DrizzleJobEntry;
+class QThreadPool;
+class QTimer;
+class RasterElement;
+
+/**
+* State of a job in the DrizzleJobManager.
+*/
+enum DrizzleJobState
+{
+	JOB_QUEUED,
+	JOB_RUNNING,
+	JOB_SUCCEEDED,
+	JOB_FAILED,
+	JOB_ABORTED
+};
+
+/**
+*
+* Snapshot of the status of one job, as shown in the queue view.
+*/
+struct DrizzleJobInfo
+{
+	/**
+	* Identifier returned by DrizzleJobManager::submit().
+	*/
+	int id;
+
+	/**
+	* Name of the job.
+	*/
+	QString name;
+
+	/**
+	* Current state of the job.
+	*/
+	DrizzleJobState state;
+
+	/**
+	* Number of tiles which are drizzled.
+	*/
+	unsigned int tilesDone;
+
+	/**
+	* Total number of tiles of the job.
+	*/
+	unsigned int tileCount;
+
+	/**
+	* Time the job has been running in seconds.
+	*/
+	double elapsed;
+
+	/**
+	* Estimated memory of the job in bytes.
+	*/
+	size_t memory;
+
+	/**
+	* Error message of a failed or aborted job.
+	*/
+	QString error;
+};
+
+/**
+*
+* Runs drizzle jobs of all open drizzle dialogs concurrently on one shared pool of
+* worker threads. Jobs are started in submission order as long as the memory budget
+* allows it, the tiles of all running jobs share the thread budget.
+* Lives on the GUI thread, all public functions have to be called from the GUI thread
+* except getInputGrid(), which is used by the jobs themselves.
+*/
+class DrizzleJobManager : public QObject
+{
+	Q_OBJECT
+public:
+	/**
+	* Returns the job manager shared by all instances of the Drizzle plugin.
+	*
+	* @return The job manager.
+	*/
+	static DrizzleJobManager* instance();
+
+	/**
+	* Adds a job to the queue. The job is started as soon as the budgets allow it.
+	*
+	* @param pJob Job to run, the manager takes ownership of the job.
+	* @param name Name of the job shown in the queue view.
+	* @return Identifier of the job.
+	*/
+	int submit(DrizzleJob* pJob, const QString& name);
+
+	/**
+	* Aborts a queued or running job.
+	*
+	* @param id Identifier of the job.
+	*/
+	void abort(int id);
+
+	/**
+	* Aborts all queued and running jobs.
+	*/
+	void abortAll();
+
+	/**
+	* Returns the status of all jobs which have not been cleared.
+	*
+	* @return Status of the jobs in submission order.
+	*/
+	QList<DrizzleJobInfo> getJobs() const;
+
+	/**
+	* Removes all jobs which are no longer queued or running from the list of jobs.
+	*/
+	void clearFinished();
+
+	/**
+	* Writes a checkpoint of every queued and running job which supports checkpoints.
+	*
+	* @return Paths of the checkpoints.
+	*/
+	QStringList checkpointAll();
+
+	/**
+	* Determines whether a plug-in instance saves the checkpoints with the session. Every instance of the plug-in
+	* is serialised, the first instance which asks saves the checkpoints until it is destroyed.
+	*
+	* @param pInstance Plug-in instance.
+	* @return True when the instance saves the checkpoints.
+	*/
+	bool isSessionOwner(const void* pInstance);
+
+	/**
+	* Lets another plug-in instance save the checkpoints, called when an instance is destroyed.
+	*
+	* @param pInstance Plug-in instance.
+	*/
+	void releaseSessionOwner(const void* pInstance);
+
+	/**
+	* Determines whether a checkpoint has been resumed, so a session listing it more than once resumes it once.
+	*
+	* @param filename Path of the checkpoint.
+	* @return True when the checkpoint has been resumed.
+	*/
+	bool isResumed(const QString& filename) const;
+
+	/**
+	* Remembers that a checkpoint has been resumed.
+	*
+	* @param filename Path of the checkpoint.
+	*/
+	void setResumed(const QString& filename);
+
+	/**
+	* @return Maximum number of worker threads shared by all jobs.
+	*/
+	int getThreadBudget() const;
+
+	/**
+	* Sets the maximum number of worker threads shared by all jobs.
+	*
+	* @param threads Number of threads, at least 1.
+	*/
+	void setThreadBudget(int threads);
+
+	/**
+	* @return Maximum memory in bytes the running jobs may allocate together.
+	*/
+	size_t getMemoryBudget() const;
+
+	/**
+	* Sets the maximum memory the running jobs may allocate together.
+	* A job which exceeds the budget on its own is started when no other job is running.
+	*
+	* @param bytes Memory budget in bytes.
+	*/
+	void setMemoryBudget(size_t bytes);
+
+	/**
+	* Returns the size and the geographical coordinates of the corners of an input image.
+	* The georeference of an input is only sampled once while jobs are running,
+	* all jobs drizzling the same input share the result. Can be called from any thread.
+	*
+	* @param pElement Georeferenced input RasterElement.
+	* @return Grid of the input image.
+	*/
+	DrizzleGrid getInputGrid(RasterElement* pElement);
+
+	/**
+	* Removes the cached georeference sampling of an input, e.g. before it is deleted.
+	*
+	* @param pElement Input RasterElement.
+	*/
+	void clearInputGrid(RasterElement* pElement);
+
+signals:
+	/**
+	* Emitted when a job is added, started, finished or cleared.
+	*/
+	void jobsChanged();
+
+	/**
+	* Emitted when the percentage of drizzled tiles of a running job changes.
+	*
+	* @param id Identifier of the job.
+	* @param percent Percentage of tiles which are drizzled.
+	*/
+	void jobProgress(int id, int percent);
+
+	/**
+	* Emitted after a job has completed.
+	*
+	* @param id Identifier of the job.
+	* @param success True when the job succeeded.
+	* @param error Error message of a failed or aborted job.
+	*/
+	void jobFinished(int id, bool success, const QString& error);
+
+private slots:
+	/**
+	* Forwards the progress of the running jobs, called by a timer.
+	*/
+	void pollProgress();
+
+	/**
+	* Completes a job after its last task has stopped.
+	* Invoked as a queued call from the worker threads.
+	*
+	* @param id Identifier of the job.
+	*/
+	void taskFinished(int id);
+
+private:
+	DrizzleJobManager();
+	~DrizzleJobManager();
+
+	/**
+	* Starts queued jobs as long as the memory budget allows it.
+	*/
+	void schedule();
+
+	/**
+	* Completes a job on the GUI thread and deletes it.
+	*/
+	void completeJob(DrizzleJobEntry* pEntry);
+
+	/**
+	* Thread pool shared by all jobs.
+	*/
+	QThreadPool* mpPool;
+
+	/**
+	* Timer polling the progress of the running jobs.
+	*/
+	QTimer* mpTimer;
+
+	/**
+	* All jobs which have not been cleared, in submission order.
+	*/
+	QList<DrizzleJobEntry*> mJobs;
+
+	/**
+	* Identifier of the next submitted job.
+	*/
+	int mNextId;
+
+	/**
+	* Memory budget in bytes.
+	*/
+	size_t mMemoryBudget;
+
+	/**
+	* Estimated memory of the running jobs in bytes.
+	*/
+	size_t mMemoryInUse;
+
+	/**
+	* Grids of the inputs of the running jobs, cleared when no job is running.
+	*/
+	std::map<RasterElement*, DrizzleGrid> mInputGrids;
+
+	/**
+	* Plug-in instance which saves the checkpoints with the session, NULL when none has asked yet.
+	*/
+	const void* mpSessionOwner;
+
+	/**
+	* Checkpoints which have been resumed.
+	*/
+	QSet<QString> mResumedCheckpoints;
+
+	/**
+	* Mutex protecting mInputGrids.
+	*/
+	QMutex mInputGridMutex;
+};
+
+#endif
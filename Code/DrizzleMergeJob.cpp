@@ -0,0 +1,147 @@
+/********************************************//*
+*
+* @file: DrizzleMergeJob.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "MessageLogResource.h"
+#include "ModelServices.h"
+#include "Progress.h"
+#include "ProgressResource.h"
+#include "RasterElement.h"
+#include "Service.h"
+#include "DrizzleMergeJob.h"
+
+#include <Qt/qfileinfo.h>
+#include <Qt/qstring.h>
+
+#include <memory>
+
+DrizzleMergeJob::DrizzleMergeJob(RasterElement* pResult, GcpList* pGcpList, ProgressResource* pProgress, const DrizzleGrid& grid,
+	const std::vector<std::string>& filenames, const std::string& mergedFile) :
+	DrizzleJob(0, 0, 1, 1, 1),
+	mpResult(pResult),
+	mpGcpList(pGcpList),
+	mpProgress(pProgress),
+	mGrid(grid),
+	mFilenames(filenames),
+	mMergedFile(mergedFile),
+	mpMerged(NULL),
+	mFilesDone(0)
+{
+}
+
+DrizzleMergeJob::~DrizzleMergeJob()
+{
+	delete mpMerged;
+	delete mpProgress;
+}
+
+size_t DrizzleMergeJob::getMemoryEstimate() const
+{
+	//Sum, weight and count planes of the merged result and of the partial result being merged into it
+	return 2 * static_cast<size_t>(mGrid.rows) * mGrid.columns * (2 * sizeof(double) + sizeof(unsigned int));
+}
+
+bool DrizzleMergeJob::processTile(const DrizzleTile& tile, std::string& error)
+{
+	std::auto_ptr<DrizzleAccumulator> pMerged;
+	for (std::vector<std::string>::const_iterator it = mFilenames.begin(); it != mFilenames.end(); ++it)
+	{
+		if (isAborted())
+		{
+			error = "Merge aborted by user.";
+			return false;
+		}
+
+		std::auto_ptr<DrizzleAccumulator> pPartial(DrizzleAccumulator::load(*it, error));
+		if (pPartial.get() == NULL)
+		{
+			return false;
+		}
+		if (!pPartial->getGrid().isCompatible(mGrid))
+		{
+			error = *it + " has another output grid than the other partial results.";
+			return false;
+		}
+		if (pMerged.get() == NULL)
+		{
+			pMerged = pPartial;
+		}
+		else if (!pMerged->merge(*pPartial, error))
+		{
+			return false;
+		}
+		mFilesDone.fetchAndAddOrdered(1);
+	}
+
+	//Keep the merged partial result so more partial results can be merged later
+	if (!mMergedFile.empty() && !pMerged->save(mMergedFile, error))
+	{
+		return false;
+	}
+	mpMerged = pMerged.release();
+	return true;
+}
+
+bool DrizzleMergeJob::finish(std::string& error)
+{
+	return mpMerged->normalise(mpResult, error);
+}
+
+bool DrizzleMergeJob::updateProgress(const std::string& message, int percent)
+{
+	if (mpProgress == NULL)
+	{
+		return true;
+	}
+
+	unsigned int done = static_cast<unsigned int>(int(mFilesDone));
+	if (done < mFilenames.size())
+	{
+		(*mpProgress)->updateProgress("Merging " + mFilenames[done], static_cast<int>((done * 100) / mFilenames.size()), NORMAL);
+	}
+	else
+	{
+		(*mpProgress)->updateProgress("Writing merged result", 100, NORMAL);
+	}
+
+	//Abort the job when the user cancelled the progress
+	return !isProgressAborted(mpProgress);
+}
+
+void DrizzleMergeJob::complete(bool success, const std::string& error)
+{
+	StepResource pStep("Drizzle merge output", "app", "A1B00BE2-0EA9-4DDA-8085-3CC89DB45B8E");
+	Progress* pProgress = (mpProgress == NULL) ? NULL : mpProgress->get();
+	std::string msg = error;
+	pStep->addProperty("Partial results", static_cast<unsigned int>(mFilenames.size()));
+
+	//Create view of the merged output and its corner coordinates
+	success = success && createView(mpResult, mpGcpList, msg) != NULL;
+
+	if (!success)
+	{
+		Service<ModelServices>()->destroyElement(mpResult);
+		pStep->finalize(Message::Failure, msg);
+		if (pProgress != NULL)
+		{
+			pProgress->updateProgress(msg, 0, ERRORS);
+		}
+	}
+	else
+	{
+		pStep->finalize();
+		if (pProgress != NULL)
+		{
+			pProgress->updateProgress("Done", 100, NORMAL);
+		}
+	}
+	mpResult = NULL;
+}
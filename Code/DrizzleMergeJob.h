@@ -0,0 +1,77 @@
+/********************************************//*
+*
+* @file: DrizzleMergeJob.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleMergeJob_H
+#define DrizzleMergeJob_H
+
+#include "DrizzleAccumulator.h"
+#include "DrizzleJob.h"
+
+#include <Qt/qatomic.h>
+
+#include <string>
+#include <vector>
+
+class GcpList;
+class ProgressResource;
+class RasterElement;
+
+/**
+*
+* DrizzleJob which merges partial results of a distributed drizzle into one output.
+* The partial results are loaded and merged one by one as the single tile of the job,
+* the merged result is optionally saved so more partial results can be merged later on,
+* and is normalised into the output RasterElement, which is shown when the job has completed.
+*/
+class DrizzleMergeJob : public DrizzleJob
+{
+public:
+	/**
+	* Constructor for the merge job.
+	*
+	* @param pResult Georeferenced output RasterElement with the output grid of the partial results, the job takes ownership until it completes.
+	* @param pGcpList GCP list with the corner coordinates of the output, can be NULL.
+	* @param pProgress Progress of the job, the job takes ownership. Can be NULL.
+	* @param grid Output grid of the partial results.
+	* @param filenames Paths of the partial results, merging is associative so the order does not matter.
+	* @param mergedFile Path the merged partial result is saved to, empty to not save it.
+	*/
+	DrizzleMergeJob(RasterElement* pResult, GcpList* pGcpList, ProgressResource* pProgress, const DrizzleGrid& grid,
+		const std::vector<std::string>& filenames, const std::string& mergedFile);
+
+	/**
+	* Destructor for the merge job.
+	*/
+	~DrizzleMergeJob();
+
+	size_t getMemoryEstimate() const;
+	bool processTile(const DrizzleTile& tile, std::string& error);
+	bool finish(std::string& error);
+	bool updateProgress(const std::string& message, int percent);
+	void complete(bool success, const std::string& error);
+
+private:
+	RasterElement* mpResult;
+	GcpList* mpGcpList;
+	ProgressResource* mpProgress;
+	DrizzleGrid mGrid;
+	std::vector<std::string> mFilenames;
+	std::string mMergedFile;
+	DrizzleAccumulator* mpMerged;
+
+	/**
+	* Number of partial results merged so far.
+	*/
+	QAtomicInt mFilesDone;
+};
+
+#endif
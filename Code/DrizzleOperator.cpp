@@ -0,0 +1,718 @@
+/********************************************//*
+*
+* @file: DrizzleOperator.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "ObjectResource.h"
+#include "Progress.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "switchOnEncoding.h"
+#include "DrizzleOperator.h"
+
+#include <Qt/qbytearray.h>
+#include <Qt/qdatastream.h>
+#include <Qt/qfile.h>
+#include <Qt/qrunnable.h>
+#include <Qt/qstring.h>
+#include <Qt/qthreadpool.h>
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <string.h>
+
+namespace
+{
+	/**
+	* Identification of an operator file ("DRZW"), followed by the format version.
+	*/
+	const quint32 OPERATOR_MAGIC = 0x44525A57;
+	const quint32 OPERATOR_VERSION = 1;
+
+	template<typename T>
+	/**
+	* Function to read a pixel of a RasterElement as double.
+	*
+	* @param pData Pointer to the pixel.
+	* @param pValue Pointer to the double which will hold the value.
+	*/
+	void ReadValue(T* pData, double* pValue)
+	{
+		*pValue = static_cast<double>(*pData);
+	}
+
+	/**
+	* Compresses the contents of a vector.
+	*/
+	template<typename T>
+	QByteArray compressVector(const std::vector<T>& values)
+	{
+		if (values.empty())
+		{
+			return qCompress(QByteArray());
+		}
+		return qCompress(QByteArray::fromRawData(reinterpret_cast<const char*>(&values[0]), static_cast<int>(values.size() * sizeof(T))));
+	}
+
+	/**
+	* Decompresses the contents of a vector.
+	*
+	* @return False when the decompressed data does not hold the expected number of values.
+	*/
+	template<typename T>
+	bool uncompressVector(const QByteArray& data, size_t count, std::vector<T>& values)
+	{
+		QByteArray raw = qUncompress(data);
+		if (static_cast<size_t>(raw.size()) != count * sizeof(T))
+		{
+			return false;
+		}
+		values.resize(count);
+		if (count > 0)
+		{
+			memcpy(&values[0], raw.constData(), raw.size());
+		}
+		return true;
+	}
+
+	void writeLocation(QDataStream& stream, const LocationType& location)
+	{
+		stream << location.mX << location.mY;
+	}
+
+	void readLocation(QDataStream& stream, LocationType& location)
+	{
+		stream >> location.mX >> location.mY;
+	}
+
+	/**
+	* Task computing the rows of the product in a band of output rows.
+	*/
+	class ApplyTask : public QRunnable
+	{
+	public:
+		ApplyTask(const std::vector<unsigned long long>* pOffsets, const std::vector<unsigned long long>* pSources, const std::vector<double>* pWeights,
+			const std::vector<unsigned int>* pCounts, const std::vector<double>* pValues, DrizzleAccumulator* pAccumulator, unsigned int firstRow, unsigned int lastRow) :
+			mpOffsets(pOffsets),
+			mpSources(pSources),
+			mpWeights(pWeights),
+			mpCounts(pCounts),
+			mpValues(pValues),
+			mpAccumulator(pAccumulator),
+			mFirstRow(firstRow),
+			mLastRow(lastRow)
+		{
+		}
+
+		void run()
+		{
+			unsigned int startRow = mpAccumulator->getStartRow();
+			unsigned int startColumn = mpAccumulator->getStartColumn();
+			unsigned int columns = mpAccumulator->getColumns();
+			for (unsigned int row = mFirstRow; row < mLastRow; ++row)
+			{
+				for (unsigned int col = 0; col < columns; ++col)
+				{
+					size_t pixel = static_cast<size_t>(row) * columns + col;
+					double sum = 0.0;
+					double weight = 0.0;
+					for (unsigned long long i = (*mpOffsets)[pixel]; i < (*mpOffsets)[pixel + 1]; ++i)
+					{
+						sum += (*mpWeights)[i] * (*mpValues)[(*mpSources)[i]];
+						weight += (*mpWeights)[i];
+					}
+					mpAccumulator->set(startRow + row, startColumn + col, sum, weight, (*mpCounts)[pixel]);
+				}
+			}
+		}
+
+	private:
+		const std::vector<unsigned long long>* mpOffsets;
+		const std::vector<unsigned long long>* mpSources;
+		const std::vector<double>* mpWeights;
+		const std::vector<unsigned int>* mpCounts;
+		const std::vector<double>* mpValues;
+		DrizzleAccumulator* mpAccumulator;
+		unsigned int mFirstRow;
+		unsigned int mLastRow;
+	};
+
+	/**
+	* Task blotting a band of input rows, from the transposed weights of the input.
+	*/
+	class BlotTask : public QRunnable
+	{
+	public:
+		BlotTask(const std::vector<unsigned long long>* pOffsets, const std::vector<size_t>* pTargets, const std::vector<double>* pWeights,
+			const std::vector<double>* pValues, std::vector<double>* pBlotted, unsigned int columns, unsigned int firstRow, unsigned int lastRow) :
+			mpOffsets(pOffsets),
+			mpTargets(pTargets),
+			mpWeights(pWeights),
+			mpValues(pValues),
+			mpBlotted(pBlotted),
+			mColumns(columns),
+			mFirstRow(firstRow),
+			mLastRow(lastRow)
+		{
+		}
+
+		void run()
+		{
+			for (size_t pixel = static_cast<size_t>(mFirstRow) * mColumns; pixel < static_cast<size_t>(mLastRow) * mColumns; ++pixel)
+			{
+				double sum = 0.0;
+				double weight = 0.0;
+				for (unsigned long long i = (*mpOffsets)[pixel]; i < (*mpOffsets)[pixel + 1]; ++i)
+				{
+					sum += (*mpWeights)[i] * (*mpValues)[(*mpTargets)[i]];
+					weight += (*mpWeights)[i];
+				}
+				(*mpBlotted)[pixel] = (weight > 0.0) ? sum / weight : 0.0;
+			}
+		}
+
+	private:
+		const std::vector<unsigned long long>* mpOffsets;
+		const std::vector<size_t>* mpTargets;
+		const std::vector<double>* mpWeights;
+		const std::vector<double>* mpValues;
+		std::vector<double>* mpBlotted;
+		unsigned int mColumns;
+		unsigned int mFirstRow;
+		unsigned int mLastRow;
+	};
+};
+
+DrizzleOperator::DrizzleOperator(const DrizzleGrid& grid, unsigned int startRow, unsigned int startColumn, unsigned int rows, unsigned int columns) :
+	mGrid(grid),
+	mStartRow(startRow),
+	mStartColumn(startColumn),
+	mRows(rows),
+	mColumns(columns),
+	mInputPixels(0)
+{
+}
+
+DrizzleOperator::~DrizzleOperator()
+{
+}
+
+const DrizzleGrid& DrizzleOperator::getGrid() const
+{
+	return mGrid;
+}
+
+unsigned long long DrizzleOperator::addInput(const std::string& name, unsigned int rows, unsigned int columns)
+{
+	unsigned long long first = mInputPixels;
+	mInputNames.push_back(name);
+	mInputRows.push_back(rows);
+	mInputColumns.push_back(columns);
+	mInputPixels += static_cast<unsigned long long>(rows) * columns;
+	return first;
+}
+
+unsigned int DrizzleOperator::getInputCount() const
+{
+	return static_cast<unsigned int>(mInputNames.size());
+}
+
+const std::string& DrizzleOperator::getInputName(unsigned int index) const
+{
+	return mInputNames[index];
+}
+
+unsigned int DrizzleOperator::getInputRows(unsigned int index) const
+{
+	return mInputRows[index];
+}
+
+unsigned int DrizzleOperator::getInputColumns(unsigned int index) const
+{
+	return mInputColumns[index];
+}
+
+void DrizzleOperator::addBlock(DrizzleOperatorBlock& block)
+{
+	QMutexLocker lock(&mBlockMutex);
+	mBlocks.push_back(DrizzleOperatorBlock());
+	DrizzleOperatorBlock& stored = mBlocks.back();
+	stored.startRow = block.startRow;
+	stored.startColumn = block.startColumn;
+	stored.rows = block.rows;
+	stored.columns = block.columns;
+	stored.offsets.swap(block.offsets);
+	stored.sources.swap(block.sources);
+	stored.weights.swap(block.weights);
+	stored.counts.swap(block.counts);
+}
+
+void DrizzleOperator::assemble()
+{
+	QMutexLocker lock(&mBlockMutex);
+	if (mBlocks.empty())
+	{
+		return;
+	}
+
+	//Pixels of the region which are not covered by a block have no entries
+	size_t pixels = static_cast<size_t>(mRows) * mColumns;
+	std::vector<unsigned long long> sizes(pixels, 0);
+	mCounts.assign(pixels, 0);
+	for (std::list<DrizzleOperatorBlock>::const_iterator it = mBlocks.begin(); it != mBlocks.end(); ++it)
+	{
+		for (unsigned int row = 0; row < it->rows; ++row)
+		{
+			for (unsigned int col = 0; col < it->columns; ++col)
+			{
+				size_t local = static_cast<size_t>(row) * it->columns + col;
+				size_t pixel = static_cast<size_t>(it->startRow - mStartRow + row) * mColumns + (it->startColumn - mStartColumn + col);
+				sizes[pixel] = it->offsets[local + 1] - it->offsets[local];
+				mCounts[pixel] = it->counts[local];
+			}
+		}
+	}
+
+	mOffsets.assign(pixels + 1, 0);
+	for (size_t pixel = 0; pixel < pixels; ++pixel)
+	{
+		mOffsets[pixel + 1] = mOffsets[pixel] + sizes[pixel];
+	}
+	mSources.resize(static_cast<size_t>(mOffsets[pixels]));
+	mWeights.resize(static_cast<size_t>(mOffsets[pixels]));
+
+	//Copy the entries of every block into the rows of its pixels, releasing the block afterwards
+	while (!mBlocks.empty())
+	{
+		const DrizzleOperatorBlock& block = mBlocks.front();
+		for (unsigned int row = 0; row < block.rows; ++row)
+		{
+			for (unsigned int col = 0; col < block.columns; ++col)
+			{
+				size_t local = static_cast<size_t>(row) * block.columns + col;
+				size_t pixel = static_cast<size_t>(block.startRow - mStartRow + row) * mColumns + (block.startColumn - mStartColumn + col);
+				std::copy(block.sources.begin() + static_cast<size_t>(block.offsets[local]), block.sources.begin() + static_cast<size_t>(block.offsets[local + 1]),
+					mSources.begin() + static_cast<size_t>(mOffsets[pixel]));
+				std::copy(block.weights.begin() + static_cast<size_t>(block.offsets[local]), block.weights.begin() + static_cast<size_t>(block.offsets[local + 1]),
+					mWeights.begin() + static_cast<size_t>(mOffsets[pixel]));
+			}
+		}
+		mBlocks.pop_front();
+	}
+}
+
+bool DrizzleOperator::save(const std::string& filename, std::string& error)
+{
+	assemble();
+
+	QFile file(QString::fromStdString(filename));
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		error = "Unable to open " + filename + " for writing.";
+		return false;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_6);
+	stream << OPERATOR_MAGIC << OPERATOR_VERSION;
+
+	//Output grid and region
+	stream << quint32(mGrid.rows) << quint32(mGrid.columns) << quint32(mGrid.dataType);
+	writeLocation(stream, mGrid.topLeft);
+	writeLocation(stream, mGrid.bottomLeft);
+	writeLocation(stream, mGrid.bottomRight);
+	writeLocation(stream, mGrid.topRight);
+	stream << QString::fromStdString(mGrid.georeferencePlugIn) << quint32(mGrid.gcps.size());
+	for (std::list<GcpPoint>::const_iterator it = mGrid.gcps.begin(); it != mGrid.gcps.end(); ++it)
+	{
+		writeLocation(stream, it->mPixel);
+		writeLocation(stream, it->mCoordinate);
+	}
+	stream << quint32(mStartRow) << quint32(mStartColumn) << quint32(mRows) << quint32(mColumns);
+
+	//Inputs
+	stream << quint32(mInputNames.size());
+	for (size_t i = 0; i < mInputNames.size(); ++i)
+	{
+		stream << QString::fromStdString(mInputNames[i]) << quint32(mInputRows[i]) << quint32(mInputColumns[i]);
+	}
+
+	//Matrix, the offsets and counts of an empty operator are omitted
+	stream << quint64(mSources.size()) << quint8(mOffsets.empty() ? 0 : 1);
+	stream << compressVector(mOffsets) << compressVector(mSources) << compressVector(mWeights) << compressVector(mCounts);
+
+	if (stream.status() != QDataStream::Ok || !file.flush())
+	{
+		error = "Unable to write " + filename + ".";
+		return false;
+	}
+	return true;
+}
+
+DrizzleOperator* DrizzleOperator::load(const std::string& filename, std::string& error)
+{
+	QFile file(QString::fromStdString(filename));
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		error = "Unable to open " + filename + ".";
+		return NULL;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_6);
+	quint32 magic = 0;
+	quint32 version = 0;
+	stream >> magic >> version;
+	if (stream.status() != QDataStream::Ok || magic != OPERATOR_MAGIC || version != OPERATOR_VERSION)
+	{
+		error = filename + " is not a Drizzle operator.";
+		return NULL;
+	}
+
+	DrizzleGrid grid;
+	quint32 rows = 0;
+	quint32 columns = 0;
+	quint32 dataType = 0;
+	QString plugIn;
+	quint32 gcpCount = 0;
+	stream >> rows >> columns >> dataType;
+	readLocation(stream, grid.topLeft);
+	readLocation(stream, grid.bottomLeft);
+	readLocation(stream, grid.bottomRight);
+	readLocation(stream, grid.topRight);
+	stream >> plugIn >> gcpCount;
+	for (quint32 i = 0; i < gcpCount && stream.status() == QDataStream::Ok; ++i)
+	{
+		GcpPoint point;
+		readLocation(stream, point.mPixel);
+		readLocation(stream, point.mCoordinate);
+		grid.gcps.push_back(point);
+	}
+	grid.rows = rows;
+	grid.columns = columns;
+	grid.dataType = static_cast<EncodingTypeEnum>(dataType);
+	grid.georeferencePlugIn = plugIn.toStdString();
+
+	quint32 startRow = 0;
+	quint32 startColumn = 0;
+	quint32 regionRows = 0;
+	quint32 regionColumns = 0;
+	stream >> startRow >> startColumn >> regionRows >> regionColumns;
+	if (stream.status() != QDataStream::Ok || startRow + regionRows > grid.rows || startColumn + regionColumns > grid.columns)
+	{
+		error = filename + " has an invalid header.";
+		return NULL;
+	}
+
+	std::auto_ptr<DrizzleOperator> pOperator(new DrizzleOperator(grid, startRow, startColumn, regionRows, regionColumns));
+	quint32 inputCount = 0;
+	stream >> inputCount;
+	for (quint32 i = 0; i < inputCount && stream.status() == QDataStream::Ok; ++i)
+	{
+		QString name;
+		quint32 inputRows = 0;
+		quint32 inputColumns = 0;
+		stream >> name >> inputRows >> inputColumns;
+		pOperator->addInput(name.toStdString(), inputRows, inputColumns);
+	}
+
+	quint64 entries = 0;
+	quint8 assembled = 0;
+	QByteArray offsets;
+	QByteArray sources;
+	QByteArray weights;
+	QByteArray counts;
+	stream >> entries >> assembled >> offsets >> sources >> weights >> counts;
+
+	size_t pixels = (assembled == 0) ? 0 : static_cast<size_t>(regionRows) * regionColumns;
+	try
+	{
+		if (stream.status() != QDataStream::Ok ||
+			!uncompressVector(offsets, (assembled == 0) ? 0 : pixels + 1, pOperator->mOffsets) ||
+			!uncompressVector(sources, static_cast<size_t>(entries), pOperator->mSources) ||
+			!uncompressVector(weights, static_cast<size_t>(entries), pOperator->mWeights) ||
+			!uncompressVector(counts, pixels, pOperator->mCounts) ||
+			(assembled != 0 && pOperator->mOffsets[pixels] != entries))
+		{
+			error = filename + " is truncated.";
+			return NULL;
+		}
+	}
+	catch (std::bad_alloc&)
+	{
+		error = "Not enough memory to load " + filename + ".";
+		return NULL;
+	}
+
+	//Every entry must refer to a pixel of the inputs
+	for (std::vector<unsigned long long>::const_iterator it = pOperator->mSources.begin(); it != pOperator->mSources.end(); ++it)
+	{
+		if (*it >= pOperator->mInputPixels)
+		{
+			error = filename + " is corrupt.";
+			return NULL;
+		}
+	}
+	return pOperator.release();
+}
+
+DrizzleAccumulator* DrizzleOperator::apply(const std::vector<RasterElement*>& images, unsigned int threads, Progress* pProgress, std::string& error)
+{
+	assemble();
+
+	if (images.size() != mInputNames.size())
+	{
+		error = "The operator needs " + QString::number(mInputNames.size()).toStdString() + " input images.";
+		return NULL;
+	}
+
+	//Gather the pixels of all inputs, numbered as in the operator
+	std::vector<double> values;
+	std::auto_ptr<DrizzleAccumulator> pAccumulator;
+	try
+	{
+		values.resize(static_cast<size_t>(mInputPixels));
+		pAccumulator.reset(new DrizzleAccumulator(mGrid, mStartRow, mStartColumn, mRows, mColumns));
+	}
+	catch (std::bad_alloc&)
+	{
+		error = "Not enough memory to apply the operator.";
+		return NULL;
+	}
+
+	size_t first = 0;
+	for (size_t i = 0; i < images.size(); ++i)
+	{
+		const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(images[i]->getDataDescriptor());
+		if (pDesc->getRowCount() != mInputRows[i] || pDesc->getColumnCount() != mInputColumns[i])
+		{
+			error = images[i]->getName() + " does not have the size of input " + mInputNames[i] + ".";
+			return NULL;
+		}
+		if (pProgress != NULL)
+		{
+			pProgress->updateProgress("Reading " + images[i]->getName(), static_cast<int>((i * 50) / images.size()), NORMAL);
+		}
+
+		FactoryResource<DataRequest> pRequest;
+		DataAccessor pAcc = images[i]->getDataAccessor(pRequest.release());
+		for (unsigned int row = 0; row < mInputRows[i]; ++row)
+		{
+			pAcc->toPixel(row, 0);
+			if (!pAcc.isValid())
+			{
+				error = "Unable to access the cube data.";
+				return NULL;
+			}
+			for (unsigned int col = 0; col < mInputColumns[i]; ++col)
+			{
+				switchOnEncoding(pDesc->getDataType(), ReadValue, pAcc->getColumn(), &values[first + static_cast<size_t>(row) * mInputColumns[i] + col]);
+				pAcc->nextColumn();
+			}
+		}
+		first += static_cast<size_t>(mInputRows[i]) * mInputColumns[i];
+	}
+
+	if (pProgress != NULL)
+	{
+		pProgress->updateProgress("Applying operator", 50, NORMAL);
+	}
+
+	//Bands of output rows are independent, an operator without entries leaves the accumulator empty
+	if (!mOffsets.empty())
+	{
+		threads = std::max(std::min(threads, std::max(mRows, 1u)), 1u);
+		QThreadPool pool;
+		pool.setMaxThreadCount(threads);
+		for (unsigned int i = 0; i < threads; ++i)
+		{
+			unsigned int firstRow = static_cast<unsigned int>((static_cast<unsigned long long>(i) * mRows) / threads);
+			unsigned int lastRow = static_cast<unsigned int>((static_cast<unsigned long long>(i + 1) * mRows) / threads);
+			pool.start(new ApplyTask(&mOffsets, &mSources, &mWeights, &mCounts, &values, pAccumulator.get(), firstRow, lastRow));
+		}
+		pool.waitForDone();
+	}
+
+	if (pProgress != NULL)
+	{
+		pProgress->updateProgress("Operator applied", 100, NORMAL);
+	}
+	return pAccumulator.release();
+}
+
+bool DrizzleOperator::blot(RasterElement* pDrizzled, unsigned int input, RasterElement* pBlotted, unsigned int threads, Progress* pProgress, std::string& error)
+{
+	assemble();
+
+	if (input >= mInputNames.size())
+	{
+		error = "The operator has no input " + QString::number(input).toStdString() + ".";
+		return false;
+	}
+	const RasterDataDescriptor* pBlotDesc = static_cast<const RasterDataDescriptor*>(pBlotted->getDataDescriptor());
+	if (pBlotDesc->getRowCount() != mInputRows[input] || pBlotDesc->getColumnCount() != mInputColumns[input] || pBlotDesc->getDataType() != FLT8BYTES)
+	{
+		error = pBlotted->getName() + " does not match input " + mInputNames[input] + ".";
+		return false;
+	}
+
+	//The drizzled output holds either the whole output grid or only the region
+	const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(pDrizzled->getDataDescriptor());
+	unsigned int rowOffset = 0;
+	unsigned int columnOffset = 0;
+	if (pDesc->getRowCount() == mGrid.rows && pDesc->getColumnCount() == mGrid.columns)
+	{
+		rowOffset = mStartRow;
+		columnOffset = mStartColumn;
+	}
+	else if (pDesc->getRowCount() != mRows || pDesc->getColumnCount() != mColumns)
+	{
+		error = pDrizzled->getName() + " does not have the size of the drizzled output.";
+		return false;
+	}
+
+	size_t firstSource = 0;
+	for (unsigned int i = 0; i < input; ++i)
+	{
+		firstSource += static_cast<size_t>(mInputRows[i]) * mInputColumns[i];
+	}
+	size_t inputPixels = static_cast<size_t>(mInputRows[input]) * mInputColumns[input];
+	size_t regionPixels = static_cast<size_t>(mRows) * mColumns;
+
+	std::vector<double> values;
+	std::vector<double> blotted;
+	std::vector<unsigned long long> offsets;
+	try
+	{
+		values.resize(regionPixels);
+		blotted.resize(inputPixels, 0.0);
+		offsets.resize(inputPixels + 1, 0);
+	}
+	catch (std::bad_alloc&)
+	{
+		error = "Not enough memory to blot " + pDrizzled->getName() + ".";
+		return false;
+	}
+
+	if (pProgress != NULL)
+	{
+		pProgress->updateProgress("Reading " + pDrizzled->getName(), 0, NORMAL);
+	}
+	FactoryResource<DataRequest> pRequest;
+	DataAccessor pAcc = pDrizzled->getDataAccessor(pRequest.release());
+	for (unsigned int row = 0; row < mRows; ++row)
+	{
+		pAcc->toPixel(rowOffset + row, columnOffset);
+		if (!pAcc.isValid())
+		{
+			error = "Unable to access the cube data.";
+			return false;
+		}
+		for (unsigned int col = 0; col < mColumns; ++col)
+		{
+			switchOnEncoding(pDesc->getDataType(), ReadValue, pAcc->getColumn(), &values[static_cast<size_t>(row) * mColumns + col]);
+			pAcc->nextColumn();
+		}
+	}
+
+	//Transpose the weights of the input: one row per input pixel, listing the output pixels it was drizzled onto
+	if (pProgress != NULL)
+	{
+		pProgress->updateProgress("Transposing operator", 30, NORMAL);
+	}
+	std::vector<size_t> targets;
+	std::vector<double> weights;
+	if (!mOffsets.empty())
+	{
+		for (std::vector<unsigned long long>::const_iterator it = mSources.begin(); it != mSources.end(); ++it)
+		{
+			if (*it >= firstSource && *it < firstSource + inputPixels)
+			{
+				offsets[static_cast<size_t>(*it - firstSource) + 1]++;
+			}
+		}
+		for (size_t pixel = 0; pixel < inputPixels; ++pixel)
+		{
+			offsets[pixel + 1] += offsets[pixel];
+		}
+
+		try
+		{
+			targets.resize(static_cast<size_t>(offsets[inputPixels]));
+			weights.resize(static_cast<size_t>(offsets[inputPixels]));
+		}
+		catch (std::bad_alloc&)
+		{
+			error = "Not enough memory to blot " + pDrizzled->getName() + ".";
+			return false;
+		}
+
+		std::vector<unsigned long long> next(offsets.begin(), offsets.end() - 1);
+		for (size_t pixel = 0; pixel < regionPixels; ++pixel)
+		{
+			for (unsigned long long i = mOffsets[pixel]; i < mOffsets[pixel + 1]; ++i)
+			{
+				if (mSources[i] >= firstSource && mSources[i] < firstSource + inputPixels)
+				{
+					size_t entry = static_cast<size_t>(next[static_cast<size_t>(mSources[i] - firstSource)]++);
+					targets[entry] = pixel;
+					weights[entry] = mWeights[i];
+				}
+			}
+		}
+
+		//Bands of input rows are independent
+		if (pProgress != NULL)
+		{
+			pProgress->updateProgress("Blotting " + mInputNames[input], 50, NORMAL);
+		}
+		unsigned int rows = mInputRows[input];
+		threads = std::max(std::min(threads, std::max(rows, 1u)), 1u);
+		QThreadPool pool;
+		pool.setMaxThreadCount(threads);
+		for (unsigned int i = 0; i < threads; ++i)
+		{
+			unsigned int firstRow = static_cast<unsigned int>((static_cast<unsigned long long>(i) * rows) / threads);
+			unsigned int lastRow = static_cast<unsigned int>((static_cast<unsigned long long>(i + 1) * rows) / threads);
+			pool.start(new BlotTask(&offsets, &targets, &weights, &values, &blotted, mInputColumns[input], firstRow, lastRow));
+		}
+		pool.waitForDone();
+	}
+
+	//Write the blot
+	FactoryResource<DataRequest> pWriteRequest;
+	pWriteRequest->setWritable(true);
+	DataAccessor pWriteAcc = pBlotted->getDataAccessor(pWriteRequest.release());
+	for (unsigned int row = 0; row < mInputRows[input]; ++row)
+	{
+		pWriteAcc->toPixel(row, 0);
+		if (!pWriteAcc.isValid())
+		{
+			error = "Unable to access the cube data.";
+			return false;
+		}
+		for (unsigned int col = 0; col < mInputColumns[input]; ++col)
+		{
+			*reinterpret_cast<double*>(pWriteAcc->getColumn()) = blotted[static_cast<size_t>(row) * mInputColumns[input] + col];
+			pWriteAcc->nextColumn();
+		}
+	}
+	pBlotted->updateData();
+
+	if (pProgress != NULL)
+	{
+		pProgress->updateProgress("Blot done", 100, NORMAL);
+	}
+	return true;
+}
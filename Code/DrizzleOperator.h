@@ -0,0 +1,225 @@
+/********************************************//*
+*
+* @file: DrizzleOperator.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleOperator_H
+#define DrizzleOperator_H
+
+#include "DrizzleAccumulator.h"
+
+#include <Qt/qmutex.h>
+
+#include <list>
+#include <string>
+#include <vector>
+
+class Progress;
+class RasterElement;
+
+/**
+*
+* Overlap weights of a rectangular block of output pixels, in compressed sparse row format.
+* Output pixels are numbered row by row within the block, input pixels row by row
+* within each input image, the input images one after the other.
+*/
+struct DrizzleOperatorBlock
+{
+	/**
+	* First row of the block in the output grid.
+	*/
+	unsigned int startRow;
+
+	/**
+	* First column of the block in the output grid.
+	*/
+	unsigned int startColumn;
+
+	/**
+	* Number of rows of the block.
+	*/
+	unsigned int rows;
+
+	/**
+	* Number of columns of the block.
+	*/
+	unsigned int columns;
+
+	/**
+	* Index of the first entry of every output pixel, followed by the number of entries.
+	*/
+	std::vector<unsigned long long> offsets;
+
+	/**
+	* Input pixel of every entry.
+	*/
+	std::vector<unsigned long long> sources;
+
+	/**
+	* Overlap area of every entry.
+	*/
+	std::vector<double> weights;
+
+	/**
+	* Number of input images overlapping every output pixel.
+	*/
+	std::vector<unsigned int> counts;
+};
+
+/**
+*
+* Sparse linear operator mapping the pixels of a set of input images onto a region
+* of the output grid. The overlap weights depend only on the geometry and the dropsize,
+* so the operator recorded by one drizzle can be applied to other data sets sharing that
+* geometry (other bands, other calibrations, reprocessed frames) without clipping any pixel.
+*/
+class DrizzleOperator
+{
+public:
+	/**
+	* Constructor for an empty operator covering a region of the output grid.
+	*
+	* @param grid Output grid.
+	* @param startRow First row of the region.
+	* @param startColumn First column of the region.
+	* @param rows Height of the region.
+	* @param columns Width of the region.
+	*/
+	DrizzleOperator(const DrizzleGrid& grid, unsigned int startRow, unsigned int startColumn, unsigned int rows, unsigned int columns);
+
+	/**
+	* Destructor for the operator.
+	*/
+	~DrizzleOperator();
+
+	/**
+	* Returns the output grid.
+	*
+	* @return The output grid.
+	*/
+	const DrizzleGrid& getGrid() const;
+
+	/**
+	* Appends an input image. Inputs must be added before blocks are recorded.
+	*
+	* @param name Name of the input image.
+	* @param rows Height of the input image.
+	* @param columns Width of the input image.
+	* @return Number of the first pixel of the input image.
+	*/
+	unsigned long long addInput(const std::string& name, unsigned int rows, unsigned int columns);
+
+	/**
+	* @return Number of input images.
+	*/
+	unsigned int getInputCount() const;
+
+	/**
+	* @return Name of an input image.
+	*/
+	const std::string& getInputName(unsigned int index) const;
+
+	/**
+	* @return Height of an input image.
+	*/
+	unsigned int getInputRows(unsigned int index) const;
+
+	/**
+	* @return Width of an input image.
+	*/
+	unsigned int getInputColumns(unsigned int index) const;
+
+	/**
+	* Records the weights of a block of output pixels. Different threads may record different blocks concurrently.
+	*
+	* @param block Weights of the block, the blocks recorded by a drizzle cover the region exactly once.
+	*              The contents are taken over, the block is left empty.
+	*/
+	void addBlock(DrizzleOperatorBlock& block);
+
+	/**
+	* Saves the operator to a compressed operator file.
+	*
+	* @param filename Path of the operator file.
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull, false otherwise.
+	*/
+	bool save(const std::string& filename, std::string& error);
+
+	/**
+	* Loads an operator from an operator file.
+	*
+	* @param filename Path of the operator file.
+	* @param error String which will hold the error message on failure.
+	* @return New operator, NULL on failure. The caller takes ownership.
+	*/
+	static DrizzleOperator* load(const std::string& filename, std::string& error);
+
+	/**
+	* Applies the operator to input images with the recorded sizes, as a multithreaded sparse matrix-vector product.
+	*
+	* @param images Input images, in the order of the recorded inputs.
+	* @param threads Number of threads.
+	* @param pProgress Progress of the product, can be NULL.
+	* @param error String which will hold the error message on failure.
+	* @return New accumulator holding the drizzle of the input images, NULL on failure. The caller takes ownership.
+	*/
+	DrizzleAccumulator* apply(const std::vector<RasterElement*>& images, unsigned int threads, Progress* pProgress, std::string& error);
+
+	/**
+	* Blots (reverse drizzles) a drizzled output onto the pixel grid of one of the recorded inputs, e.g. to
+	* compare the input with the combined result. Every input pixel takes the mean of the output pixels
+	* it was drizzled onto, weighted by the recorded overlap areas, so no geometry is recomputed.
+	* The weights of the input are transposed once, the rows of the input are then blotted in parallel.
+	*
+	* @param pDrizzled Drizzled output, with the size of the output grid or of the recorded region.
+	* @param input Number of the recorded input.
+	* @param pBlotted RasterElement of 8-byte floats with the size of the input which will hold the blot.
+	*                 Input pixels which were not drizzled onto the region are set to 0.
+	* @param threads Number of threads.
+	* @param pProgress Progress of the blot, can be NULL.
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull, false otherwise.
+	*/
+	bool blot(RasterElement* pDrizzled, unsigned int input, RasterElement* pBlotted, unsigned int threads, Progress* pProgress, std::string& error);
+
+private:
+	/**
+	* Joins the recorded blocks into one matrix with one row per output pixel of the region.
+	*/
+	void assemble();
+
+	DrizzleGrid mGrid;
+	unsigned int mStartRow;
+	unsigned int mStartColumn;
+	unsigned int mRows;
+	unsigned int mColumns;
+
+	std::vector<std::string> mInputNames;
+	std::vector<unsigned int> mInputRows;
+	std::vector<unsigned int> mInputColumns;
+	unsigned long long mInputPixels;
+
+	/**
+	* Recorded blocks, protected by mBlockMutex until they are assembled.
+	*/
+	std::list<DrizzleOperatorBlock> mBlocks;
+	QMutex mBlockMutex;
+
+	/**
+	* Matrix in compressed sparse row format, one row per output pixel of the region.
+	*/
+	std::vector<unsigned long long> mOffsets;
+	std::vector<unsigned long long> mSources;
+	std::vector<double> mWeights;
+	std::vector<unsigned int> mCounts;
+};
+
+#endif
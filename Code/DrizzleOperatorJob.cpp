@@ -0,0 +1,129 @@
+/********************************************//*
+*
+* @file: DrizzleOperatorJob.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "MessageLogResource.h"
+#include "ModelServices.h"
+#include "Progress.h"
+#include "ProgressResource.h"
+#include "RasterElement.h"
+#include "Service.h"
+#include "DrizzleAccumulator.h"
+#include "DrizzleJobManager.h"
+#include "DrizzleOperator.h"
+#include "DrizzleOperatorJob.h"
+
+#include <algorithm>
+
+DrizzleOperatorJob::DrizzleOperatorJob(RasterElement* pResult, GcpList* pGcpList, ProgressResource* pProgress, DrizzleOperator* pOperator,
+	const std::vector<RasterElement*>& images) :
+	DrizzleJob(0, 0, 1, 1, 1),
+	mpResult(pResult),
+	mpGcpList(pGcpList),
+	mpProgress(pProgress),
+	mpOperator(pOperator),
+	mImages(images),
+	mpAccumulator(NULL),
+	mApplied(0)
+{
+}
+
+DrizzleOperatorJob::~DrizzleOperatorJob()
+{
+	delete mpAccumulator;
+	delete mpOperator;
+	delete mpProgress;
+}
+
+size_t DrizzleOperatorJob::getMemoryEstimate() const
+{
+	//Pixels of all inputs gathered as doubles, and the sum, weight and count planes of the output
+	size_t pixels = 0;
+	for (unsigned int i = 0; i < mpOperator->getInputCount(); ++i)
+	{
+		pixels += static_cast<size_t>(mpOperator->getInputRows(i)) * mpOperator->getInputColumns(i);
+	}
+	const DrizzleGrid& grid = mpOperator->getGrid();
+	return pixels * sizeof(double) + static_cast<size_t>(grid.rows) * grid.columns * (2 * sizeof(double) + sizeof(unsigned int));
+}
+
+bool DrizzleOperatorJob::processTile(const DrizzleTile& tile, std::string& error)
+{
+	if (isAborted())
+	{
+		error = "Drizzle geometry aborted by user.";
+		return false;
+	}
+
+	//Sparse product on the rest of the thread budget, the thread of the job waits for it. The progress belongs to the GUI thread
+	unsigned int threads = static_cast<unsigned int>(std::max(DrizzleJobManager::instance()->getThreadBudget() - 1, 1));
+	mpAccumulator = mpOperator->apply(mImages, threads, NULL, error);
+	if (mpAccumulator == NULL)
+	{
+		return false;
+	}
+	mApplied.fetchAndStoreOrdered(1);
+	return true;
+}
+
+bool DrizzleOperatorJob::finish(std::string& error)
+{
+	return mpAccumulator->normalise(mpResult, error);
+}
+
+bool DrizzleOperatorJob::updateProgress(const std::string& message, int percent)
+{
+	if (mpProgress == NULL)
+	{
+		return true;
+	}
+
+	if (int(mApplied) == 0)
+	{
+		(*mpProgress)->updateProgress("Applying drizzle geometry", 0, NORMAL);
+	}
+	else
+	{
+		(*mpProgress)->updateProgress("Writing output", 100, NORMAL);
+	}
+
+	//Abort the job when the user cancelled the progress
+	return !isProgressAborted(mpProgress);
+}
+
+void DrizzleOperatorJob::complete(bool success, const std::string& error)
+{
+	StepResource pStep("Drizzle geometry output", "app", "6D2F4A8B-91C3-4E57-B0A6-3F8E1C7D5B29");
+	Progress* pProgress = (mpProgress == NULL) ? NULL : mpProgress->get();
+	std::string msg = error;
+
+	//Create view of the output and its corner coordinates
+	success = success && createView(mpResult, mpGcpList, msg) != NULL;
+
+	if (!success)
+	{
+		Service<ModelServices>()->destroyElement(mpResult);
+		pStep->finalize(Message::Failure, msg);
+		if (pProgress != NULL)
+		{
+			pProgress->updateProgress(msg, 0, ERRORS);
+		}
+	}
+	else
+	{
+		pStep->finalize();
+		if (pProgress != NULL)
+		{
+			pProgress->updateProgress("Done", 100, NORMAL);
+		}
+	}
+	mpResult = NULL;
+}
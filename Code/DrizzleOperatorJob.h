@@ -0,0 +1,75 @@
+/********************************************//*
+*
+* @file: DrizzleOperatorJob.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleOperatorJob_H
+#define DrizzleOperatorJob_H
+
+#include "DrizzleJob.h"
+
+#include <Qt/qatomic.h>
+
+#include <string>
+#include <vector>
+
+class DrizzleAccumulator;
+class DrizzleOperator;
+class GcpList;
+class ProgressResource;
+class RasterElement;
+
+/**
+*
+* DrizzleJob which applies a recorded drizzle geometry (DrizzleOperator) to other data sets.
+* The sparse product runs as the single tile of the job, on threads of its own within the thread budget
+* of the DrizzleJobManager, and is normalised into the output RasterElement, which is shown when the job has completed.
+*/
+class DrizzleOperatorJob : public DrizzleJob
+{
+public:
+	/**
+	* Constructor for the operator job.
+	*
+	* @param pResult Georeferenced output RasterElement with the output grid of the operator, the job takes ownership until it completes.
+	* @param pGcpList GCP list with the corner coordinates of the output, can be NULL.
+	* @param pProgress Progress of the job, the job takes ownership. Can be NULL.
+	* @param pOperator Drizzle geometry, the job takes ownership.
+	* @param images Data sets replacing the recorded inputs, in the order of the recorded inputs.
+	*/
+	DrizzleOperatorJob(RasterElement* pResult, GcpList* pGcpList, ProgressResource* pProgress, DrizzleOperator* pOperator,
+		const std::vector<RasterElement*>& images);
+
+	/**
+	* Destructor for the operator job.
+	*/
+	~DrizzleOperatorJob();
+
+	size_t getMemoryEstimate() const;
+	bool processTile(const DrizzleTile& tile, std::string& error);
+	bool finish(std::string& error);
+	bool updateProgress(const std::string& message, int percent);
+	void complete(bool success, const std::string& error);
+
+private:
+	RasterElement* mpResult;
+	GcpList* mpGcpList;
+	ProgressResource* mpProgress;
+	DrizzleOperator* mpOperator;
+	std::vector<RasterElement*> mImages;
+	DrizzleAccumulator* mpAccumulator;
+
+	/**
+	* Non-zero once the product is done and the output is being written.
+	*/
+	QAtomicInt mApplied;
+};
+
+#endif
@@ -0,0 +1,184 @@
+/********************************************//*
+*
+* @file: DrizzleQueue_GUI.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "DesktopServices.h"
+#include "Service.h"
+#include "DrizzleJobManager.h"
+#include "DrizzleQueue_GUI.h"
+
+#include <Qt/qgridlayout.h>
+#include <Qt/qheaderview.h>
+#include <Qt/qpointer.h>
+#include <Qt/qprogressbar.h>
+#include <Qt/qtimer.h>
+
+namespace
+{
+	/**
+	* Returns the text shown for the state of a job.
+	*/
+	QString stateText(const DrizzleJobInfo& info)
+	{
+		switch (info.state)
+		{
+		case JOB_QUEUED:
+			return "Queued";
+		case JOB_RUNNING:
+			return "Running";
+		case JOB_SUCCEEDED:
+			return "Done";
+		case JOB_ABORTED:
+			return "Aborted";
+		default:
+			return "Failed: " + info.error;
+		}
+	}
+
+	/**
+	* Sets the text of a cell, reusing its item so the selection is kept.
+	*/
+	QTableWidgetItem* setCell(QTableWidget* pTable, int row, int column, const QString& text)
+	{
+		QTableWidgetItem* pItem = pTable->item(row, column);
+		if (pItem == NULL)
+		{
+			pItem = new QTableWidgetItem();
+			pTable->setItem(row, column, pItem);
+		}
+		pItem->setText(text);
+		return pItem;
+	}
+};
+
+void DrizzleQueue_GUI::showQueue()
+{
+	//The queue view deletes itself when it is closed
+	static QPointer<DrizzleQueue_GUI> spQueue;
+	if (spQueue.isNull())
+	{
+		spQueue = new DrizzleQueue_GUI(Service<DesktopServices>()->getMainWidget());
+	}
+	spQueue->show();
+	spQueue->raise();
+}
+
+DrizzleQueue_GUI::DrizzleQueue_GUI(QWidget* Parent): QDialog(Parent)
+{
+	this->setWindowTitle("Drizzle queue");
+	setModal(FALSE);
+	setAttribute(Qt::WA_DeleteOnClose);
+
+	DrizzleJobManager* pManager = DrizzleJobManager::instance();
+
+	//WIDGETS
+	Jobs = new QTableWidget(0, 5, this);
+	QStringList headers;
+	headers << "Job" << "State" << "Progress" << "Tiles/s" << "Elapsed (s)";
+	Jobs->setHorizontalHeaderLabels(headers);
+	Jobs->setSelectionBehavior(QAbstractItemView::SelectRows);
+	Jobs->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	Jobs->verticalHeader()->hide();
+	Jobs->horizontalHeader()->setStretchLastSection(true);
+	Jobs->setMinimumWidth(500);
+
+	threads_text = new QLabel("Worker threads", this);
+	threads = new QSpinBox(this);
+	threads->setRange(1, 256);
+	threads->setValue(pManager->getThreadBudget());
+
+	memory_text = new QLabel("Memory budget (MB)", this);
+	memory = new QSpinBox(this);
+	memory->setRange(16, 1024 * 1024);
+	memory->setValue(static_cast<int>(pManager->getMemoryBudget() / (1024 * 1024)));
+
+	Abort = new QPushButton("Abort", this);
+	Clear = new QPushButton("Clear finished", this);
+	Close = new QPushButton("Close", this);
+
+	//LAYOUT
+	QGridLayout* pLayout = new QGridLayout(this);
+	pLayout->addWidget(Jobs, 0, 0, 1, 6);
+	pLayout->addWidget(threads_text, 1, 0);
+	pLayout->addWidget(threads, 1, 1);
+	pLayout->addWidget(memory_text, 1, 2);
+	pLayout->addWidget(memory, 1, 3);
+	pLayout->addWidget(Abort, 2, 0, 1, 2);
+	pLayout->addWidget(Clear, 2, 2, 1, 2);
+	pLayout->addWidget(Close, 2, 4, 1, 2);
+
+	//Make connections slots & signals
+	connect(Abort, SIGNAL(clicked()), this, SLOT(abortJobs()));
+	connect(Clear, SIGNAL(clicked()), this, SLOT(clearJobs()));
+	connect(Close, SIGNAL(clicked()), this, SLOT(close()));
+	connect(threads, SIGNAL(valueChanged(int)), this, SLOT(updateBudgets()));
+	connect(memory, SIGNAL(valueChanged(int)), this, SLOT(updateBudgets()));
+	connect(pManager, SIGNAL(jobsChanged()), this, SLOT(updateJobs()));
+	connect(pManager, SIGNAL(jobProgress(int, int)), this, SLOT(updateJobs()));
+
+	//Refresh elapsed time and throughput of running jobs
+	QTimer* pTimer = new QTimer(this);
+	connect(pTimer, SIGNAL(timeout()), this, SLOT(updateJobs()));
+	pTimer->start(1000);
+
+	updateJobs();
+}
+
+DrizzleQueue_GUI::~DrizzleQueue_GUI()
+{
+}
+
+void DrizzleQueue_GUI::updateJobs(){
+	QList<DrizzleJobInfo> jobs = DrizzleJobManager::instance()->getJobs();
+	Jobs->setRowCount(jobs.size());
+
+	for (int row = 0; row < jobs.size(); ++row)
+	{
+		const DrizzleJobInfo& info = jobs[row];
+
+		setCell(Jobs, row, 0, info.name)->setData(Qt::UserRole, info.id);
+		setCell(Jobs, row, 1, stateText(info));
+
+		QProgressBar* pBar = dynamic_cast<QProgressBar*>(Jobs->cellWidget(row, 2));
+		if (pBar == NULL)
+		{
+			pBar = new QProgressBar(Jobs);
+			pBar->setRange(0, 100);
+			Jobs->setCellWidget(row, 2, pBar);
+		}
+		pBar->setValue(info.tileCount == 0 ? 0 : static_cast<int>((static_cast<unsigned long long>(info.tilesDone) * 100) / info.tileCount));
+
+		double throughput = (info.elapsed > 0.0) ? info.tilesDone / info.elapsed : 0.0;
+		setCell(Jobs, row, 3, QString::number(throughput, 'f', 1));
+		setCell(Jobs, row, 4, QString::number(info.elapsed, 'f', 1));
+	}
+}
+
+void DrizzleQueue_GUI::abortJobs(){
+	QList<QTableWidgetItem*> selected = Jobs->selectedItems();
+	for (QList<QTableWidgetItem*>::iterator it = selected.begin(); it != selected.end(); ++it)
+	{
+		if ((*it)->column() == 0)
+		{
+			DrizzleJobManager::instance()->abort((*it)->data(Qt::UserRole).toInt());
+		}
+	}
+}
+
+void DrizzleQueue_GUI::clearJobs(){
+	DrizzleJobManager::instance()->clearFinished();
+}
+
+void DrizzleQueue_GUI::updateBudgets(){
+	DrizzleJobManager* pManager = DrizzleJobManager::instance();
+	pManager->setThreadBudget(threads->value());
+	pManager->setMemoryBudget(static_cast<size_t>(memory->value()) * 1024 * 1024);
+}
@@ -0,0 +1,114 @@
+/********************************************//*
+*
+* @file: DrizzleQueue_GUI.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleQueue_GUI_H
+#define DrizzleQueue_GUI_H
+
+#include <Qt/qdialog.h>
+#include <Qt/qlabel.h>
+#include <Qt/qpushbutton.h>
+#include <Qt/qspinbox.h>
+#include <Qt/qtablewidget.h>
+
+/**
+*
+* Queue view of the DrizzleJobManager: shows the progress and throughput of
+* every queued, running and finished job and lets the user change the budgets.
+*/
+class DrizzleQueue_GUI : public QDialog
+{
+	Q_OBJECT
+public:
+	/**
+	* Shows the queue view, only one queue view is opened at a time.
+	*/
+	static void showQueue();
+
+	/**
+	* Constructor for the queue view.
+	*
+	* @param Parent QWidget as parent for construction of QDialog.
+	*/
+	DrizzleQueue_GUI(QWidget* Parent);
+
+	/**
+	* Destructor for the queue view.
+	*/
+	~DrizzleQueue_GUI();
+
+public slots:
+	/**
+	* Slot to rebuild the table of jobs.
+	* Connected to DrizzleJobManager::jobsChanged() and a timer.
+	*/
+	void updateJobs();
+
+	/**
+	* Slot to abort the selected jobs, connected to 'Abort' button.
+	*/
+	void abortJobs();
+
+	/**
+	* Slot to remove finished jobs from the table, connected to 'Clear finished' button.
+	*/
+	void clearJobs();
+
+	/**
+	* Slot to pass the budgets to the DrizzleJobManager.
+	* Connected to the budget QSpinBoxes.
+	*/
+	void updateBudgets();
+
+private:
+	/**
+	* QTableWidget listing the jobs.
+	*/
+	QTableWidget *Jobs;
+
+	/**
+	* QLabel for thread budget.
+	*/
+	QLabel *threads_text;
+
+	/**
+	* QSpinBox to input the number of worker threads shared by all jobs.
+	*/
+	QSpinBox *threads;
+
+	/**
+	* QLabel for memory budget.
+	*/
+	QLabel *memory_text;
+
+	/**
+	* QSpinBox to input the memory in MB the running jobs may use together.
+	*/
+	QSpinBox *memory;
+
+	/**
+	* QPushButton to abort the selected jobs.
+	* Connects to abortJobs() SLOT.
+	*/
+	QPushButton *Abort;
+
+	/**
+	* QPushButton to clear finished jobs.
+	* Connects to clearJobs() SLOT.
+	*/
+	QPushButton *Clear;
+
+	/**
+	* QPushButton to close the queue view.
+	*/
+	QPushButton *Close;
+};
+#endif
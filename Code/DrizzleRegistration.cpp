@@ -0,0 +1,931 @@
+/********************************************//*
+*
+* @file: DrizzleRegistration.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "Progress.h"
+#include "DrizzleRegistration.h"
+
+#include <Qt/qdatetime.h>
+#include <Qt/qstring.h>
+#include <Qt/qstringlist.h>
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+using namespace cv;
+
+namespace
+{
+	/**
+	* Reports the progress of the benchmark.
+	*
+	* @return False when the user aborted the benchmark.
+	*/
+	bool report(Progress* pProgress, const std::string& message, int percent)
+	{
+		if (pProgress == NULL)
+		{
+			return true;
+		}
+		pProgress->updateProgress(message, percent, NORMAL);
+
+		std::string text;
+		int current = 0;
+		ReportingLevel level = NORMAL;
+		pProgress->getProgress(text, current, level);
+		return level != ABORT;
+	}
+
+	/**
+	* Orders keypoints from the strongest to the weakest response.
+	*/
+	bool strongerResponse(const KeyPoint& first, const KeyPoint& second)
+	{
+		return first.response > second.response;
+	}
+
+	/**
+	* Samples a gray scale image between pixels by bilinear interpolation.
+	*/
+	template<typename T>
+	double interpolate(const Mat& image, double x, double y)
+	{
+		int col = static_cast<int>(x);
+		int row = static_cast<int>(y);
+		double dx = x - col;
+		double dy = y - row;
+		const T* pTop = image.ptr<T>(row) + col;
+		const T* pBottom = image.ptr<T>(row + 1) + col;
+		return (1.0 - dy) * ((1.0 - dx) * pTop[0] + dx * pTop[1]) + dy * ((1.0 - dx) * pBottom[0] + dx * pBottom[1]);
+	}
+
+	double interpolate(const Mat& image, double x, double y)
+	{
+		return (image.depth() == CV_16U) ? interpolate<unsigned short>(image, x, y) : interpolate<unsigned char>(image, x, y);
+	}
+
+	/**
+	* Moves the zero frequency of a spectrum to its centre, for spectra of odd size as well.
+	*/
+	void shiftQuadrants(const Mat& source, Mat& target)
+	{
+		int columns = source.cols / 2;
+		int rows = source.rows / 2;
+		int rightColumns = source.cols - columns;
+		int bottomRows = source.rows - rows;
+		target.create(source.size(), source.type());
+		source(Rect(columns, rows, rightColumns, bottomRows)).copyTo(target(Rect(0, 0, rightColumns, bottomRows)));
+		source(Rect(0, rows, columns, bottomRows)).copyTo(target(Rect(rightColumns, 0, columns, bottomRows)));
+		source(Rect(columns, 0, rightColumns, rows)).copyTo(target(Rect(0, bottomRows, rightColumns, rows)));
+		source(Rect(0, 0, columns, rows)).copyTo(target(Rect(rightColumns, bottomRows, columns, rows)));
+	}
+};
+
+DrizzleRegistration::DrizzleRegistration(const std::string& features, unsigned int timeLimit) :
+	mMode(MODE_SURF),
+	mBudget(getSettingKeypointBudget()),
+	mRatio(getSettingMatchRatio()),
+	mTimeLimit(timeLimit),
+	mLevels(getSettingPyramidLevels()),
+	mIterations(getSettingRefinementIterations()),
+	mLogPolarScale(1.0),
+	mHasReference(false),
+	mDetections(0),
+	mReprojectionError(0.0)
+{
+	if (features == "Phase correlation" || features == "Log-polar phase correlation")
+	{
+		mMode = (features == "Phase correlation") ? MODE_PHASE : MODE_LOG_POLAR;
+	}
+	else if (features == "ORB")
+	{
+		mMode = MODE_ORB;
+		//ORB detects and describes, the number of features is bounded instead of the detector threshold
+		Ptr<ORB> pOrb = new ORB(mBudget == 0 ? 1000 : 2 * static_cast<int>(mBudget));
+		mpDetector = pOrb;
+		mpExtractor = pOrb;
+	}
+	else
+	{
+		//With a budget the threshold is lower, so frames with little texture still yield enough keypoints
+		mpDetector = new SurfFeatureDetector(mBudget == 0 ? 600 : 300);
+		mpExtractor = new SurfDescriptorExtractor();
+	}
+}
+
+Ptr<DescriptorMatcher> DrizzleRegistration::createMatcher() const
+{
+	if (mMode == MODE_ORB)
+	{
+		//Multi-probe LSH: 12 hash tables, 20 bit keys, neighbouring buckets probed up to 2 bits away
+		return new FlannBasedMatcher(new flann::LshIndexParams(12, 20, 2));
+	}
+	return new FlannBasedMatcher();
+}
+
+unsigned int DrizzleRegistration::getLevels(const Size& size) const
+{
+	if (mLevels > 0)
+	{
+		return mLevels;
+	}
+
+	//Halve the frame as long as its smaller side keeps at least 480 pixels
+	unsigned int levels = 0;
+	for (int side = std::min(size.width, size.height); side / 2 >= 480; side /= 2)
+	{
+		levels++;
+	}
+	return levels;
+}
+
+bool DrizzleRegistration::isOverTime(const QTime& timer) const
+{
+	//Without an earlier transformation to fall back on, the registration runs to the end
+	return mTimeLimit > 0 && !mLastHomography.empty() && static_cast<unsigned int>(timer.elapsed()) >= mTimeLimit;
+}
+
+bool DrizzleRegistration::detect(const Mat& image, unsigned int index, const QTime& timer, Features& features)
+{
+	features.index = index;
+	features.keypoints.clear();
+	features.descriptors.release();
+	features.pMatcher.release();
+	features.samples.clear();
+	features.intensities.clear();
+	features.steepestDescent.release();
+	mDetections++;
+
+	//The pyramid is kept with the features, its full resolution level is the reference of the refinement
+	buildPyramid(image, features.pyramid, static_cast<int>(getLevels(image.size())));
+	const Mat& coarse = features.pyramid.back();
+	if (isOverTime(timer))
+	{
+		return false;
+	}
+
+	//FEATURE DETECTION AND DESCRIPTION
+	mpDetector->detect(coarse, features.keypoints);
+	selectKeypoints(features.keypoints, coarse.size());
+	if (isOverTime(timer))
+	{
+		return false;
+	}
+	mpExtractor->compute(coarse, features.keypoints, features.descriptors);
+	if (features.descriptors.empty() || isOverTime(timer))
+	{
+		return false;
+	}
+
+	//The index is built once and matched against by every frame registered on these features
+	features.pMatcher = createMatcher();
+	features.pMatcher->add(std::vector<Mat>(1, features.descriptors));
+	features.pMatcher->train();
+	return true;
+}
+
+void DrizzleRegistration::selectKeypoints(std::vector<KeyPoint>& keypoints, const Size& size) const
+{
+	if (mBudget == 0 || keypoints.size() <= mBudget)
+	{
+		return;
+	}
+
+	//The strongest responses of every cell of a grid, so the features spread over the frame whatever its texture
+	const int cells = 4;
+	unsigned int quota = std::max(mBudget / (cells * cells), 1u);
+	std::vector<unsigned int> counts(cells * cells, 0);
+	std::sort(keypoints.begin(), keypoints.end(), strongerResponse);
+	std::vector<KeyPoint> selected;
+	std::vector<KeyPoint> remaining;
+	for (unsigned int i = 0; i < keypoints.size(); ++i)
+	{
+		int column = std::min(std::max(static_cast<int>(keypoints[i].pt.x * cells / size.width), 0), cells - 1);
+		int row = std::min(std::max(static_cast<int>(keypoints[i].pt.y * cells / size.height), 0), cells - 1);
+		if (counts[row * cells + column] < quota)
+		{
+			counts[row * cells + column]++;
+			selected.push_back(keypoints[i]);
+		}
+		else
+		{
+			remaining.push_back(keypoints[i]);
+		}
+	}
+
+	//Cells with few features leave their share of the budget to the strongest remaining features
+	for (unsigned int i = 0; i < remaining.size() && selected.size() < mBudget; ++i)
+	{
+		selected.push_back(remaining[i]);
+	}
+	keypoints.swap(selected);
+}
+
+bool DrizzleRegistration::estimate(const std::vector<Point2f>& frame, const std::vector<Point2f>& reference, const QTime& timer, Mat& homography, std::vector<unsigned char>& inliers) const
+{
+	//Adaptive RANSAC: the number of iterations follows from the best inlier ratio so far, so frames with many inliers stop early
+	const double threshold = 3.0;
+	const double confidence = 0.995;
+	unsigned int count = static_cast<unsigned int>(frame.size());
+	unsigned int iterations = 2000;
+	unsigned int bestCount = 0;
+	Mat best;
+	RNG rng(count);
+	std::vector<Point2f> projected;
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		//The time limit ends the search, the best model so far is kept
+		if (mTimeLimit > 0 && bestCount > 0 && static_cast<unsigned int>(timer.elapsed()) >= mTimeLimit)
+		{
+			break;
+		}
+
+		//Minimal sample of four distinct matches
+		int sample[4];
+		for (int j = 0; j < 4; ++j)
+		{
+			bool distinct = false;
+			while (!distinct)
+			{
+				sample[j] = rng.uniform(0, static_cast<int>(count));
+				distinct = true;
+				for (int k = 0; k < j; ++k)
+				{
+					distinct = distinct && sample[k] != sample[j];
+				}
+			}
+		}
+		Point2f source[4];
+		Point2f target[4];
+		for (int j = 0; j < 4; ++j)
+		{
+			source[j] = frame[sample[j]];
+			target[j] = reference[sample[j]];
+		}
+		Mat model = getPerspectiveTransform(source, target);
+		if (fabs(determinant(model)) < DBL_EPSILON)
+		{
+			continue;
+		}
+
+		perspectiveTransform(frame, projected, model);
+		unsigned int inlierCount = 0;
+		for (unsigned int j = 0; j < count; ++j)
+		{
+			if (norm(projected[j] - reference[j]) < threshold)
+			{
+				inlierCount++;
+			}
+		}
+		if (inlierCount > bestCount)
+		{
+			bestCount = inlierCount;
+			best = model;
+
+			//Iterations needed to draw one sample of inliers only with the required confidence
+			//Low ratios need more iterations than an unsigned int holds, so the count is clamped before it is converted
+			double sampleRatio = pow(static_cast<double>(inlierCount) / count, 4);
+			double needed = (sampleRatio >= 1.0 - DBL_EPSILON) ? 0.0 : ceil(log(1.0 - confidence) / log(1.0 - sampleRatio));
+			if (needed < iterations)
+			{
+				iterations = std::max(i + 1, static_cast<unsigned int>(needed));
+			}
+		}
+	}
+	if (bestCount < 4)
+	{
+		return false;
+	}
+
+	//Least squares fit on the inliers of the best model
+	perspectiveTransform(frame, projected, best);
+	std::vector<Point2f> frameInliers;
+	std::vector<Point2f> referenceInliers;
+	for (unsigned int j = 0; j < count; ++j)
+	{
+		if (norm(projected[j] - reference[j]) < threshold)
+		{
+			frameInliers.push_back(frame[j]);
+			referenceInliers.push_back(reference[j]);
+		}
+	}
+	homography = findHomography(frameInliers, referenceInliers, 0);
+	if (homography.empty())
+	{
+		homography = best;
+	}
+
+	perspectiveTransform(frame, projected, homography);
+	inliers.resize(count);
+	for (unsigned int j = 0; j < count; ++j)
+	{
+		inliers[j] = (norm(projected[j] - reference[j]) < threshold) ? 1 : 0;
+	}
+	return true;
+}
+
+void DrizzleRegistration::prepareRefinement(Features& features) const
+{
+	//At most this many pixels, the strongest gradient of every cell of a grid over the frame
+	const int maxSamples = 2000;
+	const Mat& image = features.pyramid.front();
+	int cell = std::max(static_cast<int>(ceil(sqrt(static_cast<double>(image.rows) * image.cols / maxSamples))), 4);
+	Mat gradientX;
+	Mat gradientY;
+	Sobel(image, gradientX, CV_32F, 1, 0, 3, 1.0 / 8);
+	Sobel(image, gradientY, CV_32F, 0, 1, 3, 1.0 / 8);
+
+	//Coordinates are centred and scaled to the frame, which keeps the Hessian well conditioned
+	double scale = std::max(image.cols, image.rows) / 2.0;
+	double centreX = image.cols / 2.0;
+	double centreY = image.rows / 2.0;
+	std::vector<double> steepestDescent;
+	for (int top = 1; top < image.rows - 1; top += cell)
+	{
+		for (int left = 1; left < image.cols - 1; left += cell)
+		{
+			int bestRow = -1;
+			int bestCol = -1;
+			float bestMagnitude = 1.0f;
+			for (int row = top; row < std::min(top + cell, image.rows - 1); ++row)
+			{
+				const float* pX = gradientX.ptr<float>(row);
+				const float* pY = gradientY.ptr<float>(row);
+				for (int col = left; col < std::min(left + cell, image.cols - 1); ++col)
+				{
+					float magnitude = pX[col] * pX[col] + pY[col] * pY[col];
+					if (magnitude > bestMagnitude)
+					{
+						bestMagnitude = magnitude;
+						bestRow = row;
+						bestCol = col;
+					}
+				}
+			}
+			if (bestRow < 0)
+			{
+				continue;
+			}
+
+			//Steepest descent image of the homography parameters at the identity warp
+			double x = (bestCol - centreX) / scale;
+			double y = (bestRow - centreY) / scale;
+			double gx = gradientX.at<float>(bestRow, bestCol) * scale;
+			double gy = gradientY.at<float>(bestRow, bestCol) * scale;
+			double radial = gx * x + gy * y;
+			double row[] = { gx * x, gy * x, gx * y, gy * y, gx, gy, -x * radial, -y * radial };
+			steepestDescent.insert(steepestDescent.end(), row, row + 8);
+			features.samples.push_back(Point2f(static_cast<float>(bestCol), static_cast<float>(bestRow)));
+			features.intensities.push_back(static_cast<float>(interpolate(image, bestCol, bestRow)));
+		}
+	}
+	Mat(static_cast<int>(features.samples.size()), 8, CV_64F, steepestDescent.empty() ? NULL : &steepestDescent[0]).copyTo(features.steepestDescent);
+}
+
+void DrizzleRegistration::refine(const Features& reference, const Mat& frame, const QTime& timer, Mat& homography) const
+{
+	if (reference.samples.size() < 8)
+	{
+		return;
+	}
+
+	//The warp maps the reference onto the frame, in the centred and scaled coordinates of the samples
+	double scale = std::max(frame.cols, frame.rows) / 2.0;
+	Mat normalise = (Mat_<double>(3, 3) << 1.0 / scale, 0.0, -frame.cols / (2.0 * scale), 0.0, 1.0 / scale, -frame.rows / (2.0 * scale), 0.0, 0.0, 1.0);
+	Mat denormalise = normalise.inv();
+	Mat warp = normalise * homography.inv() * denormalise;
+	Mat best = warp.clone();
+	double bestError = -1.0;
+	for (unsigned int iteration = 0; iteration <= mIterations; ++iteration)
+	{
+		Mat pixelWarp = denormalise * warp * normalise;
+		const double* g = pixelWarp.ptr<double>(0);
+
+		//Inverse compositional Gauss-Newton step: the steepest descent images of the reference are computed once
+		Mat hessian = Mat::zeros(8, 8, CV_64F);
+		Mat gradient = Mat::zeros(8, 1, CV_64F);
+		double error = 0.0;
+		unsigned int valid = 0;
+		for (unsigned int i = 0; i < reference.samples.size(); ++i)
+		{
+			const Point2f& point = reference.samples[i];
+			double w = g[6] * point.x + g[7] * point.y + g[8];
+			double u = (g[0] * point.x + g[1] * point.y + g[2]) / w;
+			double v = (g[3] * point.x + g[4] * point.y + g[5]) / w;
+			if (!(u >= 0.0 && v >= 0.0 && u < frame.cols - 1 && v < frame.rows - 1))
+			{
+				continue;
+			}
+			double difference = interpolate(frame, u, v) - reference.intensities[i];
+			const double* sd = reference.steepestDescent.ptr<double>(i);
+			for (int r = 0; r < 8; ++r)
+			{
+				gradient.at<double>(r) += sd[r] * difference;
+				double* pHessian = hessian.ptr<double>(r);
+				for (int c = 0; c < 8; ++c)
+				{
+					pHessian[c] += sd[r] * sd[c];
+				}
+			}
+			error += fabs(difference);
+			valid++;
+		}
+		if (valid < 8)
+		{
+			break;
+		}
+
+		//A step that increases the error is not kept
+		error /= valid;
+		if (bestError < 0.0 || error < bestError)
+		{
+			bestError = error;
+			best = warp.clone();
+		}
+		if (iteration == mIterations || (mTimeLimit > 0 && static_cast<unsigned int>(timer.elapsed()) >= mTimeLimit))
+		{
+			break;
+		}
+
+		Mat step;
+		if (!solve(hessian, gradient, step, DECOMP_CHOLESKY))
+		{
+			break;
+		}
+		const double* p = step.ptr<double>(0);
+		Mat increment = (Mat_<double>(3, 3) << 1.0 + p[0], p[2], p[4], p[1], 1.0 + p[3], p[5], p[6], p[7], 1.0);
+		warp = warp * increment.inv();
+	}
+
+	homography = (denormalise * best * normalise).inv();
+	homography /= homography.at<double>(2, 2);
+}
+
+void DrizzleRegistration::preparePhase(const Size& size)
+{
+	if (size == mFrameSize)
+	{
+		return;
+	}
+
+	//Transform sizes with small prime factors only are the fastest
+	mFrameSize = size;
+	createHanningWindow(mWindow, size, CV_32F);
+	mTransformSize = Size(getOptimalDFTSize(size.width), getOptimalDFTSize(size.height));
+	mLogPolarScale = mTransformSize.width / log(std::max(std::min(mTransformSize.width, mTransformSize.height) / 2.0, 2.0));
+	mHasReference = false;
+}
+
+void DrizzleRegistration::transform(const Mat& image, Mat& spectrum)
+{
+	//The window suppresses the edges of the frame, which do not move with the scene
+	Mat windowed;
+	image.convertTo(windowed, CV_32F);
+	multiply(windowed, mWindow, windowed);
+
+	Mat padded;
+	copyMakeBorder(windowed, padded, 0, mTransformSize.height - image.rows, 0, mTransformSize.width - image.cols, BORDER_CONSTANT, Scalar::all(0));
+	dft(padded, spectrum, DFT_COMPLEX_OUTPUT);
+}
+
+void DrizzleRegistration::analyse(const Mat& image, unsigned int index, Spectra& spectra)
+{
+	spectra.index = index;
+	spectra.rotation.release();
+	mDetections++;
+	transform(image, spectra.translation);
+	if (mMode != MODE_LOG_POLAR)
+	{
+		return;
+	}
+
+	//The magnitude spectrum does not depend on translation, rotation and scale turn into shifts in log-polar coordinates
+	std::vector<Mat> planes;
+	split(spectra.translation, planes);
+	Mat magnitudes;
+	magnitude(planes[0], planes[1], magnitudes);
+	magnitudes += Scalar::all(1.0);
+	log(magnitudes, magnitudes);
+	Mat centred;
+	shiftQuadrants(magnitudes, centred);
+
+	Mat polar(centred.size(), CV_32F);
+	IplImage source = centred;
+	IplImage target = polar;
+	cvLogPolar(&source, &target, cvPoint2D32f(centred.cols - centred.cols / 2, centred.rows - centred.rows / 2), mLogPolarScale, CV_INTER_LINEAR + CV_WARP_FILL_OUTLIERS);
+	dft(polar, spectra.rotation, DFT_COMPLEX_OUTPUT);
+}
+
+Point2d DrizzleRegistration::correlate(const Mat& referenceSpectrum, const Mat& spectrum)
+{
+	//Normalised cross power spectrum, only the phase difference is kept
+	Mat cross;
+	mulSpectrums(referenceSpectrum, spectrum, cross, 0, true);
+	std::vector<Mat> planes;
+	split(cross, planes);
+	Mat magnitudes;
+	magnitude(planes[0], planes[1], magnitudes);
+	magnitudes += Scalar::all(FLT_EPSILON);
+	divide(planes[0], magnitudes, planes[0]);
+	divide(planes[1], magnitudes, planes[1]);
+	merge(planes, cross);
+
+	Mat correlation;
+	idft(cross, correlation, DFT_REAL_OUTPUT | DFT_SCALE);
+	Point peak;
+	minMaxLoc(correlation, NULL, NULL, NULL, &peak);
+
+	//Weighted centroid of the neighbourhood of the peak, the correlation is periodic
+	double sum = 0.0;
+	double x = 0.0;
+	double y = 0.0;
+	for (int dy = -2; dy <= 2; ++dy)
+	{
+		int row = (peak.y + dy + correlation.rows) % correlation.rows;
+		for (int dx = -2; dx <= 2; ++dx)
+		{
+			int col = (peak.x + dx + correlation.cols) % correlation.cols;
+			double value = correlation.at<float>(row, col);
+			if (value > 0.0)
+			{
+				sum += value;
+				x += value * dx;
+				y += value * dy;
+			}
+		}
+	}
+	Point2d shift(peak.x, peak.y);
+	if (sum > 0.0)
+	{
+		shift.x += x / sum;
+		shift.y += y / sum;
+	}
+
+	//Shifts over more than half the size wrap around
+	if (shift.x > correlation.cols / 2.0)
+	{
+		shift.x -= correlation.cols;
+	}
+	if (shift.y > correlation.rows / 2.0)
+	{
+		shift.y -= correlation.rows;
+	}
+	return shift;
+}
+
+bool DrizzleRegistration::registerPhase(const Mat& frame, unsigned int index, const Mat& reference, unsigned int referenceIndex, bool keep, Mat& homography)
+{
+	preparePhase(frame.size());
+
+	//The spectra of the reference are usually kept from the frame registered before
+	if (!mHasReference || mReferenceSpectra.index != referenceIndex)
+	{
+		analyse(reference, referenceIndex, mReferenceSpectra);
+		mHasReference = true;
+	}
+	Spectra current;
+	analyse(frame, index, current);
+
+	//Rotation and scale around the centre of the frame, found first so the translation is correlated on the aligned frame
+	Mat affine = Mat::eye(2, 3, CV_64F);
+	Mat spectrum;
+	if (mMode != MODE_LOG_POLAR)
+	{
+		spectrum = current.translation;
+	}
+	else
+	{
+		Point2d shift = correlate(mReferenceSpectra.rotation, current.rotation);
+
+		//The magnitude spectrum is symmetric, rotations are only known up to 180 degrees
+		double angle = shift.y * 360.0 / current.rotation.rows;
+		if (angle > 90.0)
+		{
+			angle -= 180.0;
+		}
+		else if (angle < -90.0)
+		{
+			angle += 180.0;
+		}
+		double scale = exp(-shift.x / mLogPolarScale);
+		affine = getRotationMatrix2D(Point2f(frame.cols / 2.0f, frame.rows / 2.0f), -angle, scale);
+
+		Mat aligned;
+		warpAffine(frame, aligned, affine, frame.size());
+		transform(aligned, spectrum);
+	}
+	Point2d translation = correlate(mReferenceSpectra.translation, spectrum);
+	if (keep)
+	{
+		mReferenceSpectra = current;
+	}
+
+	homography = Mat::eye(3, 3, CV_64F);
+	affine.copyTo(homography(Rect(0, 0, 3, 2)));
+	homography.at<double>(0,2) += translation.x;
+	homography.at<double>(1,2) += translation.y;
+	mReprojectionError = 0.0;
+
+	//Compensate for the difference between frame size and frame coordinates (width in pixel != width in coordinates)
+	toRelative(frame.size(), homography);
+	return true;
+}
+
+void DrizzleRegistration::toRelative(const Size& size, Mat& homography)
+{
+	//Rotation and scale mix both axes, so translation alone is not enough when the frame is not square
+	Mat scale = Mat::eye(3, 3, CV_64F);
+	scale.at<double>(0,0) = 1.0 / size.width;
+	scale.at<double>(1,1) = 1.0 / size.height;
+	Mat inverse = Mat::eye(3, 3, CV_64F);
+	inverse.at<double>(0,0) = size.width;
+	inverse.at<double>(1,1) = size.height;
+	homography = scale * homography * inverse;
+}
+
+bool DrizzleRegistration::registerFrame(const Mat& frame, unsigned int index, const Mat& reference, unsigned int referenceIndex, bool keep, Mat& homography)
+{
+	if (mMode == MODE_PHASE || mMode == MODE_LOG_POLAR)
+	{
+		return registerPhase(frame, index, reference, referenceIndex, keep, homography);
+	}
+
+	QTime timer;
+	timer.start();
+
+	//Past the time limit the remaining stages are skipped and the transformation of the frame registered before is used,
+	//a stage which has started runs to its end
+	//The features of the reference are usually kept from the frame registered before
+	if (!mHasReference || mReference.index != referenceIndex)
+	{
+		mHasReference = detect(reference, referenceIndex, timer, mReference);
+		if (!mHasReference)
+		{
+			return fallBack(timer, homography);
+		}
+	}
+	if (mIterations > 0 && mReference.steepestDescent.empty())
+	{
+		prepareRefinement(mReference);
+	}
+	if (isOverTime(timer))
+	{
+		return fallBack(timer, homography);
+	}
+	Features referenceFeatures = mReference;
+
+	Features current;
+	if (!detect(frame, index, timer, current))
+	{
+		return fallBack(timer, homography);
+	}
+
+	//Query the frame against the index of the reference, queryIdx refers to the frame and trainIdx to the reference.
+	//The features of the frame are complete once its index is built, so they are kept even past the time limit
+	std::vector< std::vector<DMatch> > matches;
+	if (!isOverTime(timer))
+	{
+		mReference.pMatcher->knnMatch(current.descriptors, matches, 2);
+	}
+	if (isOverTime(timer))
+	{
+		if (keep)
+		{
+			mReference = current;
+		}
+		return fallBack(timer, homography);
+	}
+
+	//Ratio test: a match is kept when it is clearly closer than the second best, RANSAC rejects the remaining outliers.
+	//LSH leaves descriptors without a neighbour in the probed buckets unmatched
+	std::vector< Point2f > frame_matches;
+	std::vector< Point2f > reference_matches;
+	for( unsigned int i = 0; i < matches.size(); i++ )
+	{
+		if (matches[i].empty() || matches[i][0].trainIdx < 0)
+		{
+			continue;
+		}
+		if (matches[i].size() > 1 && matches[i][1].trainIdx >= 0 && matches[i][0].distance >= mRatio * matches[i][1].distance)
+		{
+			continue;
+		}
+		frame_matches.push_back( current.keypoints[ matches[i][0].queryIdx ].pt );
+		reference_matches.push_back( mReference.keypoints[ matches[i][0].trainIdx ].pt );
+	}
+
+	//The frame becomes the reference of the next frame whether or not it can be registered itself
+	if (keep)
+	{
+		mReference = current;
+	}
+	if (frame_matches.size() < 4)
+	{
+		return false;
+	}
+
+	//Determine transformation matrix between matches, at the coarse level of the pyramids
+	std::vector<unsigned char> inliers;
+	if (!estimate(frame_matches, reference_matches, timer, homography, inliers))
+	{
+		return false;
+	}
+
+	//The pyramid rounds odd sizes up, so the ratio between full resolution and the coarse level differs per axis
+	const Mat& coarse = current.pyramid.back();
+	double factorX = static_cast<double>(frame.cols) / coarse.cols;
+	double factorY = static_cast<double>(frame.rows) / coarse.rows;
+
+	//Distance at full resolution between the transformed inliers of the frame and their matches in the reference
+	std::vector< Point2f > transformed;
+	perspectiveTransform(frame_matches, transformed, homography);
+	double distance = 0.0;
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < transformed.size(); ++i)
+	{
+		if (i < inliers.size() && inliers[i] != 0)
+		{
+			Point2f difference = transformed[i] - reference_matches[i];
+			distance += sqrt(factorX * difference.x * factorX * difference.x + factorY * difference.y * factorY * difference.y);
+			count++;
+		}
+	}
+	mReprojectionError = (count == 0) ? 0.0 : distance / count;
+
+	//Scale the transformation from the coarse level to full resolution (D*H*D^-1), then refine it on the pixels
+	Mat scale = Mat::eye(3, 3, CV_64F);
+	scale.at<double>(0,0) = factorX;
+	scale.at<double>(1,1) = factorY;
+	Mat inverse = Mat::eye(3, 3, CV_64F);
+	inverse.at<double>(0,0) = 1.0 / factorX;
+	inverse.at<double>(1,1) = 1.0 / factorY;
+	homography = scale * homography * inverse;
+	if (mIterations > 0)
+	{
+		refine(referenceFeatures, frame, timer, homography);
+	}
+
+	//Compensate for the difference between frame size and frame coordinates (width in pixel != width in coordinates)
+	toRelative(frame.size(), homography);
+	mLastHomography = homography.clone();
+	return true;
+}
+
+bool DrizzleRegistration::fallBack(const QTime& timer, Mat& homography) const
+{
+	//Failures within the time limit are genuine
+	if (!isOverTime(timer))
+	{
+		return false;
+	}
+	homography = mLastHomography.clone();
+	return true;
+}
+
+bool DrizzleRegistration::hasReference(unsigned int index) const
+{
+	if (!mHasReference)
+	{
+		return false;
+	}
+	return (mMode == MODE_PHASE || mMode == MODE_LOG_POLAR) ? mReferenceSpectra.index == index : mReference.index == index;
+}
+
+unsigned int DrizzleRegistration::getDetections() const
+{
+	return mDetections;
+}
+
+double DrizzleRegistration::getReprojectionError() const
+{
+	return mReprojectionError;
+}
+
+bool DrizzleRegistration::benchmark(const std::string& filename, unsigned int frames, unsigned int timeLimit, Progress* pProgress, std::string& result, std::string& error)
+{
+	report(pProgress, "Benchmarking registration: loading frames", 0);
+
+	//The frames are decoded up front, so only the registration is timed
+	CvCapture* pCapture = cvCreateFileCapture(filename.c_str());
+	if (pCapture == NULL)
+	{
+		error = "Video input failed.";
+		return false;
+	}
+	std::vector<Mat> gray;
+	for (unsigned int i = 0; i < frames; ++i)
+	{
+		IplImage* pImage = cvQueryFrame(pCapture);
+		if (pImage == NULL)
+		{
+			break;
+		}
+		Mat color(pImage);
+		gray.push_back(Mat());
+		if (color.channels() == 1)
+		{
+			color.copyTo(gray.back());
+		}
+		else
+		{
+			cvtColor(color, gray.back(), CV_BGR2GRAY);
+		}
+	}
+	cvReleaseCapture(&pCapture);
+	if (gray.size() < 2)
+	{
+		error = "The benchmark needs at least two frames.";
+		return false;
+	}
+
+	//Corners of a frame in coordinates relative to the frame size, as they are placed on the output grid
+	std::vector<Point2f> corners(4);
+	corners[0] = Point2f(0, 0);
+	corners[1] = Point2f(0, 1);
+	corners[2] = Point2f(1, 1);
+	corners[3] = Point2f(1, 0);
+
+	const char* backends[] = { "SURF", "ORB", "Phase correlation", "Log-polar phase correlation" };
+	const int backendCount = sizeof(backends) / sizeof(backends[0]);
+	std::vector<Mat> surfHomographies(gray.size());
+	QStringList lines;
+	for (int backend = 0; backend < backendCount; ++backend)
+	{
+		DrizzleRegistration registration(backends[backend], timeLimit);
+		double reprojection = 0.0;
+		double difference = 0.0;
+		unsigned int compared = 0;
+		unsigned int failed = 0;
+		int time = 0;
+		for (unsigned int i = 1; i < gray.size(); ++i)
+		{
+			Mat homography;
+			QTime timer;
+			timer.start();
+			bool registered = registration.registerFrame(gray[i], i, gray[i - 1], i - 1, true, homography);
+			time += timer.elapsed();
+			if (!registered)
+			{
+				failed++;
+				continue;
+			}
+			reprojection += registration.getReprojectionError();
+
+			//Displacement of the frame corners compared to the SURF transformation, in pixels
+			if (backend == 0)
+			{
+				surfHomographies[i] = homography;
+			}
+			else if (!surfHomographies[i].empty())
+			{
+				std::vector<Point2f> surfCorners;
+				std::vector<Point2f> backendCorners;
+				perspectiveTransform(corners, surfCorners, surfHomographies[i]);
+				perspectiveTransform(corners, backendCorners, homography);
+				for (unsigned int j = 0; j < corners.size(); ++j)
+				{
+					double x = (backendCorners[j].x - surfCorners[j].x) * gray[i].cols;
+					double y = (backendCorners[j].y - surfCorners[j].y) * gray[i].rows;
+					difference += sqrt(x * x + y * y) / corners.size();
+				}
+				compared++;
+			}
+
+			if (!report(pProgress, std::string("Benchmarking registration: ") + backends[backend], (100 * backend + (100 * i) / gray.size()) / backendCount))
+			{
+				error = "Benchmark aborted.";
+				return false;
+			}
+		}
+
+		unsigned int registered = static_cast<unsigned int>(gray.size()) - 1 - failed;
+		QString line = QString("%1: %2 fps, %3 of %4 pairs failed")
+			.arg(backends[backend])
+			.arg((gray.size() - 1) * 1000.0 / std::max(time, 1), 0, 'f', 1)
+			.arg(failed)
+			.arg(gray.size() - 1);
+
+		//Phase correlation matches no points
+		if (backend < 2)
+		{
+			line += QString(", reprojection error %1 px").arg(registered == 0 ? 0.0 : reprojection / registered, 0, 'f', 3);
+		}
+		if (backend > 0)
+		{
+			line += QString(", corners %1 px from SURF").arg(compared == 0 ? 0.0 : difference / compared, 0, 'f', 3);
+		}
+		lines << line;
+	}
+	result = lines.join("\n").toStdString();
+	report(pProgress, "Benchmark done", 100);
+	return true;
+}
@@ -0,0 +1,313 @@
+/********************************************//*
+*
+* @file: DrizzleRegistration.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleRegistration_H
+#define DrizzleRegistration_H
+
+#include "ConfigurationSettings.h"
+
+#include <string>
+#include <vector>
+
+#include <opencv2\opencv.hpp>
+#include <opencv2\nonfree\nonfree.hpp>
+
+class Progress;
+class QTime;
+
+/**
+*
+* Registration of video frames against a reference frame.
+* Feature backends: SURF features matched with a FLANN KD-tree, and binary ORB features
+* matched by Hamming distance through a multi-probe LSH index, which is faster and free of patents.
+* Phase correlation backends, for tripod or gimbal footage with little more than translation jitter:
+* the peak of the normalised cross power spectrum of the windowed frames gives the translation with
+* sub-pixel precision, and optionally the log-polar magnitude spectra give rotation and scale first.
+* The keypoints, descriptors and trained matcher index, or the spectra, of the reference frame are kept,
+* so registering a run of consecutive frames analyses every frame once.
+* Features are detected on a downsampled level of an image pyramid, and the resulting homography is refined
+* at full resolution with a few inverse compositional Lucas-Kanade iterations on the pixel intensities.
+* One instance is used by one thread.
+*/
+class DrizzleRegistration
+{
+public:
+	SETTING(RegistrationFeatures, Drizzle, std::string, "SURF")
+	SETTING(KeypointBudget, Drizzle, unsigned int, 500)
+	SETTING(MatchRatio, Drizzle, double, 0.8)
+	SETTING(RegistrationTimeLimit, Drizzle, unsigned int, 0)
+	SETTING(PyramidLevels, Drizzle, unsigned int, 0)
+	SETTING(RefinementIterations, Drizzle, unsigned int, 5)
+
+	/**
+	* Constructor for the registration, without a reference frame.
+	*
+	* @param features Backend, "SURF", "ORB", "Phase correlation" or "Log-polar phase correlation".
+	* @param timeLimit Time budget of a registration in milliseconds, 0 for no budget.
+	*/
+	DrizzleRegistration(const std::string& features, unsigned int timeLimit);
+
+	/**
+	* Determines the transformation from a frame to its reference frame.
+	* The features or spectra of the reference frame are only computed when they are not kept from an earlier call.
+	*
+	* @param frame Gray scale frame.
+	* @param index Number of the frame.
+	* @param reference Gray scale reference frame.
+	* @param referenceIndex Number of the reference frame.
+	* @param keep True to keep the features or spectra of the frame, when it is the reference of the next frame.
+	* @param homography Matrix which will hold the transformation, in coordinates relative to the frame size.
+	* @return True when successfull, false when the frames have too few features in common.
+	*/
+	bool registerFrame(const cv::Mat& frame, unsigned int index, const cv::Mat& reference, unsigned int referenceIndex, bool keep, cv::Mat& homography);
+
+	/**
+	* @param index Number of a frame.
+	* @return True when the features or spectra of the frame are kept as reference, so registering against it needs no reference image.
+	*/
+	bool hasReference(unsigned int index) const;
+
+	/**
+	* @return Number of frames whose features were detected or whose spectra were computed.
+	*/
+	unsigned int getDetections() const;
+
+	/**
+	* @return Mean distance in pixels between the matched points of the reference and the RANSAC inliers
+	* of the last registered frame, after transformation. 0 for phase correlation.
+	*/
+	double getReprojectionError() const;
+
+	/**
+	* Registers the first frames of a video with every backend, and compares the frame rates,
+	* the reprojection errors of the feature backends and the transformations with those of the SURF backend.
+	*
+	* @param filename Filename of the video.
+	* @param frames Number of frames to register.
+	* @param timeLimit Time budget of a registration in milliseconds, 0 for no budget.
+	* @param pProgress Progress of the benchmark. Can be NULL.
+	* @param report String which will hold the results, one line per backend.
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull.
+	*/
+	static bool benchmark(const std::string& filename, unsigned int frames, unsigned int timeLimit, Progress* pProgress, std::string& report, std::string& error);
+
+private:
+	enum Mode
+	{
+		MODE_SURF,
+		MODE_ORB,
+		MODE_PHASE,
+		MODE_LOG_POLAR
+	};
+
+	/**
+	* Features of one frame, with a matcher index trained on its descriptors.
+	*/
+	struct Features
+	{
+		unsigned int index;
+
+		/**
+		* Image pyramid of the frame, from full resolution down to the level the features are detected on.
+		*/
+		std::vector<cv::Mat> pyramid;
+
+		/**
+		* Keypoints in the coordinates of the coarsest level.
+		*/
+		std::vector<cv::KeyPoint> keypoints;
+		cv::Mat descriptors;
+		cv::Ptr<cv::DescriptorMatcher> pMatcher;
+
+		/**
+		* Pixels sampled for the refinement, with their intensities and steepest descent images (one row of 8 per pixel).
+		* Prepared when the frame is first used as reference.
+		*/
+		std::vector<cv::Point2f> samples;
+		std::vector<float> intensities;
+		cv::Mat steepestDescent;
+	};
+
+	/**
+	* @return Number of times a frame of the given size is halved before its features are detected.
+	*/
+	unsigned int getLevels(const cv::Size& size) const;
+
+	/**
+	* Samples the pixels with the strongest gradients of a reference frame and precomputes their steepest descent images.
+	*/
+	void prepareRefinement(Features& features) const;
+
+	/**
+	* Refines a homography with inverse compositional Lucas-Kanade iterations at full resolution.
+	* Stops after the configured number of iterations or at the time limit, and keeps the iteration with the smallest error.
+	*
+	* @param reference Features of the reference frame, with its refinement samples.
+	* @param frame Gray scale frame at full resolution.
+	* @param timer Timer started when the registration of the frame started.
+	* @param homography Transformation from the frame to the reference in pixels, refined in place.
+	*/
+	void refine(const Features& reference, const cv::Mat& frame, const QTime& timer, cv::Mat& homography) const;
+
+	/**
+	* Detects and describes the features of a frame and trains a matcher index on them.
+	* The time limit is checked after building the pyramid, after detection and after description.
+	*
+	* @return False when the frame has no features or the time limit was reached.
+	*/
+	bool detect(const cv::Mat& image, unsigned int index, const QTime& timer, Features& features);
+
+	/**
+	* Determines whether the registration of a frame has reached the time limit.
+	* The limit is only applied once a transformation is known to fall back on.
+	*
+	* @param timer Timer started when the registration of the frame started.
+	* @return True when the remaining stages have to be skipped.
+	*/
+	bool isOverTime(const QTime& timer) const;
+
+	/**
+	* Falls back on the transformation of the frame registered before when a stage stopped at the time limit.
+	*
+	* @param timer Timer started when the registration of the frame started.
+	* @param homography Matrix which will hold the transformation, in coordinates relative to the frame size.
+	* @return True when the registration fell back, false when it failed within the time limit.
+	*/
+	bool fallBack(const QTime& timer, cv::Mat& homography) const;
+
+	/**
+	* Keeps at most the keypoint budget of keypoints: the strongest responses of every cell of a grid over the frame,
+	* completed with the strongest remaining responses.
+	*/
+	void selectKeypoints(std::vector<cv::KeyPoint>& keypoints, const cv::Size& size) const;
+
+	/**
+	* Estimates the homography between matched points with adaptive RANSAC, refined on the inliers.
+	* The search ends early when the inlier ratio makes further samples unnecessary, or when the time limit is reached.
+	*
+	* @param frame Matched points of the frame.
+	* @param reference Matched points of the reference.
+	* @param timer Timer started when the registration of the frame started.
+	* @param homography Matrix which will hold the transformation in pixels.
+	* @param inliers Vector which will hold 1 for every inlier.
+	* @return False when no model was found.
+	*/
+	bool estimate(const std::vector<cv::Point2f>& frame, const std::vector<cv::Point2f>& reference, const QTime& timer, cv::Mat& homography, std::vector<unsigned char>& inliers) const;
+
+	/**
+	* Creates an empty matcher index for the descriptors of the backend.
+	*/
+	cv::Ptr<cv::DescriptorMatcher> createMatcher() const;
+
+	/**
+	* Spectra of one frame.
+	*/
+	struct Spectra
+	{
+		unsigned int index;
+
+		/**
+		* Spectrum of the windowed frame.
+		*/
+		cv::Mat translation;
+
+		/**
+		* Spectrum of the log-polar magnitude spectrum of the frame, only for log-polar phase correlation.
+		*/
+		cv::Mat rotation;
+	};
+
+	/**
+	* Registers a frame by phase correlation.
+	*/
+	bool registerPhase(const cv::Mat& frame, unsigned int index, const cv::Mat& reference, unsigned int referenceIndex, bool keep, cv::Mat& homography);
+
+	/**
+	* Creates the window and determines the transform size for frames of the given size.
+	* The window and size are reused as long as the frame size does not change.
+	*/
+	void preparePhase(const cv::Size& size);
+
+	/**
+	* Computes the spectra of a frame.
+	*/
+	void analyse(const cv::Mat& image, unsigned int index, Spectra& spectra);
+
+	/**
+	* Computes the spectrum of the windowed and padded frame.
+	*/
+	void transform(const cv::Mat& image, cv::Mat& spectrum);
+
+	/**
+	* Determines the shift between two spectra from the peak of their normalised cross power spectrum.
+	*
+	* @param referenceSpectrum Spectrum of the reference.
+	* @param spectrum Spectrum of the shifted image.
+	* @return Shift which moves the image onto the reference, refined to sub-pixel precision.
+	*/
+	static cv::Point2d correlate(const cv::Mat& referenceSpectrum, const cv::Mat& spectrum);
+
+	/**
+	* Converts a transformation in pixel coordinates to coordinates relative to the frame size,
+	* in which the frame spans the unit square: S*H*S^-1 with S = diag(1/columns, 1/rows, 1).
+	*
+	* @param size Size of the frame.
+	* @param homography Transformation in pixel coordinates, replaced by the relative transformation.
+	*/
+	static void toRelative(const cv::Size& size, cv::Mat& homography);
+
+	Mode mMode;
+
+	/**
+	* Maximum number of keypoints per frame (0 for no maximum), ratio of the match test,
+	* and time budget of a registration in milliseconds (0 for no budget).
+	* The budget is checked between the stages of a registration, a stage which has started always completes.
+	*/
+	unsigned int mBudget;
+	double mRatio;
+	unsigned int mTimeLimit;
+
+	/**
+	* Pyramid levels below the frame (0 to choose them from the frame size) and refinement iterations (0 for none).
+	*/
+	unsigned int mLevels;
+	unsigned int mIterations;
+
+	cv::Ptr<cv::FeatureDetector> mpDetector;
+	cv::Ptr<cv::DescriptorExtractor> mpExtractor;
+	Features mReference;
+	Spectra mReferenceSpectra;
+
+	/**
+	* Frame size, Hann window and transform size of the phase correlation.
+	*/
+	cv::Size mFrameSize;
+	cv::Mat mWindow;
+	cv::Size mTransformSize;
+
+	/**
+	* Columns of the log-polar image per unit of log radius.
+	*/
+	double mLogPolarScale;
+
+	bool mHasReference;
+	unsigned int mDetections;
+	double mReprojectionError;
+
+	/**
+	* Transformation of the frame registered last, in coordinates relative to the frame size.
+	*/
+	cv::Mat mLastHomography;
+};
+
+#endif
@@ -0,0 +1,163 @@
+/********************************************//*
+*
+* @file: DrizzleSpscQueue.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleSpscQueue_H
+#define DrizzleSpscQueue_H
+
+#include <Qt/qatomic.h>
+#include <Qt/qmutex.h>
+#include <Qt/qthread.h>
+#include <Qt/qwaitcondition.h>
+
+#include <vector>
+
+/**
+*
+* Bounded lock-free queue between one producer thread and one consumer thread, e.g. two stages of the video pipeline.
+* A full queue makes the producer wait (backpressure), so the stages cannot run further ahead than the queue depth.
+* The producer closes the queue after its last item.
+*/
+template<typename T>
+class DrizzleSpscQueue
+{
+public:
+	/**
+	* Constructor for an empty queue.
+	*
+	* @param capacity Maximum number of items in the queue.
+	*/
+	DrizzleSpscQueue(unsigned int capacity) :
+		mItems(capacity + 1),
+		mHead(0),
+		mTail(0),
+		mClosed(0),
+		mPeak(0)
+	{
+	}
+
+	/**
+	* Appends an item, called by the producer only.
+	*
+	* @param item Item to append.
+	* @return False when the queue is full.
+	*/
+	bool tryPush(const T& item)
+	{
+		int tail = mTail.fetchAndAddOrdered(0);
+		int next = (tail + 1) % static_cast<int>(mItems.size());
+		if (next == mHead.fetchAndAddOrdered(0))
+		{
+			return false;
+		}
+		mItems[tail] = item;
+		mTail.fetchAndStoreOrdered(next);
+
+		unsigned int depth = getDepth();
+		if (depth > static_cast<unsigned int>(int(mPeak)))
+		{
+			mPeak.fetchAndStoreOrdered(static_cast<int>(depth));
+		}
+		return true;
+	}
+
+	/**
+	* Removes the oldest item, called by the consumer only.
+	*
+	* @param item Item which will hold the oldest item.
+	* @return False when the queue is empty.
+	*/
+	bool tryPop(T& item)
+	{
+		int head = mHead.fetchAndAddOrdered(0);
+		if (head == mTail.fetchAndAddOrdered(0))
+		{
+			return false;
+		}
+		item = mItems[head];
+
+		//Release the slot, e.g. the frame buffers it refers to
+		mItems[head] = T();
+		mHead.fetchAndStoreOrdered((head + 1) % static_cast<int>(mItems.size()));
+		return true;
+	}
+
+	/**
+	* Marks that the producer will not append any more items.
+	*/
+	void close()
+	{
+		mClosed.fetchAndStoreOrdered(1);
+	}
+
+	/**
+	* @return True when the queue is closed and all its items have been removed.
+	*/
+	bool isDrained() const
+	{
+		//Closed is read first, items appended before closing are still seen
+		bool closed = mClosed.fetchAndAddOrdered(0) != 0;
+		return closed && getDepth() == 0;
+	}
+
+	/**
+	* @return Number of items in the queue.
+	*/
+	unsigned int getDepth() const
+	{
+		int size = static_cast<int>(mItems.size());
+		return static_cast<unsigned int>((mTail.fetchAndAddOrdered(0) - mHead.fetchAndAddOrdered(0) + size) % size);
+	}
+
+	/**
+	* @return Largest number of items the queue has held.
+	*/
+	unsigned int getPeakDepth() const
+	{
+		return static_cast<unsigned int>(int(mPeak));
+	}
+
+	/**
+	* @return Maximum number of items in the queue.
+	*/
+	unsigned int getCapacity() const
+	{
+		return static_cast<unsigned int>(mItems.size()) - 1;
+	}
+
+	/**
+	* Waits a little while a queue is full or empty: yields the first times, then sleeps for a millisecond.
+	*
+	* @param attempts Number of times the caller waited for the same item, incremented.
+	*/
+	static void backoff(unsigned int& attempts)
+	{
+		if (attempts++ < 64)
+		{
+			QThread::yieldCurrentThread();
+			return;
+		}
+		QMutex mutex;
+		QWaitCondition condition;
+		mutex.lock();
+		condition.wait(&mutex, 1);
+		mutex.unlock();
+	}
+
+private:
+	std::vector<T> mItems;
+	mutable QAtomicInt mHead;
+	mutable QAtomicInt mTail;
+	mutable QAtomicInt mClosed;
+	QAtomicInt mPeak;
+};
+
+#endif
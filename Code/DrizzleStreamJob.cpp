@@ -0,0 +1,695 @@
+/********************************************//*
+*
+* @file: DrizzleStreamJob.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "MessageLogResource.h"
+#include "ModelServices.h"
+#include "Progress.h"
+#include "ProgressResource.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "Service.h"
+#include "TypeConverter.h"
+#include "DrizzleFrame.h"
+#include "DrizzleJobManager.h"
+#include "DrizzleRegistration.h"
+#include "DrizzleStreamJob.h"
+#include "DrizzleVideoPipeline.h"
+
+#include <Qt/qdatastream.h>
+#include <Qt/qfile.h>
+#include <Qt/qrunnable.h>
+#include <Qt/qstring.h>
+
+#include <algorithm>
+#include <math.h>
+#include <memory>
+#include <new>
+
+namespace
+{
+	/**
+	* Identification of a checkpoint file of a streaming job ("DRZS"), followed by the format version.
+	*/
+	const quint32 STREAM_CHECKPOINT_MAGIC = 0x44525A53;
+	const quint32 STREAM_CHECKPOINT_VERSION = 3;
+
+	/**
+	* Replaces a file by a newly written temporary file.
+	*/
+	bool replaceFile(const QString& tempFile, const QString& filename)
+	{
+		QFile::remove(filename);
+		return QFile::rename(tempFile, filename);
+	}
+};
+
+/**
+* Task drizzling one band of rows of the footprint of a frame.
+*/
+class DrizzleStreamJob::BandTask : public QRunnable
+{
+public:
+	BandTask(DrizzleStreamJob* pJob, const DrizzleFrame* pFrame, const DrizzleFootprint& footprint, unsigned int firstRow, unsigned int lastRow) :
+		mpJob(pJob),
+		mpFrame(pFrame),
+		mFootprint(footprint),
+		mFirstRow(firstRow),
+		mLastRow(lastRow)
+	{
+	}
+
+	void run()
+	{
+		mpJob->drizzleBand(*mpFrame, mFootprint, mFirstRow, mLastRow);
+	}
+
+private:
+	DrizzleStreamJob* mpJob;
+	const DrizzleFrame* mpFrame;
+	DrizzleFootprint mFootprint;
+	unsigned int mFirstRow;
+	unsigned int mLastRow;
+};
+
+DrizzleStreamJob::DrizzleStreamJob(RasterElement* pResult, ProgressResource* pProgress, const DrizzleGrid& grid, DrizzleVideoPipeline* pPipeline, CvCapture* pCapture,
+	unsigned int frames, double drop, DrizzleKernel kernel) :
+	DrizzleJob(0, 0, grid.rows, grid.columns, std::max(std::max(grid.rows, grid.columns), 1u)),
+	mpResult(pResult),
+	mpProgress(pProgress),
+	mGrid(grid),
+	mpPipeline(pPipeline),
+	mpCapture(pCapture),
+	mFeatures(pPipeline->getFeatures()),
+	mTimeLimit(pPipeline->getTimeLimit()),
+	mFrames(frames),
+	mDrop(drop),
+	mKernel(kernel),
+	mpAccumulator(NULL),
+	mBandThreads(0),
+	mFramesDone(0),
+	mResumeFrame(0),
+	mSigmaClip(0.0),
+	mPass(1),
+	mCheckpointInterval(0),
+	mResume(false)
+{
+	mpPipeline->getResumePoint(mResumeFrame, mResumeCorners);
+}
+
+DrizzleStreamJob::~DrizzleStreamJob()
+{
+	//The pipeline reads the video until it has stopped
+	delete mpPipeline;
+	if (mpCapture != NULL)
+	{
+		cvReleaseCapture(&mpCapture);
+	}
+	delete mpAccumulator;
+	delete mpProgress;
+}
+
+void DrizzleStreamJob::setCheckpoint(const std::string& filename, const std::string& videoFile)
+{
+	//The statistics of the first pass are not part of the checkpoint
+	if (mSigmaClip > 0.0)
+	{
+		return;
+	}
+	mCheckpointFile = filename;
+	mVideoFile = videoFile;
+
+	//The name identifies the output when the job is resumed
+	mResultName = mpResult->getName();
+}
+
+void DrizzleStreamJob::setSigmaClip(double k, const std::string& videoFile)
+{
+	mSigmaClip = std::max(k, 0.0);
+	if (mSigmaClip > 0.0)
+	{
+		mVideoFile = videoFile;
+		mCheckpointFile.clear();
+		mPass = 0;
+	}
+}
+
+size_t DrizzleStreamJob::getMemoryEstimate() const
+{
+	//Sum, weight and count planes of the accumulator, once more for the checkpoint snapshot and the state a resumed job merges,
+	//and the frames in flight in the pipeline. Sigma clipping keeps planes of the same size for the statistics, and the corners of every frame
+	size_t planes = static_cast<size_t>(mRowCount) * mColumnCount * (2 * sizeof(double) + sizeof(unsigned int));
+	size_t copies = 1 + (mCheckpointFile.empty() ? 0 : 1) + (mResume ? 1 : 0) + (mSigmaClip > 0.0 ? 1 : 0);
+	size_t corners = (mSigmaClip > 0.0) ? static_cast<size_t>(mFrames) * 4 * sizeof(cv::Point2f) : 0;
+	return copies * planes + corners + mpPipeline->getMemoryEstimate();
+}
+
+bool DrizzleStreamJob::prepare(std::string& error)
+{
+	DrizzleAccumulator* pAccumulator = NULL;
+	try
+	{
+		pAccumulator = new DrizzleAccumulator(mGrid, 0, 0, mRowCount, mColumnCount);
+	}
+	catch (std::bad_alloc&)
+	{
+		error = "Not enough memory to drizzle the output image.";
+		return false;
+	}
+	if (mSigmaClip > 0.0)
+	{
+		try
+		{
+			size_t pixels = static_cast<size_t>(mRowCount) * mColumnCount;
+			mStatCount.assign(pixels, 0);
+			mStatMean.assign(pixels, 0.0);
+			mStatM2.assign(pixels, 0.0);
+			mFrameCorners.reserve(static_cast<size_t>(mFrames) * 4);
+		}
+		catch (std::bad_alloc&)
+		{
+			delete pAccumulator;
+			error = "Not enough memory for the statistics of sigma clipping.";
+			return false;
+		}
+	}
+
+	//Continue from the frames drizzled before the checkpoint
+	if (mResume)
+	{
+		std::auto_ptr<DrizzleAccumulator> pState(DrizzleAccumulator::load(mCheckpointFile + ".drzp", error));
+		if (pState.get() == NULL || (pState->getRows() > 0 && !pAccumulator->merge(*pState, error)))
+		{
+			delete pAccumulator;
+			return false;
+		}
+	}
+
+	//Checkpoints may be written from the GUI thread from now on
+	{
+		QMutexLocker lock(&mFrameMutex);
+		mpAccumulator = pAccumulator;
+	}
+	mCheckpointInterval = ImageDrizzleJob::getSettingCheckpointInterval();
+	mCheckpointTimer.start();
+
+	//The thread of the job drizzles one band itself, the threads of the pipeline are part of the budget
+	mBandThreads = std::max(DrizzleJobManager::instance()->getThreadBudget() - static_cast<int>(mpPipeline->getThreadCount()) - 1, 0);
+	mPool.setMaxThreadCount(std::max(mBandThreads, 1));
+	mpPipeline->start();
+	return true;
+}
+
+void DrizzleStreamJob::drizzleBand(const DrizzleFrame& frame, const DrizzleFootprint& footprint, unsigned int firstRow, unsigned int lastRow)
+{
+	bool gather = (int(mPass) == 0);
+	for (unsigned int row = firstRow; row < lastRow; ++row)
+	{
+		//Poll abort flag for every row of the band
+		if (isAborted())
+		{
+			return;
+		}
+
+		for (int col = footprint.firstColumn; col <= footprint.lastColumn; ++col)
+		{
+			double sum = 0.0;
+			double weight = 0.0;
+			bool overlapped = false;
+			ImageDrizzleJob::drizzlePixel(frame, mGrid, row, col, mDrop, mKernel, sum, weight, overlapped);
+			if (!overlapped)
+			{
+				continue;
+			}
+			if (mSigmaClip <= 0.0 || weight <= 0.0)
+			{
+				if (!gather)
+				{
+					mpAccumulator->add(row, col, sum, weight, overlapped);
+				}
+				continue;
+			}
+
+			//Running mean and variance of the contributions to the pixel (Welford), as in ImageDrizzleJob
+			size_t pixel = static_cast<size_t>(row) * mColumnCount + col;
+			double value = sum / weight;
+			if (gather)
+			{
+				mStatCount[pixel]++;
+				double delta = value - mStatMean[pixel];
+				mStatMean[pixel] += delta / mStatCount[pixel];
+				mStatM2[pixel] += delta * (value - mStatMean[pixel]);
+				continue;
+			}
+			if (mStatCount[pixel] >= 3 && mStatM2[pixel] > 0.0 &&
+				fabs(value - mStatMean[pixel]) > mSigmaClip * sqrt(mStatM2[pixel] / (mStatCount[pixel] - 1)))
+			{
+				continue;
+			}
+			mpAccumulator->add(row, col, sum, weight, overlapped);
+		}
+	}
+}
+
+bool DrizzleStreamJob::processTile(const DrizzleTile& tile, std::string& error)
+{
+	//With sigma clipping the first pass only gathers the statistics, the second pass drizzles
+	if (int(mPass) == 0)
+	{
+		if (!drizzleFrames(error))
+		{
+			return false;
+		}
+		if (!startSecondPass(error))
+		{
+			return false;
+		}
+	}
+	return drizzleFrames(error);
+}
+
+bool DrizzleStreamJob::startSecondPass(std::string& error)
+{
+	if (mFrameCorners.size() != static_cast<size_t>(mFrames) * 4)
+	{
+		error = "The corners of the frames are incomplete after the first pass.";
+		return false;
+	}
+	CvCapture* pCapture = cvCreateFileCapture(mVideoFile.c_str());
+	if (pCapture == NULL)
+	{
+		error = "Unable to open the video " + mVideoFile + " for the second pass.";
+		return false;
+	}
+
+	//The frames are placed at the corners of the first pass, so every contribution is the one the statistics hold
+	std::vector<cv::Point2f> startCorners(mFrameCorners.begin(), mFrameCorners.begin() + 4);
+	std::auto_ptr<DrizzleVideoPipeline> pPipeline(new DrizzleVideoPipeline(pCapture, mVideoFile, mFrames, 0, startCorners,
+		mFeatures, mTimeLimit));
+	pPipeline->setCorners(mFrameCorners);
+	{
+		QMutexLocker lock(&mPipelineMutex);
+		mpPipeline->stop();
+		delete mpPipeline;
+		cvReleaseCapture(&mpCapture);
+		mpPipeline = pPipeline.release();
+		mpCapture = pCapture;
+		mFramesDone = 0;
+		mPass = 1;
+	}
+	std::vector<cv::Point2f>().swap(mFrameCorners);
+	mpPipeline->start();
+	return true;
+}
+
+bool DrizzleStreamJob::drizzleFrames(std::string& error)
+{
+	bool gather = (int(mPass) == 0);
+	DrizzleVideoFrame videoFrame;
+	DrizzleFrame frame;
+	unsigned int attempts = 0;
+	while (static_cast<unsigned int>(int(mFramesDone)) < mFrames)
+	{
+		if (isAborted())
+		{
+			return false;
+		}
+		if (!mpPipeline->takeFrame(videoFrame))
+		{
+			if (mpPipeline->getError(error))
+			{
+				return false;
+			}
+			DrizzleSpscQueue<DrizzleVideoFrame>::backoff(attempts);
+			continue;
+		}
+		attempts = 0;
+
+		//A resumed pipeline starts at the last reference frame, the frames up to the checkpoint were drizzled
+		if (videoFrame.index < static_cast<unsigned int>(int(mFramesDone)))
+		{
+			continue;
+		}
+
+		//The decoded frame is released as soon as it is copied
+		try
+		{
+			DrizzleVideoPipeline::copyFrame(videoFrame, frame);
+			if (gather)
+			{
+				mFrameCorners.insert(mFrameCorners.end(), videoFrame.corners.begin(), videoFrame.corners.end());
+			}
+		}
+		catch (std::bad_alloc&)
+		{
+			error = "Not enough memory to drizzle frame " + QString::number(videoFrame.index).toStdString() + ".";
+			return false;
+		}
+		videoFrame = DrizzleVideoFrame();
+
+		//Checkpoints see either all or none of the frame
+		QMutexLocker frameLock(&mFrameMutex);
+
+		//Only the rows and columns of the output grid the frame covers are drizzled, degenerate frames cover none
+		DrizzleFootprint footprint;
+		if (ImageDrizzleJob::getFootprint(frame.grid, mGrid, footprint))
+		{
+			footprint.firstRow = std::max(footprint.firstRow, 0);
+			footprint.lastRow = std::min(footprint.lastRow, static_cast<int>(mGrid.rows) - 1);
+			footprint.firstColumn = std::max(footprint.firstColumn, 0);
+			footprint.lastColumn = std::min(footprint.lastColumn, static_cast<int>(mGrid.columns) - 1);
+			if (footprint.firstRow <= footprint.lastRow && footprint.firstColumn <= footprint.lastColumn)
+			{
+				//Bands hold different rows, so they add to the accumulator without locking
+				unsigned int rows = static_cast<unsigned int>(footprint.lastRow - footprint.firstRow + 1);
+				unsigned int bands = std::min(static_cast<unsigned int>(mBandThreads) + 1, rows);
+				for (unsigned int i = 0; i < bands; ++i)
+				{
+					unsigned int firstRow = footprint.firstRow + static_cast<unsigned int>((static_cast<unsigned long long>(i) * rows) / bands);
+					unsigned int lastRow = footprint.firstRow + static_cast<unsigned int>((static_cast<unsigned long long>(i + 1) * rows) / bands);
+					if (i + 1 < bands)
+					{
+						mPool.start(new BandTask(this, &frame, footprint, firstRow, lastRow));
+					}
+					else
+					{
+						drizzleBand(frame, footprint, firstRow, lastRow);
+					}
+				}
+				mPool.waitForDone();
+			}
+		}
+
+		//A partly drizzled frame is not counted, checkpoints keep the state before it
+		if (isAborted())
+		{
+			return false;
+		}
+		mFramesDone.fetchAndAddOrdered(1);
+		mpPipeline->getResumePoint(mResumeFrame, mResumeCorners);
+		frameLock.unlock();
+
+		//Write a checkpoint now and then
+		bool due = !gather && !mCheckpointFile.empty() && mCheckpointInterval > 0 && static_cast<unsigned int>(mCheckpointTimer.elapsed()) >= mCheckpointInterval * 1000;
+		if (due && mCheckpointMutex.tryLock())
+		{
+			//A failed checkpoint does not stop the drizzle, the previous one is kept
+			std::string checkpointError;
+			writeCheckpoint(checkpointError);
+			mCheckpointTimer.restart();
+			mCheckpointMutex.unlock();
+		}
+	}
+	return !isAborted();
+}
+
+bool DrizzleStreamJob::finish(std::string& error)
+{
+	mpPipeline->stop();
+
+	//Divide output pixels by the sum of the weights of the frame pixels drizzled onto them
+	return mpAccumulator->normalise(mpResult, error);
+}
+
+bool DrizzleStreamJob::updateProgress(const std::string& message, int percent)
+{
+	if (mpProgress == NULL)
+	{
+		return true;
+	}
+
+	//The job has a single tile, progress is counted in frames, over both passes with sigma clipping
+	std::string statistics;
+	unsigned int done = 0;
+	int pass = 1;
+	{
+		QMutexLocker lock(&mPipelineMutex);
+		statistics = mpPipeline->getStatistics();
+		done = static_cast<unsigned int>(int(mFramesDone));
+		pass = int(mPass);
+	}
+	unsigned long long total = static_cast<unsigned long long>(mFrames) * (mSigmaClip > 0.0 ? 2 : 1);
+	unsigned long long passed = (mSigmaClip > 0.0 && pass == 1) ? mFrames : 0;
+	int framesPercent = (total == 0) ? 100 : static_cast<int>(((passed + done) * 100) / total);
+	std::string stage = (pass == 0) ? "Gathering statistics: " : "Drizzling frames: ";
+	(*mpProgress)->updateProgress(stage + statistics, framesPercent, NORMAL);
+
+	//Abort the job when the user cancelled the progress
+	return !isProgressAborted(mpProgress);
+}
+
+void DrizzleStreamJob::complete(bool success, const std::string& error)
+{
+	StepResource pStep("Drizzle output", "app", "0C0B86C4-3DA4-4B0C-9C61-52D0B1A6E8C5");
+	Progress* pProgress = (mpProgress == NULL) ? NULL : mpProgress->get();
+	std::string msg = error;
+	mpPipeline->stop();
+	pStep->addProperty("Pipeline", mpPipeline->getStatistics());
+
+	//Checkpoint is no longer needed once the result is complete
+	if (success && !mCheckpointFile.empty())
+	{
+		QMutexLocker lock(&mCheckpointMutex);
+		QFile::remove(QString::fromStdString(mCheckpointFile));
+		QFile::remove(QString::fromStdString(mCheckpointFile + ".drzp"));
+	}
+
+	//Create view
+	success = success && createView(mpResult, NULL, msg) != NULL;
+
+	if (!success)
+	{
+		Service<ModelServices>()->destroyElement(mpResult);
+		pStep->finalize(Message::Failure, msg);
+		if (pProgress != NULL)
+		{
+			pProgress->updateProgress(msg, 0, ERRORS);
+		}
+	}
+	else
+	{
+		pStep->finalize();
+		if (pProgress != NULL)
+		{
+			pProgress->updateProgress("Done", 100, NORMAL);
+		}
+	}
+	mpResult = NULL;
+}
+
+bool DrizzleStreamJob::checkpoint(std::string& filename, std::string& error)
+{
+	if (mCheckpointFile.empty())
+	{
+		return false;
+	}
+
+	QMutexLocker lock(&mCheckpointMutex);
+	filename = mCheckpointFile;
+	return writeCheckpoint(error);
+}
+
+bool DrizzleStreamJob::writeCheckpoint(std::string& error)
+{
+	//The checkpoint a queued job resumes from is still valid
+	std::auto_ptr<DrizzleAccumulator> pSnapshot;
+	unsigned int framesDone = 0;
+	unsigned int resumeFrame = 0;
+	std::vector<cv::Point2f> resumeCorners;
+	{
+		QMutexLocker lock(&mFrameMutex);
+		if (mpAccumulator == NULL && mResume)
+		{
+			return true;
+		}
+
+		//Snapshot between two frames, the accumulator is only locked while it is copied
+		try
+		{
+			pSnapshot.reset(mpAccumulator == NULL ? new DrizzleAccumulator(mGrid, 0, 0, 0, 0) : new DrizzleAccumulator(*mpAccumulator));
+		}
+		catch (std::bad_alloc&)
+		{
+			error = "Not enough memory to write the checkpoint.";
+			return false;
+		}
+		framesDone = static_cast<unsigned int>(int(mFramesDone));
+		resumeFrame = mResumeFrame;
+		resumeCorners = mResumeCorners;
+	}
+
+	std::string stateFile = mCheckpointFile + ".drzp";
+	if (!pSnapshot->save(stateFile + ".tmp", error))
+	{
+		return false;
+	}
+
+	QString tempFile = QString::fromStdString(mCheckpointFile + ".tmp");
+	QFile file(tempFile);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		error = "Unable to open " + mCheckpointFile + " for writing.";
+		return false;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_6);
+	stream << STREAM_CHECKPOINT_MAGIC << STREAM_CHECKPOINT_VERSION << QString::fromStdString(mResultName) << QString::fromStdString(mVideoFile)
+		<< quint32(mFrames) << mDrop << qint32(mKernel) << quint32(framesDone) << quint32(resumeFrame) << quint32(resumeCorners.size());
+	for (unsigned int i = 0; i < resumeCorners.size(); ++i)
+	{
+		stream << double(resumeCorners[i].x) << double(resumeCorners[i].y);
+	}
+
+	//Version 2: the registration backend the pipeline was started with, version 3: its time budget,
+	//so a resumed job registers the same way
+	stream << QString::fromStdString(mFeatures) << quint32(mTimeLimit);
+	file.close();
+	if (stream.status() != QDataStream::Ok || file.error() != QFile::NoError)
+	{
+		error = "Unable to write " + mCheckpointFile + ".";
+		return false;
+	}
+
+	//Replace the previous checkpoint only when the new one is complete
+	if (!replaceFile(QString::fromStdString(stateFile + ".tmp"), QString::fromStdString(stateFile)) ||
+		!replaceFile(tempFile, QString::fromStdString(mCheckpointFile)))
+	{
+		error = "Unable to replace " + mCheckpointFile + ".";
+		return false;
+	}
+	return true;
+}
+
+bool DrizzleStreamJob::isCheckpoint(const std::string& filename)
+{
+	QFile file(QString::fromStdString(filename));
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_6);
+	quint32 magic = 0;
+	stream >> magic;
+	return magic == STREAM_CHECKPOINT_MAGIC;
+}
+
+DrizzleStreamJob* DrizzleStreamJob::resume(const std::string& filename, std::string& name, std::string& error)
+{
+	QFile file(QString::fromStdString(filename));
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		error = "Unable to open " + filename + ".";
+		return NULL;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_6);
+	quint32 magic = 0;
+	quint32 version = 0;
+	stream >> magic >> version;
+	if (magic != STREAM_CHECKPOINT_MAGIC || version < 1 || version > STREAM_CHECKPOINT_VERSION)
+	{
+		error = filename + " is not a Drizzle video checkpoint.";
+		return NULL;
+	}
+
+	QString resultName;
+	QString videoFile;
+	quint32 frames = 0;
+	double drop = 0.0;
+	qint32 kernel = 0;
+	quint32 framesDone = 0;
+	quint32 resumeFrame = 0;
+	quint32 cornerCount = 0;
+	stream >> resultName >> videoFile >> frames >> drop >> kernel >> framesDone >> resumeFrame >> cornerCount;
+	std::vector<cv::Point2f> corners;
+	for (quint32 i = 0; i < cornerCount && stream.status() == QDataStream::Ok; ++i)
+	{
+		double x = 0.0;
+		double y = 0.0;
+		stream >> x >> y;
+		corners.push_back(cv::Point2f(static_cast<float>(x), static_cast<float>(y)));
+	}
+
+	//Older checkpoints were registered with the settings of that time
+	QString features = QString::fromStdString(DrizzleRegistration::getSettingRegistrationFeatures());
+	quint32 timeLimit = DrizzleRegistration::getSettingRegistrationTimeLimit();
+	if (version >= 2)
+	{
+		stream >> features;
+	}
+	if (version >= 3)
+	{
+		stream >> timeLimit;
+	}
+	if (stream.status() != QDataStream::Ok)
+	{
+		error = filename + " is truncated.";
+		return NULL;
+	}
+	if (cornerCount != 4 || resumeFrame > framesDone || framesDone > frames)
+	{
+		error = filename + " does not hold a valid position in the video.";
+		return NULL;
+	}
+
+	//The output grid is stored with the accumulation state
+	std::auto_ptr<DrizzleAccumulator> pState(DrizzleAccumulator::load(filename + ".drzp", error));
+	if (pState.get() == NULL)
+	{
+		return NULL;
+	}
+	const DrizzleGrid& grid = pState->getGrid();
+
+	CvCapture* pCapture = cvCreateFileCapture(videoFile.toStdString().c_str());
+	if (pCapture == NULL)
+	{
+		error = "Unable to open the video " + videoFile.toStdString() + " of the checkpoint.";
+		return NULL;
+	}
+
+	//Continue on the output of the interrupted run when it is still loaded
+	Service<ModelServices> pModel;
+	RasterElement* pResult = dynamic_cast<RasterElement*>(pModel->getElement(resultName.toStdString(), TypeConverter::toString<RasterElement>(), NULL));
+	if (pResult != NULL)
+	{
+		const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(pResult->getDataDescriptor());
+		if (pDesc->getRowCount() != grid.rows || pDesc->getColumnCount() != grid.columns)
+		{
+			cvReleaseCapture(&pCapture);
+			error = "The output image " + resultName.toStdString() + " does not match the checkpoint.";
+			return NULL;
+		}
+	}
+	else
+	{
+		pResult = grid.createElement(resultName.toStdString(), NULL, NULL, error);
+		if (pResult == NULL)
+		{
+			cvReleaseCapture(&pCapture);
+			return NULL;
+		}
+	}
+
+	//The pipeline starts at the last reference frame drizzled, the frames after it are registered again
+	DrizzleVideoPipeline* pPipeline = new DrizzleVideoPipeline(pCapture, videoFile.toStdString(), frames, resumeFrame, corners,
+		features.toStdString(), timeLimit);
+	DrizzleStreamJob* pJob = new DrizzleStreamJob(pResult, new ProgressResource("ProgressBar"), grid, pPipeline, pCapture,
+		frames, drop, static_cast<DrizzleKernel>(kernel));
+	pJob->setCheckpoint(filename, videoFile.toStdString());
+	pJob->mResume = true;
+	pJob->mFramesDone = static_cast<int>(framesDone);
+
+	name = resultName.toStdString() + " (resumed)";
+	return pJob;
+}
@@ -0,0 +1,203 @@
+/********************************************//*
+*
+* @file: DrizzleStreamJob.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleStreamJob_H
+#define DrizzleStreamJob_H
+
+#include "DrizzleAccumulator.h"
+#include "DrizzleImageJob.h"
+#include "DrizzleJob.h"
+
+#include <Qt/qatomic.h>
+#include <Qt/qdatetime.h>
+#include <Qt/qmutex.h>
+#include <Qt/qthreadpool.h>
+
+#include <string>
+#include <vector>
+
+#include <opencv2\opencv.hpp>
+
+class DrizzleVideoPipeline;
+class ProgressResource;
+class RasterElement;
+struct DrizzleFrame;
+
+/**
+*
+* DrizzleJob which drizzles the frames of a video onto the output grid as they come out of the
+* DrizzleVideoPipeline, and discards every frame once it is drizzled. Memory use is bounded by the
+* accumulator and the frames in the queues of the pipeline, whatever the length of the video.
+* The job has a single tile: the frames are taken in order, and the footprint of every frame is split
+* into bands of rows which are drizzled in parallel. A checkpoint holds the accumulator, the number of frames
+* drizzled, the last reference frame with its corners, from which the pipeline is started again on resume, and the
+* registration backend and time budget the pipeline was created with.
+* With sigma clipping the video is streamed twice, and only the running mean and variance of every output pixel
+* are kept between the passes.
+*/
+class DrizzleStreamJob : public DrizzleJob
+{
+public:
+	/**
+	* Constructor for the streaming job.
+	*
+	* @param pResult Georeferenced output RasterElement, the job takes ownership until it completes.
+	* @param pProgress Progress of the job, the job takes ownership. Can be NULL.
+	* @param grid Output grid.
+	* @param pPipeline Pipeline producing the registered frames, not started yet. The job takes ownership.
+	* @param pCapture Video read by the pipeline, the job takes ownership.
+	* @param frames Number of frames to drizzle.
+	* @param drop Dropsize (from 0 to 1).
+	* @param kernel Kernel variant.
+	*/
+	DrizzleStreamJob(RasterElement* pResult, ProgressResource* pProgress, const DrizzleGrid& grid, DrizzleVideoPipeline* pPipeline, CvCapture* pCapture,
+		unsigned int frames, double drop, DrizzleKernel kernel);
+
+	/**
+	* Destructor for the streaming job, stops the pipeline.
+	*/
+	~DrizzleStreamJob();
+
+	/**
+	* Lets the job write a checkpoint every CheckpointInterval seconds, from which it can be resumed.
+	* The checkpoint is removed when the job has succeeded.
+	*
+	* @param filename Path of the checkpoint, the accumulation state is written next to it.
+	* @param videoFile Filename of the video, opened again when the job is resumed.
+	*/
+	void setCheckpoint(const std::string& filename, const std::string& videoFile);
+
+	/**
+	* Rejects contributions further than k standard deviations from the mean of their output pixel.
+	* The first pass over the video gathers the mean and variance of the contributions to every output pixel (Welford)
+	* and the corners of every frame, the second pass decodes the video again, places the frames at the same corners
+	* and drizzles the contributions within the limit. A job which clips does not write checkpoints.
+	*
+	* @param k Number of standard deviations, 0 disables clipping.
+	* @param videoFile Filename of the video, opened again for the second pass.
+	*/
+	void setSigmaClip(double k, const std::string& videoFile);
+
+	/**
+	* Determines whether a checkpoint was written by a streaming job rather than by an ImageDrizzleJob.
+	*
+	* @param filename Path of the checkpoint.
+	* @return True when the checkpoint belongs to a streaming job.
+	*/
+	static bool isCheckpoint(const std::string& filename);
+
+	/**
+	* Creates a job which continues from a checkpoint. The video is decoded again from the last
+	* reference frame which was drizzled, the frames before it are skipped.
+	*
+	* @param filename Path of the checkpoint.
+	* @param name String which will hold the name of the job.
+	* @param error String which will hold the error message on failure.
+	* @return New job, NULL on failure.
+	*/
+	static DrizzleStreamJob* resume(const std::string& filename, std::string& name, std::string& error);
+
+	size_t getMemoryEstimate() const;
+	bool prepare(std::string& error);
+	bool processTile(const DrizzleTile& tile, std::string& error);
+	bool finish(std::string& error);
+	bool updateProgress(const std::string& message, int percent);
+	void complete(bool success, const std::string& error);
+	bool checkpoint(std::string& filename, std::string& error);
+
+private:
+	class BandTask;
+	friend class BandTask;
+
+	/**
+	* Drizzles the rows of a frame's footprint from firstRow up to lastRow (exclusive).
+	*/
+	void drizzleBand(const DrizzleFrame& frame, const DrizzleFootprint& footprint, unsigned int firstRow, unsigned int lastRow);
+
+	/**
+	* Drizzles the frames of the pipeline until all frames are done, or gathers their statistics in the first pass of sigma clipping.
+	*/
+	bool drizzleFrames(std::string& error);
+
+	/**
+	* Replaces the pipeline of the first pass by one decoding the video again at the corners of the first pass.
+	*/
+	bool startSecondPass(std::string& error);
+
+	/**
+	* Writes the checkpoint, serialised by mCheckpointMutex.
+	*/
+	bool writeCheckpoint(std::string& error);
+
+	RasterElement* mpResult;
+	ProgressResource* mpProgress;
+	DrizzleGrid mGrid;
+	DrizzleVideoPipeline* mpPipeline;
+	CvCapture* mpCapture;
+
+	/**
+	* Mutex protecting mpPipeline while it is replaced for the second pass, read by updateProgress() on the GUI thread.
+	*/
+	QMutex mPipelineMutex;
+
+	/**
+	* Registration backend and time budget the pipeline was created with, kept for the second pass and the checkpoint.
+	*/
+	std::string mFeatures;
+	unsigned int mTimeLimit;
+
+	unsigned int mFrames;
+	double mDrop;
+	DrizzleKernel mKernel;
+	DrizzleAccumulator* mpAccumulator;
+
+	/**
+	* Threads drizzling the bands of a frame besides the thread of the job, the rest of the thread budget is left to the pipeline.
+	*/
+	QThreadPool mPool;
+	int mBandThreads;
+
+	/**
+	* Number of frames drizzled so far, all frames before it in the video are drizzled.
+	*/
+	QAtomicInt mFramesDone;
+
+	/**
+	* Last reference frame taken and its corners, from which the pipeline continues on resume.
+	* Protected by mFrameMutex together with the accumulator, which is held while a frame is drizzled.
+	*/
+	unsigned int mResumeFrame;
+	std::vector<cv::Point2f> mResumeCorners;
+	QMutex mFrameMutex;
+
+	/**
+	* Sigma clipping: number of standard deviations, current pass (0 gathers the statistics, 1 drizzles),
+	* the corners of every frame from the first pass, and the number, mean and sum of squared deviations
+	* of the contributions to every output pixel.
+	*/
+	double mSigmaClip;
+	QAtomicInt mPass;
+	std::vector<cv::Point2f> mFrameCorners;
+	std::vector<unsigned int> mStatCount;
+	std::vector<double> mStatMean;
+	std::vector<double> mStatM2;
+
+	std::string mCheckpointFile;
+	std::string mVideoFile;
+	std::string mResultName;
+	unsigned int mCheckpointInterval;
+	QTime mCheckpointTimer;
+	QMutex mCheckpointMutex;
+	bool mResume;
+};
+
+#endif
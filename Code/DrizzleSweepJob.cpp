@@ -0,0 +1,234 @@
+/********************************************//*
+*
+* @file: DrizzleSweepJob.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "MessageLogResource.h"
+#include "Progress.h"
+#include "ProgressResource.h"
+#include "DrizzleImageJob.h"
+#include "DrizzleSweepJob.h"
+
+#include <Qt/qdatetime.h>
+#include <Qt/qstring.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	/**
+	* Orders the tiles of the parts by band of relative rows, then by relative column.
+	*/
+	struct TileOrder
+	{
+		double band;
+		double column;
+		unsigned int part;
+		unsigned int index;
+
+		bool operator<(const TileOrder& other) const
+		{
+			if (band != other.band)
+			{
+				return band < other.band;
+			}
+			if (column != other.column)
+			{
+				return column < other.column;
+			}
+			return part < other.part;
+		}
+	};
+};
+
+DrizzleSweepJob::DrizzleSweepJob(const std::vector<ImageDrizzleJob*>& parts, const std::vector<std::string>& labels, ProgressResource* pProgress) :
+	DrizzleJob(0, 0, 0, 0, 1),
+	mParts(parts),
+	mLabels(labels),
+	mpProgress(pProgress),
+	mPartTimes(parts.size(), QAtomicInt(0)),
+	mPrepareTime(0),
+	mFinishTime(0)
+{
+	//Bands as high as the tiles of the part with the most tile rows
+	unsigned int bands = 1;
+	for (unsigned int part = 0; part < mParts.size(); ++part)
+	{
+		unsigned int count = mParts[part]->getTileCount();
+		if (count > 0)
+		{
+			DrizzleTile last = mParts[part]->getTile(count - 1);
+			DrizzleTile first = mParts[part]->getTile(0);
+			bands = std::max(bands, (last.startRow - first.startRow) / std::max(first.rows, 1u) + 1);
+		}
+	}
+
+	std::vector<TileOrder> order;
+	for (unsigned int part = 0; part < mParts.size(); ++part)
+	{
+		unsigned int count = mParts[part]->getTileCount();
+		if (count == 0)
+		{
+			continue;
+		}
+		DrizzleTile first = mParts[part]->getTile(0);
+		DrizzleTile last = mParts[part]->getTile(count - 1);
+		double rows = double(last.startRow + last.rows - first.startRow);
+		double columns = double(last.startColumn + last.columns - first.startColumn);
+		for (unsigned int index = 0; index < count; ++index)
+		{
+			DrizzleTile tile = mParts[part]->getTile(index);
+			TileOrder entry;
+			entry.band = std::floor(((tile.startRow - first.startRow + tile.rows / 2.0) / rows) * bands);
+			entry.column = (tile.startColumn - first.startColumn + tile.columns / 2.0) / columns;
+			entry.part = part;
+			entry.index = index;
+			order.push_back(entry);
+		}
+	}
+	std::stable_sort(order.begin(), order.end());
+	for (std::vector<TileOrder>::iterator it = order.begin(); it != order.end(); ++it)
+	{
+		mTiles.push_back(std::make_pair(it->part, it->index));
+	}
+}
+
+DrizzleSweepJob::~DrizzleSweepJob()
+{
+	for (std::vector<ImageDrizzleJob*>::iterator it = mParts.begin(); it != mParts.end(); ++it)
+	{
+		delete *it;
+	}
+	delete mpProgress;
+}
+
+unsigned int DrizzleSweepJob::getTileCount() const
+{
+	return static_cast<unsigned int>(mTiles.size());
+}
+
+DrizzleTile DrizzleSweepJob::getTile(unsigned int index) const
+{
+	DrizzleTile tile = mParts[mTiles[index].first]->getTile(mTiles[index].second);
+	tile.part = mTiles[index].first;
+	return tile;
+}
+
+void DrizzleSweepJob::setAbortFlag(const QAtomicInt* pAbortFlag)
+{
+	DrizzleJob::setAbortFlag(pAbortFlag);
+	for (std::vector<ImageDrizzleJob*>::iterator it = mParts.begin(); it != mParts.end(); ++it)
+	{
+		(*it)->setAbortFlag(pAbortFlag);
+	}
+}
+
+size_t DrizzleSweepJob::getMemoryEstimate() const
+{
+	size_t memory = 0;
+	for (std::vector<ImageDrizzleJob*>::const_iterator it = mParts.begin(); it != mParts.end(); ++it)
+	{
+		memory += (*it)->getMemoryEstimate();
+	}
+	return memory;
+}
+
+bool DrizzleSweepJob::prepare(std::string& error)
+{
+	//The georeference of the inputs is sampled by the first part and cached for the others
+	QTime timer;
+	timer.start();
+	for (std::vector<ImageDrizzleJob*>::iterator it = mParts.begin(); it != mParts.end(); ++it)
+	{
+		if (!(*it)->prepare(error))
+		{
+			return false;
+		}
+	}
+	mPrepareTime = timer.elapsed();
+	return true;
+}
+
+bool DrizzleSweepJob::processTile(const DrizzleTile& tile, std::string& error)
+{
+	QTime timer;
+	timer.start();
+	bool success = mParts[tile.part]->processTile(tile, error);
+	mPartTimes[tile.part].fetchAndAddOrdered(timer.elapsed());
+	return success;
+}
+
+bool DrizzleSweepJob::finish(std::string& error)
+{
+	QTime timer;
+	timer.start();
+	for (std::vector<ImageDrizzleJob*>::iterator it = mParts.begin(); it != mParts.end(); ++it)
+	{
+		if (!(*it)->finish(error))
+		{
+			return false;
+		}
+	}
+	mFinishTime = timer.elapsed();
+	return true;
+}
+
+bool DrizzleSweepJob::updateProgress(const std::string& message, int percent)
+{
+	if (mpProgress == NULL)
+	{
+		return true;
+	}
+
+	(*mpProgress)->updateProgress(message, percent, NORMAL);
+
+	//Abort the sweep when the user cancelled the progress
+	return !isProgressAborted(mpProgress);
+}
+
+void DrizzleSweepJob::complete(bool success, const std::string& error)
+{
+	StepResource pStep("Drizzle sweep", "app", "6A1D4C2B-9E37-4F85-B0A6-3C8E5F2D7B19");
+
+	//Every part creates the view of its result, or removes it
+	for (std::vector<ImageDrizzleJob*>::iterator it = mParts.begin(); it != mParts.end(); ++it)
+	{
+		(*it)->complete(success, error);
+	}
+
+	//Timing summary, the tiles of a part are summed over all threads
+	QString summary = "Sweep of " + QString::number(mParts.size()) + " parameter sets: prepared in " +
+		QString::number(mPrepareTime / 1000.0, 'f', 1) + " s, written in " + QString::number(mFinishTime / 1000.0, 'f', 1) + " s";
+	for (unsigned int part = 0; part < mParts.size(); ++part)
+	{
+		double seconds = int(mPartTimes[part]) / 1000.0;
+		pStep->addProperty(mLabels[part], seconds);
+		summary += "; " + QString::fromStdString(mLabels[part]) + ": " + QString::number(seconds, 'f', 1) + " s";
+	}
+	pStep->addProperty("Summary", summary.toStdString());
+
+	if (success)
+	{
+		pStep->finalize();
+		if (mpProgress != NULL)
+		{
+			(*mpProgress)->updateProgress(summary.toStdString(), 100, NORMAL);
+		}
+	}
+	else
+	{
+		pStep->finalize(Message::Failure, error);
+		if (mpProgress != NULL)
+		{
+			(*mpProgress)->updateProgress(error, 0, ERRORS);
+		}
+	}
+}
@@ -0,0 +1,84 @@
+/********************************************//*
+*
+* @file: DrizzleSweepJob.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleSweepJob_H
+#define DrizzleSweepJob_H
+
+#include "DrizzleJob.h"
+
+#include <Qt/qatomic.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class ImageDrizzleJob;
+class ProgressResource;
+
+/**
+*
+* Composite DrizzleJob drizzling the same input images with several parameter sets
+* (dropsize and output size) in one pass. The tiles of all parts are interleaved by
+* their relative position in the output image, so the parts read the same region of
+* the inputs at the same time, and the georeference of the inputs is sampled once.
+* A timing summary of the parts is reported when the sweep has completed.
+*/
+class DrizzleSweepJob : public DrizzleJob
+{
+public:
+	/**
+	* Constructor for the sweep.
+	*
+	* @param parts Jobs drizzling one parameter set each, the sweep takes ownership.
+	* @param labels Description of the parameter set of every part.
+	* @param pProgress Progress of the sweep, the sweep takes ownership. Can be NULL.
+	*/
+	DrizzleSweepJob(const std::vector<ImageDrizzleJob*>& parts, const std::vector<std::string>& labels, ProgressResource* pProgress);
+
+	/**
+	* Destructor for the sweep.
+	*/
+	~DrizzleSweepJob();
+
+	unsigned int getTileCount() const;
+	DrizzleTile getTile(unsigned int index) const;
+	void setAbortFlag(const QAtomicInt* pAbortFlag);
+	size_t getMemoryEstimate() const;
+	bool prepare(std::string& error);
+	bool processTile(const DrizzleTile& tile, std::string& error);
+	bool finish(std::string& error);
+	bool updateProgress(const std::string& message, int percent);
+	void complete(bool success, const std::string& error);
+
+private:
+	std::vector<ImageDrizzleJob*> mParts;
+	std::vector<std::string> mLabels;
+	ProgressResource* mpProgress;
+
+	/**
+	* Part and index within that part of every tile, in processing order.
+	*/
+	std::vector<std::pair<unsigned int, unsigned int> > mTiles;
+
+	/**
+	* Time spent in the tiles of every part, in milliseconds.
+	*/
+	std::vector<QAtomicInt> mPartTimes;
+
+	/**
+	* Time spent preparing and finishing the sweep, in milliseconds.
+	*/
+	int mPrepareTime;
+	int mFinishTime;
+};
+
+#endif
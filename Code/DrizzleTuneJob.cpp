@@ -0,0 +1,357 @@
+/********************************************//*
+*
+* @file: DrizzleTuneJob.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "GcpList.h"
+#include "MessageLogResource.h"
+#include "ModelServices.h"
+#include "ObjectResource.h"
+#include "Progress.h"
+#include "ProgressResource.h"
+#include "RasterElement.h"
+#include "Service.h"
+#include "DrizzleImageJob.h"
+#include "DrizzleJobManager.h"
+#include "DrizzleTuneJob.h"
+
+#include <Qt/qdatetime.h>
+#include <Qt/qrunnable.h>
+#include <Qt/qstring.h>
+#include <Qt/qthread.h>
+#include <Qt/qthreadpool.h>
+
+#include <algorithm>
+#include <math.h>
+#include <memory>
+
+namespace
+{
+	/**
+	* Largest tile size which is timed.
+	*/
+	const unsigned int MAX_TILE_SIZE = 128;
+
+	/**
+	* Task drizzling tiles of a calibration drizzle until none are left.
+	*/
+	class TuneTask : public QRunnable
+	{
+	public:
+		TuneTask(DrizzleJob* pJob, QAtomicInt* pNextTile, QAtomicInt* pFailed) :
+			mpJob(pJob),
+			mpNextTile(pNextTile),
+			mpFailed(pFailed)
+		{
+		}
+
+		void run()
+		{
+			std::string error;
+			while (int(*mpFailed) == 0)
+			{
+				unsigned int index = static_cast<unsigned int>(mpNextTile->fetchAndAddOrdered(1));
+				if (index >= mpJob->getTileCount())
+				{
+					break;
+				}
+				if (!mpJob->processTile(mpJob->getTile(index), error))
+				{
+					mpFailed->fetchAndStoreOrdered(1);
+				}
+			}
+		}
+
+	private:
+		DrizzleJob* mpJob;
+		QAtomicInt* mpNextTile;
+		QAtomicInt* mpFailed;
+	};
+
+	/**
+	* Creates the grid of a synthetic north-up image covering the unit square.
+	*
+	* @param size Width and height of the image.
+	* @param shift Shift of the image in pixels.
+	*/
+	DrizzleGrid syntheticGrid(unsigned int size, double shift)
+	{
+		double offset = shift / size;
+
+		DrizzleGrid grid;
+		grid.rows = size;
+		grid.columns = size;
+		grid.dataType = FLT4BYTES;
+		grid.topLeft = LocationType(offset, offset);
+		grid.bottomLeft = LocationType(offset, 1.0 + offset);
+		grid.bottomRight = LocationType(1.0 + offset, 1.0 + offset);
+		grid.topRight = LocationType(1.0 + offset, offset);
+		grid.georeferencePlugIn = "GCP Georeference";
+
+		const LocationType* pCorners[] = { &grid.topLeft, &grid.bottomLeft, &grid.bottomRight, &grid.topRight };
+		const LocationType pixels[] = { LocationType(0, 0), LocationType(0, size), LocationType(size, size), LocationType(size, 0) };
+		for (int i = 0; i < 4; ++i)
+		{
+			GcpPoint point;
+			point.mPixel = pixels[i];
+			point.mCoordinate = *pCorners[i];
+			grid.gcps.push_back(point);
+		}
+		return grid;
+	}
+};
+
+DrizzleTuneJob::DrizzleTuneJob(ProgressResource* pProgress) :
+	DrizzleJob(0, 0, 1, 1, 1),
+	mpProgress(pProgress),
+	mpResult(NULL),
+	mpAbort(NULL),
+	mPercent(0)
+{
+	mBest.tileSize = 32;
+	mBest.threads = static_cast<unsigned int>(std::max(QThread::idealThreadCount(), 1));
+	mBest.kernel = KERNEL_CLIP;
+}
+
+DrizzleTuneJob::~DrizzleTuneJob()
+{
+	Service<ModelServices> pModel;
+	for (std::vector<RasterElement*>::iterator it = mInputs.begin(); it != mInputs.end(); ++it)
+	{
+		//The address may be reused, so the georeference may no longer be cached
+		DrizzleJobManager::instance()->clearInputGrid(*it);
+		pModel->destroyElement(*it);
+	}
+	if (mpResult != NULL)
+	{
+		pModel->destroyElement(mpResult);
+	}
+	delete mpProgress;
+}
+
+DrizzleTuneJob* DrizzleTuneJob::create(ProgressResource* pProgress, std::string& error)
+{
+	std::auto_ptr<DrizzleTuneJob> pJob(new DrizzleTuneJob(pProgress));
+
+	//Synthetic workload: two shifted north-up inputs drizzled onto a finer output grid,
+	//at least two of the largest tiles per thread so the thread counts are not limited by the tiles
+	unsigned int tiles = std::max(static_cast<unsigned int>(ceil(sqrt(2.0 * pJob->mBest.threads))), 4u);
+	pJob->mGrid = syntheticGrid(tiles * MAX_TILE_SIZE, 0.0);
+	pJob->mpResult = pJob->mGrid.createElement("Drizzle calibration", NULL, NULL, error);
+	if (pJob->mpResult == NULL)
+	{
+		return NULL;
+	}
+
+	for (int i = 0; i < 2; ++i)
+	{
+		DrizzleGrid inputGrid = syntheticGrid((pJob->mGrid.rows * 3) / 4, i / 3.0);
+		RasterElement* pInput = inputGrid.createElement("Drizzle calibration input " + QString::number(i).toStdString(), NULL, NULL, error);
+		if (pInput == NULL)
+		{
+			return NULL;
+		}
+		pJob->mInputs.push_back(pInput);
+
+		//Fill the input with a pattern
+		FactoryResource<DataRequest> pRequest;
+		pRequest->setWritable(true);
+		DataAccessor pAcc = pInput->getDataAccessor(pRequest.release());
+		for (unsigned int row = 0; row < inputGrid.rows; ++row)
+		{
+			pAcc->toPixel(row, 0);
+			if (!pAcc.isValid())
+			{
+				error = "Unable to access the cube data.";
+				return NULL;
+			}
+			for (unsigned int col = 0; col < inputGrid.columns; ++col)
+			{
+				*reinterpret_cast<float*>(pAcc->getColumn()) = static_cast<float>((row * 7 + col * 13) % 255);
+				pAcc->nextColumn();
+			}
+		}
+	}
+	return pJob.release();
+}
+
+void DrizzleTuneJob::setAbortFlag(const QAtomicInt* pAbortFlag)
+{
+	DrizzleJob::setAbortFlag(pAbortFlag);
+	mpAbort = pAbortFlag;
+}
+
+size_t DrizzleTuneJob::getMemoryEstimate() const
+{
+	//More than the budget: the job only starts when no other job runs, and no other job starts while it runs
+	return DrizzleJobManager::instance()->getMemoryBudget() + 1;
+}
+
+void DrizzleTuneJob::setStage(const std::string& stage, int percent)
+{
+	QMutexLocker lock(&mStageMutex);
+	mStage = stage;
+	mPercent = percent;
+}
+
+double DrizzleTuneJob::timeDrizzle(unsigned int tileSize, unsigned int threads, DrizzleKernel kernel, std::string& error)
+{
+	ImageDrizzleJob job(mpResult, NULL, NULL, mGrid, 0, mGrid.rows, mInputs, 0.7, std::string(), tileSize, kernel);
+	job.setAbortFlag(mpAbort);
+	if (!job.prepare(error))
+	{
+		return -1.0;
+	}
+
+	QAtomicInt nextTile(0);
+	QAtomicInt failed(0);
+	QThreadPool pool;
+	pool.setMaxThreadCount(threads);
+
+	QTime timer;
+	timer.start();
+	for (unsigned int i = 0; i < threads; ++i)
+	{
+		pool.start(new TuneTask(&job, &nextTile, &failed));
+	}
+	pool.waitForDone();
+	int elapsed = timer.elapsed();
+
+	if (isAborted())
+	{
+		error = "Calibration aborted by user.";
+		return -1.0;
+	}
+	if (int(failed) != 0)
+	{
+		error = "Calibration drizzle failed.";
+		return -1.0;
+	}
+	return std::max(elapsed, 1) / 1000.0;
+}
+
+bool DrizzleTuneJob::processTile(const DrizzleTile& tile, std::string& error)
+{
+	unsigned int maxThreads = mBest.threads;
+	double bestTime = -1.0;
+
+	//Kernel variant first, then tile size and thread count
+	DrizzleKernel kernels[] = { KERNEL_CLIP, KERNEL_SEPARABLE };
+	for (int i = 0; i < 2; ++i)
+	{
+		setStage("Calibrating kernel variant", 10 + 10 * i);
+		double time = timeDrizzle(mBest.tileSize, mBest.threads, kernels[i], error);
+		if (time < 0.0)
+		{
+			return false;
+		}
+		if (bestTime < 0.0 || time < bestTime)
+		{
+			bestTime = time;
+			mBest.kernel = kernels[i];
+		}
+	}
+
+	unsigned int tileSizes[] = { 16, 32, 64, MAX_TILE_SIZE };
+	for (int i = 0; i < 4; ++i)
+	{
+		setStage("Calibrating tile size", 30 + 10 * i);
+		double time = timeDrizzle(tileSizes[i], mBest.threads, mBest.kernel, error);
+		if (time < 0.0)
+		{
+			return false;
+		}
+		if (time < bestTime)
+		{
+			bestTime = time;
+			mBest.tileSize = tileSizes[i];
+		}
+	}
+
+	//All thread counts are timed first, the choice compares them with the fastest of them
+	std::vector<unsigned int> threadCounts(1, maxThreads);
+	std::vector<double> times(1, bestTime);
+	for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+	{
+		setStage("Calibrating thread count", 70 + (25 * threads) / maxThreads);
+		double time = timeDrizzle(mBest.tileSize, threads, mBest.kernel, error);
+		if (time < 0.0)
+		{
+			return false;
+		}
+		threadCounts.push_back(threads);
+		times.push_back(time);
+	}
+
+	//Fewer threads are preferred unless more threads are clearly faster, the fastest count always qualifies
+	double fastest = *std::min_element(times.begin(), times.end());
+	for (size_t i = 0; i < times.size(); ++i)
+	{
+		if (times[i] * 0.95 <= fastest && threadCounts[i] < mBest.threads)
+		{
+			mBest.threads = threadCounts[i];
+		}
+	}
+	return true;
+}
+
+bool DrizzleTuneJob::updateProgress(const std::string& message, int percent)
+{
+	if (mpProgress == NULL)
+	{
+		return true;
+	}
+
+	std::string stage;
+	int stagePercent = 0;
+	{
+		QMutexLocker lock(&mStageMutex);
+		stage = mStage.empty() ? "Calibrating drizzle" : mStage;
+		stagePercent = mPercent;
+	}
+	(*mpProgress)->updateProgress(stage, stagePercent, NORMAL);
+
+	//Abort the job when the user cancelled the progress
+	return !isProgressAborted(mpProgress);
+}
+
+void DrizzleTuneJob::complete(bool success, const std::string& error)
+{
+	StepResource pStep("Drizzle calibration", "app", "B3E1C6F2-7D0A-4E8B-9C35-1F6A2D4E8B70");
+	Progress* pProgress = (mpProgress == NULL) ? NULL : mpProgress->get();
+	if (!success)
+	{
+		pStep->finalize(Message::Failure, error);
+		if (pProgress != NULL)
+		{
+			pProgress->updateProgress(error, 0, ERRORS);
+		}
+		return;
+	}
+
+	//The settings and the thread budget belong to the GUI thread
+	DrizzleTuner::setSettingTileSize(mBest.tileSize);
+	DrizzleTuner::setSettingThreadCount(mBest.threads);
+	DrizzleTuner::setSettingKernelVariant(DrizzleTuner::toString(mBest.kernel));
+	DrizzleTuner::setSettingCpuModel(DrizzleTuner::getCpuModel());
+	DrizzleJobManager::instance()->setThreadBudget(mBest.threads);
+
+	std::string summary = DrizzleTuner::toString(mBest.kernel) + " kernel, tiles of " + QString::number(mBest.tileSize).toStdString() +
+		" pixels, " + QString::number(mBest.threads).toStdString() + " threads";
+	pStep->addProperty("Configuration", summary);
+	pStep->finalize(Message::Success);
+	if (pProgress != NULL)
+	{
+		pProgress->updateProgress("Calibration done: " + summary, 100, NORMAL);
+	}
+}
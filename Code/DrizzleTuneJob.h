@@ -0,0 +1,96 @@
+/********************************************//*
+*
+* @file: DrizzleTuneJob.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleTuneJob_H
+#define DrizzleTuneJob_H
+
+#include "DrizzleAccumulator.h"
+#include "DrizzleJob.h"
+#include "DrizzleTuner.h"
+
+#include <Qt/qatomic.h>
+#include <Qt/qmutex.h>
+
+#include <string>
+#include <vector>
+
+class ProgressResource;
+class RasterElement;
+
+/**
+*
+* DrizzleJob which calibrates the tile size, thread count and kernel variant by timing short
+* synthetic drizzles, and stores the fastest configuration in the settings of the DrizzleTuner.
+* The synthetic images are created and removed on the GUI thread, the timings run as the single
+* tile of the job. The synthetic output is several of the largest tiles wide, so every thread count
+* is timed on enough tiles. The job claims the whole memory budget, so it runs alone and other jobs
+* do not skew its timings. Jobs submitted before it has completed use the previous configuration.
+*/
+class DrizzleTuneJob : public DrizzleJob
+{
+public:
+	/**
+	* Creates the calibration job and its synthetic images.
+	*
+	* @param pProgress Progress of the calibration, the job takes ownership, also on failure. Can be NULL.
+	* @param error String which will hold the error message on failure.
+	* @return New job, NULL on failure.
+	*/
+	static DrizzleTuneJob* create(ProgressResource* pProgress, std::string& error);
+
+	/**
+	* Destructor for the calibration job, removes the synthetic images.
+	*/
+	~DrizzleTuneJob();
+
+	void setAbortFlag(const QAtomicInt* pAbortFlag);
+	size_t getMemoryEstimate() const;
+	bool processTile(const DrizzleTile& tile, std::string& error);
+	bool updateProgress(const std::string& message, int percent);
+	void complete(bool success, const std::string& error);
+
+private:
+	DrizzleTuneJob(ProgressResource* pProgress);
+
+	/**
+	* Times the drizzle of the synthetic inputs onto the synthetic output.
+	*
+	* @return Time in seconds, negative on failure.
+	*/
+	double timeDrizzle(unsigned int tileSize, unsigned int threads, DrizzleKernel kernel, std::string& error);
+
+	/**
+	* Sets the stage of the calibration reported by updateProgress().
+	*/
+	void setStage(const std::string& stage, int percent);
+
+	ProgressResource* mpProgress;
+	RasterElement* mpResult;
+	DrizzleGrid mGrid;
+	std::vector<RasterElement*> mInputs;
+
+	/**
+	* Abort flag of the job, passed on to the timed drizzles.
+	*/
+	const QAtomicInt* mpAbort;
+
+	/**
+	* Fastest configuration found by the timings.
+	*/
+	DrizzleTuning mBest;
+
+	QMutex mStageMutex;
+	std::string mStage;
+	int mPercent;
+};
+
+#endif
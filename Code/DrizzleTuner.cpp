@@ -0,0 +1,76 @@
+/********************************************//*
+*
+* @file: DrizzleTuner.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "DrizzleTuner.h"
+
+#include <Qt/qstring.h>
+#include <Qt/qthread.h>
+
+#include <algorithm>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+std::string DrizzleTuner::getCpuModel()
+{
+	char brand[49];
+	memset(brand, 0, sizeof(brand));
+#if defined(_MSC_VER)
+	//Processor brand string
+	int info[4] = { 0, 0, 0, 0 };
+	__cpuid(info, 0x80000000);
+	if (static_cast<unsigned int>(info[0]) >= 0x80000004)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			__cpuid(info, 0x80000002 + i);
+			memcpy(brand + 16 * i, info, sizeof(info));
+		}
+	}
+#endif
+	QString model = QString::fromLatin1(brand).trimmed();
+	if (model.isEmpty())
+	{
+		model = "Unknown processor";
+	}
+	return (model + " (" + QString::number(QThread::idealThreadCount()) + " threads)").toStdString();
+}
+
+bool DrizzleTuner::needsTuning()
+{
+	return getSettingCpuModel() != getCpuModel();
+}
+
+DrizzleTuning DrizzleTuner::getTuning()
+{
+	DrizzleTuning tuning;
+	tuning.tileSize = std::max(getSettingTileSize(), 1u);
+	tuning.threads = getSettingThreadCount();
+	if (tuning.threads == 0)
+	{
+		tuning.threads = static_cast<unsigned int>(std::max(QThread::idealThreadCount(), 1));
+	}
+	tuning.kernel = toKernel(getSettingKernelVariant());
+	return tuning;
+}
+
+std::string DrizzleTuner::toString(DrizzleKernel kernel)
+{
+	return kernel == KERNEL_SEPARABLE ? "Separable" : "Clip";
+}
+
+DrizzleKernel DrizzleTuner::toKernel(const std::string& name)
+{
+	return name == "Separable" ? KERNEL_SEPARABLE : KERNEL_CLIP;
+}
@@ -0,0 +1,89 @@
+/********************************************//*
+*
+* @file: DrizzleTuner.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleTuner_H
+#define DrizzleTuner_H
+
+#include "ConfigurationSettings.h"
+#include "DrizzleImageJob.h"
+
+#include <string>
+
+/**
+*
+* Configuration used to run drizzle jobs on this machine.
+*/
+struct DrizzleTuning
+{
+	/**
+	* Width and height of one tile in pixels.
+	*/
+	unsigned int tileSize;
+
+	/**
+	* Number of worker threads shared by all jobs.
+	*/
+	unsigned int threads;
+
+	/**
+	* Kernel variant.
+	*/
+	DrizzleKernel kernel;
+};
+
+/**
+*
+* Configuration of the tile size, thread count and kernel variant in the Opticks settings,
+* calibrated by a DrizzleTuneJob. The calibration is repeated when the processor of the machine changes.
+*/
+class DrizzleTuner
+{
+public:
+	SETTING(TileSize, Drizzle, unsigned int, 32)
+	SETTING(ThreadCount, Drizzle, unsigned int, 0)
+	SETTING(KernelVariant, Drizzle, std::string, "Clip")
+	SETTING(CpuModel, Drizzle, std::string, "")
+
+	/**
+	* Returns a description of the processor of this machine.
+	*
+	* @return Processor brand and number of hardware threads.
+	*/
+	static std::string getCpuModel();
+
+	/**
+	* Determines whether the calibration has to be run, i.e. when it never ran
+	* or when it ran on a different processor.
+	*
+	* @return True when the stored configuration is missing or outdated.
+	*/
+	static bool needsTuning();
+
+	/**
+	* Returns the stored configuration, or defaults when the calibration never ran.
+	*
+	* @return The configuration.
+	*/
+	static DrizzleTuning getTuning();
+
+	/**
+	* Converts a kernel variant to the name stored in the settings.
+	*/
+	static std::string toString(DrizzleKernel kernel);
+
+	/**
+	* Converts a name stored in the settings to a kernel variant.
+	*/
+	static DrizzleKernel toKernel(const std::string& name);
+};
+
+#endif
@@ -0,0 +1,560 @@
+/********************************************//*
+*
+* @file: DrizzleVideoPipeline.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "DrizzleFrame.h"
+#include "DrizzleJobManager.h"
+#include "DrizzleRegistration.h"
+#include "DrizzleVideoPipeline.h"
+
+#include <Qt/qdatetime.h>
+#include <Qt/qrunnable.h>
+#include <Qt/qstring.h>
+#include <Qt/qstringlist.h>
+
+#include <algorithm>
+#include <string.h>
+
+using namespace cv;
+
+namespace
+{
+	enum Stage
+	{
+		STAGE_DECODE,
+		STAGE_DISPATCH,
+		STAGE_REGISTER
+	};
+};
+
+/**
+* Task running one stage of the pipeline until its input is drained.
+*/
+class DrizzleVideoPipeline::StageTask : public QRunnable
+{
+public:
+	StageTask(DrizzleVideoPipeline* pPipeline, int stage, unsigned int worker) :
+		mpPipeline(pPipeline),
+		mStage(stage),
+		mWorker(worker)
+	{
+	}
+
+	void run()
+	{
+		switch (mStage)
+		{
+		case STAGE_DECODE:
+			mpPipeline->decodeStage(mWorker);
+			break;
+		case STAGE_DISPATCH:
+			mpPipeline->dispatchStage();
+			break;
+		default:
+			mpPipeline->registerStage(mWorker);
+			break;
+		}
+	}
+
+private:
+	DrizzleVideoPipeline* mpPipeline;
+	int mStage;
+	unsigned int mWorker;
+};
+
+DrizzleVideoPipeline::DrizzleVideoPipeline(CvCapture* pCapture, const std::string& filename, unsigned int frames, unsigned int first, const std::vector<cv::Point2f>& startCorners,
+	const std::string& features, unsigned int timeLimit) :
+	mFrames(frames),
+	mFirst(std::min(first, frames)),
+	mSegmentLength(std::max(getSettingDecodeSegmentLength(), 1u)),
+	mFeatures(features),
+	mTimeLimit(timeLimit),
+	mFramePixels(0),
+	mWindow(0),
+	mKeyframeInterval(getSettingKeyframeInterval()),
+	mRunLength(std::max(getSettingQueueDepth(), 1u)),
+	mCorners(startCorners),
+	mCornersFrame(mFirst),
+	mNextFrame(static_cast<int>(mFirst)),
+	mDetections(0),
+	mAbort(0)
+{
+	//The thread budget is split between the decoders, the registration workers and the consumer of the frames
+	unsigned int budget = static_cast<unsigned int>(std::max(DrizzleJobManager::instance()->getThreadBudget(), 1));
+
+	//Every additional decoder needs at least one segment of its own
+	unsigned int decoders = getSettingDecodeThreads();
+	if (decoders == 0)
+	{
+		decoders = std::min(std::max(budget / 4, 1u), 4u);
+	}
+	decoders = std::max(std::min(decoders, (frames - mFirst + mSegmentLength - 1) / mSegmentLength), 1u);
+	mCaptures.push_back(pCapture);
+	while (mCaptures.size() < decoders)
+	{
+		CvCapture* pExtra = cvCreateFileCapture(filename.c_str());
+		if (pExtra == NULL)
+		{
+			break;
+		}
+		mCaptures.push_back(pExtra);
+	}
+
+	//A decoder runs at most one segment ahead of the frames being converted, plus the frame it checks the next segment with
+	for (unsigned int i = 0; i < mCaptures.size(); ++i)
+	{
+		mDecoded.push_back(new DrizzleSpscQueue<DrizzleVideoFrame>(std::max(getSettingQueueDepth(), mSegmentLength + 1)));
+	}
+
+	unsigned int workers = getSettingRegistrationThreads();
+	if (workers == 0)
+	{
+		workers = (budget - 1) / 2;
+	}
+	workers = std::max(workers, 1u);
+	for (unsigned int i = 0; i < workers; ++i)
+	{
+		mDispatched.push_back(new DrizzleSpscQueue<DrizzleVideoFrame>(std::max(getSettingQueueDepth(), 1u)));
+		mRegistered.push_back(new DrizzleSpscQueue<DrizzleVideoFrame>(std::max(getSettingQueueDepth(), 1u)));
+	}
+
+	//By default the queues bound the frames in flight, the consumer waits for the first frame of the next segment as well
+	mWindow = getSettingFramesInFlight();
+	if (mWindow == 0)
+	{
+		mWindow = static_cast<unsigned int>(mCaptures.size()) * (mSegmentLength + 1) + 2 * workers * mRunLength;
+	}
+	mWindow = std::max(mWindow, 2u);
+	mFramePixels = static_cast<size_t>(cvGetCaptureProperty(pCapture, CV_CAP_PROP_FRAME_WIDTH)) *
+		static_cast<size_t>(cvGetCaptureProperty(pCapture, CV_CAP_PROP_FRAME_HEIGHT));
+	for (int i = 0; i < 3; ++i)
+	{
+		mStageFrames[i] = 0;
+		mStageTime[i] = 0;
+	}
+	mPool.setMaxThreadCount(static_cast<int>(workers + mCaptures.size()) + 1);
+}
+
+DrizzleVideoPipeline::~DrizzleVideoPipeline()
+{
+	stop();
+	for (unsigned int i = 0; i < mDispatched.size(); ++i)
+	{
+		delete mDispatched[i];
+		delete mRegistered[i];
+	}
+	for (unsigned int i = 0; i < mDecoded.size(); ++i)
+	{
+		delete mDecoded[i];
+		if (i > 0)
+		{
+			cvReleaseCapture(&mCaptures[i]);
+		}
+	}
+}
+
+void DrizzleVideoPipeline::setCorners(const std::vector<cv::Point2f>& corners)
+{
+	mKnownCorners = corners;
+}
+
+void DrizzleVideoPipeline::start()
+{
+	for (unsigned int i = 0; i < mDecoded.size(); ++i)
+	{
+		mPool.start(new StageTask(this, STAGE_DECODE, i));
+	}
+	mPool.start(new StageTask(this, STAGE_DISPATCH, 0));
+	for (unsigned int i = 0; i < mDispatched.size(); ++i)
+	{
+		mPool.start(new StageTask(this, STAGE_REGISTER, i));
+	}
+}
+
+void DrizzleVideoPipeline::stop()
+{
+	mAbort.fetchAndStoreOrdered(1);
+	mPool.waitForDone();
+}
+
+bool DrizzleVideoPipeline::push(DrizzleSpscQueue<DrizzleVideoFrame>& queue, const DrizzleVideoFrame& frame)
+{
+	unsigned int attempts = 0;
+	while (!queue.tryPush(frame))
+	{
+		if (int(mAbort) != 0)
+		{
+			return false;
+		}
+		DrizzleSpscQueue<DrizzleVideoFrame>::backoff(attempts);
+	}
+	return true;
+}
+
+bool DrizzleVideoPipeline::pop(DrizzleSpscQueue<DrizzleVideoFrame>& queue, DrizzleVideoFrame& frame)
+{
+	unsigned int attempts = 0;
+	while (!queue.tryPop(frame))
+	{
+		if (int(mAbort) != 0 || queue.isDrained())
+		{
+			return false;
+		}
+		DrizzleSpscQueue<DrizzleVideoFrame>::backoff(attempts);
+	}
+	return true;
+}
+
+void DrizzleVideoPipeline::fail(const std::string& error)
+{
+	QMutexLocker lock(&mErrorMutex);
+	if (mError.empty())
+	{
+		mError = error;
+	}
+	mAbort.fetchAndStoreOrdered(1);
+}
+
+bool DrizzleVideoPipeline::isKeyframe(unsigned int index) const
+{
+	return mKeyframeInterval == 0 || index % mKeyframeInterval == 0;
+}
+
+unsigned int DrizzleVideoPipeline::getWorker(unsigned int index) const
+{
+	//A run fits in the queues of its worker, so the worker never waits for the consumer to collect another run
+	return ((index - mFirst) / mRunLength) % static_cast<unsigned int>(mDispatched.size());
+}
+
+bool DrizzleVideoPipeline::getError(std::string& error) const
+{
+	QMutexLocker lock(&mErrorMutex);
+	if (mError.empty())
+	{
+		return false;
+	}
+	error = mError;
+	return true;
+}
+
+void DrizzleVideoPipeline::decodeStage(unsigned int decoder)
+{
+	CvCapture* pCapture = mCaptures[decoder];
+	unsigned int decoders = static_cast<unsigned int>(mCaptures.size());
+	unsigned int segments = (mFrames - mFirst + mSegmentLength - 1) / mSegmentLength;
+
+	//Only the first video is positioned, at frame 0
+	unsigned int position = decoder == 0 ? 0 : mFrames;
+	for (unsigned int segment = decoder; segment < segments && int(mAbort) == 0; segment += decoders)
+	{
+		unsigned int start = mFirst + segment * mSegmentLength;
+		unsigned int end = std::min(start + mSegmentLength, mFrames);
+		if (position < start && segment == 0)
+		{
+			//The first frame is reached exactly by skipping frames, the other segments are checked against it
+			while (position < start && int(mAbort) == 0 && cvGrabFrame(pCapture) != 0)
+			{
+				position++;
+			}
+		}
+		if (position != start)
+		{
+			//The video backend seeks to the preceding keyframe and decodes up to the requested frame
+			cvSetCaptureProperty(pCapture, CV_CAP_PROP_POS_FRAMES, start);
+			position = start;
+		}
+
+		//With several decoders the first frame of the next segment is decoded as well, to check its decoder seeked exactly
+		unsigned int last = (decoders > 1 && end < mFrames) ? end + 1 : end;
+		for (unsigned int index = start; index < last && int(mAbort) == 0; ++index)
+		{
+			//The frames the consumer takes next are always within the window, so waiting cannot block them
+			unsigned int attempts = 0;
+			while (index >= static_cast<unsigned int>(int(mNextFrame)) + mWindow && int(mAbort) == 0)
+			{
+				DrizzleSpscQueue<DrizzleVideoFrame>::backoff(attempts);
+			}
+			if (int(mAbort) != 0)
+			{
+				break;
+			}
+
+			QTime timer;
+			timer.start();
+
+			//The capture owns the decoded image, the frame keeps a copy
+			IplImage* pImage = cvQueryFrame(pCapture);
+			if (pImage == NULL)
+			{
+				fail("Error: unable to load frame " + QString::number(index).toStdString() + ".");
+				break;
+			}
+			position++;
+			DrizzleVideoFrame frame;
+			frame.index = index;
+			frame.color = Mat(pImage, true);
+
+			mStageTime[STAGE_DECODE].fetchAndAddOrdered(timer.elapsed());
+			if (index < end)
+			{
+				mStageFrames[STAGE_DECODE].fetchAndAddOrdered(1);
+			}
+			if (!push(*mDecoded[decoder], frame))
+			{
+				break;
+			}
+		}
+	}
+	mDecoded[decoder]->close();
+}
+
+void DrizzleVideoPipeline::dispatchStage()
+{
+	DrizzleVideoFrame frame;
+	DrizzleVideoFrame check;
+	Mat previous;
+	Mat keyframe;
+	unsigned int keyframeIndex = 0;
+	unsigned int decoders = static_cast<unsigned int>(mDecoded.size());
+	for (unsigned int index = mFirst; index < mFrames && int(mAbort) == 0; ++index)
+	{
+		//The segments are collected from the decoders in turn
+		DrizzleSpscQueue<DrizzleVideoFrame>& decoded = *mDecoded[((index - mFirst) / mSegmentLength) % decoders];
+		if (!pop(decoded, frame))
+		{
+			break;
+		}
+		if (!check.color.empty() && frame.index == check.index && norm(frame.color, check.color, NORM_INF) != 0)
+		{
+			fail("Frame " + QString::number(frame.index).toStdString() + " differs between decoders, the video cannot be seeked exactly. Set Drizzle/DecodeThreads to 1.");
+			break;
+		}
+		check = DrizzleVideoFrame();
+
+		//Only the decoded frames are shared, the workers convert them so this stage stays cheap at any number of workers
+		QTime timer;
+		timer.start();
+		if (index > mFirst)
+		{
+			frame.referenceIndex = (mKeyframeInterval == 0) ? index - 1 : keyframeIndex;
+			frame.reference = (mKeyframeInterval == 0) ? previous : keyframe;
+		}
+		previous = frame.color;
+		if (isKeyframe(index))
+		{
+			keyframe = frame.color;
+			keyframeIndex = index;
+		}
+		mStageTime[STAGE_DISPATCH].fetchAndAddOrdered(timer.elapsed());
+		mStageFrames[STAGE_DISPATCH].fetchAndAddOrdered(1);
+
+		//Keep the first frame of the next segment as decoded by this decoder
+		if (decoders > 1 && (index + 1 - mFirst) % mSegmentLength == 0 && index + 1 < mFrames)
+		{
+			if (!pop(decoded, check))
+			{
+				break;
+			}
+		}
+
+		//Runs of frames are dealt out in turn, so the registered frames can be collected in order
+		if (!push(*mDispatched[getWorker(frame.index)], frame))
+		{
+			break;
+		}
+	}
+	for (unsigned int i = 0; i < mDispatched.size(); ++i)
+	{
+		mDispatched[i]->close();
+	}
+}
+
+void DrizzleVideoPipeline::toGray(const Mat& color, Mat& gray)
+{
+	if (color.channels() == 1)
+	{
+		gray = color;
+	}
+	else
+	{
+		cvtColor(color, gray, CV_BGR2GRAY);
+	}
+}
+
+void DrizzleVideoPipeline::registerStage(unsigned int worker)
+{
+	DrizzleVideoFrame frame;
+	DrizzleRegistration registration(mFeatures, mTimeLimit);
+	Mat previous;
+	unsigned int previousIndex = 0;
+	while (pop(*mDispatched[worker], frame))
+	{
+		QTime timer;
+		timer.start();
+		toGray(frame.color, frame.gray);
+		frame.color.release();
+
+		//Pairs are registered in parallel, within a run the reference is usually the frame registered before and its features are kept.
+		//The consumer composes the transformations in order
+		unsigned int detections = registration.getDetections();
+		if (!mKnownCorners.empty())
+		{
+			frame.reference.release();
+		}
+		else if (!frame.reference.empty())
+		{
+			Mat reference;
+			if (!previous.empty() && previousIndex == frame.referenceIndex)
+			{
+				reference = previous;
+			}
+			else if (!registration.hasReference(frame.referenceIndex))
+			{
+				toGray(frame.reference, reference);
+			}
+			frame.reference.release();
+			if (!registration.registerFrame(frame.gray, frame.index, reference, frame.referenceIndex, isKeyframe(frame.index), frame.homography))
+			{
+				fail("Frame " + QString::number(frame.index).toStdString() + " could not be registered.");
+				break;
+			}
+		}
+		previous = frame.gray;
+		previousIndex = frame.index;
+		mDetections.fetchAndAddOrdered(static_cast<int>(registration.getDetections() - detections));
+		mStageTime[STAGE_REGISTER].fetchAndAddOrdered(timer.elapsed());
+		mStageFrames[STAGE_REGISTER].fetchAndAddOrdered(1);
+		if (!push(*mRegistered[worker], frame))
+		{
+			break;
+		}
+	}
+	mRegistered[worker]->close();
+}
+
+bool DrizzleVideoPipeline::takeFrame(DrizzleVideoFrame& frame)
+{
+	unsigned int next = static_cast<unsigned int>(int(mNextFrame));
+	if (next >= mFrames || !mRegistered[getWorker(next)]->tryPop(frame))
+	{
+		return false;
+	}
+	mNextFrame.fetchAndAddOrdered(1);
+
+	//Get the corners of the current frame via the transformation matrix of its reference frame, which was taken before
+	frame.corners = mCorners;
+	if (!mKnownCorners.empty())
+	{
+		size_t first = static_cast<size_t>(frame.index) * 4;
+		if (first + 4 <= mKnownCorners.size())
+		{
+			frame.corners.assign(mKnownCorners.begin() + first, mKnownCorners.begin() + first + 4);
+		}
+	}
+	else if (!frame.homography.empty())
+	{
+		perspectiveTransform(mCorners, frame.corners, frame.homography);
+	}
+	if (isKeyframe(frame.index))
+	{
+		mCorners = frame.corners;
+		mCornersFrame = frame.index;
+	}
+	return true;
+}
+
+void DrizzleVideoPipeline::getResumePoint(unsigned int& frame, std::vector<cv::Point2f>& corners) const
+{
+	//Frames after the last reference frame are registered against it, or against frames after it
+	frame = mCornersFrame;
+	corners = mCorners;
+}
+
+const std::string& DrizzleVideoPipeline::getFeatures() const
+{
+	return mFeatures;
+}
+
+unsigned int DrizzleVideoPipeline::getTimeLimit() const
+{
+	return mTimeLimit;
+}
+
+unsigned int DrizzleVideoPipeline::getThreadCount() const
+{
+	return static_cast<unsigned int>(mDecoded.size() + mDispatched.size()) + 1;
+}
+
+size_t DrizzleVideoPipeline::getMemoryEstimate() const
+{
+	//A frame in flight holds at most its colour and gray scale pixels, the dispatch stage keeps the colour previous frame
+	//and keyframe, every worker the gray scale previous frame, reference frame and pyramids, and the consumer one copy
+	size_t colorFrame = 3 * mFramePixels;
+	size_t grayFrame = mFramePixels;
+	return mWindow * (colorFrame + grayFrame) + 2 * colorFrame + mDispatched.size() * 4 * grayFrame + grayFrame;
+}
+
+void DrizzleVideoPipeline::copyFrame(const DrizzleVideoFrame& videoFrame, DrizzleFrame& frame)
+{
+	frame.name = "frame_" + QString::number(videoFrame.index).toStdString();
+	frame.grid.rows = videoFrame.gray.rows;
+	frame.grid.columns = videoFrame.gray.cols;
+	frame.grid.dataType = (videoFrame.gray.depth() == CV_16U) ? INT2UBYTES : INT1UBYTE;
+	frame.grid.topLeft = LocationType(videoFrame.corners[0].x, videoFrame.corners[0].y);
+	frame.grid.bottomLeft = LocationType(videoFrame.corners[1].x, videoFrame.corners[1].y);
+	frame.grid.bottomRight = LocationType(videoFrame.corners[2].x, videoFrame.corners[2].y);
+	frame.grid.topRight = LocationType(videoFrame.corners[3].x, videoFrame.corners[3].y);
+
+	//Copy gray scale frame to one contiguous buffer
+	size_t lineSize = videoFrame.gray.cols * videoFrame.gray.elemSize();
+	frame.pixels.resize(lineSize * videoFrame.gray.rows);
+	for (int row = 0; row < videoFrame.gray.rows; ++row)
+	{
+		memcpy(&frame.pixels[row * lineSize], videoFrame.gray.ptr(row), lineSize);
+	}
+}
+
+std::string DrizzleVideoPipeline::getStatistics() const
+{
+	const char* names[] = { "decode", "dispatch", "register" };
+	int workers[] = { static_cast<int>(mDecoded.size()), 1, static_cast<int>(mRegistered.size()) };
+	QStringList stages;
+	for (int i = 0; i < 3; ++i)
+	{
+		int frames = mStageFrames[i];
+		int time = mStageTime[i];
+		double fps = (frames * 1000.0 * workers[i]) / std::max(time, 1);
+		stages << QString("%1 %2 fps").arg(names[i]).arg(fps, 0, 'f', 1);
+	}
+
+	unsigned int decoded = 0;
+	unsigned int decodedCapacity = 0;
+	unsigned int decodedPeak = 0;
+	for (unsigned int i = 0; i < mDecoded.size(); ++i)
+	{
+		decoded += mDecoded[i]->getDepth();
+		decodedCapacity += mDecoded[i]->getCapacity();
+		decodedPeak = std::max(decodedPeak, mDecoded[i]->getPeakDepth());
+	}
+
+	unsigned int dispatched = 0;
+	unsigned int registered = 0;
+	unsigned int capacity = 0;
+	for (unsigned int i = 0; i < mDispatched.size(); ++i)
+	{
+		dispatched += mDispatched[i]->getDepth();
+		registered += mRegistered[i]->getDepth();
+		capacity += mDispatched[i]->getCapacity();
+	}
+	return (stages.join(", ") + QString(" (%1 decoders, %2 workers); queues: decoded %3/%4, dispatched %5/%6, registered %7/%6; decoded peak %8; frames analysed %9 times")
+		.arg(mDecoded.size()).arg(mRegistered.size()).arg(decoded).arg(decodedCapacity).arg(dispatched).arg(capacity).arg(registered)
+		.arg(decodedPeak).arg(int(mDetections))).toStdString();
+}
@@ -0,0 +1,307 @@
+/********************************************//*
+*
+* @file: DrizzleVideoPipeline.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleVideoPipeline_H
+#define DrizzleVideoPipeline_H
+
+#include "ConfigurationSettings.h"
+#include "DrizzleSpscQueue.h"
+
+#include <Qt/qatomic.h>
+#include <Qt/qmutex.h>
+#include <Qt/qthreadpool.h>
+
+#include <string>
+#include <vector>
+
+#include <opencv2\opencv.hpp>
+
+struct DrizzleFrame;
+
+/**
+*
+* Video frame passed between the stages of the DrizzleVideoPipeline.
+*/
+struct DrizzleVideoFrame
+{
+	/**
+	* Number of the frame in the video, starting from 0.
+	*/
+	unsigned int index;
+
+	/**
+	* Decoded colour frame, released once a registration worker made the gray scale frame.
+	*/
+	cv::Mat color;
+
+	/**
+	* Gray scale frame.
+	*/
+	cv::Mat gray;
+
+	/**
+	* Decoded frame this frame is registered against, empty for the first frame.
+	* Released once the frame is registered.
+	*/
+	cv::Mat reference;
+
+	/**
+	* Number of the reference frame: the preceding frame, or the last keyframe when keyframes are used.
+	*/
+	unsigned int referenceIndex;
+
+	/**
+	* Transformation from this frame to the reference frame, in coordinates relative to the frame size.
+	*/
+	cv::Mat homography;
+
+	/**
+	* Coordinates of the corners of the frame in the output grid (top left, bottom left, bottom right, top right).
+	*/
+	std::vector<cv::Point2f> corners;
+};
+
+/**
+*
+* Staged dataflow pipeline which decodes, converts and registers the frames of a video.
+* Every stage runs on its own thread, decoding and registration run on several workers, and the stages are
+* connected by bounded lock-free queues so they overlap without running ahead too far.
+* The video is split into segments of consecutive frames, which the decoders take in turn, each decoder
+* seeking to the start of its next segment. A single dispatch stage pairs every frame with its reference
+* frame and deals runs of consecutive frames to the registration workers, which convert and register the
+* pairs independently, so a worker detects the features of every frame once and matches the next frame against them.
+* The registered frames are taken in order by the consumer, which composes the transformations and places
+* the frames on the output grid. The decoders stay at most FramesInFlight frames ahead of the consumer,
+* which bounds the memory of the whole pipeline.
+*/
+class DrizzleVideoPipeline
+{
+public:
+	SETTING(QueueDepth, Drizzle, unsigned int, 8)
+	SETTING(RegistrationThreads, Drizzle, unsigned int, 0)
+	SETTING(DecodeThreads, Drizzle, unsigned int, 0)
+	SETTING(DecodeSegmentLength, Drizzle, unsigned int, 32)
+	SETTING(KeyframeInterval, Drizzle, unsigned int, 0)
+	SETTING(FramesInFlight, Drizzle, unsigned int, 0)
+
+	/**
+	* Constructor for the pipeline.
+	*
+	* @param pCapture Video positioned at frame 0, used by the decode stage until the pipeline has stopped.
+	* @param filename Filename of the video, opened again by every additional decoder.
+	* @param frames Number of frames of the video to process.
+	* @param first First frame to process, e.g. the resume point of an interrupted drizzle. It has no reference frame.
+	* @param startCorners Coordinates of the corners of the first frame in the output grid.
+	* @param features Registration backend of the workers, see DrizzleRegistration.
+	* @param timeLimit Time budget of the registration of a frame in milliseconds, 0 for no budget.
+	*/
+	DrizzleVideoPipeline(CvCapture* pCapture, const std::string& filename, unsigned int frames, unsigned int first, const std::vector<cv::Point2f>& startCorners,
+		const std::string& features, unsigned int timeLimit);
+
+	/**
+	* Destructor for the pipeline, stops the stages.
+	*/
+	~DrizzleVideoPipeline();
+
+	/**
+	* Places the frames at corners known from an earlier pass over the video instead of registering them,
+	* so a second pass places every frame exactly as the first. The workers only convert the frames.
+	* Has to be called before the stages are started.
+	*
+	* @param corners Corners of every frame from frame 0 on, four per frame in the order of DrizzleVideoFrame::corners.
+	*/
+	void setCorners(const std::vector<cv::Point2f>& corners);
+
+	/**
+	* Starts the stages.
+	*/
+	void start();
+
+	/**
+	* Aborts the stages and waits until they have stopped.
+	*/
+	void stop();
+
+	/**
+	* Takes the next registered frame, in the order of the video, and places it relative to its reference frame.
+	* Does not wait when no frame is available yet.
+	*
+	* @param frame Frame which will hold the next frame, with its corners.
+	* @return True when a frame was taken.
+	*/
+	bool takeFrame(DrizzleVideoFrame& frame);
+
+	/**
+	* Returns the point from which the frames after the last frame taken can be processed again:
+	* the last reference frame taken, or the first frame when none was taken, and its corners.
+	* Called by the consumer, like takeFrame.
+	*
+	* @param frame Unsigned int which will hold the number of the frame.
+	* @param corners Vector which will hold the corners of the frame.
+	*/
+	void getResumePoint(unsigned int& frame, std::vector<cv::Point2f>& corners) const;
+
+	/**
+	* @return Registration backend of the workers.
+	*/
+	const std::string& getFeatures() const;
+
+	/**
+	* @return Time budget of the registration of a frame in milliseconds.
+	*/
+	unsigned int getTimeLimit() const;
+
+	/**
+	* @return Number of threads running the stages.
+	*/
+	unsigned int getThreadCount() const;
+
+	/**
+	* @return Estimated memory in bytes of the frames in flight and of the frames kept by the stages.
+	*/
+	size_t getMemoryEstimate() const;
+
+	/**
+	* Copies a registered frame into a DrizzleFrame, the buffer the drizzle jobs read.
+	*
+	* @param videoFrame Registered frame, with its corners.
+	* @param frame Frame which will hold the gray scale pixels and the corners.
+	*/
+	static void copyFrame(const DrizzleVideoFrame& videoFrame, DrizzleFrame& frame);
+
+	/**
+	* Returns the error of a failed stage.
+	*
+	* @param error String which will hold the error message.
+	* @return True when a stage failed.
+	*/
+	bool getError(std::string& error) const;
+
+	/**
+	* @return Throughput of every stage and depth of every queue.
+	*/
+	std::string getStatistics() const;
+
+private:
+	class StageTask;
+	friend class StageTask;
+
+	void decodeStage(unsigned int decoder);
+	void dispatchStage();
+	void registerStage(unsigned int worker);
+
+	/**
+	* Pushes an item onto a queue, waiting while the queue is full.
+	*
+	* @return False when the pipeline was aborted.
+	*/
+	bool push(DrizzleSpscQueue<DrizzleVideoFrame>& queue, const DrizzleVideoFrame& frame);
+
+	/**
+	* Pops an item from a queue, waiting while the queue is empty.
+	*
+	* @return False when the queue is drained or the pipeline was aborted.
+	*/
+	bool pop(DrizzleSpscQueue<DrizzleVideoFrame>& queue, DrizzleVideoFrame& frame);
+
+	/**
+	* Converts a decoded frame to gray scale, frames with one channel are shared.
+	*/
+	static void toGray(const cv::Mat& color, cv::Mat& gray);
+
+	void fail(const std::string& error);
+
+	/**
+	* @return True when the frame is the reference of the frames after it.
+	*/
+	bool isKeyframe(unsigned int index) const;
+
+	/**
+	* @return Worker registering the frame.
+	*/
+	unsigned int getWorker(unsigned int index) const;
+
+	/**
+	* Video of every decoder, the first one is owned by the caller.
+	*/
+	std::vector<CvCapture*> mCaptures;
+	unsigned int mFrames;
+	unsigned int mFirst;
+	unsigned int mSegmentLength;
+
+	/**
+	* Registration backend and time budget of the workers, fixed when the pipeline is created.
+	*/
+	std::string mFeatures;
+	unsigned int mTimeLimit;
+
+	/**
+	* Number of pixels of a frame.
+	*/
+	size_t mFramePixels;
+
+	/**
+	* Frames the decoders may run ahead of the consumer.
+	*/
+	unsigned int mWindow;
+
+	/**
+	* Frames between keyframes, 0 registers every frame against the preceding frame.
+	*/
+	unsigned int mKeyframeInterval;
+
+	/**
+	* Consecutive frames registered by the same worker.
+	*/
+	unsigned int mRunLength;
+
+	/**
+	* Corners and number of the last frame taken that is a reference frame.
+	*/
+	std::vector<cv::Point2f> mCorners;
+	unsigned int mCornersFrame;
+
+	/**
+	* Corners of every frame set by setCorners(), empty when the frames are registered.
+	*/
+	std::vector<cv::Point2f> mKnownCorners;
+
+	/**
+	* Next frame to be taken, polled by the decoders.
+	*/
+	QAtomicInt mNextFrame;
+
+	/**
+	* Queues between the stages, every decoder and every registration worker has its own queue.
+	*/
+	std::vector<DrizzleSpscQueue<DrizzleVideoFrame>*> mDecoded;
+	std::vector<DrizzleSpscQueue<DrizzleVideoFrame>*> mDispatched;
+	std::vector<DrizzleSpscQueue<DrizzleVideoFrame>*> mRegistered;
+
+	/**
+	* Frames processed by and time spent in (milliseconds) the decode, dispatch and registration stages.
+	*/
+	QAtomicInt mStageFrames[3];
+	QAtomicInt mStageTime[3];
+
+	/**
+	* Frames whose features or spectra were computed by the registration workers.
+	*/
+	QAtomicInt mDetections;
+
+	QThreadPool mPool;
+	QAtomicInt mAbort;
+	mutable QMutex mErrorMutex;
+	std::string mError;
+};
+
+#endif
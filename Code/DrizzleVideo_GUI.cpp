@@ -51,6 +51,15 @@
 #include "Progress.h"
 #include "StringUtilities.h"
 #include "drizzle_helper_functions.h"
+#include "DrizzleFrame.h"
+#include "DrizzleImageJob.h"
+#include "DrizzleJobManager.h"
+#include "DrizzleQueue_GUI.h"
+#include "DrizzleRegistration.h"
+#include "DrizzleStreamJob.h"
+#include "DrizzleTuner.h"
+#include "DrizzleVideoPipeline.h"
+#include "DrizzleWindowJob.h"
 
 #include <Qt/QInputDialog.h>
 #include <Qt/qgridlayout.h>
@@ -58,8 +67,12 @@
 #include <Qt/qmessagebox.h>
 #include <Qt/qfiledialog.h>
 #include <Qt/qdir.h>
+#include <Qt/qfileinfo.h>
 
 #include <stdio.h>
+#include <algorithm>
+#include <memory>
+#include <new>
 
 
 #include <opencv\cv.hpp>
@@ -72,332 +85,7 @@
 
 using namespace cv;
 
-namespace
-{
-	template<typename T>
-	/**
-	* Function which performs the drizzling for one pixel of the destination image.
-	*
-	* @param pData Typename T to be divided.
-	* @param pDestAcc DataAccessor to the destination RasterElement.
-	* @param pSrcAcc DataAccessor to the source RasterElement.
-	* @param row Current row of the destination RasterElement.
-	* @param col Current column of the destination RasterElement.
-	* @param rowSize height of the destination RasterElement.
-	* @param colSize width of the destination RasterElement.
-	* @param drop Percentage of width and height of pixel of the source images which is taken into account (from 0 to 1).
-	* @param num_overlap_images Pointer to double which holds the number of source images overlapping with the destination pixel.
-	*/
-	void DrizzleVideo(T* pData, DataAccessor pDestAcc, DataAccessor pSrcAcc, unsigned int row, unsigned int col, unsigned int rowSize, unsigned int colSize, double drop, double* num_overlap_images)
-	{
-		std::vector<LocationType> ipoints;	//initialise vector holding point of interest
-
-		LocationType *tllt = new LocationType(0,0);					//top left pixel of destination image
-		LocationType *bllt = new LocationType(0,rowSize);			//bottom left pixel of destination image
-		LocationType *brlt = new LocationType(colSize,rowSize);		//bottom right pixel of destination image
-		LocationType *trlt = new LocationType(colSize,0);			//top right pixel of destination image
-
-		LocationType desgeo1 = pDestAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*tllt);		//coordinates of top left pixel of destination image
-		LocationType desgeo2 = pDestAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*bllt);		//coordinates of bottom left pixel of destination image
-		LocationType desgeo3 = pDestAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*trlt);		//coordinates of bottom right pixel of destination image
-		LocationType desgeo4 = pDestAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*brlt);		//coordinates of top right pixel of destination image
-
-		double dtlx1 = desgeo1.mX;			//x coordinate of top left pixel of destination image
-		double dtly1 = desgeo1.mY;			//y coordinate of top left pixel of destination image
-		double dblx1 = desgeo2.mX;			//x coordinate of top right pixel of destination image
-		double dbly1 = desgeo2.mY;			//y coordinate of top right pixel of destination image
-		double dtrx1 = desgeo3.mX;			//x coordinate of bottom left pixel of destination image
-		double dtry1 = desgeo3.mY;			//y coordinate of bottom left pixel of destination image
-		double dbrx1 = desgeo4.mX;			//x coordinate of bottom right pixel of destination image
-		double dbry1 = desgeo4.mY;			//y coordinate of bottom right pixel of destination image
-
-		//Delete temporary Locationtypes
-		delete tllt;
-		delete bllt;
-		delete trlt;
-		delete brlt;
-
-		double ddtx1 = dtrx1 - dtlx1;		//difference in x coordinate over top of image
-		double ddty1 = dtry1 - dtly1;		//difference in y coordinate over top of image
-		double ddlx1 = dblx1 - dtlx1;		//difference in x coordinate over left side of image
-		double ddly1 = dbly1 - dtly1;		//difference in y coordinate over left side of image
-		double ddbx1 = dbrx1 - dblx1;		//difference in x coordinate over bottom of image
-		double ddby1 = dbry1 - dbly1;		//difference in y coordinate over bottom of image
-		double ddrx1 = dbrx1 - dtrx1;		//difference in x coordinate over right side of image
-		double ddry1 = dbry1 - dtry1;		//difference in y coordinate over right side of image
-
-		double dptlx1 = dtlx1 + ((((ddbx1-ddtx1)/rowSize)*double(row) + ddtx1)/double(colSize))*double(col) + ((((ddrx1-ddlx1)/colSize)*double(col) + ddlx1)/double(rowSize))*double(row);					//top left x coordinate of destination pixel
-		double dptly1 = dtly1 + ((((ddby1-ddty1)/rowSize)*double(row) + ddty1)/double(colSize))*double(col) + ((((ddry1-ddly1)/colSize)*double(col) + ddly1)/double(rowSize))*double(row);					//top left y coordinate of destination pixel
-		double dpblx1 = dtlx1 + ((((ddbx1-ddtx1)/rowSize)*double(row+1) + ddtx1)/double(colSize))*double(col) + ((((ddrx1-ddlx1)/colSize)*double(col) + ddlx1)/double(rowSize))*double(row+1);				//top right x coordinate of destination pixel
-		double dpbly1 = dtly1 + ((((ddby1-ddty1)/rowSize)*double(row+1) + ddty1)/double(colSize))*double(col) + ((((ddry1-ddly1)/colSize)*double(col) + ddly1)/double(rowSize))*double(row+1);				//top right y coordinate of destination pixel
-		double dptrx1 = dtlx1 + ((((ddbx1-ddtx1)/rowSize)*double(row) + ddtx1)/double(colSize))*double(col+1) + ((((ddrx1-ddlx1)/colSize)*double(col+1) + ddlx1)/double(rowSize))*double(row);				//bottom left x coordinate of destination pixel
-		double dptry1 = dtly1 + ((((ddby1-ddty1)/rowSize)*double(row) + ddty1)/double(colSize))*double(col+1) + ((((ddry1-ddly1)/colSize)*double(col+1) + ddly1)/double(rowSize))*double(row);				//bottom left y coordinate of destination pixel
-		double dpbrx1 = dtlx1 + ((((ddbx1-ddtx1)/rowSize)*double(row+1) + ddtx1)/double(colSize))*double(col+1) + ((((ddrx1-ddlx1)/colSize)*double(col+1) + ddlx1)/double(rowSize))*double(row+1);			//bottom right x coordinate of destination pixel
-		double dpbry1 = dtly1 + ((((ddby1-ddty1)/rowSize)*double(row+1) + ddty1)/double(colSize))*double(col+1) + ((((ddry1-ddly1)/colSize)*double(col+1) + ddly1)/double(rowSize))*double(row+1);			//bottom right y coordinate of destination pixel
-
-		//Equations of four lines (top, bottom, left, right) for one pixel: Y = MX + C
-		double dtm = (dptly1 - dptry1)/(dptlx1 - dptrx1);
-		double dtc = dptry1 - dtm*dptrx1;
-		double dbm = (dpbly1 - dpbry1)/(dpblx1 - dpbrx1);
-		double dbc = dpbry1 - dbm*dpbrx1;
-		double dlm = (dptly1 - dpbly1)/(dptlx1 - dpblx1);
-		double dlc = dpbly1 - dlm*dpblx1;
-		double drm = (dptry1 - dpbry1)/(dptrx1 - dpbrx1);
-		double drc = dpbry1 - drm*dpbrx1;
-
-		int srcrowSize = dynamic_cast<const RasterDataDescriptor*>(pSrcAcc->getAssociatedRasterElement()->getDataDescriptor())->getRows().size();		//height of source image
-		int srccolSize = dynamic_cast<const RasterDataDescriptor*>(pSrcAcc->getAssociatedRasterElement()->getDataDescriptor())->getColumns().size();	//width of source image
-
-		LocationType *tlsrclt = new LocationType(dptlx1,dptly1);		//top left pixel of source image
-		LocationType *blsrclt = new LocationType(dpblx1,dpbly1);		//bottom left pixel of source image
-		LocationType *trsrclt = new LocationType(dptrx1,dptry1);		//top right pixel of source image
-		LocationType *brsrclt = new LocationType(dpbrx1,dpbry1);		//bottom right pixel of source image
-
-		double tlsrccol = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*tlsrclt).mX) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*tlsrclt).mX : 0;		//top left x coordinate of destination pixel wrt source image
-		double tlsrcrow = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*tlsrclt).mY) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*tlsrclt).mY : 0;		//top left y coordinate of destination pixel wrt source image
-		double trsrccol = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*trsrclt).mX) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*trsrclt).mX : 0;		//top right x coordinate of destination pixel wrt source image
-		double trsrcrow = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*trsrclt).mY) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*trsrclt).mY : 0;		//top right y coordinate of destination pixel wrt source image
-		double brsrccol = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*brsrclt).mX) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*brsrclt).mX : 0;		//bottom right x coordinate of destination pixel wrt source image
-		double brsrcrow = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*brsrclt).mY) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*brsrclt).mY : 0;		//bottom right y coordinate of destination pixel wrt source image
-		double blsrccol = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*blsrclt).mX) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*blsrclt).mX : 0;		//bottom left x coordinate of destination pixel wrt source image
-		double blsrcrow = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*blsrclt).mY) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*blsrclt).mY : 0;		//bottom left y coordinate of destination pixel wrt source image
-
-		//Delete temporary Locationtypes
-		delete tlsrclt;
-		delete blsrclt;
-		delete trsrclt;
-		delete brsrclt;
-
-		tlsrclt = new LocationType(0,0);					//top left pixel of source image
-		blsrclt = new LocationType(0,srcrowSize);			//bottom left pixel of source image
-		trsrclt = new LocationType(srccolSize,0);			//top right pixel of source image
-		brsrclt = new LocationType(srccolSize,srcrowSize);	//bottom right pixel of source image
-
-		LocationType geo1 = pSrcAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*tlsrclt);		//coordinates of top left pixel of source image
-		LocationType geo2 = pSrcAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*blsrclt);		//coordinates of bottom left pixel of source image
-		LocationType geo3 = pSrcAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*trsrclt);		//coordinates of top right pixel of source image
-		LocationType geo4 = pSrcAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*brsrclt);		//coordinates of bottom right pixel of source image
-
-		//Delete temporary Locationtypes
-		delete tlsrclt;
-		delete blsrclt;
-		delete trsrclt;
-		delete brsrclt;
-
-		double tlx1 = geo1.mX;			//x coordinate of top left pixel of source image
-		double tly1 = geo1.mY;			//y coordinate of top left pixel of source image
-		double blx1 = geo2.mX;			//x coordinate of top right pixel of source image
-		double bly1 = geo2.mY;			//y coordinate of top right pixel of source image 
-		double trx1 = geo3.mX;			//x coordinate of bottom left pixel of source image 
-		double try1 = geo3.mY;			//y coordinate of bottom left pixel of source image 
-		double brx1 = geo4.mX;			//x coordinate of bottom right pixel of source image 
-		double bry1 = geo4.mY;			//y coordinate of bottom right pixel of source image 
-
-		double dtx1 = trx1 - tlx1;		//difference in x coordinate over top of source image 
-		double dty1 = try1 - tly1;		//difference in y coordinate over top of source image
-		double dlx1 = blx1 - tlx1;		//difference in x coordinate over left side of source image
-		double dly1 = bly1 - tly1;		//difference in y coordinate over left side of source image
-		double dbx1 = brx1 - blx1;		//difference in x coordinate over bottom of source image
-		double dby1 = bry1 - bly1;		//difference in y coordinate over bottom of source image
-		double drx1 = brx1 - trx1;		//difference in x coordinate over right side of source image
-		double dry1 = bry1 - try1;		//difference in y coordinate over right side of source image
-		
-		//Get upper and lower bounds on searchable area for pixels of the source image
-		int rtlsrccol = int(std::floor(tlsrccol));
-		int rtlsrcrow = int(std::floor(tlsrcrow));
-		int rtrsrccol = int(std::floor(trsrccol));
-		int rtrsrcrow = int(std::ceil(trsrcrow));
-		int rbrsrccol = int(std::ceil(brsrccol));
-		int rbrsrcrow = int(std::ceil(brsrcrow));
-		int rblsrccol = int(std::ceil(blsrccol));
-		int rblsrcrow = int(std::floor(blsrcrow));
-
-		//Set indicator for whether current output pixel and input image overlapped to FALSE
-		bool overlapped = false;
-		//Set temporary output pixel value to zero
-		unsigned long temp = 0;
-
-		for(int srcrow = std::min(std::min(rtlsrcrow,rtrsrcrow),std::min(rblsrcrow,rbrsrcrow)); srcrow <= std::max(std::max(rtlsrcrow,rtrsrcrow),std::max(rblsrcrow,rbrsrcrow)); srcrow++){
-			for(int srccol = std::min(std::min(rtlsrccol,rtrsrccol),std::min(rblsrccol,rbrsrccol)); srccol <= std::max(std::max(rtlsrccol,rtrsrccol),std::max(rblsrccol,rbrsrccol)); srccol++){
-				if(srccol < srccolSize && srcrow < srcrowSize){ 
-					ipoints.clear();		//Clear interest points vector
-
-					double ddrop = (1-drop)/2;
-
-					double ptlx1 = tlx1 + ((((dbx1-dtx1)/srcrowSize)*double(srcrow + ddrop) + dtx1)/double(srccolSize))*double(srccol + ddrop) + ((((drx1-dlx1)/srccolSize)*double(srccol + ddrop) + dlx1)/double(srcrowSize))*double(srcrow + ddrop);					//top left x coordinate of source pixel 
-					double ptly1 = tly1 + ((((dby1-dty1)/srcrowSize)*double(srcrow + ddrop) + dty1)/double(srccolSize))*double(srccol + ddrop) + ((((dry1-dly1)/srccolSize)*double(srccol + ddrop) + dly1)/double(srcrowSize))*double(srcrow + ddrop);					//top left y coordinate of source pixel
-					double pblx1 = tlx1 + ((((dbx1-dtx1)/srcrowSize)*double(srcrow+1 - ddrop) + dtx1)/double(srccolSize))*double(srccol + ddrop) + ((((drx1-dlx1)/srccolSize)*double(srccol + ddrop) + dlx1)/double(srcrowSize))*double(srcrow+1 - ddrop);				//top right x coordinate of source pixel
-					double pbly1 = tly1 + ((((dby1-dty1)/srcrowSize)*double(srcrow+1 - ddrop) + dty1)/double(srccolSize))*double(srccol + ddrop) + ((((dry1-dly1)/srccolSize)*double(srccol + ddrop) + dly1)/double(srcrowSize))*double(srcrow+1 - ddrop);				//top right y coordinate of source pixel
-					double ptrx1 = tlx1 + ((((dbx1-dtx1)/srcrowSize)*double(srcrow + ddrop) + dtx1)/double(srccolSize))*double(srccol+1 - ddrop) + ((((drx1-dlx1)/srccolSize)*double(srccol+1 - ddrop) + dlx1)/double(srcrowSize))*double(srcrow + ddrop);				//bottom left x coordinate of source pixel
-					double ptry1 = tly1 + ((((dby1-dty1)/srcrowSize)*double(srcrow + ddrop) + dty1)/double(srccolSize))*double(srccol+1 - ddrop) + ((((dry1-dly1)/srccolSize)*double(srccol+1 - ddrop) + dly1)/double(srcrowSize))*double(srcrow + ddrop);				//bottom left y coordinate of source pixel
-					double pbrx1 = tlx1 + ((((dbx1-dtx1)/srcrowSize)*double(srcrow+1 - ddrop) + dtx1)/double(srccolSize))*double(srccol+1 - ddrop) + ((((drx1-dlx1)/srccolSize)*double(srccol+1 - ddrop) + dlx1)/double(srcrowSize))*double(srcrow+1 - ddrop);			//bottom right x coordinate of source pixel
-					double pbry1 = tly1 + ((((dby1-dty1)/srcrowSize)*double(srcrow+1 - ddrop) + dty1)/double(srccolSize))*double(srccol+1 - ddrop) + ((((dry1-dly1)/srccolSize)*double(srccol+1 - ddrop) + dly1)/double(srcrowSize))*double(srcrow+1 - ddrop);			//bottom right y coordinate of source pixel
-
-					//Check whether input and output pixel can overlap
-					if((std::max(std::max(pbrx1,pblx1),std::max(ptrx1,ptlx1))>=std::min(std::min(dpbrx1,dpblx1),std::min(dptrx1,dptlx1)))
-						&& (std::min(std::min(pbrx1,pblx1),std::min(ptrx1,ptlx1))<=std::max(std::max(dpbrx1,dpblx1),std::max(dptrx1,dptlx1)))
-						&& (std::max(std::max(pbry1,pbly1),std::max(ptry1,ptly1))>=std::min(std::min(dpbry1,dpbly1),std::min(dptry1,dptly1)))
-						&& (std::min(std::min(pbry1,pbly1),std::min(ptry1,ptly1))<=std::max(std::max(dpbry1,dpbly1),std::max(dptry1,dptly1))))
-					{
-						//SUTHERLAND-HODGMAN POLYGON CLIPPING
-
-						//Use of geographical positions -> limited resolution of double
-						/*std::vector<LocationType> subject;
-						subject.push_back(*(new LocationType(ptlx1,ptly1)));
-						subject.push_back(*(new LocationType(pblx1,pbly1)));
-						subject.push_back(*(new LocationType(pbrx1,pbry1)));
-						subject.push_back(*(new LocationType(ptrx1,ptry1)));
-						std::vector<LocationType> clip;
-						clip.push_back(*(new LocationType(dptlx1,dptly1)));
-						clip.push_back(*(new LocationType(dpblx1,dpbly1)));
-						clip.push_back(*(new LocationType(dpbrx1,dpbry1)));
-						clip.push_back(*(new LocationType(dptrx1,dptry1)));*/
-
-						//Use relative positions wrt source image instead of geographical positions due to limited resolution of double.
-						std::vector<LocationType> subject;
-
-						LocationType *tlsubjectlt = new LocationType(srccol + ddrop,srcrow + ddrop);
-						LocationType *blsubjectlt = new LocationType(srccol + ddrop,srcrow+1 - ddrop);
-						LocationType *brsubjectlt = new LocationType(srccol+1 - ddrop,srcrow+1  - ddrop);
-						LocationType *trsubjectlt = new LocationType(srccol+1 - ddrop,srcrow + ddrop);
-
-						subject.push_back(*tlsubjectlt);
-						subject.push_back(*blsubjectlt);
-						subject.push_back(*brsubjectlt);
-						subject.push_back(*trsubjectlt);
-
-						std::vector<LocationType> clip;
-
-						LocationType *tlcliplt = new LocationType(tlsrccol,tlsrcrow);
-						LocationType *blcliplt = new LocationType(blsrccol,blsrcrow);
-						LocationType *brcliplt = new LocationType(brsrccol,brsrcrow);
-						LocationType *trcliplt = new LocationType(trsrccol,trsrcrow);
-
-						clip.push_back(*tlcliplt);
-						clip.push_back(*blcliplt);
-						clip.push_back(*brcliplt);
-						clip.push_back(*trcliplt);
-						
-						std::vector<LocationType> p1;
-						std::vector<LocationType> tmp;
-
-						int dir = int(drizzle_helper_functions::left_of(clip[0], clip[1], clip[2]));
-						
-						drizzle_helper_functions::poly_edge_clip(subject, clip[clip.size()-1], clip[0], dir, &ipoints);
-
-						for (int i = 0; i < clip.size()-1; i++) {
-							tmp = ipoints; 
-							ipoints = p1; 
-							p1 = tmp;
-
-							if(p1.size() == 0) {
-								ipoints.clear();
-								break;
-							}
-							drizzle_helper_functions::poly_edge_clip(p1, clip[i], clip[i+1], dir, &ipoints);
-						}
-
-						p1.clear();
-						tmp.clear();
-
-						if(ipoints.size() > 0){
-							//CALCULATION OF AREA OF OVERLAP
-							double s1 = 0;
-							double s2 = 0;
-							double area = 0;
-							for (unsigned int i = 0; i < ipoints.size(); i++){
-								s1 += ipoints.at(i).mY*ipoints.at((i+1)%ipoints.size()).mX;
-								s2 += ipoints.at(i).mX*ipoints.at((i+1)%ipoints.size()).mY;
-							}
-
-							area = (s1-s2)/2.0;
-
-							//Total area for geographical coordinate:
-							//double totalarea = (((ptly1*pblx1)+(pbly1*pbrx1)+(pbry1*ptrx1)+(ptry1*ptlx1))-((ptlx1*pbly1)+(pblx1*pbry1)+(pbrx1*ptry1)+(ptrx1*ptly1)))/2;
-
-							//Total area for relative coordinate
-							//double totalarea = (((tlsrcrow*blsrcrow)+(blsrcrow*brsrccol)+(brsrcrow*trsrccol)+(trsrcrow*tlsrccol))-((tlsrccol*blsrcrow)+(blsrccol*brsrcrow)+(brsrccol*trsrcrow)+(trsrccol*tlsrcrow)))/2;
-
-							//Get source pixel value
-							pSrcAcc->toPixel(srcrow, srccol);
-							VERIFYNRV(pSrcAcc.isValid());
-							T srcpixel = *reinterpret_cast<T*>(pSrcAcc->getColumn());
-
-							//Add weighted source pixel to temporary destination pixel
-							temp += area*srcpixel;
-
-							//Set overlapped true to be able to determine the number of overlapping images for each destination pixel
-							overlapped = true;
-
-							//Delete remainder of Locationtypes
-							delete tlsubjectlt;
-							delete blsubjectlt;
-							delete trsubjectlt;
-							delete brsubjectlt;
-							delete tlcliplt;
-							delete blcliplt;
-							delete trcliplt;
-							delete brcliplt;
-
-							//ipoints.clear();
-							//clip.clear();
-							//subject.clear();
-							//p1.clear();
-							//tmp.clear();
-						}
-					}
-				}
-			}
-		}
-		//Divide output pixel value by total number of overlapping input images with that particular output pixel
-		if(*num_overlap_images!=0){
-			*pData = static_cast<T>(static_cast<double>(*pData) * (*num_overlap_images)/(*num_overlap_images+1));
-		}
-		*pData += static_cast<T>(temp / ((*num_overlap_images+1.0)));
-
-		//Determine number of overlapping images
-		if(overlapped) (*num_overlap_images)++;
-		//ipoints.clear();
-	}
-};
-
-namespace
-{
-	template<typename T>
-	/**
-	* Function to copy one pixel of an IplImage to a pixel of a RasterElement
-	*
-	* @param pData Pixel of RasterElement
-	* @param frame_pixel Pixel of IplImage
-	*/
-	void IplImagetoRaster(T* pData, double frame_pixel)
-	{
-		*pData = static_cast<T>(frame_pixel);
-	}
-};
-
-/**
-* Function to allocate memory for an IplImage
-*
-* @param IplImage Allocated memory
-* @param CvSize Size of image
-* @param depth Depth of image
-* @param channels Numbers of channels of the image
-*/
-inline static void allocateOnDemand( IplImage **img, CvSize size, int depth, int channels )
-{
-	if ( *img != NULL )	return;
-
-	*img = cvCreateImage( size, depth, channels );
-	if ( *img == NULL )
-	{
-		QMessageBox::critical(NULL, "Drizzle: Memory allocation", "Memory allocation failed", "Back" );
-		return;
-	}
-
-}
-
-DrizzleVideo_GUI::DrizzleVideo_GUI(QWidget* Parent): QDialog(Parent)
+DrizzleVideo_GUI::DrizzleVideo_GUI(QWidget* Parent): QDialog(Parent), mAbortRequested(false)
 {
 	this->setWindowTitle("Drizzle algorithm");
 	setModal(FALSE);
@@ -426,6 +114,37 @@ DrizzleVideo_GUI::DrizzleVideo_GUI(QWidget* Parent): QDialog(Parent)
 	y_out = new QLineEdit(this);
 	dropsize = new QLineEdit(this);
 	num_images = new QLineEdit(this);
+	sigma_clip_text = new QLabel("Sigma clip");
+	sigma_clip = new QDoubleSpinBox(this);
+	sigma_clip->setRange(0.0, 10.0);
+	sigma_clip->setSingleStep(0.5);
+	sigma_clip->setSpecialValueText("Off");
+	sigma_clip->setToolTip("Rejects contributions further than this many standard deviations from the mean, e.g. passing vehicles. The video is decoded twice: once to gather the mean and variance of every output pixel, once to drizzle");
+	window_size_text = new QLabel("Sliding window");
+	window_size = new QSpinBox(this);
+	window_size->setRange(0, 100000);
+	window_size->setSpecialValueText("Still image");
+	window_size->setToolTip("Writes a super-resolved video in which every frame drizzles this many neighbouring input frames. Keeps all frames in memory");
+	fit_output = new QCheckBox("Fit output to all frames", this);
+	fit_output->setToolTip("Registers the video twice: the first pass finds the extent of all frames, the output then covers every frame instead of the first one");
+	features_text = new QLabel("Registration");
+	features = new QComboBox(this);
+	features->addItem("SURF");
+	features->addItem("ORB");
+	features->addItem("Phase correlation");
+	features->addItem("Log-polar phase correlation");
+	features->setCurrentIndex(std::max(features->findText(QString::fromStdString(DrizzleRegistration::getSettingRegistrationFeatures())), 0));
+	features->setToolTip("ORB features are binary and matched by Hamming distance, which is faster than SURF. Phase correlation suits tripod or gimbal footage with translation jitter only, log-polar phase correlation adds rotation and scale");
+	time_limit_text = new QLabel("Registration time budget (ms)");
+	time_limit = new QSpinBox(this);
+	time_limit->setRange(0, 60000);
+	time_limit->setSingleStep(10);
+	time_limit->setSpecialValueText("No budget");
+	time_limit->setValue(static_cast<int>(DrizzleRegistration::getSettingRegistrationTimeLimit()));
+	time_limit->setToolTip("Checked between the stages of a feature registration: once a frame has taken this long, the remaining stages are skipped and the transformation of the frame before is used, and the outlier rejection keeps the best transformation so far. A stage which has started always completes, so a registration can take longer than this");
+	Benchmark = new QPushButton( "benchmarkButton", this );
+	Benchmark->setText("Benchmark");
+	Benchmark->setToolTip("Registers the first frames of the video with every registration method and compares speed and accuracy");
 
 	//LAYOUT
 
@@ -449,8 +168,23 @@ DrizzleVideo_GUI::DrizzleVideo_GUI(QWidget* Parent): QDialog(Parent)
 	pLayout->addWidget( y_out,5,1);
 	pLayout->addWidget( dropsize,5,2);
 
-	pLayout->addWidget(Cancel, 6, 2,1,3);
-	pLayout->addWidget(Apply, 6, 0,1,1);
+	pLayout->addWidget( sigma_clip_text,6,0);
+	pLayout->addWidget( sigma_clip,6,1);
+
+	pLayout->addWidget( window_size_text,7,0);
+	pLayout->addWidget( window_size,7,1);
+
+	pLayout->addWidget( fit_output,8,0,1,3);
+
+	pLayout->addWidget( features_text,9,0);
+	pLayout->addWidget( features,9,1);
+	pLayout->addWidget( Benchmark,9,2);
+
+	pLayout->addWidget( time_limit_text,10,0);
+	pLayout->addWidget( time_limit,10,1);
+
+	pLayout->addWidget(Cancel, 11, 2,1,3);
+	pLayout->addWidget(Apply, 11, 0,1,1);
 
 	//Call init() for the necessary initialisations
 	init();
@@ -458,15 +192,15 @@ DrizzleVideo_GUI::DrizzleVideo_GUI(QWidget* Parent): QDialog(Parent)
 
 DrizzleVideo_GUI::~DrizzleVideo_GUI()
 {
-
 }
 
 void DrizzleVideo_GUI::init()
 {
 	//Initialize buttons
-	connect(Cancel, SIGNAL(clicked()), this, SLOT(reject()));
+	connect(Cancel, SIGNAL(clicked()), this, SLOT(closeGUI()));
 	connect(Apply, SIGNAL(clicked()), this, SLOT(PerformDrizzle()));
 	connect(Browse, SIGNAL(clicked()), this, SLOT(browse()));
+	connect(Benchmark, SIGNAL(clicked()), this, SLOT(benchmarkRegistration()));
 	connect(Dir, SIGNAL(textChanged(const QString &)), this, SLOT(updateInfo()));
 
 	//Fix size of GUI
@@ -501,14 +235,51 @@ void DrizzleVideo_GUI::browse()
     Dir->setText(fileName);
 }
 
+void DrizzleVideo_GUI::benchmarkRegistration()
+{
+	StepResource pStep( "DrizzleVideo registration benchmark", "app", "5E9A2C71-0B4D-4F63-A8E2-3C7D1B9F6A40" );
+	ProgressResource pProgress("ProgressBar");
+
+	//A short clip is enough to compare the registration backends, at the selected time limit
+	unsigned int frames = std::max(std::min(num_images->text().toUInt(), 100u), 2u);
+	std::string result;
+	std::string error;
+	if (!DrizzleRegistration::benchmark(Dir->text().toStdString(), frames, static_cast<unsigned int>(time_limit->value()), pProgress.get(), result, error))
+	{
+		pProgress->updateProgress(error, 0, ERRORS);
+		pStep->finalize(Message::Failure, error);
+		return;
+	}
+	pStep->addProperty("Results", result);
+	pStep->finalize(Message::Success);
+	QMessageBox::information(this, "Registration benchmark", QString::fromStdString(result));
+}
+
 void DrizzleVideo_GUI::closeGUI(){
+	if (!Apply->isEnabled())
+	{
+		abortDrizzle();
+		return;
+	}
 	this->reject();
 }
 
+void DrizzleVideo_GUI::abortDrizzle(){
+	//Frames are still being registered on the GUI thread
+	mAbortRequested = true;
+}
+
 bool DrizzleVideo_GUI::PerformDrizzle(){
+	//Frames are still being registered
+	if (!Apply->isEnabled())
+	{
+		return false;
+	}
+
 	Service<ModelServices> pModel;
 	StepResource pStep( "DrizzleVideo GUI", "app", "7743FFD5-C2DA-4AD5-B0F0-9D6AF2C01A86" );
-	ProgressResource pProgress("ProgressBar");
+	std::auto_ptr<ProgressResource> pNewProgress(new ProgressResource("ProgressBar"));
+	ProgressResource& pProgress = *pNewProgress;
 
 	//Get input video from LineEdit
 	CvCapture* input_video = cvCreateFileCapture(Dir->text().toStdString().c_str());
@@ -542,14 +313,6 @@ bool DrizzleVideo_GUI::PerformDrizzle(){
 		return false;
 	}
 
-	//New IplImage as buffer and for frame1
-	static IplImage *frame = NULL, *frame1 = NULL, *frame1_1C = NULL;
-
-	//Get size of frames
-	CvSize frame_size;
-	frame_size.height = (int) cvGetCaptureProperty( input_video, CV_CAP_PROP_FRAME_HEIGHT );
-	frame_size.width = (int) cvGetCaptureProperty( input_video, CV_CAP_PROP_FRAME_WIDTH );
-
 	//Get total number of frames in video
 	long number_of_frames;
 	cvSetCaptureProperty( input_video, CV_CAP_PROP_POS_AVI_RATIO, 1. );
@@ -562,23 +325,28 @@ bool DrizzleVideo_GUI::PerformDrizzle(){
 		return false;
 	}
 
-	//Reset current frame to first
-	cvSetCaptureProperty( input_video, CV_CAP_PROP_POS_FRAMES, 0. );
-	long current_frame = 0;
-
-	//Get frame from input video
-	frame = cvQueryFrame(input_video);
-	
-	//Check whether getting frame was succesfull
-	if(&frame == NULL)
+	//A sliding window writes a video instead of a still image, ask where before the frames are registered
+	QString windowOutput;
+	if (window_size->value() > 0)
 	{
-		QMessageBox::critical( this, "Drizzle",  "Error: unable to load frame.", "Back" );
-		pStep->finalize( Message::Failure,  "Error: unable to load frame." );
-		return false;
+		if (window_size->value() > num_images->text().toInt())
+		{
+			pProgress->updateProgress("The sliding window is longer than the number of frames.", 100, ERRORS);
+			return false;
+		}
+		windowOutput = QFileDialog::getSaveFileName(this, "Save super-resolved video", QString(), "Video (*.avi);;Image sequence (*.png *.tif)");
+		if (windowOutput.isEmpty())
+		{
+			pStep->finalize(Message::Abort);
+			return false;
+		}
 	}
+	double framesPerSecond = cvGetCaptureProperty( input_video, CV_CAP_PROP_FPS );
 
-	//Create new vectors containing corner coordinates of previous and first frame
-	std::vector<Point2f> prev_frame_corners(4);
+	//Get number of frames to be used
+	int num_frames = num_images->text().toInt();
+
+	//Create new vector containing corner coordinates of first frame
 	std::vector<Point2f> start_frame_corners(4);
 
 	//Inialise vector containing corner coordinates of start frame to fake coordinates
@@ -587,41 +355,103 @@ bool DrizzleVideo_GUI::PerformDrizzle(){
 	start_frame_corners[2] = cvPoint(1,1);
 	start_frame_corners[3] = cvPoint(1,0);
 
-	//Create new RasterElement for output image and for current frame
-	ModelResource<RasterElement> pResultCube(RasterUtilities::createRasterElement("DrizzleVideo_output", y_out->text().toDouble(), x_out->text().toDouble(), INT1UBYTE));
-	ModelResource<RasterElement> pFrameCube(RasterUtilities::createRasterElement("temp_frame", frame_size.height, frame_size.width,  INT1UBYTE));
+	//Reset current frame to first, the frames are decoded by the pipeline
+	cvSetCaptureProperty( input_video, CV_CAP_PROP_POS_FRAMES, 0. );
+
+	//The registration workers of every pipeline of this drizzle use the selected method and time limit
+	std::string registrationFeatures = features->currentText().toStdString();
+	unsigned int registrationTimeLimit = static_cast<unsigned int>(time_limit->value());
+
+	//The output spans the first frame, or all frames when the output is fitted to them
+	std::vector<Point2f> output_corners = start_frame_corners;
+	std::vector<Point2f> frame_corners;
+	double out_columns = x_out->text().toDouble();
+	double out_rows = y_out->text().toDouble();
+	if (fit_output->isChecked())
+	{
+		//First pass only registers the frames, to find the extent of their corners
+		std::string failure;
+		float minX = 0, maxX = 1, minY = 0, maxY = 1;
+		{
+			DrizzleVideoPipeline pipeline(input_video, Dir->text().toStdString(), num_frames, 0, start_frame_corners,
+				registrationFeatures, registrationTimeLimit);
+			pipeline.start();
+			mAbortRequested = false;
+			Apply->setEnabled(false);
+			DrizzleVideoFrame videoFrame;
+			frame_corners.reserve(static_cast<size_t>(num_frames) * 4);
+			for (int counter = 0; counter < num_frames && waitForFrame(pipeline, pProgress.get(), videoFrame, failure); counter++){
+				//Keep the corners, so the frames are not registered a second time
+				frame_corners.insert(frame_corners.end(), videoFrame.corners.begin(), videoFrame.corners.end());
+				for (unsigned int i = 0; i < videoFrame.corners.size(); i++){
+					minX = std::min(minX, videoFrame.corners[i].x);
+					maxX = std::max(maxX, videoFrame.corners[i].x);
+					minY = std::min(minY, videoFrame.corners[i].y);
+					maxY = std::max(maxY, videoFrame.corners[i].y);
+				}
+				pProgress->updateProgress("Determining output extent: " + pipeline.getStatistics(), (counter + 1) * 100 / num_frames, NORMAL);
+			}
+			pipeline.stop();
+			Apply->setEnabled(true);
+		}
+
+		//The second pass reads the video from the start again
+		cvReleaseCapture(&input_video);
+		if (failure.empty())
+		{
+			input_video = cvCreateFileCapture(Dir->text().toStdString().c_str());
+			if (input_video == NULL)
+			{
+				failure = "Video input failed!";
+			}
+		}
+		if (!failure.empty())
+		{
+			pStep->finalize(Message::Failure, failure);
+			pProgress->updateProgress(failure, 0, ERRORS);
+			return false;
+		}
+
+		//Output scale stays that of the first frame
+		output_corners[0] = Point2f(minX, minY);
+		output_corners[1] = Point2f(minX, maxY);
+		output_corners[2] = Point2f(maxX, maxY);
+		output_corners[3] = Point2f(maxX, minY);
+		out_columns = floor(out_columns * (maxX - minX) + 0.5);
+		out_rows = floor(out_rows * (maxY - minY) + 0.5);
+		pStep->addProperty("Output size", QString("%1x%2").arg(out_columns).arg(out_rows).toStdString());
+	}
 
-	//Check whether creation of RasterElements was succesfull
-	if (pResultCube.get() == NULL || pFrameCube.get() == NULL){
+	//Create new RasterElement for output image
+	ModelResource<RasterElement> pResultCube(RasterUtilities::createRasterElement("DrizzleVideo_output", out_rows, out_columns, INT1UBYTE));
+
+	//Check whether creation of RasterElement was succesfull
+	if (pResultCube.get() == NULL){
 		std::string msg = "A raster cube could not be created.";
+		cvReleaseCapture(&input_video);
 		pStep->finalize(Message::Failure, msg);
 		return false;
 	}
 
-	//Get DataAccessor and RasterDataDescriptor of output RasterElement
-	FactoryResource<DataRequest> pResultRequest;
-	DataAccessor pDestAcc = pResultCube->getDataAccessor(pResultRequest.release());
+	//Get RasterDataDescriptor of output RasterElement
 	RasterDataDescriptor* pDestDesc = static_cast<RasterDataDescriptor*>(pResultCube->getDataDescriptor());
 
-	//Get RasterDataDescriptor of frame RasterElement
-	RasterDataDescriptor* pFrameDesc = static_cast<RasterDataDescriptor*>(pFrameCube->getDataDescriptor());
-
 	//Create list containing corner coordinates
 	std::list<GcpPoint> pNewGcpList(4);
 
 	//Set corner coordinates of the output RasterElement
 	std::list<GcpPoint>::iterator it = pNewGcpList.begin();
 	it->mPixel = *(new LocationType(0, 0));
-	it->mCoordinate = *(new LocationType(start_frame_corners[0].x, start_frame_corners[0].y));
+	it->mCoordinate = *(new LocationType(output_corners[0].x, output_corners[0].y));
 	std::advance(it, 1);
-	it->mPixel = *(new LocationType(0, y_out->text().toDouble()));
-	it->mCoordinate = *(new LocationType(start_frame_corners[1].x, start_frame_corners[1].y));
+	it->mPixel = *(new LocationType(0, out_rows));
+	it->mCoordinate = *(new LocationType(output_corners[1].x, output_corners[1].y));
 	std::advance(it, 1);
-	it->mPixel = *(new LocationType(x_out->text().toDouble(), y_out->text().toDouble()));
-	it->mCoordinate = *(new LocationType(start_frame_corners[2].x, start_frame_corners[2].y));
+	it->mPixel = *(new LocationType(out_columns, out_rows));
+	it->mCoordinate = *(new LocationType(output_corners[2].x, output_corners[2].y));
 	std::advance(it, 1);
-	it->mPixel = *(new LocationType(x_out->text().toDouble(), 0));
-	it->mCoordinate = *(new LocationType(start_frame_corners[3].x, start_frame_corners[3].y));
+	it->mPixel = *(new LocationType(out_columns, 0));
+	it->mCoordinate = *(new LocationType(output_corners[3].x, output_corners[3].y));
 	GcpList* newGCPList = static_cast<GcpList*>(pModel->createElement("Corner coordinates","GcpList",pResultCube.get()));
 	newGCPList->addPoints(pNewGcpList);
 
@@ -630,19 +460,6 @@ bool DrizzleVideo_GUI::PerformDrizzle(){
 	//Set GeoreferencePlugin to be used
 	pDestGeoDesc->setGeoreferencePlugInName("GCP Georeference");
 
-	//Create view
-	Service<DesktopServices> pDesktop;
-	SpatialDataWindow* pWindow = static_cast<SpatialDataWindow*>(pDesktop->createWindow(pResultCube->getName(), SPATIAL_DATA_WINDOW));
-	SpatialDataView* pView = (pWindow == NULL) ? NULL : pWindow->getSpatialDataView();
-
-	//Check whether creation of view was successfull
-	if (pView == NULL){
-		std::string msg = "Unable to create view.";
-		pStep->finalize(Message::Failure, msg);
-		pProgress->updateProgress(msg, 0, ERRORS);
-		return false;
-	}
-
 	//Georeference the output image using the Georeference Plugin
 	const std::string &plugInName = pDestGeoDesc->getGeoreferencePlugInName();
 	if (!plugInName.empty()){
@@ -651,7 +468,6 @@ bool DrizzleVideo_GUI::PerformDrizzle(){
 		argList.setPlugInArgValue(Executable::DataElementArg(), pResultCube.get());
 		argList.setPlugInArgValue(Executable::ProgressArg(), pProgress.get());
 		argList.setPlugInArgValueLoose(Georeference::GcpListArg(), newGCPList);
-		argList.setPlugInArgValueLoose(Executable::ViewArg(), pView);
 		if (geoPlugIn->execute() == false)
 		{
 			std::string message = "Could not georeference the data set.";
@@ -672,341 +488,122 @@ bool DrizzleVideo_GUI::PerformDrizzle(){
 		pStep->addMessage(message, "app", "44E8D3C8-64C3-44DC-AB65-43F433D69DC8");
 	}
 
-	//Output destination RasterElement
-	pView->setPrimaryRasterElement(pResultCube.get());
-	pView->createLayer(RASTER, pResultCube.get());
-	
-	//Set corner coordinates of the frame RasterElement
-	it = pNewGcpList.begin();
-	it->mPixel = *(new LocationType(0, 0));
-	it->mCoordinate = *(new LocationType(start_frame_corners[0].x, start_frame_corners[0].y));
-	std::advance(it, 1);
-	it->mPixel = *(new LocationType(0, frame_size.height));
-	it->mCoordinate = *(new LocationType(start_frame_corners[1].x, start_frame_corners[1].y));
-	std::advance(it, 1);
-	it->mPixel = *(new LocationType(frame_size.width, frame_size.height));
-	it->mCoordinate = *(new LocationType(start_frame_corners[2].x, start_frame_corners[2].y));
-	std::advance(it, 1);
-	it->mPixel = *(new LocationType(frame_size.width, 0));
-	it->mCoordinate = *(new LocationType(start_frame_corners[3].x, start_frame_corners[3].y));
-	newGCPList = static_cast<GcpList*>(pModel->createElement("Corner coordinates","GcpList",pFrameCube.get()));
-	newGCPList->addPoints(pNewGcpList);
-
-	//Get GeoreferenceDescriptor of frame RasterElement
-	GeoreferenceDescriptor *pFrameGeoDesc = pFrameDesc->getGeoreferenceDescriptor();
-	//Set GeoreferencePlugin to be used
-	pFrameGeoDesc->setGeoreferencePlugInName("GCP Georeference");
-
-	//Georeference the frame using the Georeference Plugin
-	if (!plugInName.empty()){
-		ExecutableResource geoPlugIn(plugInName);
-		PlugInArgList& argList = geoPlugIn->getInArgList();
-		argList.setPlugInArgValue(Executable::DataElementArg(), pFrameCube.get());
-		argList.setPlugInArgValue(Executable::ProgressArg(), pProgress.get());
-		argList.setPlugInArgValueLoose(Georeference::GcpListArg(), newGCPList);
-		if (geoPlugIn->execute() == false)
+	//Output grid spanned by the first frame, or by all frames
+	DrizzleGrid grid;
+	grid.rows = pDestDesc->getRowCount();
+	grid.columns = pDestDesc->getColumnCount();
+	grid.dataType = pDestDesc->getDataType();
+	grid.topLeft = pResultCube->convertPixelToGeocoord(LocationType(0,0));
+	grid.bottomLeft = pResultCube->convertPixelToGeocoord(LocationType(0,grid.rows));
+	grid.bottomRight = pResultCube->convertPixelToGeocoord(LocationType(grid.columns,grid.rows));
+	grid.topRight = pResultCube->convertPixelToGeocoord(LocationType(grid.columns,0));
+	grid.georeferencePlugIn = plugInName;
+	grid.gcps = pNewGcpList;
+
+	//Queue the drizzle in the job manager, the job creates the view when it has finished
+	DrizzleTuning tuning = DrizzleTuner::getTuning();
+
+	//Without a sliding window every frame is drizzled as soon as it is registered, and then discarded.
+	//Sigma clipping streams the video twice and keeps only the statistics of every output pixel in between
+	if (windowOutput.isEmpty())
+	{
+		DrizzleVideoPipeline* pPipeline = new DrizzleVideoPipeline(input_video, Dir->text().toStdString(), num_frames, 0, start_frame_corners,
+			registrationFeatures, registrationTimeLimit);
+		pPipeline->setCorners(frame_corners);
+		DrizzleStreamJob* pStreamJob = new DrizzleStreamJob(pResultCube.release(), pNewProgress.release(), grid, pPipeline, input_video,
+			num_frames, dropsize->text().toDouble(), tuning.kernel);
+		if (sigma_clip->value() > 0.0)
 		{
-			std::string message = "Could not georeference the data set.";
-			pProgress->updateProgress(message, 0, WARNING);
-
-			pStep->addMessage(message, "app", "A8050A4B-824A-4E60-88E5-729367DEEAD0");
+			pStreamJob->setSigmaClip(sigma_clip->value(), Dir->text().toStdString());
 		}
 		else
 		{
-			geoPlugIn.release();
-			pStep->finalize(Message::Success);
+			pStreamJob->setCheckpoint(ImageDrizzleJob::getScratchFile(QFileInfo(Dir->text()).fileName().toStdString(), ".drzc"), Dir->text().toStdString());
 		}
-	}
-	else
-	{
-		std::string message = "A georeference plug-in is not available to georeference the data set.";
-		pProgress->updateProgress(message, 0, WARNING);
-		pStep->addMessage(message, "app", "44E8D3C8-64C3-44DC-AB65-43F433D69DC8");
+		DrizzleJobManager::instance()->submit(pStreamJob, QFileInfo(Dir->text()).fileName());
+		pStep->finalize();
+		DrizzleQueue_GUI::showQueue();
+		this->accept();
+		return true;
 	}
 
-	//Create vectors containing RasterElements and DataAccessors for all frames of video
-	std::vector<ModelResource<RasterElement>> rasters;
-	std::vector<DataAccessor> accessors;
-
-	//Get DataAccessor of frame RasterElement
-	FactoryResource<DataRequest> pFrameRequest;
-	DataAccessor pFrameAcc = pFrameCube->getDataAccessor(pFrameRequest.release());
-
-	//Copy frame to gray scale and color IplImages
-	allocateOnDemand( &frame1_1C, frame_size, IPL_DEPTH_8U, 1 );
-	cvConvertImage(frame, frame1_1C);
-	allocateOnDemand( &frame1, frame_size, IPL_DEPTH_8U, 3 );
-	cvConvertImage(frame, frame1);
-
-	//Set frame RasterElement to top left pixel.
-	pFrameAcc->toPixel(0,0);
-	//Copy IplImage to RasterElement
-	for (unsigned int row = 0; row < pFrameDesc->getRowCount(); ++row){ 
-		if (!pDestAcc.isValid())
+	//The sliding window revisits the frames, so they are all kept as raw buffers
+	std::vector<DrizzleFrame*> frames;
+
+	//Frames are decoded, converted and registered on worker threads while the GUI thread collects them
+	DrizzleVideoPipeline pipeline(input_video, Dir->text().toStdString(), num_frames, 0, start_frame_corners,
+		registrationFeatures, registrationTimeLimit);
+	pipeline.setCorners(frame_corners);
+	pipeline.start();
+
+	//Keep processing events so the user can abort
+	mAbortRequested = false;
+	Apply->setEnabled(false);
+	std::string failure;
+	DrizzleVideoFrame videoFrame;
+	for (int counter = 0; counter < num_frames && waitForFrame(pipeline, pProgress.get(), videoFrame, failure); counter++){
+		try
 		{
-			std::string msg = "Unable to access the cube data.";
-			pStep->finalize(Message::Failure, msg);
-			pProgress->updateProgress(msg, 0, ERRORS);
-			return false;
+			std::auto_ptr<DrizzleFrame> pFrame(new DrizzleFrame());
+			DrizzleVideoPipeline::copyFrame(videoFrame, *pFrame);
+			frames.push_back(pFrame.release());
 		}
-
-		for (unsigned int col = 0; col < pFrameDesc->getColumnCount(); ++col)
+		catch (std::bad_alloc&)
 		{
-			switchOnEncoding(pFrameDesc->getDataType(), IplImagetoRaster, pFrameAcc->getColumn(), frame1_1C->imageData[row*frame1_1C->widthStep+col]);
-			pFrameAcc->nextColumn();
+			failure = "Not enough memory to keep frame " + QString::number(counter).toStdString() + ".";
+			break;
 		}
-		pFrameAcc->nextRow();
+		pProgress->updateProgress("Registering frames: " + pipeline.getStatistics(), (counter + 1) * 100 / num_frames, NORMAL);
 	}
+	pStep->addProperty("Pipeline", pipeline.getStatistics());
+	pipeline.stop();
+	cvReleaseCapture(&input_video);
+	Apply->setEnabled(true);
 
-	//Add RasterElement and DataAccessor of first frame to vectors
-	rasters.push_back(pFrameCube);
-	accessors.push_back(pFrameAcc);
-
-	//Initialise previous frame corners as the start frame corners
-	prev_frame_corners[0] = start_frame_corners[0];
-	prev_frame_corners[1] = start_frame_corners[1];
-	prev_frame_corners[2] = start_frame_corners[2];
-	prev_frame_corners[3] = start_frame_corners[3];
-
-	//Set frame counter to one (one frame is already processed)
-	int counter = 1;
-	//Get number of frames to be used
-	int num_frames = num_images->text().toInt();
-
-	while(counter < num_frames)
+	//Check whether registration of all frames was succesfull
+	if (!failure.empty())
 	{
-		//New IplImage  for frame2
-		static IplImage *frame2_1C = NULL, *frame2 = NULL;
-
-		//Copy previous frame to gray scale and color IplImages (frame1)
-		allocateOnDemand( &frame1_1C, frame_size, IPL_DEPTH_8U, 1 );
-		cvConvertImage(frame, frame1_1C);
-		allocateOnDemand( &frame1, frame_size, IPL_DEPTH_8U, 3 );
-		cvConvertImage(frame, frame1);
-
-		//Get frame from input video
-		frame = cvQueryFrame(input_video);
-	
-		//Check whether getting frame was succesfull
-		if(&frame == NULL)
-		{
-			QMessageBox::critical( this, "Drizzle", "Error: unable to load frame.", "Back" );
-			pStep->finalize( Message::Failure, "Error: unable to load frame." );
-			return false;
+		for (unsigned int i = 0; i < frames.size(); i++){
+			delete frames[i];
 		}
+		pStep->finalize(Message::Failure, failure);
+		pProgress->updateProgress(failure, 0, ERRORS);
+		return false;
+	}
 
-		//Copy current frame to gray scale and color IplImages (frame2)
-		allocateOnDemand( &frame2_1C, frame_size, IPL_DEPTH_8U, 1 );
-		cvConvertImage(frame, frame2_1C);
-		allocateOnDemand( &frame2, frame_size, IPL_DEPTH_8U, 3 );
-		cvConvertImage(frame, frame2);
-
-		//SURF DETECTION AND DESCRIPTION
-		std::vector< KeyPoint > frame1_features;
-		std::vector< KeyPoint >  frame2_features;
-
-		int minHessian = 600;
-		SurfFeatureDetector detector(minHessian);
-
-		detector.detect( frame1_1C, frame1_features );
-		detector.detect( frame2_1C, frame2_features );
-
-		SurfDescriptorExtractor extractor;
-
-		cv::Mat frame1_descriptors, frame2_descriptors;
-
-		extractor.compute(frame1_1C,frame1_features,frame1_descriptors);
-		extractor.compute(frame2_1C,frame2_features,frame2_descriptors);
-
-		FlannBasedMatcher matcher;
-		std::vector<DMatch> matches;
-
-		matcher.match(frame1_descriptors, frame2_descriptors, matches);
-
-		double max_dist = 0; double min_dist = 100;
-
-		for( int i = 0; i < frame1_descriptors.rows; i++ )
-		{ double dist = matches[i].distance;
-		if( dist < min_dist && dist != 0 ) min_dist = dist;
-		if( dist > max_dist ) max_dist = dist;
-		}
-
-		std::vector< DMatch > good_matches;
-
-		for( int i = 0; i < frame1_descriptors.rows; i++ )
-		{ 
-			//if( matches[i].distance < 100*min_dist )
-			{ 
-				good_matches.push_back( matches[i]); 
-			}
-		}
+	//Every output frame drizzles a window of frames, the output is written to disk instead of shown
+	DrizzleWindowJob* pWindowJob = new DrizzleWindowJob(frames, pNewProgress.release(), grid, window_size->value(), dropsize->text().toDouble(),
+		tuning.tileSize, tuning.kernel, windowOutput.toStdString(), framesPerSecond);
+	DrizzleJobManager::instance()->submit(pWindowJob, QFileInfo(Dir->text()).fileName() + " (sliding window)");
 
-		cv::Mat img_matches;
-		cv::Mat frame1_mat = cv::Mat(frame1);
-		drawMatches( frame1_mat,  frame1_features,cv::Mat(frame2), frame2_features, good_matches, img_matches, Scalar::all(-1), Scalar::all(-1), vector<char>(), DrawMatchesFlags::NOT_DRAW_SINGLE_POINTS );
+	pStep->finalize();
 
-		std::vector< Point2f > frame1_matches;
-		std::vector< Point2f > frame2_matches;
+	//The dialog is no longer needed, follow the job in the queue view
+	DrizzleQueue_GUI::showQueue();
+	this->accept();
+	return true;
+}
 
-		for( int i = 0; i < good_matches.size(); i++ )
+bool DrizzleVideo_GUI::waitForFrame(DrizzleVideoPipeline& pipeline, Progress* pProgress, DrizzleVideoFrame& frame, std::string& failure)
+{
+	unsigned int attempts = 0;
+	while (!pipeline.takeFrame(frame))
+	{
+		std::string text;
+		int percent = 0;
+		ReportingLevel level = NORMAL;
+		pProgress->getProgress(text, percent, level);
+		if (mAbortRequested || level == ABORT)
 		{
-			frame1_matches.push_back( frame1_features[ good_matches[i].queryIdx ].pt );
-			frame2_matches.push_back( frame2_features[ good_matches[i].trainIdx ].pt );
-		}
-
-		//Determine transformation matrix between matches
-		Mat H = findHomography( frame2_matches, frame1_matches, CV_RANSAC );
-
-		//Compensate for the difference between frame size and frame coordinates (width in pixel != width in coordinates)
-		H.at<double>(0,2)/=frame_size.width;
-		H.at<double>(1,2)/=frame_size.height;
-
-		// Get the corners from the previous frame
-		std::vector<Point2f> frame1_corners(4);
-		frame1_corners[0] = prev_frame_corners[0];
-		frame1_corners[1] = prev_frame_corners[1];
-		frame1_corners[2] = prev_frame_corners[2];
-		frame1_corners[3] = prev_frame_corners[3];
-
-		//Get the corners of the current frame via the transformation matrix determined by SURF
-		std::vector<Point2f> frame2_corners(4);
-		perspectiveTransform( frame1_corners, frame2_corners, H);
-
-		//Create new RasterElement for current frame
-		std::string name("temp_frame_" + std::to_string(static_cast<long long>(counter)));
-		ModelResource<RasterElement> pTempCube(RasterUtilities::createRasterElement(name, frame_size.height, frame_size.width, INT1UBYTE));
-		pFrameCube = pTempCube;
-
-		//Check whether RasterElement creation was succesfull
-		if (pFrameCube.get() == NULL){
-			std::string msg = "A raster cube could not be created.";
-			pProgress->updateProgress(msg, 0, WARNING);
-			pStep->finalize(Message::Failure, msg);
+			failure = "Drizzle aborted by user.";
 			return false;
 		}
-
-		//Get RasterDataDescriptor of current frame
-		pFrameDesc = static_cast<RasterDataDescriptor*>(pFrameCube->getDataDescriptor());
-
-		//Set corner coordinates of the current frame RasterElement
-		it = pNewGcpList.begin();
-		it->mPixel = *(new LocationType(0, 0));
-		it->mCoordinate = *(new LocationType(frame2_corners[0].x, frame2_corners[0].y));
-		std::advance(it, 1);
-		it->mPixel = *(new LocationType(0, frame_size.height));
-		it->mCoordinate = *(new LocationType(frame2_corners[1].x, frame2_corners[1].y));
-		std::advance(it, 1);
-		it->mPixel = *(new LocationType(frame_size.width, frame_size.height));
-		it->mCoordinate = *(new LocationType(frame2_corners[2].x, frame2_corners[2].y));
-		std::advance(it, 1);
-		it->mPixel = *(new LocationType(frame_size.width, 0));
-		it->mCoordinate = *(new LocationType(frame2_corners[3].x, frame2_corners[3].y));
-		newGCPList = static_cast<GcpList*>(pModel->createElement("Corner coordinates","GcpList",pFrameCube.get()));
-		newGCPList->addPoints(pNewGcpList);
-
-		//Get GeoreferenceDescriptor of current frame RasterElement
-		pFrameGeoDesc = pFrameDesc->getGeoreferenceDescriptor();
-		//Set GeoreferencePlugin to be used
-		pFrameGeoDesc->setGeoreferencePlugInName("GCP Georeference");
-
-		//Georeference the frame using the Georeference Plugin
-		if (!plugInName.empty()){
-		ExecutableResource geoPlugIn(plugInName);
-		PlugInArgList& argList = geoPlugIn->getInArgList();
-		argList.setPlugInArgValue(Executable::DataElementArg(), pFrameCube.get());
-		argList.setPlugInArgValue(Executable::ProgressArg(), pProgress.get());
-		argList.setPlugInArgValueLoose(Georeference::GcpListArg(), newGCPList);
-		argList.setPlugInArgValueLoose(Executable::ViewArg(), pView);
-			if (geoPlugIn->execute() == false)
-			{
-				std::string message = "Could not georeference the data set.";
-				pProgress->updateProgress(message, 0, WARNING);
-
-				pStep->addMessage(message, "app", "A8050A4B-824A-4E60-88E5-729367DEEAD0");
-			}
-			else
-			{
-				geoPlugIn.release();
-				pStep->finalize(Message::Success);
-			}
-		}
-		else
-		{
-			std::string message = "A georeference plug-in is not available to georeference the data set.";
-			pProgress->updateProgress(message, 0, WARNING);
-			pStep->addMessage(message, "app", "44E8D3C8-64C3-44DC-AB65-43F433D69DC8");
-		}
-		
-		//Get DataAccessor of the current frame RasterElement
-		FactoryResource<DataRequest> pFrameRequest;
-		pFrameAcc = pFrameCube->getDataAccessor(pFrameRequest.release());
-
-		//Set frame RasterElement to top left pixel.
-		pFrameAcc->toPixel(0,0);
-		//Copy IplImage to RasterElement
-		for (unsigned int row = 0; row < pFrameDesc->getRowCount(); ++row){ 
-			if (!pFrameAcc.isValid())
-			{
-				std::string msg = "Unable to access the cube data.";
-				pStep->finalize(Message::Failure, msg);
-				pProgress->updateProgress(msg, 0, ERRORS);
-				return false;
-			}
-
-			for (unsigned int col = 0; col < pFrameDesc->getColumnCount(); ++col)
-			{
-				switchOnEncoding(pFrameDesc->getDataType(), IplImagetoRaster, pFrameAcc->getColumn(), frame2_1C->imageData[row*frame2_1C->widthStep+col]);
-				
-				pFrameAcc->nextColumn();
-			}
-			pFrameAcc->nextRow();
-		}
-		//Add RasterElement and DataAccessor of current frame to vectors
-		rasters.push_back(pFrameCube);
-		accessors.push_back(pFrameAcc);
-
-		//Set previous frame corners for use by next frame
-		prev_frame_corners[0] = frame2_corners[0];
-		prev_frame_corners[1] = frame2_corners[1];
-		prev_frame_corners[2] = frame2_corners[2];
-		prev_frame_corners[3] = frame2_corners[3];
-
-		counter++;
-	}
-	double num_overlap_images;
-
-	//Get dropsize from GUI
-	double drop = dropsize->text().toDouble();
-
-	//Reset destination image to top left pixel.
-	pDestAcc->toPixel(0,0);
-	//Drizzle images onto destination image.
-	for (unsigned int row = 0; row < pDestDesc->getRowCount(); ++row){ 
-		pProgress->updateProgress("Calculating result", row * 100 / pDestDesc->getRowCount(), NORMAL);
-		if (!pDestAcc.isValid())
+		if (pipeline.getError(failure))
 		{
-			std::string msg = "Unable to access the cube data.";
-			pStep->finalize(Message::Failure, msg);
-			pProgress->updateProgress(msg, 0, ERRORS);
 			return false;
 		}
-
-		for (unsigned int col = 0; col < pDestDesc->getColumnCount(); ++col)
-		{
-			num_overlap_images=0.0;
-			for (int i=0; i<rasters.size();i++){
-				switchOnEncoding(pDestDesc->getDataType(), DrizzleVideo, pDestAcc->getColumn(), pDestAcc, accessors[i], row, col, pDestDesc->getRowCount(), pDestDesc->getColumnCount(), drop, &num_overlap_images);
-			}
-			pDestAcc->nextColumn();
-		}
-		pDestAcc->nextRow();
+		QApplication::processEvents();
+		DrizzleSpscQueue<DrizzleVideoFrame>::backoff(attempts);
 	}
-
-	//Release output RasterElement
-	pResultCube.release();
-
-	pStep->finalize();
-	pProgress->updateProgress("Done", 100, NORMAL);
-	this->accept();
 	return true;
-}
\ No newline at end of file
+}
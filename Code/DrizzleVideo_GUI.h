@@ -13,6 +13,7 @@
 #ifndef DrizzleVideo_GUI_H
 #define DrizzleVideo_GUI_H
 
+#include <Qt/qcheckbox.h>
 #include <Qt/qdialog.h>
 #include <Qt/qpushbutton.h>
 #include <Qt/qmessagebox.h>
@@ -20,7 +21,13 @@
 #include <Qt/qlabel.h>
 #include <Qt/qlineedit.h>
 #include <Qt/qlistwidget.h>
+#include <Qt/qspinbox.h>
 
+#include <string>
+
+class DrizzleVideoPipeline;
+class Progress;
+struct DrizzleVideoFrame;
 
 /**
 *
@@ -47,15 +54,21 @@ public:
 public slots:
 	/**
 	* Slot for closing the image GUI, connected to 'Cancel' button.
+	* Aborts the registration of the frames instead when it is running.
 	*/
 	void closeGUI();
 
+	/**
+	* Slot to abort the registration of the frames. Does nothing when no frames are being registered.
+	*/
+	void abortDrizzle();
+
 	/**
 	* Slot to perform the Drizzling. Performs necessary preliminary
-	* calculations for Drizzle function and calls it.
+	* calculations for Drizzle function and queues it in the DrizzleJobManager.
 	* Connected to 'Drizzle' button.
 	*
-	* @return True when Drizzling is successfull, false otherwise.
+	* @return True when Drizzling is queued successfully, false otherwise.
 	*/
 	bool PerformDrizzle();
 
@@ -70,6 +83,12 @@ public slots:
 	* displayed on the image GUI.
 	*/
 	void updateInfo();
+
+	/**
+	* Slot to compare the registration backends on the first frames of the input video.
+	* Connected to 'Benchmark' button.
+	*/
+	void benchmarkRegistration();
 private:
 	/**
 	* QLabel for video.
@@ -148,11 +167,67 @@ private:
 	*/
 	QLineEdit *num_images;
 
+	/**
+	* QLabel for the sigma clipping threshold.
+	*/
+	QLabel *sigma_clip_text;
+
+	/**
+	* QDoubleSpinBox to input the sigma clipping threshold in standard deviations, 0 when clipping is off.
+	*/
+	QDoubleSpinBox *sigma_clip;
+
+	/**
+	* QLabel for the sliding window.
+	*/
+	QLabel *window_size_text;
+
+	/**
+	* QSpinBox to input the number of frames drizzled onto every frame of a super-resolved video, 0 for a still image.
+	*/
+	QSpinBox *window_size;
+
+	/**
+	* QCheckBox to fit the output to all frames instead of the first frame, with an extra registration pass.
+	*/
+	QCheckBox *fit_output;
+
+	/**
+	* QLabel for the registration method.
+	*/
+	QLabel *features_text;
+
+	/**
+	* QComboBox to select how the frames are registered: SURF or ORB features, or phase correlation.
+	*/
+	QComboBox *features;
+
+	/**
+	* QLabel for the registration time limit.
+	*/
+	QLabel *time_limit_text;
+
+	/**
+	* QSpinBox to input the time limit of the registration of one frame in milliseconds, 0 for no limit.
+	*/
+	QSpinBox *time_limit;
+
+	/**
+	* QPushButton to benchmark the registration methods.
+	* Connects to benchmarkRegistration() SLOT.
+	*/
+	QPushButton *Benchmark;
+
 	/**
 	* QString containing path to input video.
 	*/
 	QString fileName;
 
+	/**
+	* True when the user aborted while the frames are being registered.
+	*/
+	bool mAbortRequested;
+
 	/**
 	* Initialisations needed for image GUI:
 	* Connects buttons to SLOTS.
@@ -160,5 +235,16 @@ private:
 	*/
 	void init();
 
+	/**
+	* Waits for the next registered frame of the pipeline, processing events so the user can abort.
+	*
+	* @param pipeline Pipeline registering the frames.
+	* @param pProgress Progress which can be cancelled by the user.
+	* @param frame Frame which will hold the next registered frame.
+	* @param failure String which will hold the error message on failure.
+	* @return True when a frame was taken, false when the user aborted or the pipeline failed.
+	*/
+	bool waitForFrame(DrizzleVideoPipeline& pipeline, Progress* pProgress, DrizzleVideoFrame& frame, std::string& failure);
+
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,338 @@
+/********************************************//*
+*
+* @file: DrizzleWindowJob.cpp
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#include "MessageLogResource.h"
+#include "Progress.h"
+#include "ProgressResource.h"
+#include "DrizzleFrame.h"
+#include "DrizzleJobManager.h"
+#include "DrizzleWindowJob.h"
+
+#include <Qt/qfileinfo.h>
+#include <Qt/qrunnable.h>
+#include <Qt/qstring.h>
+
+#include <algorithm>
+#include <math.h>
+#include <new>
+
+namespace
+{
+	/**
+	* Adds a value to a sum with Neumaier's compensated summation, the compensation holds the low-order bits lost by the sum.
+	*/
+	void addCompensated(double& sum, double& compensation, double value)
+	{
+		double total = sum + value;
+		if (fabs(sum) >= fabs(value))
+		{
+			compensation += (sum - total) + value;
+		}
+		else
+		{
+			compensation += (value - total) + sum;
+		}
+		sum = total;
+	}
+};
+
+/**
+* Task moving the window of one tile to the next output frame.
+*/
+class DrizzleWindowJob::TileTask : public QRunnable
+{
+public:
+	TileTask(DrizzleWindowJob* pJob, const DrizzleTile& tile, unsigned int output, cv::Mat* pBuffer) :
+		mpJob(pJob),
+		mTile(tile),
+		mOutput(output),
+		mpBuffer(pBuffer)
+	{
+	}
+
+	void run()
+	{
+		mpJob->drizzleOutput(mTile, mOutput, *mpBuffer);
+	}
+
+private:
+	DrizzleWindowJob* mpJob;
+	DrizzleTile mTile;
+	unsigned int mOutput;
+	cv::Mat* mpBuffer;
+};
+
+DrizzleWindowJob::DrizzleWindowJob(const std::vector<DrizzleFrame*>& frames, ProgressResource* pProgress, const DrizzleGrid& grid, unsigned int window,
+	double drop, unsigned int tileSize, DrizzleKernel kernel, const std::string& outputFile, double framesPerSecond) :
+	DrizzleJob(0, 0, grid.rows, grid.columns, std::max(std::max(grid.rows, grid.columns), 1u)),
+	mFrames(frames),
+	mpProgress(pProgress),
+	mGrid(grid),
+	mWindow(std::max(window, 1u)),
+	mDrop(drop),
+	mKernel(kernel),
+	mOutputFile(outputFile),
+	mFramesPerSecond(framesPerSecond > 0.0 ? framesPerSecond : 25.0),
+	mOutputTileSize(std::max(tileSize, 1u)),
+	mOutputsDone(0)
+{
+}
+
+DrizzleWindowJob::~DrizzleWindowJob()
+{
+	mPool.waitForDone();
+	delete mpProgress;
+	for (std::vector<DrizzleFrame*>::iterator it = mFrames.begin(); it != mFrames.end(); ++it){
+		delete *it;
+	}
+}
+
+unsigned int DrizzleWindowJob::getOutputCount() const
+{
+	return (mFrames.size() < mWindow) ? 0 : static_cast<unsigned int>(mFrames.size()) - mWindow + 1;
+}
+
+size_t DrizzleWindowJob::getMemoryEstimate() const
+{
+	//Running sums and weights with their compensations and counts of every output pixel, and the two 8-bit output frames
+	size_t pixels = static_cast<size_t>(mRowCount) * mColumnCount;
+	return pixels * (4 * sizeof(double) + sizeof(int) + 2);
+}
+
+bool DrizzleWindowJob::prepare(std::string& error)
+{
+	if (getOutputCount() == 0)
+	{
+		error = "The sliding window is longer than the video.";
+		return false;
+	}
+
+	mFootprints.clear();
+	for (std::vector<DrizzleFrame*>::iterator it = mFrames.begin(); it != mFrames.end(); ++it){
+		//Degenerate frames cover no pixels at all
+		DrizzleFootprint footprint;
+		if (!ImageDrizzleJob::getFootprint((*it)->grid, mGrid, footprint))
+		{
+			footprint.firstRow = footprint.firstColumn = 0;
+			footprint.lastRow = footprint.lastColumn = -1;
+		}
+		mFootprints.push_back(footprint);
+	}
+
+	mTiles.clear();
+	for (unsigned int row = 0; row < mGrid.rows; row += mOutputTileSize)
+	{
+		for (unsigned int col = 0; col < mGrid.columns; col += mOutputTileSize)
+		{
+			DrizzleTile tile;
+			tile.startRow = row;
+			tile.startColumn = col;
+			tile.rows = std::min(mOutputTileSize, mGrid.rows - row);
+			tile.columns = std::min(mOutputTileSize, mGrid.columns - col);
+			tile.part = 0;
+			mTiles.push_back(tile);
+		}
+	}
+
+	try
+	{
+		size_t pixels = static_cast<size_t>(mGrid.rows) * mGrid.columns;
+		mSums.assign(pixels, 0.0);
+		mCompensations.assign(pixels, 0.0);
+		mWeights.assign(pixels, 0.0);
+		mWeightCompensations.assign(pixels, 0.0);
+		mCounts.assign(pixels, 0);
+		for (int i = 0; i < 2; ++i)
+		{
+			mBuffers[i].create(mGrid.rows, mGrid.columns, CV_8UC1);
+		}
+	}
+	catch (std::bad_alloc&)
+	{
+		error = "Not enough memory to drizzle the output frames.";
+		return false;
+	}
+	catch (cv::Exception&)
+	{
+		error = "Not enough memory to drizzle the output frames.";
+		return false;
+	}
+
+	//The thread of the job writes the output frames, the tiles run on the rest of the thread budget
+	mPool.setMaxThreadCount(std::max(DrizzleJobManager::instance()->getThreadBudget() - 1, 1));
+	return true;
+}
+
+void DrizzleWindowJob::drizzleFrame(const DrizzleTile& tile, unsigned int frame, int sign)
+{
+	const DrizzleFootprint& footprint = mFootprints[frame];
+	unsigned int firstRow = static_cast<unsigned int>(std::max(footprint.firstRow, static_cast<int>(tile.startRow)));
+	unsigned int lastRow = static_cast<unsigned int>(std::max(std::min(footprint.lastRow + 1, static_cast<int>(tile.startRow + tile.rows)), static_cast<int>(firstRow)));
+	unsigned int firstColumn = static_cast<unsigned int>(std::max(footprint.firstColumn, static_cast<int>(tile.startColumn)));
+	unsigned int lastColumn = static_cast<unsigned int>(std::max(std::min(footprint.lastColumn + 1, static_cast<int>(tile.startColumn + tile.columns)), static_cast<int>(firstColumn)));
+	for (unsigned int row = firstRow; row < lastRow; ++row)
+	{
+		for (unsigned int col = firstColumn; col < lastColumn; ++col)
+		{
+			double sum = 0.0;
+			double weight = 0.0;
+			bool overlapped = false;
+			ImageDrizzleJob::drizzlePixel(*mFrames[frame], mGrid, row, col, mDrop, mKernel, sum, weight, overlapped);
+			if (!overlapped)
+			{
+				continue;
+			}
+
+			//The same contribution is subtracted when the frame leaves the window, but the running sum rounds
+			//differently by then, so it is compensated and starts again from zero whenever no frame overlaps
+			size_t pixel = static_cast<size_t>(row) * mGrid.columns + col;
+			addCompensated(mSums[pixel], mCompensations[pixel], sign * sum);
+			addCompensated(mWeights[pixel], mWeightCompensations[pixel], sign * weight);
+			mCounts[pixel] += sign;
+			if (mCounts[pixel] == 0)
+			{
+				mSums[pixel] = 0.0;
+				mCompensations[pixel] = 0.0;
+				mWeights[pixel] = 0.0;
+				mWeightCompensations[pixel] = 0.0;
+			}
+		}
+	}
+}
+
+void DrizzleWindowJob::drizzleOutput(const DrizzleTile& tile, unsigned int output, cv::Mat& buffer)
+{
+	//The first window is drizzled completely, afterwards one frame leaves and one frame enters
+	if (output > 0)
+	{
+		drizzleFrame(tile, output - 1, -1);
+	}
+	unsigned int first = (output == 0) ? 0 : output + mWindow - 1;
+	for (unsigned int frame = first; frame < output + mWindow; ++frame)
+	{
+		//Poll abort flag for every frame, an aborted output frame is never written
+		if (isAborted())
+		{
+			return;
+		}
+		drizzleFrame(tile, frame, 1);
+	}
+
+	//Divide by the sum of the weights, as the still image drizzle does
+	for (unsigned int row = tile.startRow; row < tile.startRow + tile.rows; ++row)
+	{
+		unsigned char* pLine = buffer.ptr<unsigned char>(row);
+		for (unsigned int col = tile.startColumn; col < tile.startColumn + tile.columns; ++col)
+		{
+			size_t pixel = static_cast<size_t>(row) * mGrid.columns + col;
+			double weight = mWeights[pixel] + mWeightCompensations[pixel];
+			double value = (mCounts[pixel] <= 0 || weight <= 0.0) ? 0.0 : (mSums[pixel] + mCompensations[pixel]) / weight;
+			pLine[col] = static_cast<unsigned char>(std::min(std::max(value + 0.5, 0.0), 255.0));
+		}
+	}
+}
+
+bool DrizzleWindowJob::writeOutput(unsigned int output, const cv::Mat& buffer, cv::VideoWriter& writer, std::string& error) const
+{
+	if (writer.isOpened())
+	{
+		writer << buffer;
+		return true;
+	}
+
+	QFileInfo info(QString::fromStdString(mOutputFile));
+	QString name = info.path() + "/" + info.completeBaseName() + "_" + QString("%1").arg(output, 5, 10, QChar('0')) + "." + info.suffix();
+	if (!cv::imwrite(name.toStdString(), buffer))
+	{
+		error = "Unable to write " + name.toStdString() + ".";
+		return false;
+	}
+	return true;
+}
+
+bool DrizzleWindowJob::processTile(const DrizzleTile& tile, std::string& error)
+{
+	//A video file when the output has the .avi extension, a numbered image sequence otherwise
+	cv::VideoWriter writer;
+	if (QFileInfo(QString::fromStdString(mOutputFile)).suffix().toLower() == "avi" &&
+		!writer.open(mOutputFile, CV_FOURCC('M','J','P','G'), mFramesPerSecond, cv::Size(mGrid.columns, mGrid.rows), false))
+	{
+		error = "Unable to create " + mOutputFile + ".";
+		return false;
+	}
+
+	//Output frames are drizzled in order, each one while the output frame before it is written.
+	//Tiles hold different pixels, so they update the running sums without locking
+	unsigned int outputs = getOutputCount();
+	for (unsigned int output = 0; output <= outputs; ++output)
+	{
+		if (output < outputs)
+		{
+			for (std::vector<DrizzleTile>::iterator it = mTiles.begin(); it != mTiles.end(); ++it){
+				mPool.start(new TileTask(this, *it, output, &mBuffers[output % 2]));
+			}
+		}
+		bool written = (output == 0) || writeOutput(output - 1, mBuffers[(output - 1) % 2], writer, error);
+		mPool.waitForDone();
+		if (!written || isAborted())
+		{
+			return false;
+		}
+		mOutputsDone = static_cast<int>(output);
+	}
+	return true;
+}
+
+bool DrizzleWindowJob::updateProgress(const std::string& message, int percent)
+{
+	if (mpProgress == NULL)
+	{
+		return true;
+	}
+
+	//The job has a single tile, progress is counted in output frames
+	unsigned int done = static_cast<unsigned int>(int(mOutputsDone));
+	unsigned int outputs = getOutputCount();
+	int outputPercent = (outputs == 0) ? 100 : static_cast<int>((static_cast<unsigned long long>(done) * 100) / outputs);
+	(*mpProgress)->updateProgress("Drizzling output frames: " + QString::number(done).toStdString() + " of " + QString::number(outputs).toStdString(),
+		outputPercent, NORMAL);
+
+	//Abort the job when the user cancelled the progress
+	return !isProgressAborted(mpProgress);
+}
+
+void DrizzleWindowJob::complete(bool success, const std::string& error)
+{
+	StepResource pStep("Drizzle video output", "app", "6A3C1E0B-5D4F-4B8A-9E27-0F6D3B2C8A51");
+	Progress* pProgress = (mpProgress == NULL) ? NULL : mpProgress->get();
+
+	if (success)
+	{
+		pStep->addProperty("Output", mOutputFile);
+		pStep->addProperty("Output frames", getOutputCount());
+		pStep->finalize();
+		if (pProgress != NULL)
+		{
+			pProgress->updateProgress("Done: " + QString::number(getOutputCount()).toStdString() + " frames written to " + mOutputFile, 100, NORMAL);
+		}
+	}
+	else
+	{
+		//The output frames written before the failure are kept
+		pStep->addProperty("Output frames written", static_cast<unsigned int>(int(mOutputsDone)));
+		pStep->finalize(Message::Failure, error);
+		if (pProgress != NULL)
+		{
+			pProgress->updateProgress(error, 0, ERRORS);
+		}
+	}
+}
@@ -0,0 +1,144 @@
+/********************************************//*
+*
+* @file: DrizzleWindowJob.h
+*
+* The information in this file is
+* Copyright(c) 2015 Tom Van den Eynde
+* and is subject to the terms and conditions of the
+* GNU Lesser General Public License Version 2.1
+* The license text is available from
+* http://www.gnu.org/licenses/lgpl.html
+***********************************************/
+
+#ifndef DrizzleWindowJob_H
+#define DrizzleWindowJob_H
+
+#include "DrizzleAccumulator.h"
+#include "DrizzleImageJob.h"
+#include "DrizzleJob.h"
+
+#include <Qt/qatomic.h>
+#include <Qt/qthreadpool.h>
+
+#include <string>
+#include <vector>
+
+#include <opencv2\opencv.hpp>
+
+class ProgressResource;
+struct DrizzleFrame;
+
+/**
+*
+* DrizzleJob which turns registered video frames into a super-resolved video: output frame k
+* drizzles the window of input frames k to k+N-1. Running sums are kept for every output pixel,
+* the incoming frame is added and the outgoing frame subtracted, so each output frame costs the drizzle
+* of two input frames whatever the window size. The job has a single tile: the output frames are produced
+* in order, the tiles of an output frame are drizzled in parallel while the output frame before it is
+* written to the video file (.avi) or to the next image of a numbered image sequence.
+*/
+class DrizzleWindowJob : public DrizzleJob
+{
+public:
+	/**
+	* Constructor for the sliding-window job.
+	*
+	* @param frames Registered input frames, the job takes ownership.
+	* @param pProgress Progress of the job, the job takes ownership. Can be NULL.
+	* @param grid Output grid.
+	* @param window Number of input frames drizzled onto every output frame.
+	* @param drop Dropsize (from 0 to 1).
+	* @param tileSize Width and height of the tiles of an output frame which are drizzled in parallel.
+	* @param kernel Kernel variant.
+	* @param outputFile Path of the output video (.avi) or of the first image of the output sequence.
+	* @param framesPerSecond Frame rate of the output video.
+	*/
+	DrizzleWindowJob(const std::vector<DrizzleFrame*>& frames, ProgressResource* pProgress, const DrizzleGrid& grid, unsigned int window,
+		double drop, unsigned int tileSize, DrizzleKernel kernel, const std::string& outputFile, double framesPerSecond);
+
+	/**
+	* Destructor for the sliding-window job.
+	*/
+	~DrizzleWindowJob();
+
+	/**
+	* @return Number of output frames.
+	*/
+	unsigned int getOutputCount() const;
+
+	size_t getMemoryEstimate() const;
+	bool prepare(std::string& error);
+	bool processTile(const DrizzleTile& tile, std::string& error);
+	bool updateProgress(const std::string& message, int percent);
+	void complete(bool success, const std::string& error);
+
+private:
+	class TileTask;
+	friend class TileTask;
+
+	/**
+	* Adds the contribution of an input frame to the running sums of the pixels of a tile, or subtracts it.
+	*
+	* @param tile Tile of the output grid.
+	* @param frame Number of the input frame.
+	* @param sign 1 to add the contribution, -1 to subtract it.
+	*/
+	void drizzleFrame(const DrizzleTile& tile, unsigned int frame, int sign);
+
+	/**
+	* Moves the window of a tile to an output frame and writes the normalised pixels of the tile.
+	*
+	* @param tile Tile of the output grid.
+	* @param output Number of the output frame, the window of the tile is at the output frame before it.
+	* @param buffer 8-bit image of the output frame.
+	*/
+	void drizzleOutput(const DrizzleTile& tile, unsigned int output, cv::Mat& buffer);
+
+	/**
+	* Writes an output frame to the video or to its image of the sequence.
+	*/
+	bool writeOutput(unsigned int output, const cv::Mat& buffer, cv::VideoWriter& writer, std::string& error) const;
+
+	std::vector<DrizzleFrame*> mFrames;
+	ProgressResource* mpProgress;
+	DrizzleGrid mGrid;
+	unsigned int mWindow;
+	double mDrop;
+	DrizzleKernel mKernel;
+	std::string mOutputFile;
+	double mFramesPerSecond;
+
+	unsigned int mOutputTileSize;
+
+	/**
+	* Footprints of the input frames.
+	*/
+	std::vector<DrizzleFootprint> mFootprints;
+
+	/**
+	* Tiles of an output frame, drizzled in parallel on the pool of the job.
+	*/
+	std::vector<DrizzleTile> mTiles;
+	QThreadPool mPool;
+
+	/**
+	* Running sums and weights of every output pixel with their compensation terms (Neumaier), and running numbers of overlapping frames.
+	*/
+	std::vector<double> mSums;
+	std::vector<double> mCompensations;
+	std::vector<double> mWeights;
+	std::vector<double> mWeightCompensations;
+	std::vector<int> mCounts;
+
+	/**
+	* Output frame being drizzled and output frame being written, used in turn.
+	*/
+	cv::Mat mBuffers[2];
+
+	/**
+	* Number of output frames written so far.
+	*/
+	QAtomicInt mOutputsDone;
+};
+
+#endif
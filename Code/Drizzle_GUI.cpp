@@ -10,6 +10,8 @@
 * http://www.gnu.org/licenses/lgpl.html
 ***********************************************/
 
+#include "AoiElement.h"
+#include "BitMask.h"
 #include "DataAccessor.h"
 #include "DataAccessorImpl.h"
 #include "DesktopServices.h"
@@ -26,6 +28,7 @@
 #include "SpatialDataView.h"
 #include "SpatialDataWindow.h"
 #include "StringUtilities.h"
+#include "TypeConverter.h"
 #include "PlugInArgList.h"
 #include "PlugInRegistration.h"
 #include "Statistics.h"
@@ -51,302 +54,23 @@
 #include "Progress.h"
 #include "StringUtilities.h"
 #include "drizzle_helper_functions.h"
+#include "DrizzleAccumulator.h"
+#include "DrizzleImageJob.h"
+#include "DrizzleJob.h"
+#include "DrizzleJobManager.h"
+#include "DrizzleQueue_GUI.h"
+#include "DrizzleSweepJob.h"
+#include "DrizzleTuner.h"
 
 #include <Qt/QInputDialog.h>
+#include <Qt/qfiledialog.h>
 #include <Qt/qgridlayout.h>
 #include <Qt/qapplication.h>
 #include <Qt/qmessagebox.h>
 
-namespace
-{
-	template<typename T>
-	/**
-	* Function which performs the drizzling for one pixel of the destination image.
-	*
-	* @param pData Typename T to be divided.
-	* @param pDestAcc DataAccessor to the destination RasterElement.
-	* @param pSrcAcc DataAccessor to the source RasterElement.
-	* @param row Current row of the destination RasterElement.
-	* @param col Current column of the destination RasterElement.
-	* @param rowSize height of the destination RasterElement.
-	* @param colSize width of the destination RasterElement.
-	* @param drop Percentage of width and height of pixel of the source images which is taken into account (from 0 to 1).
-	* @param overlapped Pointer to boolean indicating whether or not current pixel of destination RasterElement overlapped with the source RasterElement.
-	*/
-	void Drizzle(T* pData, DataAccessor pDestAcc, DataAccessor pSrcAcc, unsigned int row, unsigned int col, unsigned int rowSize, unsigned int colSize, double drop, bool* overlapped)
-	{
-		std::vector<LocationType> ipoints;	//initialise vector holding point of interest
-
-		LocationType *tllt = new LocationType(0,0);					//top left pixel of destination image
-		LocationType *bllt = new LocationType(0,rowSize);			//bottom left pixel of destination image
-		LocationType *brlt = new LocationType(colSize,rowSize);		//bottom right pixel of destination image
-		LocationType *trlt = new LocationType(colSize,0);			//top right pixel of destination image
-
-		LocationType desgeo1 = pDestAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*tllt);		//coordinates of top left pixel of destination image
-		LocationType desgeo2 = pDestAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*bllt);		//coordinates of bottom left pixel of destination image
-		LocationType desgeo3 = pDestAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*trlt);		//coordinates of bottom right pixel of destination image
-		LocationType desgeo4 = pDestAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*brlt);		//coordinates of top right pixel of destination image
-
-		double dtlx1 = desgeo1.mX;			//x coordinate of top left pixel of destination image
-		double dtly1 = desgeo1.mY;			//y coordinate of top left pixel of destination image
-		double dblx1 = desgeo2.mX;			//x coordinate of top right pixel of destination image
-		double dbly1 = desgeo2.mY;			//y coordinate of top right pixel of destination image
-		double dtrx1 = desgeo3.mX;			//x coordinate of bottom left pixel of destination image
-		double dtry1 = desgeo3.mY;			//y coordinate of bottom left pixel of destination image
-		double dbrx1 = desgeo4.mX;			//x coordinate of bottom right pixel of destination image
-		double dbry1 = desgeo4.mY;			//y coordinate of bottom right pixel of destination image
-
-		//Delete temporary Locationtypes
-		delete tllt;
-		delete bllt;
-		delete trlt;
-		delete brlt;
-
-		double ddtx1 = dtrx1 - dtlx1;		//difference in x coordinate over top of image
-		double ddty1 = dtry1 - dtly1;		//difference in y coordinate over top of image
-		double ddlx1 = dblx1 - dtlx1;		//difference in x coordinate over left side of image
-		double ddly1 = dbly1 - dtly1;		//difference in y coordinate over left side of image
-		double ddbx1 = dbrx1 - dblx1;		//difference in x coordinate over bottom of image
-		double ddby1 = dbry1 - dbly1;		//difference in y coordinate over bottom of image
-		double ddrx1 = dbrx1 - dtrx1;		//difference in x coordinate over right side of image
-		double ddry1 = dbry1 - dtry1;		//difference in y coordinate over right side of image
-
-		double dptlx1 = dtlx1 + ((((ddbx1-ddtx1)/rowSize)*double(row) + ddtx1)/double(colSize))*double(col) + ((((ddrx1-ddlx1)/colSize)*double(col) + ddlx1)/double(rowSize))*double(row);					//top left x coordinate of destination pixel
-		double dptly1 = dtly1 + ((((ddby1-ddty1)/rowSize)*double(row) + ddty1)/double(colSize))*double(col) + ((((ddry1-ddly1)/colSize)*double(col) + ddly1)/double(rowSize))*double(row);					//top left y coordinate of destination pixel
-		double dpblx1 = dtlx1 + ((((ddbx1-ddtx1)/rowSize)*double(row+1) + ddtx1)/double(colSize))*double(col) + ((((ddrx1-ddlx1)/colSize)*double(col) + ddlx1)/double(rowSize))*double(row+1);				//top right x coordinate of destination pixel
-		double dpbly1 = dtly1 + ((((ddby1-ddty1)/rowSize)*double(row+1) + ddty1)/double(colSize))*double(col) + ((((ddry1-ddly1)/colSize)*double(col) + ddly1)/double(rowSize))*double(row+1);				//top right y coordinate of destination pixel
-		double dptrx1 = dtlx1 + ((((ddbx1-ddtx1)/rowSize)*double(row) + ddtx1)/double(colSize))*double(col+1) + ((((ddrx1-ddlx1)/colSize)*double(col+1) + ddlx1)/double(rowSize))*double(row);				//bottom left x coordinate of destination pixel
-		double dptry1 = dtly1 + ((((ddby1-ddty1)/rowSize)*double(row) + ddty1)/double(colSize))*double(col+1) + ((((ddry1-ddly1)/colSize)*double(col+1) + ddly1)/double(rowSize))*double(row);				//bottom left y coordinate of destination pixel
-		double dpbrx1 = dtlx1 + ((((ddbx1-ddtx1)/rowSize)*double(row+1) + ddtx1)/double(colSize))*double(col+1) + ((((ddrx1-ddlx1)/colSize)*double(col+1) + ddlx1)/double(rowSize))*double(row+1);			//bottom right x coordinate of destination pixel
-		double dpbry1 = dtly1 + ((((ddby1-ddty1)/rowSize)*double(row+1) + ddty1)/double(colSize))*double(col+1) + ((((ddry1-ddly1)/colSize)*double(col+1) + ddly1)/double(rowSize))*double(row+1);			//bottom right y coordinate of destination pixel
-
-		//Equations of four lines (top, bottom, left, right) for one pixel: Y = MX + C
-		double dtm = (dptly1 - dptry1)/(dptlx1 - dptrx1);
-		double dtc = dptry1 - dtm*dptrx1;
-		double dbm = (dpbly1 - dpbry1)/(dpblx1 - dpbrx1);
-		double dbc = dpbry1 - dbm*dpbrx1;
-		double dlm = (dptly1 - dpbly1)/(dptlx1 - dpblx1);
-		double dlc = dpbly1 - dlm*dpblx1;
-		double drm = (dptry1 - dpbry1)/(dptrx1 - dpbrx1);
-		double drc = dpbry1 - drm*dpbrx1;
-
-		int srcrowSize = dynamic_cast<const RasterDataDescriptor*>(pSrcAcc->getAssociatedRasterElement()->getDataDescriptor())->getRows().size();		//height of source image
-		int srccolSize = dynamic_cast<const RasterDataDescriptor*>(pSrcAcc->getAssociatedRasterElement()->getDataDescriptor())->getColumns().size();	//width of source image
-
-		LocationType *tlsrclt = new LocationType(dptlx1,dptly1);		//top left pixel of source image
-		LocationType *blsrclt = new LocationType(dpblx1,dpbly1);		//bottom left pixel of source image
-		LocationType *trsrclt = new LocationType(dptrx1,dptry1);		//top right pixel of source image
-		LocationType *brsrclt = new LocationType(dpbrx1,dpbry1);		//bottom right pixel of source image
-
-		double tlsrccol = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*tlsrclt).mX) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*tlsrclt).mX : 0;		//top left x coordinate of destination pixel wrt source image
-		double tlsrcrow = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*tlsrclt).mY) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*tlsrclt).mY : 0;		//top left y coordinate of destination pixel wrt source image
-		double trsrccol = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*trsrclt).mX) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*trsrclt).mX : 0;		//top right x coordinate of destination pixel wrt source image
-		double trsrcrow = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*trsrclt).mY) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*trsrclt).mY : 0;		//top right y coordinate of destination pixel wrt source image
-		double brsrccol = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*brsrclt).mX) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*brsrclt).mX : 0;		//bottom right x coordinate of destination pixel wrt source image
-		double brsrcrow = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*brsrclt).mY) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*brsrclt).mY : 0;		//bottom right y coordinate of destination pixel wrt source image
-		double blsrccol = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*blsrclt).mX) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*blsrclt).mX : 0;		//bottom left x coordinate of destination pixel wrt source image
-		double blsrcrow = ((pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*blsrclt).mY) > 0) ? pSrcAcc->getAssociatedRasterElement()->convertGeocoordToPixel(*blsrclt).mY : 0;		//bottom left y coordinate of destination pixel wrt source image
-
-		//Delete temporary Locationtypes
-		delete tlsrclt;
-		delete blsrclt;
-		delete trsrclt;
-		delete brsrclt;
-
-		tlsrclt = new LocationType(0,0);					//top left pixel of source image
-		blsrclt = new LocationType(0,srcrowSize);			//bottom left pixel of source image
-		trsrclt = new LocationType(srccolSize,0);			//top right pixel of source image
-		brsrclt = new LocationType(srccolSize,srcrowSize);	//bottom right pixel of source image
-
-		LocationType geo1 = pSrcAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*tlsrclt);		//coordinates of top left pixel of source image
-		LocationType geo2 = pSrcAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*blsrclt);		//coordinates of bottom left pixel of source image
-		LocationType geo3 = pSrcAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*trsrclt);		//coordinates of top right pixel of source image
-		LocationType geo4 = pSrcAcc->getAssociatedRasterElement()->convertPixelToGeocoord(*brsrclt);		//coordinates of bottom right pixel of source image
-
-		//Delete temporary Locationtypes
-		delete tlsrclt;
-		delete blsrclt;
-		delete trsrclt;
-		delete brsrclt;
-
-		double tlx1 = geo1.mX;			//x coordinate of top left pixel of source image
-		double tly1 = geo1.mY;			//y coordinate of top left pixel of source image
-		double blx1 = geo2.mX;			//x coordinate of top right pixel of source image
-		double bly1 = geo2.mY;			//y coordinate of top right pixel of source image 
-		double trx1 = geo3.mX;			//x coordinate of bottom left pixel of source image 
-		double try1 = geo3.mY;			//y coordinate of bottom left pixel of source image 
-		double brx1 = geo4.mX;			//x coordinate of bottom right pixel of source image 
-		double bry1 = geo4.mY;			//y coordinate of bottom right pixel of source image 
-
-		double dtx1 = trx1 - tlx1;		//difference in x coordinate over top of source image 
-		double dty1 = try1 - tly1;		//difference in y coordinate over top of source image
-		double dlx1 = blx1 - tlx1;		//difference in x coordinate over left side of source image
-		double dly1 = bly1 - tly1;		//difference in y coordinate over left side of source image
-		double dbx1 = brx1 - blx1;		//difference in x coordinate over bottom of source image
-		double dby1 = bry1 - bly1;		//difference in y coordinate over bottom of source image
-		double drx1 = brx1 - trx1;		//difference in x coordinate over right side of source image
-		double dry1 = bry1 - try1;		//difference in y coordinate over right side of source image
-		
-		//Get upper and lower bounds on searchable area for pixels of the source image
-		int rtlsrccol = int(std::floor(tlsrccol));
-		int rtlsrcrow = int(std::floor(tlsrcrow));
-		int rtrsrccol = int(std::floor(trsrccol));
-		int rtrsrcrow = int(std::ceil(trsrcrow));
-		int rbrsrccol = int(std::ceil(brsrccol));
-		int rbrsrcrow = int(std::ceil(brsrcrow));
-		int rblsrccol = int(std::ceil(blsrccol));
-		int rblsrcrow = int(std::floor(blsrcrow));
-
-		for(int srcrow = std::min(std::min(rtlsrcrow,rtrsrcrow),std::min(rblsrcrow,rbrsrcrow)); srcrow <= std::max(std::max(rtlsrcrow,rtrsrcrow),std::max(rblsrcrow,rbrsrcrow)); srcrow++){
-			for(int srccol = std::min(std::min(rtlsrccol,rtrsrccol),std::min(rblsrccol,rbrsrccol)); srccol <= std::max(std::max(rtlsrccol,rtrsrccol),std::max(rblsrccol,rbrsrccol)); srccol++){
-				if(srccol < srccolSize && srcrow < srcrowSize){ 
-					ipoints.clear();		//Clear interest points vector
-
-					double ddrop = (1-drop)/2;
-
-					double ptlx1 = tlx1 + ((((dbx1-dtx1)/srcrowSize)*double(srcrow + ddrop) + dtx1)/double(srccolSize))*double(srccol + ddrop) + ((((drx1-dlx1)/srccolSize)*double(srccol + ddrop) + dlx1)/double(srcrowSize))*double(srcrow + ddrop);					//top left x coordinate of source pixel 
-					double ptly1 = tly1 + ((((dby1-dty1)/srcrowSize)*double(srcrow + ddrop) + dty1)/double(srccolSize))*double(srccol + ddrop) + ((((dry1-dly1)/srccolSize)*double(srccol + ddrop) + dly1)/double(srcrowSize))*double(srcrow + ddrop);					//top left y coordinate of source pixel
-					double pblx1 = tlx1 + ((((dbx1-dtx1)/srcrowSize)*double(srcrow+1 - ddrop) + dtx1)/double(srccolSize))*double(srccol + ddrop) + ((((drx1-dlx1)/srccolSize)*double(srccol + ddrop) + dlx1)/double(srcrowSize))*double(srcrow+1 - ddrop);				//top right x coordinate of source pixel
-					double pbly1 = tly1 + ((((dby1-dty1)/srcrowSize)*double(srcrow+1 - ddrop) + dty1)/double(srccolSize))*double(srccol + ddrop) + ((((dry1-dly1)/srccolSize)*double(srccol + ddrop) + dly1)/double(srcrowSize))*double(srcrow+1 - ddrop);				//top right y coordinate of source pixel
-					double ptrx1 = tlx1 + ((((dbx1-dtx1)/srcrowSize)*double(srcrow + ddrop) + dtx1)/double(srccolSize))*double(srccol+1 - ddrop) + ((((drx1-dlx1)/srccolSize)*double(srccol+1 - ddrop) + dlx1)/double(srcrowSize))*double(srcrow + ddrop);				//bottom left x coordinate of source pixel
-					double ptry1 = tly1 + ((((dby1-dty1)/srcrowSize)*double(srcrow + ddrop) + dty1)/double(srccolSize))*double(srccol+1 - ddrop) + ((((dry1-dly1)/srccolSize)*double(srccol+1 - ddrop) + dly1)/double(srcrowSize))*double(srcrow + ddrop);				//bottom left y coordinate of source pixel
-					double pbrx1 = tlx1 + ((((dbx1-dtx1)/srcrowSize)*double(srcrow+1 - ddrop) + dtx1)/double(srccolSize))*double(srccol+1 - ddrop) + ((((drx1-dlx1)/srccolSize)*double(srccol+1 - ddrop) + dlx1)/double(srcrowSize))*double(srcrow+1 - ddrop);			//bottom right x coordinate of source pixel
-					double pbry1 = tly1 + ((((dby1-dty1)/srcrowSize)*double(srcrow+1 - ddrop) + dty1)/double(srccolSize))*double(srccol+1 - ddrop) + ((((dry1-dly1)/srccolSize)*double(srccol+1 - ddrop) + dly1)/double(srcrowSize))*double(srcrow+1 - ddrop);			//bottom right y coordinate of source pixel
-
-					//Check whether input and output pixel can overlap
-					if((std::max(std::max(pbrx1,pblx1),std::max(ptrx1,ptlx1))>=std::min(std::min(dpbrx1,dpblx1),std::min(dptrx1,dptlx1)))
-						&& (std::min(std::min(pbrx1,pblx1),std::min(ptrx1,ptlx1))<=std::max(std::max(dpbrx1,dpblx1),std::max(dptrx1,dptlx1)))
-						&& (std::max(std::max(pbry1,pbly1),std::max(ptry1,ptly1))>=std::min(std::min(dpbry1,dpbly1),std::min(dptry1,dptly1)))
-						&& (std::min(std::min(pbry1,pbly1),std::min(ptry1,ptly1))<=std::max(std::max(dpbry1,dpbly1),std::max(dptry1,dptly1))))
-					{
-						//SUTHERLAND-HODGMAN POLYGON CLIPPING
-
-						//Use of geographical positions -> limited resolution of double
-						/*std::vector<LocationType> subject;
-						subject.push_back(*(new LocationType(ptlx1,ptly1)));
-						subject.push_back(*(new LocationType(pblx1,pbly1)));
-						subject.push_back(*(new LocationType(pbrx1,pbry1)));
-						subject.push_back(*(new LocationType(ptrx1,ptry1)));
-						std::vector<LocationType> clip;
-						clip.push_back(*(new LocationType(dptlx1,dptly1)));
-						clip.push_back(*(new LocationType(dpblx1,dpbly1)));
-						clip.push_back(*(new LocationType(dpbrx1,dpbry1)));
-						clip.push_back(*(new LocationType(dptrx1,dptry1)));*/
-
-						//Use relative positions wrt source image instead of geographical positions due to limited resolution of double.
-						std::vector<LocationType> subject;
-
-						LocationType *tlsubjectlt = new LocationType(srccol + ddrop,srcrow + ddrop);
-						LocationType *blsubjectlt = new LocationType(srccol + ddrop,srcrow+1 - ddrop);
-						LocationType *brsubjectlt = new LocationType(srccol+1 - ddrop,srcrow+1  - ddrop);
-						LocationType *trsubjectlt = new LocationType(srccol+1 - ddrop,srcrow + ddrop);
-
-						subject.push_back(*tlsubjectlt);
-						subject.push_back(*blsubjectlt);
-						subject.push_back(*brsubjectlt);
-						subject.push_back(*trsubjectlt);
-
-						std::vector<LocationType> clip;
-
-						LocationType *tlcliplt = new LocationType(tlsrccol,tlsrcrow);
-						LocationType *blcliplt = new LocationType(blsrccol,blsrcrow);
-						LocationType *brcliplt = new LocationType(brsrccol,brsrcrow);
-						LocationType *trcliplt = new LocationType(trsrccol,trsrcrow);
-
-						clip.push_back(*tlcliplt);
-						clip.push_back(*blcliplt);
-						clip.push_back(*brcliplt);
-						clip.push_back(*trcliplt);
-						
-						std::vector<LocationType> p1;
-						std::vector<LocationType> tmp;
-
-						int dir = int(drizzle_helper_functions::left_of(clip[0], clip[1], clip[2]));
-						
-						drizzle_helper_functions::poly_edge_clip(subject, clip[clip.size()-1], clip[0], dir, &ipoints);
-
-						for (int i = 0; i < clip.size()-1; i++) {
-							tmp = ipoints; 
-							ipoints = p1; 
-							p1 = tmp;
-
-							if(p1.size() == 0) {
-								ipoints.clear();
-								break;
-							}
-							drizzle_helper_functions::poly_edge_clip(p1, clip[i], clip[i+1], dir, &ipoints);
-						}
-
-						p1.clear();
-						tmp.clear();
-
-						if(ipoints.size() > 0){
-							//CALCULATION OF AREA OF OVERLAP
-							double s1 = 0;
-							double s2 = 0;
-							double area = 0;
-							for (unsigned int i = 0; i < ipoints.size(); i++){
-								s1 += ipoints.at(i).mY*ipoints.at((i+1)%ipoints.size()).mX;
-								s2 += ipoints.at(i).mX*ipoints.at((i+1)%ipoints.size()).mY;
-							}
-
-							area = (s1-s2)/2.0;
-
-							//Total area for geographical coordinate
-							//double totalarea = (((ptly1*pblx1)+(pbly1*pbrx1)+(pbry1*ptrx1)+(ptry1*ptlx1))-((ptlx1*pbly1)+(pblx1*pbry1)+(pbrx1*ptry1)+(ptrx1*ptly1)))/2;
-
-							//Total area for relative coordinate
-							//double totalarea = (((tlsrcrow*blsrcrow)+(blsrcrow*brsrccol)+(brsrcrow*trsrccol)+(trsrcrow*tlsrccol))-((tlsrccol*blsrcrow)+(blsrccol*brsrcrow)+(brsrccol*trsrcrow)+(trsrccol*tlsrcrow)))/2;
-
-							//Get source pixel value
-							pSrcAcc->toPixel(srcrow, srccol);
-							VERIFYNRV(pSrcAcc.isValid());
-							T srcpixel = *reinterpret_cast<T*>(pSrcAcc->getColumn());
-
-							//Add weighted source pixel to destination pixel
-							*pData += static_cast<T>(area*srcpixel);
-
-							//Set overlapped true to be able to determine the number of overlapping images for each destination pixel
-							*overlapped=true;
-
-							//Delete remainder of Locationtypes
-							delete tlsubjectlt;
-							delete blsubjectlt;
-							delete trsubjectlt;
-							delete brsubjectlt;
-							delete tlcliplt;
-							delete blcliplt;
-							delete trcliplt;
-							delete brcliplt;
-
-							//ipoints.clear();
-							//clip.clear();
-							//subject.clear();
-							//p1.clear();
-							//tmp.clear();
-						}
-					}
-				}
-			}
-		}
-		//ipoints.clear();
-	}
-};
-
-namespace
-{
-template<typename T>
-	/**
-	* Function to divide a pixel value of a rasterelement by a given integer.
-	*
-	* @param pData Typename T to be divided.
-	* @param num_overlap_images Integer to be divided with.
-	*/
-	void Divide(T* pData, int num_overlap_images)
-	{
-		*pData = static_cast<T>(*pData/num_overlap_images);
-	}
-};
+#include <algorithm>
+#include <cmath>
+#include <memory>
 
 Drizzle_GUI::Drizzle_GUI(QWidget* Parent): QDialog(Parent)
 {
@@ -378,6 +102,89 @@ Drizzle_GUI::Drizzle_GUI(QWidget* Parent): QDialog(Parent)
 	y_out = new QLineEdit(this);
 	dropsize = new QLineEdit(this);
 
+	Distributed = new QGroupBox("Distributed drizzle", this);
+	IncludeBase = new QCheckBox("Drizzle base image", Distributed);
+	IncludeBase->setChecked(true);
+	shard_index = new QSpinBox(Distributed);
+	shard_index->setRange(0, 0);
+	shard_count = new QSpinBox(Distributed);
+	shard_count->setRange(1, 1024);
+	partial_file = new QLineEdit(Distributed);
+	BrowsePartial = new QPushButton("Browse", Distributed);
+
+	QGridLayout* pDistributedLayout = new QGridLayout(Distributed);
+	pDistributedLayout->addWidget(IncludeBase, 0, 0, 1, 4);
+	pDistributedLayout->addWidget(new QLabel("Row band", Distributed), 1, 0);
+	pDistributedLayout->addWidget(shard_index, 1, 1);
+	pDistributedLayout->addWidget(new QLabel("of", Distributed), 1, 2);
+	pDistributedLayout->addWidget(shard_count, 1, 3);
+	pDistributedLayout->addWidget(new QLabel("Partial result file", Distributed), 2, 0);
+	pDistributedLayout->addWidget(partial_file, 2, 1, 1, 2);
+	pDistributedLayout->addWidget(BrowsePartial, 2, 3);
+
+	Performance = new QGroupBox("Performance", this);
+	tile_size = new QSpinBox(Performance);
+	tile_size->setRange(0, 1024);
+	tile_size->setSpecialValueText("Calibrated");
+	kernel = new QComboBox(Performance);
+	kernel->addItem("Calibrated");
+	kernel->addItem("Clip");
+	kernel->addItem("Separable");
+	Preview = new QCheckBox("Progressive preview", Performance);
+	sweep = new QLineEdit(Performance);
+	sweep->setToolTip("Extra parameter sets drizzled in the same pass: dropsize width height; ...");
+	sigma_clip = new QDoubleSpinBox(Performance);
+	sigma_clip->setRange(0.0, 10.0);
+	sigma_clip->setSingleStep(0.5);
+	sigma_clip->setSpecialValueText("Off");
+	sigma_clip->setToolTip("Rejects contributions further than this many standard deviations from the mean, at twice the drizzle time");
+
+	QGridLayout* pPerformanceLayout = new QGridLayout(Performance);
+	pPerformanceLayout->addWidget(new QLabel("Tile size", Performance), 0, 0);
+	pPerformanceLayout->addWidget(tile_size, 0, 1);
+	pPerformanceLayout->addWidget(new QLabel("Kernel", Performance), 1, 0);
+	pPerformanceLayout->addWidget(kernel, 1, 1);
+	pPerformanceLayout->addWidget(Preview, 2, 0, 1, 2);
+	pPerformanceLayout->addWidget(new QLabel("Sweep", Performance), 3, 0);
+	pPerformanceLayout->addWidget(sweep, 3, 1);
+	pPerformanceLayout->addWidget(new QLabel("Sigma clip", Performance), 4, 0);
+	pPerformanceLayout->addWidget(sigma_clip, 4, 1);
+
+	Region = new QGroupBox("Region", this);
+	region = new QComboBox(Region);
+	roi_row = new QSpinBox(Region);
+	roi_column = new QSpinBox(Region);
+	roi_rows = new QSpinBox(Region);
+	roi_rows->setMinimum(1);
+	roi_columns = new QSpinBox(Region);
+	roi_columns->setMinimum(1);
+
+	QGridLayout* pRegionLayout = new QGridLayout(Region);
+	pRegionLayout->addWidget(new QLabel("Output covers", Region), 0, 0);
+	pRegionLayout->addWidget(region, 0, 1, 1, 3);
+	pRegionLayout->addWidget(new QLabel("First row", Region), 1, 0);
+	pRegionLayout->addWidget(roi_row, 1, 1);
+	pRegionLayout->addWidget(new QLabel("First column", Region), 1, 2);
+	pRegionLayout->addWidget(roi_column, 1, 3);
+	pRegionLayout->addWidget(new QLabel("Rows", Region), 2, 0);
+	pRegionLayout->addWidget(roi_rows, 2, 1);
+	pRegionLayout->addWidget(new QLabel("Columns", Region), 2, 2);
+	pRegionLayout->addWidget(roi_columns, 2, 3);
+
+	Outputs = new QGroupBox("Extra outputs", this);
+	WeightOutput = new QCheckBox("Weight map", Outputs);
+	CountOutput = new QCheckBox("Contributing input count", Outputs);
+	KeepState = new QCheckBox("Keep accumulation state", Outputs);
+	AddToResult = new QCheckBox("Add inputs to base image (earlier result)", Outputs);
+	GeometryOutput = new QCheckBox("Drizzle geometry (operator file)", Outputs);
+
+	QGridLayout* pOutputsLayout = new QGridLayout(Outputs);
+	pOutputsLayout->addWidget(WeightOutput, 0, 0);
+	pOutputsLayout->addWidget(CountOutput, 0, 1);
+	pOutputsLayout->addWidget(KeepState, 1, 0);
+	pOutputsLayout->addWidget(AddToResult, 1, 1);
+	pOutputsLayout->addWidget(GeometryOutput, 2, 0);
+
 	//LAYOUT
 	QGridLayout* pLayout = new QGridLayout(this);
 
@@ -398,8 +205,13 @@ Drizzle_GUI::Drizzle_GUI(QWidget* Parent): QDialog(Parent)
 	pLayout->addWidget( y_out,5,1);
 	pLayout->addWidget( dropsize,5,2);
 
-	pLayout->addWidget(Cancel, 6, 4,1,3);
-	pLayout->addWidget(Apply, 6, 0,1,3);
+	pLayout->addWidget( Distributed, 6, 0, 1, 4);
+	pLayout->addWidget( Performance, 6, 4, 1, 3);
+	pLayout->addWidget( Region, 7, 0, 1, 7);
+	pLayout->addWidget( Outputs, 8, 0, 1, 7);
+
+	pLayout->addWidget(Cancel, 9, 4,1,3);
+	pLayout->addWidget(Apply, 9, 0,1,3);
 
 	//Call init() for the necessary initialisations
 	init();
@@ -407,16 +219,17 @@ Drizzle_GUI::Drizzle_GUI(QWidget* Parent): QDialog(Parent)
 
 Drizzle_GUI::~Drizzle_GUI()
 {
-
 }
 
 void Drizzle_GUI::init(){
 	
 	//Initialize buttons
-	connect(Cancel, SIGNAL(clicked()), this, SLOT(reject()));
+	connect(Cancel, SIGNAL(clicked()), this, SLOT(closeGUI()));
 	connect(Apply, SIGNAL(clicked()), this, SLOT(PerformDrizzle()));
 	connect(Rasterlist1, SIGNAL(currentIndexChanged(int)), this, SLOT(updateInfo1()));
 	connect(Rasterlist2, SIGNAL(currentRowChanged(int)), this, SLOT(updateInfo2()));
+	connect(BrowsePartial, SIGNAL(clicked()), this, SLOT(browsePartial()));
+	connect(region, SIGNAL(currentIndexChanged(int)), this, SLOT(updateRegion()));
 
 	//Get RasterElements
 	Service<ModelServices> Model;
@@ -447,6 +260,12 @@ void Drizzle_GUI::init(){
 	const std::vector<DimensionDescriptor>& Columns = Des1->getColumns();
 	Size1->setText("Size:\t"+ QString::number(Columns.size()) + "x" + QString::number(Rows.size()));
 
+	//Inputs can only be added to an earlier result which kept its accumulation state
+	AddToResult->setEnabled(!ImageDrizzleJob::getStateFile(dynamic_cast<RasterElement*>(Model->getElement(RasterElements.at(0),"",NULL))).empty());
+
+	//Initialise regions of image 1
+	updateRegions();
+
 	//Fix size of GUI
 	this->layout()->setSizeConstraint( QLayout::SetFixedSize );
 }
@@ -458,6 +277,14 @@ void Drizzle_GUI::updateInfo1(){
 	const std::vector<DimensionDescriptor>& Rows = Des->getRows();
 	const std::vector<DimensionDescriptor>& Columns = Des->getColumns();
 	Size1->setText("Size:\t"+ QString::number(Columns.size()) + "x" + QString::number(Rows.size()));
+	//Check for a kept accumulation state
+	AddToResult->setEnabled(!ImageDrizzleJob::getStateFile(dynamic_cast<RasterElement*>(Model->getElement(RasterElements.at(Rasterlist1->currentIndex()),"",NULL))).empty());
+	if (!AddToResult->isEnabled())
+	{
+		AddToResult->setChecked(false);
+	}
+	//Get regions
+	updateRegions();
 	//Get geo information
 	FactoryResource<DataRequest> pRequest;
 	DataAccessor pSrcAcc = dynamic_cast<RasterElement*>(Model->getElement(RasterElements.at(Rasterlist1->currentIndex()),"",NULL ))->getDataAccessor(pRequest.release());
@@ -487,6 +314,96 @@ void Drizzle_GUI::updateInfo2(){
 		"\n\t(" + QString::number(geo2.mX) + "," + QString::number(geo2.mY) + "," + QString::number(geo2.mZ)+")\t(" + QString::number(geo4.mX) + "," + QString::number(geo4.mY) + "," + QString::number(geo4.mZ)+")");
 }
 
+void Drizzle_GUI::updateRegion(){
+	//The pixel window is only used when it is selected
+	bool window = (region->currentIndex() == 1);
+	roi_row->setEnabled(window);
+	roi_column->setEnabled(window);
+	roi_rows->setEnabled(window);
+	roi_columns->setEnabled(window);
+}
+
+void Drizzle_GUI::updateRegions(){
+	Service<ModelServices> Model;
+	RasterElement* pImage = dynamic_cast<RasterElement*>(Model->getElement(RasterElements.at(Rasterlist1->currentIndex()),"",NULL));
+	const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(pImage->getDataDescriptor());
+
+	//Pixel window within the base image
+	roi_row->setRange(0, pDesc->getRowCount() - 1);
+	roi_column->setRange(0, pDesc->getColumnCount() - 1);
+	roi_rows->setRange(1, pDesc->getRowCount());
+	roi_columns->setRange(1, pDesc->getColumnCount());
+
+	//AOIs of the base image
+	region->clear();
+	region->addItem("Whole base image");
+	region->addItem("Pixel window");
+	std::vector<DataElement*> aois = Model->getElements(pImage, TypeConverter::toString<AoiElement>());
+	for (std::vector<DataElement*>::iterator it = aois.begin(); it != aois.end(); ++it)
+	{
+		region->addItem(QString::fromStdString((*it)->getName()));
+	}
+	updateRegion();
+}
+
+bool Drizzle_GUI::getRegion(RasterElement* pImage, unsigned int& firstRow, unsigned int& firstColumn, unsigned int& rows, unsigned int& columns, std::string& error){
+	const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(pImage->getDataDescriptor());
+	unsigned int imageRows = pDesc->getRowCount();
+	unsigned int imageColumns = pDesc->getColumnCount();
+	firstRow = 0;
+	firstColumn = 0;
+	rows = imageRows;
+	columns = imageColumns;
+
+	if (region->currentIndex() == 1)
+	{
+		firstRow = roi_row->value();
+		firstColumn = roi_column->value();
+		rows = roi_rows->value();
+		columns = roi_columns->value();
+	}
+	else if (region->currentIndex() > 1)
+	{
+		//Bounding box of the selected pixels of the AOI
+		AoiElement* pAoi = dynamic_cast<AoiElement*>(Service<ModelServices>()->getElement(region->currentText().toStdString(), TypeConverter::toString<AoiElement>(), pImage));
+		const BitMask* pMask = (pAoi == NULL) ? NULL : pAoi->getSelectedPoints();
+		if (pMask == NULL || pMask->getCount() == 0)
+		{
+			error = "The AOI does not select any pixels.";
+			return false;
+		}
+		if (!pMask->isOutsideSelected())
+		{
+			int x1 = 0;
+			int y1 = 0;
+			int x2 = 0;
+			int y2 = 0;
+			pMask->getBoundingBox(x1, y1, x2, y2);
+			int lastRow = std::min(std::max(y1, y2), static_cast<int>(imageRows) - 1);
+			int lastColumn = std::min(std::max(x1, x2), static_cast<int>(imageColumns) - 1);
+			firstRow = static_cast<unsigned int>(std::max(std::min(y1, y2), 0));
+			firstColumn = static_cast<unsigned int>(std::max(std::min(x1, x2), 0));
+			rows = (lastRow < static_cast<int>(firstRow)) ? 0 : lastRow - firstRow + 1;
+			columns = (lastColumn < static_cast<int>(firstColumn)) ? 0 : lastColumn - firstColumn + 1;
+		}
+	}
+
+	if (rows == 0 || columns == 0 || firstRow + rows > imageRows || firstColumn + columns > imageColumns)
+	{
+		error = "The region must lie within the base image.";
+		return false;
+	}
+	return true;
+}
+
+void Drizzle_GUI::browsePartial(){
+	QString filename = QFileDialog::getSaveFileName(this, "Partial result file", partial_file->text(), "Drizzle partial results (*.drzp)");
+	if (!filename.isEmpty())
+	{
+		partial_file->setText(filename);
+	}
+}
+
 void Drizzle_GUI::closeGUI(){
 	this->reject();
 }
@@ -494,7 +411,8 @@ void Drizzle_GUI::closeGUI(){
 bool Drizzle_GUI::PerformDrizzle(){
 	Service<ModelServices> pModel;
 	StepResource pStep("Drizzle", "app", "4539C009-F756-41A4-A94D-9867C0FF3B87");
-	ProgressResource pProgress("ProgressBar");
+	std::auto_ptr<ProgressResource> pNewProgress(new ProgressResource("ProgressBar"));
+	ProgressResource& pProgress = *pNewProgress;
 
 	//Get base RasterElement from the ComboBox
 	RasterElement *image1 =  dynamic_cast<RasterElement*>(pModel->getElement(RasterElements.at(Rasterlist1->currentIndex()),"",NULL ));
@@ -514,8 +432,8 @@ bool Drizzle_GUI::PerformDrizzle(){
 		}
 	}
 
-	//Check image import
-	if (image1 == NULL || images.size() == 0)
+	//Check image import, the base image only counts as input when it is drizzled as well
+	if (image1 == NULL || (images.size() == 0 && !IncludeBase->isChecked()))
 	{				
 		pProgress->updateProgress("Image import failed", 100, ERRORS);
 		return false;	
@@ -552,19 +470,8 @@ bool Drizzle_GUI::PerformDrizzle(){
 			pDesc.push_back(static_cast<RasterDataDescriptor*>((*it)->getDataDescriptor()));
 		}
 	}
-	//Get DataAccessor of base image
-	FactoryResource<DataRequest> pRequest1;
-	DataAccessor pSrcAcc1 = image1->getDataAccessor(pRequest1.release());
-	std::vector<DataAccessor> pSrcAcc;
-	
-	//Get DataAccessors of other input images
-	for (std::vector<RasterElement*>::iterator it = images.begin(); it != images.end(); ++it){
-		FactoryResource<DataRequest> pRequest;
-		pSrcAcc.push_back((*it)->getDataAccessor(pRequest.release()));
-	}
-
-	//Check whether output width and height are filled in
-	if(x_out->text().isNull() || y_out->text().isNull() || x_out->text().isEmpty() || y_out->text().isEmpty())
+	//Check whether output width and height are filled in, inputs added to an earlier result keep its size
+	if(!AddToResult->isChecked() && (x_out->text().isNull() || y_out->text().isNull() || x_out->text().isEmpty() || y_out->text().isEmpty()))
 	{
 		pProgress->updateProgress("No output size specified.", 100, ERRORS);
 		return false;
@@ -577,8 +484,87 @@ bool Drizzle_GUI::PerformDrizzle(){
 		return false;
 	}
 
+	//Extra parameter sets of a sweep
+	std::vector<double> sweepDrops;
+	std::vector<unsigned int> sweepColumns;
+	std::vector<unsigned int> sweepRows;
+	QStringList sweepSets = sweep->text().split(';', QString::SkipEmptyParts);
+	for (QStringList::iterator it = sweepSets.begin(); it != sweepSets.end(); ++it)
+	{
+		QStringList values = it->split(' ', QString::SkipEmptyParts);
+		bool validDrop = false;
+		bool validColumns = false;
+		bool validRows = false;
+		if (values.size() == 3)
+		{
+			sweepDrops.push_back(values[0].toDouble(&validDrop));
+			sweepColumns.push_back(values[1].toUInt(&validColumns));
+			sweepRows.push_back(values[2].toUInt(&validRows));
+		}
+		if (!validDrop || !validColumns || !validRows || sweepDrops.back() < 0 || sweepDrops.back() > 1 || sweepColumns.back() == 0 || sweepRows.back() == 0)
+		{
+			pProgress->updateProgress("Sweep parameter sets must be given as \"dropsize width height\", separated by semicolons.", 100, ERRORS);
+			return false;
+		}
+	}
+	if (!sweepDrops.empty() && AddToResult->isChecked())
+	{
+		pProgress->updateProgress("A sweep cannot add inputs to an earlier result.", 100, ERRORS);
+		return false;
+	}
+	if (!sweepDrops.empty() && (Preview->isChecked() || WeightOutput->isChecked() || CountOutput->isChecked() || GeometryOutput->isChecked()))
+	{
+		pProgress->updateProgress("A sweep cannot show a preview or write weight, count or geometry outputs.", 100, ERRORS);
+		return false;
+	}
+
+	//Only the new inputs are drizzled onto the accumulation state of the earlier result
+	if (AddToResult->isChecked())
+	{
+		std::string stateFile = ImageDrizzleJob::getStateFile(image1);
+		if (stateFile.empty() || images.empty())
+		{
+			pProgress->updateProgress("Select the inputs to add to a result with a kept accumulation state.", 100, ERRORS);
+			return false;
+		}
+
+		//The stored grid is checked against the earlier result when the state is loaded
+		DrizzleGrid grid = DrizzleJobManager::instance()->getInputGrid(image1);
+		DrizzleTuning tuning = DrizzleTuner::getTuning();
+		ImageDrizzleJob* pJob = new ImageDrizzleJob(image1, NULL, pNewProgress.release(), grid, 0, grid.rows,
+			images, dropsize->text().toDouble(), stateFile, tuning.tileSize, tuning.kernel);
+		pJob->setInitialState(stateFile);
+		pJob->setCheckpoint(ImageDrizzleJob::getScratchFile(image1->getName(), ".drzc"));
+		DrizzleJobManager::instance()->submit(pJob, QString::fromStdString(image1->getName() + " (added inputs)"));
+
+		pStep->finalize();
+		DrizzleQueue_GUI::showQueue();
+		this->accept();
+		return true;
+	}
+
+	//Region of the base image covered by the output image
+	unsigned int regionRow = 0;
+	unsigned int regionColumn = 0;
+	unsigned int regionRows = 0;
+	unsigned int regionColumns = 0;
+	std::string regionError;
+	if (!getRegion(image1, regionRow, regionColumn, regionRows, regionColumns, regionError))
+	{
+		pProgress->updateProgress(regionError, 100, ERRORS);
+		return false;
+	}
+
+	//Window of the full output grid corresponding to the region, only this window is drizzled
+	double scaleX = x_out->text().toDouble() / pDesc1->getColumnCount();
+	double scaleY = y_out->text().toDouble() / pDesc1->getRowCount();
+	unsigned int outRow = static_cast<unsigned int>(std::floor(regionRow * scaleY));
+	unsigned int outColumn = static_cast<unsigned int>(std::floor(regionColumn * scaleX));
+	unsigned int outRows = std::max(static_cast<unsigned int>(std::ceil((regionRow + regionRows) * scaleY)), outRow + 1) - outRow;
+	unsigned int outColumns = std::max(static_cast<unsigned int>(std::ceil((regionColumn + regionColumns) * scaleX)), outColumn + 1) - outColumn;
+
 	//Create the output RasterElement
-	ModelResource<RasterElement> pResultCube(RasterUtilities::createRasterElement(image1->getName() + "_Drizzled", y_out->text().toDouble(), x_out->text().toDouble(), pDesc1->getDataType()));
+	ModelResource<RasterElement> pResultCube(RasterUtilities::createRasterElement(image1->getName() + "_Drizzled", outRows, outColumns, pDesc1->getDataType()));
 
 	//Check whether creation of new RasterElement succeeded
 	if (pResultCube.get() == NULL){
@@ -587,16 +573,13 @@ bool Drizzle_GUI::PerformDrizzle(){
 		return false;
 	}
 
-	//Get DataAccessor and RasterDataDescriptor of output RasterElement
-	FactoryResource<DataRequest> pResultRequest;
-	pResultRequest->setWritable(true);
-	DataAccessor pDestAcc = pResultCube->getDataAccessor(pResultRequest.release());
+	//Get RasterDataDescriptor of output RasterElement
 	RasterDataDescriptor* pDestDesc = static_cast<RasterDataDescriptor*>(pResultCube->getDataDescriptor());
 
 	//Get GCPs of input image via GUI
 	GcpList * GCPs = NULL;
 
-	std::vector<DataElement*> pGcpLists = pModel->getElements(pSrcAcc1->getAssociatedRasterElement(), TypeConverter::toString<GcpList>());
+	std::vector<DataElement*> pGcpLists = pModel->getElements(image1, TypeConverter::toString<GcpList>());
 
 	if (!pGcpLists.empty())
 	{
@@ -637,13 +620,13 @@ bool Drizzle_GUI::PerformDrizzle(){
 		}
 	}
 
-	//Compensation of GCPs for increase in resolution of output image 
+	//Compensation of GCPs for increase in resolution of output image and the offset of the region
 	std::list<GcpPoint> pNewGcpList = GCPs->getSelectedPoints();
 
 	for (std::list<GcpPoint>::iterator it = (pNewGcpList.begin()); it != pNewGcpList.end(); ++it)
 	{
-		(*it).mPixel.mX *= (x_out->text().toDouble() / pDesc1->getColumnCount());
-		(*it).mPixel.mY *= (y_out->text().toDouble() / pDesc1->getRowCount());
+		(*it).mPixel.mX = (*it).mPixel.mX * scaleX - outColumn;
+		(*it).mPixel.mY = (*it).mPixel.mY * scaleY - outRow;
 	}
 
 	//Create new GCP list for output RasterElement
@@ -655,19 +638,6 @@ bool Drizzle_GUI::PerformDrizzle(){
 	pDestDesc->setGeoreferenceDescriptor(pDesc1->getGeoreferenceDescriptor());
 	GeoreferenceDescriptor *pDestGeoDesc = pDestDesc->getGeoreferenceDescriptor();
 
-	//Create view
-	Service<DesktopServices> pDesktop;
-	SpatialDataWindow* pWindow = static_cast<SpatialDataWindow*>(pDesktop->createWindow(pResultCube->getName(), SPATIAL_DATA_WINDOW));
-	SpatialDataView* pView = (pWindow == NULL) ? NULL : pWindow->getSpatialDataView();
-
-	//Check whether creation of view was successfull
-	if (pView == NULL){
-		std::string msg = "Unable to create view.";
-		pStep->finalize(Message::Failure, msg);
-		pProgress->updateProgress(msg, 0, ERRORS);
-		return false;
-	}
-
 	//Georeference the output image using the Georeference Plugin
 	const std::string &plugInName = pDestGeoDesc->getGeoreferencePlugInName();
 	pStep->addProperty("PluginName", plugInName);
@@ -676,7 +646,6 @@ bool Drizzle_GUI::PerformDrizzle(){
 		PlugInArgList& argList = geoPlugIn->getInArgList();
 		argList.setPlugInArgValue(Executable::DataElementArg(), pResultCube.get());
 		argList.setPlugInArgValue(Executable::ProgressArg(), pProgress.get());
-		argList.setPlugInArgValueLoose(Executable::ViewArg(), pView);
 		if (geoPlugIn->execute() == false)
 		{
 			std::string message = "Could not georeference the data set.";
@@ -698,55 +667,150 @@ bool Drizzle_GUI::PerformDrizzle(){
 	}
 
 
-	bool overlapped = false;
-	int num_overlap_images;
-	double drop = dropsize->text().toDouble();
-	
-	//Set destination image to top left pixel.
-	pDestAcc->toPixel(0,0);
-	//Drizzle images onto destination image.
-	for (unsigned int row = 0; row < pDestDesc->getRowCount(); ++row){ 
-		pProgress->updateProgress("Calculating result", row * 100 / pDestDesc->getRowCount(), NORMAL);
-		if (!pDestAcc.isValid())
+	//Check which band of output rows has to be drizzled
+	unsigned int shardCount = shard_count->value();
+	unsigned int shardIndex = shard_index->value();
+	if (shardIndex >= shardCount)
+	{
+		pProgress->updateProgress("Row band must be smaller than the number of bands.", 100, ERRORS);
+		return false;
+	}
+
+	//Output grid, shared by all partial results drizzled onto the same output image
+	DrizzleGrid grid;
+	grid.rows = pDestDesc->getRowCount();
+	grid.columns = pDestDesc->getColumnCount();
+	grid.dataType = pDestDesc->getDataType();
+	grid.topLeft = pResultCube->convertPixelToGeocoord(LocationType(0,0));
+	grid.bottomLeft = pResultCube->convertPixelToGeocoord(LocationType(0,grid.rows));
+	grid.bottomRight = pResultCube->convertPixelToGeocoord(LocationType(grid.columns,grid.rows));
+	grid.topRight = pResultCube->convertPixelToGeocoord(LocationType(grid.columns,0));
+	grid.georeferencePlugIn = plugInName;
+	grid.gcps = pNewGcpList;
+
+	unsigned int startRow = static_cast<unsigned int>((static_cast<unsigned long long>(shardIndex) * grid.rows) / shardCount);
+	unsigned int endRow = static_cast<unsigned int>((static_cast<unsigned long long>(shardIndex + 1) * grid.rows) / shardCount);
+
+	//Base image is drizzled first
+	if (IncludeBase->isChecked())
+	{
+		images.insert(images.begin(), image1);
+	}
+
+	//Calibrated configuration, unless overridden for this run
+	DrizzleTuning tuning = DrizzleTuner::getTuning();
+	if (tile_size->value() > 0)
+	{
+		tuning.tileSize = tile_size->value();
+	}
+	if (kernel->currentIndex() > 0)
+	{
+		tuning.kernel = DrizzleTuner::toKernel(kernel->currentText().toStdString());
+	}
+
+	//Accumulation state is written to the partial result file, or to a temporary file
+	std::string stateFile = partial_file->text().toStdString();
+	if (stateFile.empty() && KeepState->isChecked())
+	{
+		stateFile = ImageDrizzleJob::getScratchFile(pResultCube->getName(), ".drzp");
+	}
+
+	//Overlap weights are recorded to apply the same geometry to other data sets
+	QString operatorFile;
+	if (GeometryOutput->isChecked())
+	{
+		operatorFile = QFileDialog::getSaveFileName(this, "Drizzle geometry", QString::fromStdString(pResultCube->getName()) + ".drzw", "Drizzle operators (*.drzw)");
+		if (operatorFile.isEmpty())
 		{
-			std::string msg = "Unable to access the cube data.";
-			pStep->finalize(Message::Failure, msg);
-			pProgress->updateProgress(msg, 0, ERRORS);
+			pStep->finalize(Message::Abort);
 			return false;
 		}
+	}
+
+	//Extra outputs are children of the output RasterElement
+	RasterElement* pWeight = NULL;
+	RasterElement* pCount = NULL;
+	if (WeightOutput->isChecked())
+	{
+		pWeight = RasterUtilities::createRasterElement(pResultCube->getName() + "_Weight", grid.rows, grid.columns, FLT8BYTES, true, pResultCube.get());
+	}
+	if (CountOutput->isChecked())
+	{
+		pCount = RasterUtilities::createRasterElement(pResultCube->getName() + "_Count", grid.rows, grid.columns, INT4UBYTES, true, pResultCube.get());
+	}
+	if ((WeightOutput->isChecked() && pWeight == NULL) || (CountOutput->isChecked() && pCount == NULL))
+	{
+		std::string msg = "A raster cube could not be created.";
+		pStep->finalize(Message::Failure, msg);
+		return false;
+	}
+
+	//Queue the drizzle in the job manager, the job creates the view when it has finished
+	ImageDrizzleJob* pJob = new ImageDrizzleJob(pResultCube.release(), newGCPList, pNewProgress.release(), grid, startRow, endRow - startRow,
+		images, dropsize->text().toDouble(), stateFile, tuning.tileSize, tuning.kernel);
+	pJob->setCoverageOutputs(pWeight, pCount);
+	pJob->setSigmaClip(sigma_clip->value());
+	if (!operatorFile.isEmpty())
+	{
+		pJob->setOperatorFile(operatorFile.toStdString());
+	}
 
-		for (unsigned int col = 0; col < pDestDesc->getColumnCount(); ++col)
+	//A sweep drizzles the other parameter sets in the same pass, one output per parameter set
+	if (!sweepDrops.empty())
+	{
+		std::vector<ImageDrizzleJob*> parts(1, pJob);
+		std::vector<std::string> labels(1, "Dropsize " + dropsize->text().toStdString() + ", " + x_out->text().toStdString() + "x" + y_out->text().toStdString());
+		for (size_t i = 0; i < sweepDrops.size(); ++i)
 		{
-			//Drizzle base image
-			switchOnEncoding(pDestDesc->getDataType(), Drizzle, pDestAcc->getColumn(), pDestAcc, pSrcAcc1, row, col, pDestDesc->getRowCount(), pDestDesc->getColumnCount(), drop, &overlapped);
-			num_overlap_images=1;
-			//Drizzle other images
-			for (int i=0; i<images.size();i++){
-				overlapped=false;
-				switchOnEncoding(pDestDesc->getDataType(), Drizzle, pDestAcc->getColumn(), pDestAcc, pSrcAcc[i], row, col, pDestDesc->getRowCount(), pDestDesc->getColumnCount(), drop, &overlapped);
-				if(overlapped) num_overlap_images++;
+			//Same area at another scale, a region keeps its share of the output
+			DrizzleGrid sweepGrid = grid.resize(static_cast<unsigned int>(grid.rows * (sweepRows[i] / y_out->text().toDouble()) + 0.5),
+				static_cast<unsigned int>(grid.columns * (sweepColumns[i] / x_out->text().toDouble()) + 0.5));
+			std::string label = "Dropsize " + QString::number(sweepDrops[i]).toStdString() + ", " + QString::number(sweepColumns[i]).toStdString() + "x" + QString::number(sweepRows[i]).toStdString();
+			std::string error;
+			GcpList* pSweepGcps = NULL;
+			RasterElement* pSweepResult = sweepGrid.createElement(image1->getName() + "_Drizzled (" + label + ")", pProgress.get(), &pSweepGcps, error);
+			if (pSweepResult == NULL)
+			{
+				for (std::vector<ImageDrizzleJob*>::iterator it = parts.begin(); it != parts.end(); ++it)
+				{
+					(*it)->complete(false, error);
+					delete *it;
+				}
+				pStep->finalize(Message::Failure, error);
+				return false;
 			}
-			//Divide output pixel by the number of input image overlapping with that particular pixel 
-			switchOnEncoding(pDestDesc->getDataType(), Divide, pDestAcc->getColumn(), num_overlap_images);
-			pDestAcc->nextColumn();
+
+			unsigned int sweepStart = static_cast<unsigned int>((static_cast<unsigned long long>(shardIndex) * sweepGrid.rows) / shardCount);
+			unsigned int sweepEnd = static_cast<unsigned int>((static_cast<unsigned long long>(shardIndex + 1) * sweepGrid.rows) / shardCount);
+			parts.push_back(new ImageDrizzleJob(pSweepResult, pSweepGcps, NULL, sweepGrid, sweepStart, sweepEnd - sweepStart,
+				images, sweepDrops[i], std::string(), tuning.tileSize, tuning.kernel));
+			parts.back()->setSigmaClip(sigma_clip->value());
+			labels.push_back(label);
 		}
-		pDestAcc->nextRow();
+
+		DrizzleJobManager::instance()->submit(new DrizzleSweepJob(parts, labels, new ProgressResource("ProgressBar")), QString::fromStdString(image1->getName() + " (sweep)"));
+		pStep->finalize();
+		DrizzleQueue_GUI::showQueue();
+		this->accept();
+		return true;
 	}
 
-	//Clear vectors
-	images.clear();
-	pDesc.clear();
-	pSrcAcc.clear();
-	pGcpLists.clear();
+	//A sweep is not checkpointed, its parts are drizzled in one pass and are only complete together
+	pJob->setCheckpoint(ImageDrizzleJob::getScratchFile(image1->getName(), ".drzc"));
 
-	//Output destination RasterElement
-	pView->setPrimaryRasterElement(pResultCube.get());
-	pView->createLayer(RASTER, pResultCube.get());
-	pView->createLayer(GCP_LAYER,newGCPList,"Corner Coordinates");
-	pResultCube.release();
+	//A coarse preview of the whole output is shown first, the full drizzle then refines it
+	std::string jobName = image1->getName();
+	if (Preview->isChecked() && shardCount == 1)
+	{
+		pJob = ImageDrizzleJob::createPreview(pJob, new ProgressResource("ProgressBar"), jobName);
+		jobName += " (preview)";
+	}
+	DrizzleJobManager::instance()->submit(pJob, QString::fromStdString(jobName));
 
 	pStep->finalize();
-	pProgress->updateProgress("Done", 100, NORMAL);
+
+	//The dialog is no longer needed, follow the job in the queue view
+	DrizzleQueue_GUI::showQueue();
 	this->accept();
 	return true;
-}
\ No newline at end of file
+}
@@ -13,13 +13,21 @@
 #ifndef Drizzle_GUI_H
 #define Drizzle_GUI_H
 
+#include <Qt/qcheckbox.h>
 #include <Qt/qdialog.h>
+#include <Qt/qgroupbox.h>
 #include <Qt/qpushbutton.h>
 #include <Qt/qmessagebox.h>
 #include <Qt/qcombobox.h>
 #include <Qt/qlabel.h>
 #include <Qt/qlineedit.h>
 #include <Qt/qlistwidget.h>
+#include <Qt/qspinbox.h>
+
+#include <string>
+#include <vector>
+
+class RasterElement;
 
 /**
 *
@@ -51,13 +59,19 @@ public slots:
 
 	/**
 	* Slot to perform the Drizzling. Performs necessary preliminary
-	* calculations for Drizzle function and calls it.
+	* calculations for Drizzle function and queues it in the DrizzleJobManager.
 	* Connected to 'Drizzle' button.
 	*
-	* @return True when Drizzling is successfull, false otherwise.
+	* @return True when Drizzling is queued successfully, false otherwise.
 	*/
 	bool PerformDrizzle();
 
+	/**
+	* Slot to select the partial result file via a file dialog.
+	* Connected to 'Browse' button.
+	*/
+	void browsePartial();
+
 	/**
 	* Slot to update the information of the first selected input image
 	* displayed on the image GUI.
@@ -70,6 +84,12 @@ public slots:
 	*/
 	void updateInfo2();
 
+	/**
+	* Slot to enable the pixel window only when it is selected as region.
+	* Connected to the region QComboBox.
+	*/
+	void updateRegion();
+
 private:
 	/**
 	* QLabel for base image.
@@ -154,11 +174,135 @@ private:
 	*/
 	QLineEdit *dropsize;
 
+	/**
+	* QGroupBox containing the options for distributed drizzling.
+	*/
+	QGroupBox *Distributed;
+
+	/**
+	* QCheckBox to select whether the base image is drizzled as well.
+	* Uncheck to drizzle a disjoint subset of inputs onto the same output grid.
+	*/
+	QCheckBox *IncludeBase;
+
+	/**
+	* QSpinBox to input the index of the band of output rows to drizzle.
+	*/
+	QSpinBox *shard_index;
+
+	/**
+	* QSpinBox to input the number of bands the output rows are split into.
+	*/
+	QSpinBox *shard_count;
+
+	/**
+	* QLineEdit to input the path of the partial result file.
+	* When empty no partial result is written.
+	*/
+	QLineEdit *partial_file;
+
+	/**
+	* QPushButton to select the partial result file.
+	* Connects to browsePartial() SLOT.
+	*/
+	QPushButton *BrowsePartial;
+
+	/**
+	* QGroupBox containing the options overriding the calibrated configuration.
+	*/
+	QGroupBox *Performance;
+
+	/**
+	* QSpinBox to input the tile size, 0 uses the calibrated tile size.
+	*/
+	QSpinBox *tile_size;
+
+	/**
+	* QComboBox to select the kernel variant: calibrated, clipping or separable.
+	*/
+	QComboBox *kernel;
+
+	/**
+	* QCheckBox to select whether a quick coarse preview is shown before the full drizzle.
+	*/
+	QCheckBox *Preview;
+
+	/**
+	* QLineEdit to input extra parameter sets drizzled in the same pass,
+	* as "dropsize width height" separated by semicolons.
+	*/
+	QLineEdit *sweep;
+
+	/**
+	* QDoubleSpinBox to input the sigma clipping threshold in standard deviations, 0 when clipping is off.
+	*/
+	QDoubleSpinBox *sigma_clip;
+
+	/**
+	* QGroupBox containing the region of the base image covered by the output image.
+	*/
+	QGroupBox *Region;
+
+	/**
+	* QComboBox to select the region: the whole base image, a pixel window or an AOI of the base image.
+	*/
+	QComboBox *region;
+
+	/**
+	* QSpinBox to input the first row of the pixel window on the base image.
+	*/
+	QSpinBox *roi_row;
+
+	/**
+	* QSpinBox to input the first column of the pixel window on the base image.
+	*/
+	QSpinBox *roi_column;
+
+	/**
+	* QSpinBox to input the number of rows of the pixel window on the base image.
+	*/
+	QSpinBox *roi_rows;
+
+	/**
+	* QSpinBox to input the number of columns of the pixel window on the base image.
+	*/
+	QSpinBox *roi_columns;
+
+	/**
+	* QGroupBox containing the optional extra outputs.
+	*/
+	QGroupBox *Outputs;
+
+	/**
+	* QCheckBox to select whether the weight (coverage) map is output.
+	*/
+	QCheckBox *WeightOutput;
+
+	/**
+	* QCheckBox to select whether the number of contributing input images is output.
+	*/
+	QCheckBox *CountOutput;
+
+	/**
+	* QCheckBox to select whether the accumulation state is kept, so inputs can be added later on.
+	*/
+	QCheckBox *KeepState;
+
+	/**
+	* QCheckBox to select whether the inputs are added to the base image, an earlier result with a kept accumulation state.
+	*/
+	QCheckBox *AddToResult;
+
+	/**
+	* QCheckBox to select whether the drizzle geometry is exported as an operator file, to apply it to other data sets.
+	*/
+	QCheckBox *GeometryOutput;
+
 	/**
 	* vector containing all open RasterElements.
 	*/
 	std::vector<std::string> RasterElements;
-	
+
 	/**
 	* Initialisations needed for image GUI:
 	* Connects buttons to SLOTS.
@@ -167,5 +311,23 @@ private:
 	*/
 	void init();
 
+	/**
+	* Lists the AOIs of the base image as regions and limits the pixel window to its size.
+	*/
+	void updateRegions();
+
+	/**
+	* Returns the selected region of the base image.
+	*
+	* @param pImage Base image.
+	* @param firstRow Holds the first row of the region.
+	* @param firstColumn Holds the first column of the region.
+	* @param rows Holds the number of rows of the region.
+	* @param columns Holds the number of columns of the region.
+	* @param error String which will hold the error message on failure.
+	* @return True when successfull, false when the region is empty or outside the base image.
+	*/
+	bool getRegion(RasterElement* pImage, unsigned int& firstRow, unsigned int& firstColumn, unsigned int& rows, unsigned int& columns, std::string& error);
+
 };
 #endif
\ No newline at end of file
@@ -1,7 +1,7 @@
 /****************************************************************************
 ** Meta object code from reading C++ file 'Drizzle.h'
 **
-** Created: Thu 20. Aug 17:56:31 2015
+** Created: Mon 19. Oct 10:42:17 2026
 **      by: The Qt Meta Object Compiler version 62 (Qt 4.7.1)
 **
 ** WARNING! All changes made in this file will be lost!
@@ -23,7 +23,7 @@ static const uint qt_meta_data_Drizzle[] = {
        5,       // revision
        0,       // classname
        0,    0, // classinfo
-       3,   14, // methods
+       8,   14, // methods
        0,    0, // properties
        0,    0, // enums/sets
        0,    0, // constructors
@@ -34,13 +34,19 @@ static const uint qt_meta_data_Drizzle[] = {
        9,    8,    8,    8, 0x0a,
       24,    8,    8,    8, 0x0a,
       35,    8,    8,    8, 0x0a,
+      46,    8,    8,    8, 0x0a,
+      57,    8,    8,    8, 0x0a,
+      71,    8,    8,    8, 0x0a,
+      82,    8,    8,    8, 0x0a,
+      92,    8,    8,    8, 0x0a,
 
        0        // eod
 };
 
 static const char qt_meta_stringdata_Drizzle[] = {
     "Drizzle\0\0closemainGUI()\0imageGUI()\0"
-    "videoGUI()\0"
+    "videoGUI()\0mergeGUI()\0operatorGUI()\0"
+    "queueGUI()\0tuneGUI()\0resumeGUI()\0"
 };
 
 const QMetaObject Drizzle::staticMetaObject = {
@@ -77,9 +83,14 @@ int Drizzle::qt_metacall(QMetaObject::Call _c, int _id, void **_a)
         case 0: closemainGUI(); break;
         case 1: imageGUI(); break;
         case 2: videoGUI(); break;
+        case 3: mergeGUI(); break;
+        case 4: operatorGUI(); break;
+        case 5: queueGUI(); break;
+        case 6: tuneGUI(); break;
+        case 7: resumeGUI(); break;
         default: ;
         }
-        _id -= 3;
+        _id -= 8;
     }
     return _id;
 }
@@ -0,0 +1,112 @@
+/****************************************************************************
+** Meta object code from reading C++ file 'DrizzleJobManager.h'
+**
+** Created: Mon 19. Oct 10:42:17 2026
+**      by: The Qt Meta Object Compiler version 62 (Qt 4.7.1)
+**
+** WARNING! All changes made in this file will be lost!
+*****************************************************************************/
+
+#include "../../../application/PlugIns/src/Drizzle/DrizzleJobManager.h"
+#if !defined(Q_MOC_OUTPUT_REVISION)
+#error "The header file 'DrizzleJobManager.h' doesn't include <QObject>."
+#elif Q_MOC_OUTPUT_REVISION != 62
+#error "This file was generated using the moc from 4.7.1. It"
+#error "cannot be used with the include files from this version of Qt."
+#error "(The moc has changed too much.)"
+#endif
+
+QT_BEGIN_MOC_NAMESPACE
+static const uint qt_meta_data_DrizzleJobManager[] = {
+
+ // content:
+       5,       // revision
+       0,       // classname
+       0,    0, // classinfo
+       5,   14, // methods
+       0,    0, // properties
+       0,    0, // enums/sets
+       0,    0, // constructors
+       0,       // flags
+       3,       // signalCount
+
+ // signals: signature, parameters, type, tag, flags
+      19,   18,   18,   18, 0x06,
+      44,   33,   18,   18, 0x06,
+      82,   65,   18,   18, 0x06,
+
+ // slots: signature, parameters, type, tag, flags
+     112,   18,   18,   18, 0x08,
+     130,  127,   18,   18, 0x08,
+
+       0        // eod
+};
+
+static const char qt_meta_stringdata_DrizzleJobManager[] = {
+    "DrizzleJobManager\0\0jobsChanged()\0"
+    "id,percent\0jobProgress(int,int)\0"
+    "id,success,error\0jobFinished(int,bool,QString)\0"
+    "pollProgress()\0id\0taskFinished(int)\0"
+};
+
+const QMetaObject DrizzleJobManager::staticMetaObject = {
+    { &QObject::staticMetaObject, qt_meta_stringdata_DrizzleJobManager,
+      qt_meta_data_DrizzleJobManager, 0 }
+};
+
+#ifdef Q_NO_DATA_RELOCATION
+const QMetaObject &DrizzleJobManager::getStaticMetaObject() { return staticMetaObject; }
+#endif //Q_NO_DATA_RELOCATION
+
+const QMetaObject *DrizzleJobManager::metaObject() const
+{
+    return QObject::d_ptr->metaObject ? QObject::d_ptr->metaObject : &staticMetaObject;
+}
+
+void *DrizzleJobManager::qt_metacast(const char *_clname)
+{
+    if (!_clname) return 0;
+    if (!strcmp(_clname, qt_meta_stringdata_DrizzleJobManager))
+        return static_cast<void*>(const_cast< DrizzleJobManager*>(this));
+    return QObject::qt_metacast(_clname);
+}
+
+int DrizzleJobManager::qt_metacall(QMetaObject::Call _c, int _id, void **_a)
+{
+    _id = QObject::qt_metacall(_c, _id, _a);
+    if (_id < 0)
+        return _id;
+    if (_c == QMetaObject::InvokeMetaMethod) {
+        switch (_id) {
+        case 0: jobsChanged(); break;
+        case 1: jobProgress((*reinterpret_cast< int(*)>(_a[1])),(*reinterpret_cast< int(*)>(_a[2]))); break;
+        case 2: jobFinished((*reinterpret_cast< int(*)>(_a[1])),(*reinterpret_cast< bool(*)>(_a[2])),(*reinterpret_cast< const QString(*)>(_a[3]))); break;
+        case 3: pollProgress(); break;
+        case 4: taskFinished((*reinterpret_cast< int(*)>(_a[1]))); break;
+        default: ;
+        }
+        _id -= 5;
+    }
+    return _id;
+}
+
+// SIGNAL 0
+void DrizzleJobManager::jobsChanged()
+{
+    QMetaObject::activate(this, &staticMetaObject, 0, 0);
+}
+
+// SIGNAL 1
+void DrizzleJobManager::jobProgress(int _t1, int _t2)
+{
+    void *_a[] = { 0, const_cast<void*>(reinterpret_cast<const void*>(&_t1)), const_cast<void*>(reinterpret_cast<const void*>(&_t2)) };
+    QMetaObject::activate(this, &staticMetaObject, 1, _a);
+}
+
+// SIGNAL 2
+void DrizzleJobManager::jobFinished(int _t1, bool _t2, const QString & _t3)
+{
+    void *_a[] = { 0, const_cast<void*>(reinterpret_cast<const void*>(&_t1)), const_cast<void*>(reinterpret_cast<const void*>(&_t2)), const_cast<void*>(reinterpret_cast<const void*>(&_t3)) };
+    QMetaObject::activate(this, &staticMetaObject, 2, _a);
+}
+QT_END_MOC_NAMESPACE
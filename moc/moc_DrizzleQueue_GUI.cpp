@@ -0,0 +1,86 @@
+/****************************************************************************
+** Meta object code from reading C++ file 'DrizzleQueue_GUI.h'
+**
+** Created: Mon 19. Oct 10:42:17 2026
+**      by: The Qt Meta Object Compiler version 62 (Qt 4.7.1)
+**
+** WARNING! All changes made in this file will be lost!
+*****************************************************************************/
+
+#include "../../../application/PlugIns/src/Drizzle/DrizzleQueue_GUI.h"
+#if !defined(Q_MOC_OUTPUT_REVISION)
+#error "The header file 'DrizzleQueue_GUI.h' doesn't include <QObject>."
+#elif Q_MOC_OUTPUT_REVISION != 62
+#error "This file was generated using the moc from 4.7.1. It"
+#error "cannot be used with the include files from this version of Qt."
+#error "(The moc has changed too much.)"
+#endif
+
+QT_BEGIN_MOC_NAMESPACE
+static const uint qt_meta_data_DrizzleQueue_GUI[] = {
+
+ // content:
+       5,       // revision
+       0,       // classname
+       0,    0, // classinfo
+       4,   14, // methods
+       0,    0, // properties
+       0,    0, // enums/sets
+       0,    0, // constructors
+       0,       // flags
+       0,       // signalCount
+
+ // slots: signature, parameters, type, tag, flags
+      18,   17,   17,   17, 0x0a,
+      31,   17,   17,   17, 0x0a,
+      43,   17,   17,   17, 0x0a,
+      55,   17,   17,   17, 0x0a,
+
+       0        // eod
+};
+
+static const char qt_meta_stringdata_DrizzleQueue_GUI[] = {
+    "DrizzleQueue_GUI\0\0updateJobs()\0"
+    "abortJobs()\0clearJobs()\0updateBudgets()\0"
+};
+
+const QMetaObject DrizzleQueue_GUI::staticMetaObject = {
+    { &QDialog::staticMetaObject, qt_meta_stringdata_DrizzleQueue_GUI,
+      qt_meta_data_DrizzleQueue_GUI, 0 }
+};
+
+#ifdef Q_NO_DATA_RELOCATION
+const QMetaObject &DrizzleQueue_GUI::getStaticMetaObject() { return staticMetaObject; }
+#endif //Q_NO_DATA_RELOCATION
+
+const QMetaObject *DrizzleQueue_GUI::metaObject() const
+{
+    return QObject::d_ptr->metaObject ? QObject::d_ptr->metaObject : &staticMetaObject;
+}
+
+void *DrizzleQueue_GUI::qt_metacast(const char *_clname)
+{
+    if (!_clname) return 0;
+    if (!strcmp(_clname, qt_meta_stringdata_DrizzleQueue_GUI))
+        return static_cast<void*>(const_cast< DrizzleQueue_GUI*>(this));
+    return QDialog::qt_metacast(_clname);
+}
+
+int DrizzleQueue_GUI::qt_metacall(QMetaObject::Call _c, int _id, void **_a)
+{
+    _id = QDialog::qt_metacall(_c, _id, _a);
+    if (_id < 0)
+        return _id;
+    if (_c == QMetaObject::InvokeMetaMethod) {
+        switch (_id) {
+        case 0: updateJobs(); break;
+        case 1: abortJobs(); break;
+        case 2: clearJobs(); break;
+        case 3: updateBudgets(); break;
+        default: ;
+        }
+        _id -= 4;
+    }
+    return _id;
+}
+QT_END_MOC_NAMESPACE
@@ -1,7 +1,7 @@
 /****************************************************************************
 ** Meta object code from reading C++ file 'DrizzleVideo_GUI.h'
 **
-** Created: Thu 20. Aug 18:14:21 2015
+** Created: Mon 19. Oct 10:42:17 2026
 **      by: The Qt Meta Object Compiler version 62 (Qt 4.7.1)
 **
 ** WARNING! All changes made in this file will be lost!
@@ -23,7 +23,7 @@ static const uint qt_meta_data_DrizzleVideo_GUI[] = {
        5,       // revision
        0,       // classname
        0,    0, // classinfo
-       4,   14, // methods
+       6,   14, // methods
        0,    0, // properties
        0,    0, // enums/sets
        0,    0, // constructors
@@ -32,16 +32,19 @@ static const uint qt_meta_data_DrizzleVideo_GUI[] = {
 
  // slots: signature, parameters, type, tag, flags
       18,   17,   17,   17, 0x0a,
-      34,   17,   29,   17, 0x0a,
-      51,   17,   17,   17, 0x0a,
-      60,   17,   17,   17, 0x0a,
+      29,   17,   17,   17, 0x0a,
+      49,   17,   44,   17, 0x0a,
+      66,   17,   17,   17, 0x0a,
+      75,   17,   17,   17, 0x0a,
+      88,   17,   17,   17, 0x0a,
 
        0        // eod
 };
 
 static const char qt_meta_stringdata_DrizzleVideo_GUI[] = {
-    "DrizzleVideo_GUI\0\0closeGUI()\0bool\0"
-    "PerformDrizzle()\0browse()\0updateInfo()\0"
+    "DrizzleVideo_GUI\0\0closeGUI()\0"
+    "abortDrizzle()\0bool\0PerformDrizzle()\0"
+    "browse()\0updateInfo()\0benchmarkRegistration()\0"
 };
 
 const QMetaObject DrizzleVideo_GUI::staticMetaObject = {
@@ -74,13 +77,15 @@ int DrizzleVideo_GUI::qt_metacall(QMetaObject::Call _c, int _id, void **_a)
     if (_c == QMetaObject::InvokeMetaMethod) {
         switch (_id) {
         case 0: closeGUI(); break;
-        case 1: { bool _r = PerformDrizzle();
+        case 1: abortDrizzle(); break;
+        case 2: { bool _r = PerformDrizzle();
             if (_a[0]) *reinterpret_cast< bool*>(_a[0]) = _r; }  break;
-        case 2: browse(); break;
-        case 3: updateInfo(); break;
+        case 3: browse(); break;
+        case 4: updateInfo(); break;
+        case 5: benchmarkRegistration(); break;
         default: ;
         }
-        _id -= 4;
+        _id -= 6;
     }
     return _id;
 }
@@ -1,7 +1,7 @@
 /****************************************************************************
 ** Meta object code from reading C++ file 'Drizzle_GUI.h'
 **
-** Created: Thu 20. Aug 17:56:31 2015
+** Created: Mon 19. Oct 10:42:17 2026
 **      by: The Qt Meta Object Compiler version 62 (Qt 4.7.1)
 **
 ** WARNING! All changes made in this file will be lost!
@@ -23,7 +23,7 @@ static const uint qt_meta_data_Drizzle_GUI[] = {
        5,       // revision
        0,       // classname
        0,    0, // classinfo
-       4,   14, // methods
+       6,   14, // methods
        0,    0, // properties
        0,    0, // enums/sets
        0,    0, // constructors
@@ -34,15 +34,17 @@ static const uint qt_meta_data_Drizzle_GUI[] = {
       13,   12,   12,   12, 0x0a,
       29,   12,   24,   12, 0x0a,
       46,   12,   12,   12, 0x0a,
-      60,   12,   12,   12, 0x0a,
+      62,   12,   12,   12, 0x0a,
+      76,   12,   12,   12, 0x0a,
+      90,   12,   12,   12, 0x0a,
 
        0        // eod
 };
 
 static const char qt_meta_stringdata_Drizzle_GUI[] = {
     "Drizzle_GUI\0\0closeGUI()\0bool\0"
-    "PerformDrizzle()\0updateInfo1()\0"
-    "updateInfo2()\0"
+    "PerformDrizzle()\0browsePartial()\0"
+    "updateInfo1()\0updateInfo2()\0updateRegion()\0"
 };
 
 const QMetaObject Drizzle_GUI::staticMetaObject = {
@@ -77,11 +79,13 @@ int Drizzle_GUI::qt_metacall(QMetaObject::Call _c, int _id, void **_a)
         case 0: closeGUI(); break;
         case 1: { bool _r = PerformDrizzle();
             if (_a[0]) *reinterpret_cast< bool*>(_a[0]) = _r; }  break;
-        case 2: updateInfo1(); break;
-        case 3: updateInfo2(); break;
+        case 2: browsePartial(); break;
+        case 3: updateInfo1(); break;
+        case 4: updateInfo2(); break;
+        case 5: updateRegion(); break;
         default: ;
         }
-        _id -= 4;
+        _id -= 6;
     }
     return _id;
 }